@@ -0,0 +1,31 @@
+# Measures objects allocated per event by Query#each.
+#
+#   $ ridk exec bundle exec ruby benchmark/allocations.rb [channel] [max_events]
+require 'winevt'
+
+channel = ARGV[0] || "Application"
+max_events = (ARGV[1] || 1000).to_i
+
+[
+  ["xml", {render_as_xml: true}],
+  ["hash", {render_as_xml: false}],
+  ["hash (symbolize_keys)", {render_as_xml: false, symbolize_keys: true}],
+].each do |label, options|
+  query = Winevt::EventLog::Query.new(channel, "*")
+  options.each do |name, value|
+    query.__send__("#{name}=", value)
+  end
+  count = 0
+  GC.start
+  GC.disable
+  before = GC.stat(:total_allocated_objects)
+  query.each do |eventlog, message, string_inserts|
+    count += 1
+    break if count >= max_events
+  end
+  allocated = GC.stat(:total_allocated_objects) - before
+  GC.enable
+  query.close
+  printf("%-24s events: %6d  %8.1f objects/event\n",
+         label, count, allocated.to_f / count)
+end
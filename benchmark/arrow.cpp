@@ -0,0 +1,105 @@
+// Measures writing record batches of events with winevt_arrow.h, which
+// test/native/test_arrow.cpp checks. This does not need Windows:
+//
+//   $ c++ -O2 -std=c++11 -Iext/winevt benchmark/arrow.cpp -o arrow
+//   $ ./arrow [events]
+//
+// The stream can be checked with pyarrow, too:
+//
+//   $ ./arrow 1000 events.arrow
+//   $ python3 -c 'import pyarrow.ipc as i; print(i.open_stream("events.arrow").read_all())'
+#include <winevt_arrow.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+static std::vector<WinevtArrowColumn>
+event_columns()
+{
+  std::vector<WinevtArrowColumn> columns;
+
+  columns.push_back(WinevtArrowColumn("ProviderName", WINEVT_ARROW_UTF8));
+  columns.push_back(WinevtArrowColumn("EventID", WINEVT_ARROW_UINT32));
+  columns.push_back(WinevtArrowColumn("Level", WINEVT_ARROW_UINT8));
+  columns.push_back(WinevtArrowColumn("Task", WINEVT_ARROW_UINT16));
+  columns.push_back(WinevtArrowColumn("Keywords", WINEVT_ARROW_UINT64));
+  columns.push_back(WinevtArrowColumn("TimeCreated", WINEVT_ARROW_TIMESTAMP));
+  columns.push_back(WinevtArrowColumn("Computer", WINEVT_ARROW_UTF8));
+  columns.push_back(WinevtArrowColumn("Message", WINEVT_ARROW_UTF8));
+  columns.push_back(WinevtArrowColumn("StringInserts", WINEVT_ARROW_UTF8_LIST));
+
+  return columns;
+}
+
+static void
+append_event(std::vector<WinevtArrowColumn>& columns, uint64_t i)
+{
+  char message[128];
+
+  columns[0].appendString("Microsoft-Windows-Security-Auditing", 35);
+  columns[1].appendInteger(4624 + i % 8);
+  columns[2].appendInteger(i % 5);
+  if (i % 3 == 0) {
+    columns[3].appendNull();
+  } else {
+    columns[3].appendInteger(12544);
+  }
+  columns[4].appendInteger(0x8020000000000000ULL);
+  columns[5].appendInteger(1704067200000000000ULL + i * 1000);
+  columns[6].appendString("WIN-HOST.example.com", 20);
+  int length = snprintf(message, sizeof(message), "An account was successfully logged on. %llu",
+                        static_cast<unsigned long long>(i));
+  columns[7].appendString(message, static_cast<size_t>(length));
+  for (uint64_t j = 0; j < i % 4; j++) {
+    columns[8].item().appendString("S-1-5-18", 8);
+  }
+  columns[8].endList();
+}
+
+int
+main(int argc, char** argv)
+{
+  int events = argc > 1 ? atoi(argv[1]) : 1000000;
+  std::vector<WinevtArrowColumn> columns = event_columns();
+  std::string stream;
+  size_t written = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  WinevtArrowWriter::writeSchema(columns, stream);
+  for (int i = 0; i < events; i++) {
+    append_event(columns, static_cast<uint64_t>(i));
+    if (columns[0].length() == 1024 || i == events - 1) {
+      WinevtArrowWriter::writeRecordBatch(columns, stream);
+      for (WinevtArrowColumn& column : columns) {
+        column.clear();
+      }
+      if (argc > 2) {
+        continue;
+      }
+      written += stream.size();
+      stream.clear();
+    }
+  }
+  WinevtArrowWriter::writeEndOfStream(stream);
+  written += stream.size();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  printf("%d events in batches of 1024: %.1f ns/event, %.1f MB/s\n",
+         events,
+         elapsed.count() * 1e9 / events,
+         written / elapsed.count() / 1e6);
+
+  if (argc > 2) {
+    FILE* file = fopen(argv[2], "wb");
+    if (file == nullptr || fwrite(stream.data(), 1, stream.size(), file) != stream.size()) {
+      perror(argv[2]);
+      return EXIT_FAILURE;
+    }
+    fclose(file);
+  }
+
+  return EXIT_SUCCESS;
+}
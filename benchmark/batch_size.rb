@@ -0,0 +1,23 @@
+# Measures Query#each throughput against Query#batch_size.
+#
+#   $ ridk exec bundle exec ruby benchmark/batch_size.rb [channel] [max_events]
+require 'benchmark'
+require 'winevt'
+
+channel = ARGV[0] || "Application"
+max_events = (ARGV[1] || 10000).to_i
+
+[1, 10, 64, 256, 1024].each do |batch_size|
+  query = Winevt::EventLog::Query.new(channel, "*")
+  query.batch_size = batch_size
+  count = 0
+  elapsed = Benchmark.realtime do
+    query.each do |xml, message, string_inserts|
+      count += 1
+      break if count >= max_events
+    end
+  end
+  query.close
+  printf("batch_size: %4d  events: %6d  %10.1f events/s\n",
+         batch_size, count, count / elapsed)
+end
@@ -0,0 +1,56 @@
+// Measures the throughput of winevt_crc32, which
+// test/native/test_crc32.cpp checks. This does not need Windows:
+//
+//   $ c++ -O2 -std=c++11 -Iext/winevt benchmark/crc32.cpp -o crc32
+//   $ ./crc32 [megabytes]
+#include <winevt_crc32.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+template<typename Function>
+static void
+run_benchmark(const char* name, const std::vector<uint8_t>& data, int iterations, Function crc)
+{
+  uint32_t checksum = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    checksum += crc(data.data(), data.size());
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  double megabytes = (double)data.size() * iterations / (1024 * 1024);
+  printf("%-12s %10.1f MB/s (checksum %08x)\n", name, megabytes / elapsed.count(), checksum);
+}
+
+int
+main(int argc, char** argv)
+{
+  size_t megabytes = argc > 1 ? strtoul(argv[1], nullptr, 10) : 64;
+  std::vector<uint8_t> data(megabytes * 1024 * 1024);
+  std::mt19937 rng(1);
+
+  for (uint8_t& byte : data) {
+    byte = static_cast<uint8_t>(rng());
+  }
+
+  run_benchmark("bytewise", data, 2, [](const uint8_t* p, size_t len) {
+    return ~winevt_crc32_bytes(0xffffffff, p, len);
+  });
+  run_benchmark("slicing-by-8", data, 5, [](const uint8_t* p, size_t len) {
+    return ~winevt_crc32_slicing_by_8(0xffffffff, p, len);
+  });
+#ifdef WINEVT_CRC32_PCLMUL
+  if (winevt_cpu_has(WINEVT_CPU_PCLMUL | WINEVT_CPU_SSE4_1)) {
+    run_benchmark("pclmul", data, 20, [](const uint8_t* p, size_t len) {
+      return winevt_crc32(0, p, len);
+    });
+  }
+#endif /* WINEVT_CRC32_PCLMUL */
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,134 @@
+// Measures how fast EVTX records are decoded without Ruby, with and
+// without the template cache, and how much each checksum mode costs.
+// This does not need Windows:
+//
+//   $ ruby -r./test/evtx_writer -e 'EvtxWriter.generate("sample.evtx", 200_000)'
+//   $ c++ -O2 -std=c++11 -Iext/winevt benchmark/evtx_decode.cpp ext/winevt/winevt_evtx.cpp -o evtx_decode
+//   $ ./evtx_decode sample.evtx
+//
+// Checksums are verified with carry-less multiplication when the CPU
+// has PCLMULQDQ and SSE4.1, or with slicing-by-8 otherwise.
+#include <winevt_evtx.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+// Counts events so that nothing is optimized away.
+class CountingVisitor : public EvtxVisitor
+{
+public:
+  CountingVisitor()
+    : events(0)
+  {
+  }
+
+  void startElement(const EvtxName&) { events++; }
+  void attribute(const EvtxName&) { events++; }
+  void closeStartElement(bool) { events++; }
+  void endElement() { events++; }
+  void content(const EvtxValue&) { events++; }
+  void entityReference(const EvtxName&) { events++; }
+
+  size_t events;
+};
+
+enum Output
+{
+  // Only read the chunks
+  OUTPUT_NONE,
+  OUTPUT_EVENTS,
+  OUTPUT_XML,
+  OUTPUT_VALUES,
+};
+
+static void
+run(const char* path, Output output, bool useCache, EvtxChecksumMode mode = EVTX_CHECKSUM_SKIP)
+{
+  static const char* const outputNames[] = { "none", "events", "xml", "values" };
+  static const char* const modeNames[] = { "strict", "warn", "skip" };
+  EvtxFile file;
+  EvtxTemplateCache cache;
+  std::vector<EvtxRecord> records;
+  std::string xml;
+  std::vector<EvtxValue> inserts;
+  size_t count = 0, chunks = 0, checksum = 0;
+
+  file.open(path);
+  file.setChecksumMode(mode);
+  auto start = std::chrono::steady_clock::now();
+  while (file.nextChunk()) {
+    EvtxChunk chunk = file.chunk();
+    records.clear();
+    chunk.records(records);
+    chunks++;
+    for (const EvtxRecord& record : records) {
+      switch (output) {
+        case OUTPUT_NONE:
+          checksum += record.dataSize;
+          break;
+        case OUTPUT_EVENTS: {
+          CountingVisitor visitor;
+          chunk.render(record, visitor, useCache ? &cache : nullptr);
+          checksum += visitor.events;
+          break;
+        }
+        case OUTPUT_XML: {
+          xml.clear();
+          EvtxXmlWriter writer(xml);
+          chunk.render(record, writer, useCache ? &cache : nullptr);
+          checksum += xml.size();
+          break;
+        }
+        case OUTPUT_VALUES: {
+          EvtxSystemValues system;
+          inserts.clear();
+          EvtxValueCollector collector(&system, &inserts);
+          chunk.render(record, collector, useCache ? &cache : nullptr);
+          checksum += inserts.size();
+          break;
+        }
+      }
+      count++;
+    }
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  printf("%-7s cache: %-5s  checksum: %-6s  records: %8lu  %12.1f records/s  %8.1f MB/s  (checksum %lu, hit rate %.3f)\n",
+         outputNames[output],
+         useCache ? "true" : "false",
+         modeNames[mode],
+         (unsigned long)count,
+         count / elapsed.count(),
+         chunks * (double)EVTX_CHUNK_SIZE / elapsed.count() / (1024 * 1024),
+         (unsigned long)checksum,
+         cache.hits() + cache.misses() > 0
+           ? (double)cache.hits() / (cache.hits() + cache.misses())
+           : 0.0);
+}
+
+int
+main(int argc, char** argv)
+{
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s path.evtx\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  try {
+    for (Output output : { OUTPUT_EVENTS, OUTPUT_XML, OUTPUT_VALUES }) {
+      run(argv[1], output, false);
+      run(argv[1], output, true);
+    }
+    for (Output output : { OUTPUT_NONE, OUTPUT_VALUES }) {
+      for (EvtxChecksumMode mode : { EVTX_CHECKSUM_STRICT, EVTX_CHECKSUM_WARN, EVTX_CHECKSUM_SKIP }) {
+        run(argv[1], output, true, mode);
+      }
+    }
+  } catch (const EvtxError& e) {
+    fprintf(stderr, "%s\n", e.what());
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,47 @@
+# Measures EventLog::File#each throughput with buffered reads and with
+# mmap. This does not need Windows. Without arguments, a sample file is
+# generated. The resident set size is shown on Linux.
+#
+#   $ bundle exec rake compile
+#   $ bundle exec ruby -Ilib benchmark/evtx_file.rb [path.evtx ...]
+require 'benchmark'
+require 'rbconfig'
+require 'tmpdir'
+require 'winevt'
+
+def rss_megabytes
+  status = File.read("/proc/self/status") rescue nil
+  return Float::NAN unless status
+  status[/^VmRSS:\s+(\d+)/, 1].to_i / 1024.0
+end
+
+def run(path)
+  size = File.size(path)
+  [false, true].product([true, false]).each do |mmap, render_as_xml|
+    file = Winevt::EventLog::File.new(path, mmap)
+    file.render_as_xml = render_as_xml
+    count = 0
+    elapsed = Benchmark.realtime do
+      file.each do |event, message, string_inserts|
+        count += 1
+      end
+    end
+    file.close
+    printf("%-20s mmap: %-5s  render_as_xml: %-5s  events: %7d  %10.1f events/s  %8.1f MB/s  RSS: %6.1f MB\n",
+           File.basename(path), mmap, render_as_xml, count, count / elapsed,
+           size / elapsed / (1024 * 1024), rss_megabytes)
+  end
+end
+
+if ARGV.empty?
+  Dir.mktmpdir("winevt") do |dir|
+    path = File.join(dir, "sample.evtx")
+    # Generate the file in another process so that it does not affect RSS.
+    writer = File.expand_path('../test/evtx_writer', __dir__)
+    system(RbConfig.ruby, "-r#{writer}", "-e", "EvtxWriter.generate(ARGV[0], 200_000)", path,
+           exception: true)
+    run(path)
+  end
+else
+  ARGV.each { |path| run(path) }
+end
@@ -0,0 +1,63 @@
+# Compares hashes decoded straight from binary XML with
+# EventLog::File#include_event_data against rendering XML and parsing
+# it with REXML, which is what users of render_as_xml do today. This
+# does not need Windows. Without arguments, a sample file is generated.
+#
+#   $ bundle exec rake compile
+#   $ bundle exec ruby -Ilib benchmark/evtx_hash.rb [path.evtx] [max_events]
+require 'benchmark'
+require 'rexml/document'
+require 'tmpdir'
+require 'winevt'
+require_relative '../test/evtx_writer'
+
+# Builds the same shape as include_event_data from XML.
+def parse_xml(xml)
+  document = REXML::Document.new(xml)
+  hash = {}
+  document.elements.each("Event/System/*") do |element|
+    if element.attributes.empty?
+      hash[element.name] = element.text
+    else
+      element.attributes.each { |name, value| hash[name] = value }
+    end
+  end
+  event_data = {}
+  document.elements.each("Event/EventData/Data") do |element|
+    event_data[element.attributes["Name"]] = element.text
+  end
+  hash["EventData"] = event_data
+  hash
+end
+
+def run(path, max_events)
+  results = {}
+  [:xml_rexml, :hash].each do |mode|
+    file = Winevt::EventLog::File.new(path)
+    file.render_as_xml = mode == :xml_rexml
+    file.include_event_data = true
+    count = 0
+    elapsed = Benchmark.realtime do
+      file.each do |event, _, _|
+        event = parse_xml(event) if mode == :xml_rexml
+        count += 1
+        break if count >= max_events
+      end
+    end
+    file.close
+    results[mode] = count / elapsed
+    printf("%-10s  events: %7d  %10.1f events/s\n", mode, count, results[mode])
+  end
+  printf("speedup: %.1fx\n", results[:hash] / results[:xml_rexml])
+end
+
+max_events = (ARGV[1] || 20_000).to_i
+if ARGV[0].nil? || ARGV[0].empty?
+  Dir.mktmpdir("winevt") do |dir|
+    path = File.join(dir, "sample.evtx")
+    EvtxWriter.generate(path, max_events)
+    run(path, max_events)
+  end
+else
+  run(ARGV[0], max_events)
+end
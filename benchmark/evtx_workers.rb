@@ -0,0 +1,47 @@
+# Measures EventLog::File#each throughput against the number of
+# workers which decode chunks. This does not need Windows. Without
+# arguments, a sample file is generated.
+#
+#   $ bundle exec rake compile
+#   $ bundle exec ruby -Ilib benchmark/evtx_workers.rb [path.evtx|""] [max_workers]
+require 'benchmark'
+require 'etc'
+require 'rbconfig'
+require 'tmpdir'
+require 'winevt'
+
+def run(path, max_workers)
+  workers = [1]
+  workers << workers.last * 2 while workers.last * 2 <= max_workers
+  workers << max_workers unless workers.include?(max_workers)
+
+  workers.product([true, false], [true, false]).each do |worker_count, render_as_xml, ordered|
+    next if worker_count == 1 && !ordered
+    file = Winevt::EventLog::File.new(path)
+    file.workers = worker_count
+    file.ordered = ordered
+    file.render_as_xml = render_as_xml
+    count = 0
+    elapsed = Benchmark.realtime do
+      file.each do |event, message, string_inserts|
+        count += 1
+      end
+    end
+    file.close
+    printf("workers: %3d  ordered: %-5s  render_as_xml: %-5s  events: %7d  %10.1f events/s\n",
+           worker_count, ordered, render_as_xml, count, count / elapsed)
+  end
+end
+
+max_workers = (ARGV[1] || Etc.nprocessors).to_i
+if ARGV[0] && !ARGV[0].empty?
+  run(ARGV[0], max_workers)
+else
+  Dir.mktmpdir("winevt") do |dir|
+    path = File.join(dir, "sample.evtx")
+    writer = File.expand_path('../test/evtx_writer', __dir__)
+    system(RbConfig.ruby, "-r#{writer}", "-e", "EvtxWriter.generate(ARGV[0], 200_000)", path,
+           exception: true)
+    run(path, max_workers)
+  end
+end
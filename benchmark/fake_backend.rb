@@ -0,0 +1,74 @@
+# Measures Query#each, Subscribe#each, #each_batch, #write_arrow and #write_json
+# throughput against the in-memory fake backend, so that the rendering code
+# can be profiled without Windows or the Event Log service. "msgpack" rows yield
+# MessagePack with #each_batch(format: :msgpack). "json" rows write JSON
+# lines with #write_json, and "to_json" rows make the same lines from
+# the values of #each with the JSON library.
+#
+#   $ WINEVT_FAKE_BACKEND=1 bundle exec rake clobber compile
+#   $ bundle exec ruby -Ilib benchmark/fake_backend.rb [events_per_channel]
+require 'benchmark'
+require 'json'
+require 'stringio'
+require 'winevt'
+
+events = (ARGV[0] || 100_000).to_i
+Winevt::EventLog::FakeBackend.reset(events)
+
+[
+  ["query xml", Winevt::EventLog::Query, {render_as_xml: true}],
+  ["query hash", Winevt::EventLog::Query, {render_as_xml: false}],
+  ["query batch", Winevt::EventLog::Query, {render_as_xml: false}, :each_batch],
+  ["query msgpack", Winevt::EventLog::Query, {render_as_xml: false}, :each_msgpack],
+  ["query arrow", Winevt::EventLog::Query, {render_as_xml: false}, :write_arrow],
+  ["query to_json", Winevt::EventLog::Query, {render_as_xml: false}, :each_to_json],
+  ["query json", Winevt::EventLog::Query, {render_as_xml: false}, :write_json],
+  ["subscribe xml", Winevt::EventLog::Subscribe, {render_as_xml: true}],
+  ["subscribe hash", Winevt::EventLog::Subscribe, {render_as_xml: false}],
+  ["subscribe batch", Winevt::EventLog::Subscribe, {render_as_xml: false}, :each_batch],
+  ["subscribe msgpack", Winevt::EventLog::Subscribe, {render_as_xml: false}, :each_msgpack],
+  ["subscribe arrow", Winevt::EventLog::Subscribe, {render_as_xml: false}, :write_arrow],
+  ["subscribe to_json", Winevt::EventLog::Subscribe, {render_as_xml: false}, :each_to_json],
+  ["subscribe json", Winevt::EventLog::Subscribe, {render_as_xml: false}, :write_json],
+].each do |label, klass, options, method = :each|
+  if klass == Winevt::EventLog::Query
+    source = klass.new("Application", "*")
+  else
+    source = klass.new
+    source.subscribe("Application", "*")
+  end
+  source.batch_size = 256
+  options.each do |name, value|
+    source.__send__("#{name}=", value)
+  end
+  count = 0
+  elapsed = Benchmark.realtime do
+    case method
+    when :write_arrow
+      count = source.write_arrow(StringIO.new("".b))
+    when :write_json
+      count = source.write_json(StringIO.new)
+    when :each_to_json
+      io = StringIO.new
+      source.each do |event, message, string_inserts|
+        record = event.merge("Message" => message, "StringInserts" => string_inserts)
+        io.write(JSON.generate(record), "\n")
+        count += 1
+      end
+    when :each_msgpack
+      # Every event of the channel is read.
+      source.each_batch(format: :msgpack) {|packed| }
+      count = events
+    when :each_batch
+      source.each_batch do |columns|
+        count += columns["StringInserts"].size
+      end
+    else
+      source.each do |event, message, string_inserts|
+        count += 1
+      end
+    end
+  end
+  source.close if source.respond_to?(:close)
+  printf("%-17s  events: %7d  %10.1f events/s\n", label, count, count / elapsed)
+end
@@ -0,0 +1,23 @@
+# Measures Query#each throughput against Query#fields.
+#
+#   $ ridk exec bundle exec ruby benchmark/fields.rb [channel] [max_events]
+require 'benchmark'
+require 'winevt'
+
+channel = ARGV[0] || "Application"
+max_events = (ARGV[1] || 10000).to_i
+
+[nil, [:xml], [:system], [:system, :inserts], [:message]].each do |fields|
+  query = Winevt::EventLog::Query.new(channel, "*")
+  query.fields = fields
+  count = 0
+  elapsed = Benchmark.realtime do
+    query.each do |event, message, string_inserts|
+      count += 1
+      break if count >= max_events
+    end
+  end
+  query.close
+  printf("fields: %-20s  events: %6d  %10.1f events/s\n",
+         fields.inspect, count, count / elapsed)
+end
@@ -0,0 +1,90 @@
+// Measures the formatters of winevt_format.h, which
+// test/native/test_format.cpp checks, against the printf formats they
+// replace. This does not need Windows:
+//
+//   $ c++ -O2 -std=c++11 -Iext/winevt benchmark/format.cpp -o format
+//   $ ./format [iterations]
+#include <winevt_format.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+// gmtime is the reference for the civil time. FILETIME starts 11644473600
+// seconds before the Unix epoch.
+static bool
+reference_civil(uint64_t filetime, struct tm* tm)
+{
+  time_t t = static_cast<time_t>(static_cast<int64_t>(filetime / 10000000) - 11644473600LL);
+#ifdef _WIN32
+  return gmtime_s(tm, &t) == 0;
+#else
+  return gmtime_r(&t, tm) != nullptr;
+#endif /* _WIN32 */
+}
+
+template<typename Function>
+static void
+run_benchmark(const char* name, int iterations, Function format)
+{
+  size_t checksum = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    checksum += format(i);
+  }
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+  printf("%-26s %8.1f ns/value (checksum %lu)\n",
+         name,
+         elapsed.count() / iterations,
+         (unsigned long)checksum);
+}
+
+int
+main(int argc, char** argv)
+{
+  int iterations = argc > 1 ? atoi(argv[1]) : 1000000;
+  char buf[256];
+
+  run_benchmark("snprintf %f", iterations, [&](int i) {
+    return snprintf(buf, sizeof(buf), "%f", i * 0.37);
+  });
+  run_benchmark("winevt_format_fixed", iterations, [&](int i) {
+    return winevt_format_fixed(i * 0.37, buf, sizeof(buf));
+  });
+  run_benchmark("snprintf 0x%08x%08x", iterations, [&](int i) {
+    uint64_t value = i * 0x9e3779b97f4a7c15ULL;
+    return snprintf(buf,
+                    sizeof(buf),
+                    "0x%08x%08x",
+                    static_cast<uint32_t>(value >> 32),
+                    static_cast<uint32_t>(value));
+  });
+  run_benchmark("winevt_format_hex_prefixed", iterations, [&](int i) {
+    return winevt_format_hex_prefixed(i * 0x9e3779b97f4a7c15ULL, 16, buf);
+  });
+  run_benchmark("gmtime+snprintf", iterations, [&](int i) {
+    uint64_t filetime = 133485408000000000ULL + i * 12345678901ULL;
+    struct tm tm;
+    reference_civil(filetime, &tm);
+    return snprintf(buf,
+                    sizeof(buf),
+                    "%04d-%02d-%02d %02d:%02d:%02d.%dZ",
+                    tm.tm_year + 1900,
+                    tm.tm_mon + 1,
+                    tm.tm_mday,
+                    tm.tm_hour,
+                    tm.tm_min,
+                    tm.tm_sec,
+                    static_cast<int>(filetime % 10000000 / 10000));
+  });
+  run_benchmark("winevt_format_insert_time", iterations, [&](int i) {
+    WinevtCivilTime time;
+    winevt_filetime_to_civil(133485408000000000ULL + i * 12345678901ULL, &time);
+    return winevt_format_insert_time(&time, buf);
+  });
+
+  return EXIT_SUCCESS;
+}
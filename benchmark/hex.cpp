@@ -0,0 +1,91 @@
+// Measures the throughput of winevt_hex_encode, which
+// test/native/test_hex.cpp checks, against the loop it replaced. This
+// does not need Windows:
+//
+//   $ c++ -O2 -std=c++11 -Iext/winevt benchmark/hex.cpp -o hex
+//   $ ./hex [megabytes]
+//
+// "simd" is the SSSE3 or AVX2 path which the CPU supports.
+#include <winevt_hex.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+// The nested loop which make_displayable_binary_string used before.
+static std::string
+reference_hex(const uint8_t* p, size_t len)
+{
+  const char* HEX_TABLE = "0123456789ABCDEF";
+  std::string out(len * 2, '\0');
+
+  for (size_t i = 0; i < len; i++) {
+    for (size_t j = 0; j < 2; j++) {
+      out[2 * i + (1 - j)] = HEX_TABLE[(p[i] >> (j * 4)) & 0x0F];
+    }
+  }
+
+  return out;
+}
+
+template<typename Function>
+static void
+run_benchmark(const char* name,
+              const std::vector<uint8_t>& data,
+              size_t block,
+              int iterations,
+              Function encode)
+{
+  std::string out(block * 2, '\0');
+  size_t checksum = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    for (size_t offset = 0; offset + block <= data.size(); offset += block) {
+      encode(data.data() + offset, block, &out[0]);
+      checksum += static_cast<uint8_t>(out[offset % out.size()]);
+    }
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  double megabytes = (double)(data.size() / block * block) * iterations / (1024 * 1024);
+  printf("%-10s %6lu bytes %10.1f MB/s (checksum %lu)\n",
+         name,
+         (unsigned long)block,
+         megabytes / elapsed.count(),
+         (unsigned long)checksum);
+}
+
+int
+main(int argc, char** argv)
+{
+  size_t megabytes = argc > 1 ? strtoul(argv[1], nullptr, 10) : 16;
+  std::vector<uint8_t> data(megabytes * 1024 * 1024);
+  std::mt19937 rng(1);
+
+  for (uint8_t& byte : data) {
+    byte = static_cast<uint8_t>(rng());
+  }
+
+  // Small payloads as most providers attach, and kilobytes as some do.
+  const size_t blocks[] = { 16, 64, 4096 };
+  for (size_t block : blocks) {
+    run_benchmark("reference", data, block, 1, [](const uint8_t* p, size_t len, char* dst) {
+      std::string out = reference_hex(p, len);
+      memcpy(dst, out.data(), out.size());
+    });
+    run_benchmark("scalar", data, block, 4, winevt_hex_encode_scalar);
+#ifdef WINEVT_HEX_SSSE3
+    if (winevt_cpu_has(WINEVT_CPU_SSSE3)) {
+      run_benchmark("simd", data, block, 16, [](const uint8_t* p, size_t len, char* dst) {
+        winevt_hex_encode(p, len, dst);
+      });
+    }
+#endif
+  }
+
+  return EXIT_SUCCESS;
+}
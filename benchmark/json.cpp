@@ -0,0 +1,133 @@
+// Measures the JSON escaping of winevt_json.h, which
+// test/native/test_json.cpp checks, against a simple reference. This
+// does not need Windows:
+//
+//   $ c++ -O2 -std=c++11 -Iext/winevt benchmark/json.cpp -o json
+//   $ ./json [megabytes]
+#include <winevt_json.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+// Escapes one code point at a time.
+static std::string
+reference_utf16_to_json(const std::vector<uint16_t>& src)
+{
+  std::string out;
+
+  for (size_t i = 0; i < src.size(); i++) {
+    uint32_t c = src[i];
+    char buf[8];
+
+    if (c >= 0xd800 && c <= 0xdfff) {
+      if (c <= 0xdbff && i + 1 < src.size() && src[i + 1] >= 0xdc00 && src[i + 1] <= 0xdfff) {
+        c = 0x10000 + ((c - 0xd800) << 10) + (src[++i] - 0xdc00);
+      } else {
+        c = 0xfffd;
+      }
+    }
+    if (c == '"' || c == '\\') {
+      out.push_back('\\');
+      out.push_back(static_cast<char>(c));
+    } else if (c == '\n') {
+      out += "\\n";
+    } else if (c == '\r') {
+      out += "\\r";
+    } else if (c == '\t') {
+      out += "\\t";
+    } else if (c == '\b') {
+      out += "\\b";
+    } else if (c == '\f') {
+      out += "\\f";
+    } else if (c < 0x20) {
+      snprintf(buf, sizeof(buf), "\\u%04x", c);
+      out += buf;
+    } else if (c < 0x80) {
+      out.push_back(static_cast<char>(c));
+    } else if (c < 0x800) {
+      out.push_back(static_cast<char>(0xc0 | (c >> 6)));
+      out.push_back(static_cast<char>(0x80 | (c & 0x3f)));
+    } else if (c < 0x10000) {
+      out.push_back(static_cast<char>(0xe0 | (c >> 12)));
+      out.push_back(static_cast<char>(0x80 | ((c >> 6) & 0x3f)));
+      out.push_back(static_cast<char>(0x80 | (c & 0x3f)));
+    } else {
+      out.push_back(static_cast<char>(0xf0 | (c >> 18)));
+      out.push_back(static_cast<char>(0x80 | ((c >> 12) & 0x3f)));
+      out.push_back(static_cast<char>(0x80 | ((c >> 6) & 0x3f)));
+      out.push_back(static_cast<char>(0x80 | (c & 0x3f)));
+    }
+  }
+
+  return out;
+}
+
+// Mostly ASCII text with a character which needs care at a random
+// place, so that the SIMD loops stop at every position of a block.
+static std::vector<uint16_t>
+random_text(std::mt19937& rng, size_t length)
+{
+  static const uint16_t specials[] = { '"',    '\\',   '\n',   0x01,   0x1f,   0x7f,
+                                       0x80,   0xe9,   0x3042, 0xd83d, 0xde00, 0xfffd,
+                                       0x8000, 0xff22, 0x20,   0x7e };
+  std::vector<uint16_t> text(length);
+
+  for (uint16_t& c : text) {
+    c = static_cast<uint16_t>(0x20 + rng() % 0x5f);
+  }
+  for (size_t n = rng() % 4; n > 0 && length > 0; n--) {
+    text[rng() % length] = specials[rng() % (sizeof(specials) / sizeof(specials[0]))];
+  }
+  if (length > 1 && rng() % 8 == 0) {
+    // A surrogate pair
+    size_t i = rng() % (length - 1);
+    text[i] = 0xd83d;
+    text[i + 1] = 0xde00;
+  }
+
+  return text;
+}
+
+int
+main(int argc, char** argv)
+{
+  int megabytes = argc > 1 ? atoi(argv[1]) : 64;
+  std::mt19937 rng(20241016);
+
+  // Messages of events are mostly ASCII with line breaks and quotes.
+  std::vector<uint16_t> text;
+  while (text.size() < 1024 * 1024) {
+    std::vector<uint16_t> line = random_text(rng, 80);
+    text.insert(text.end(), line.begin(), line.end());
+    text.push_back('\r');
+    text.push_back('\n');
+  }
+  std::string out(text.size() * WINEVT_JSON_MAX_BYTES_PER_CHAR, '\0');
+  size_t iterations = static_cast<size_t>(megabytes) * 1024 * 1024 / (text.size() * 2);
+  size_t checksum = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; i++) {
+    checksum += winevt_utf16_to_json(text.data(), text.size(), &out[0]);
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  printf("winevt_utf16_to_json    %8.1f MB/s of UTF-16 (checksum %lu)\n",
+         iterations * text.size() * 2 / elapsed.count() / 1e6,
+         (unsigned long)checksum);
+
+  checksum = 0;
+  start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; i++) {
+    checksum += reference_utf16_to_json(text).size();
+  }
+  elapsed = std::chrono::steady_clock::now() - start;
+  printf("reference               %8.1f MB/s of UTF-16 (checksum %lu)\n",
+         iterations * text.size() * 2 / elapsed.count() / 1e6,
+         (unsigned long)checksum);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,76 @@
+// Measures writing events with winevt_msgpack.h, which
+// test/native/test_msgpack.cpp checks. This does not need Windows:
+//
+//   $ c++ -O2 -std=c++11 -Iext/winevt benchmark/msgpack.cpp -o msgpack
+//   $ ./msgpack [events]
+#include <winevt_msgpack.h>
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+
+// An event as Query#each_batch(format: :msgpack) writes it.
+static void
+pack_event(WinevtMsgpackWriter& writer, uint64_t i)
+{
+  static const char* keys[] = { "ProviderName", "EventID", "Level", "Task", "Keywords",
+                                "TimeCreated", "EventRecordID", "Computer", "Message",
+                                "StringInserts" };
+  char buffer[128];
+  int length;
+
+  writer.packMapHeader(10);
+  writer.packString(keys[0], strlen(keys[0]));
+  writer.packString("Microsoft-Windows-Security-Auditing", 35);
+  writer.packString(keys[1], strlen(keys[1]));
+  writer.packUnsigned(4624 + i % 8);
+  writer.packString(keys[2], strlen(keys[2]));
+  writer.packUnsigned(i % 5);
+  writer.packString(keys[3], strlen(keys[3]));
+  writer.packUnsigned(12544);
+  writer.packString(keys[4], strlen(keys[4]));
+  writer.packString("0x8020000000000000", 18);
+  writer.packString(keys[5], strlen(keys[5]));
+  writer.packString("2024/01/01 00:00:01.123400", 26);
+  writer.packString(keys[6], strlen(keys[6]));
+  length = snprintf(buffer, sizeof(buffer), "%" PRIu64, i);
+  writer.packString(buffer, static_cast<size_t>(length));
+  writer.packString(keys[7], strlen(keys[7]));
+  writer.packString("WIN-HOST.example.com", 20);
+  writer.packString(keys[8], strlen(keys[8]));
+  char* p = writer.startString(sizeof(buffer));
+  length = snprintf(p, sizeof(buffer), "An account was successfully logged on. %" PRIu64, i);
+  writer.endString(static_cast<size_t>(length));
+  writer.packString(keys[9], strlen(keys[9]));
+  writer.packArrayHeader(static_cast<uint32_t>(i % 4));
+  for (uint64_t j = 0; j < i % 4; j++) {
+    writer.packString("S-1-5-18", 8);
+  }
+}
+
+int
+main(int argc, char** argv)
+{
+  int events = argc > 1 ? atoi(argv[1]) : 1000000;
+  WinevtMsgpackWriter writer;
+  size_t written = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < events; i++) {
+    pack_event(writer, static_cast<uint64_t>(i));
+    if (i % 1024 == 1023) {
+      written += writer.size();
+      writer.clear();
+    }
+  }
+  written += writer.size();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  printf("%d events: %.1f ns/event, %.1f MB/s\n",
+         events,
+         elapsed.count() * 1e9 / events,
+         written / elapsed.count() / 1e6);
+
+  return EXIT_SUCCESS;
+}
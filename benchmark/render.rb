@@ -0,0 +1,62 @@
+# Measures the rendering and conversion hot paths of winevt_utils.cpp
+# (render_system_event, extract_user_evt_variants, wstr_to_rb_str,
+# make_displayable_binary_string and the GUID/SID/FILETIME/hex/double
+# formatters)
+# per event: the time, the objects allocated and the bytes allocated.
+# The events and EVT_VARIANT arrays are synthetic, so this runs on Linux
+# too. The results are also written as JSON to compare runs.
+#
+#   $ bundle exec rake bench
+#   $ bundle exec rake bench ITERATIONS=200000 OUTPUT=before.json
+#
+# `rake bench` builds benchmark/render/ and runs this with it in the
+# load path.
+require 'json'
+require 'rbconfig'
+require 'time'
+
+require 'winevt_render_bench'
+
+iterations = (ENV["ITERATIONS"] || 100_000).to_i
+output = ENV["OUTPUT"] || "benchmark_render.json"
+slot_size = GC::INTERNAL_CONSTANTS[:BASE_SLOT_SIZE] || GC::INTERNAL_CONSTANTS[:RVALUE_SIZE]
+
+# Allocations are counted over fewer iterations with GC disabled, so
+# that no allocated byte is swept before it is counted.
+def allocations(name, iterations, slot_size)
+  GC.start
+  GC.disable
+  objects = GC.stat(:total_allocated_objects)
+  malloc_bytes = GC.stat(:malloc_increase_bytes)
+  Winevt::RenderBench.run(name, iterations)
+  objects = GC.stat(:total_allocated_objects) - objects
+  malloc_bytes = GC.stat(:malloc_increase_bytes) - malloc_bytes
+  [objects.to_f / iterations, (objects * slot_size + malloc_bytes).to_f / iterations]
+ensure
+  GC.enable
+end
+
+results = Winevt::RenderBench.names.map do |name|
+  Winevt::RenderBench.run(name, iterations / 10)
+  elapsed = Winevt::RenderBench.run(name, iterations)
+  objects, bytes = allocations(name, [iterations / 10, 1000].min, slot_size)
+  result = {
+    "name" => name,
+    "iterations" => iterations,
+    "ns_per_event" => (elapsed.to_f / iterations).round(1),
+    "allocations_per_event" => objects.round(2),
+    "bytes_per_event" => bytes.round(1),
+  }
+  printf("%-36s %10.1f ns/event %8.2f allocs/event %10.1f bytes/event\n",
+         name, result["ns_per_event"], result["allocations_per_event"],
+         result["bytes_per_event"])
+  result
+end
+
+File.write(output, JSON.pretty_generate({
+  "ruby" => RUBY_DESCRIPTION,
+  "platform" => RbConfig::CONFIG["host"],
+  "time" => Time.now.utc.iso8601,
+  "results" => results,
+}) + "\n")
+puts "Wrote #{output}"
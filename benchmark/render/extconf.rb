@@ -0,0 +1,41 @@
+# Builds the extension which benchmark/render.rb drives. It is compiled
+# from the sources of ext/winevt with winevt_utils.cpp included into
+# winevt_render_bench.cpp, and it reads events from the fake backend.
+# Run it through `rake bench`.
+require "mkmf"
+require "rbconfig"
+
+ext_dir = File.expand_path("../../ext/winevt", __dir__)
+
+$VPATH << ext_dir
+$INCFLAGS << " -I#{ext_dir}"
+
+have_func("rb_interned_str_cstr", "ruby.h")
+have_func("rb_enc_interned_str", "ruby.h")
+
+ext_srcs = Dir.glob(File.join(ext_dir, "*.{c,cpp}")).map { |path| File.basename(path) }
+# winevt_utils.cpp is included by winevt_render_bench.cpp.
+$srcs = ["winevt_render_bench.cpp"] + ext_srcs - %w[winevt_portable.c winevt_utils.cpp]
+# Windows reads events from the Event Log service otherwise.
+$defs << "-DWINEVT_FAKE_BACKEND"
+
+if RbConfig::CONFIG['host_os'] =~ /mingw|mswin/
+  have_library("wevtapi")
+  have_library("advapi32")
+  have_library("ole32")
+  if have_macro("RB_ALLOCV")
+    $CFLAGS << " -DHAVE_RB_ALLOCV=1 "
+  end
+
+  $LDFLAGS << " -lwevtapi -ladvapi32 -lole32"
+else
+  $INCFLAGS << " -I#{ext_dir}/compat"
+  $CFLAGS << " -fshort-wchar "
+  $CXXFLAGS << " -fshort-wchar "
+  have_library("pthread")
+end
+
+$CFLAGS << " -Wall -std=c99 -fPIC -fms-extensions "
+$CXXFLAGS << " -Wall -std=c++11 -fPIC -fms-extensions "
+
+create_makefile("winevt_render_bench")
@@ -0,0 +1,312 @@
+// Calls the rendering and conversion functions of winevt_utils.cpp in a
+// loop over synthetic EVT_VARIANT arrays and fake backend events, so
+// that their cost per event can be measured without the Event Log
+// service. winevt_utils.cpp is included to reach its static functions.
+// See benchmark/render.rb.
+#include <winevt_utils.cpp>
+
+#include <chrono>
+
+extern "C" void Init_winevt(void);
+
+namespace {
+
+const DWORD BENCH_EVENT_COUNT = 64;
+
+struct BenchData
+{
+  struct WinevtRenderer renderer;
+  EVT_HANDLE events[BENCH_EVENT_COUNT];
+  DWORD eventCount;
+  EVT_VARIANT userValues[9];
+  EVT_VARIANT guidValue;
+  EVT_VARIANT sidValue;
+  EVT_VARIANT fileTimeValue;
+  EVT_VARIANT hexInt64Value;
+  EVT_VARIANT doubleValue;
+  GUID guid;
+  BYTE sid[28];
+  BYTE binary[64];
+  BYTE largeBinary[4096];
+};
+
+BenchData benchData;
+
+const WCHAR ASCII_STRING[] =
+  L"An account was successfully logged on. Logon Type: 3, Process: NtLmSsp";
+const WCHAR NON_ASCII_STRING[] =
+  L"アカウントが正常にログオンしました。 Überprüfung der Anmeldung: Typ 3";
+
+void
+set_variant(EVT_VARIANT* variant, EVT_VARIANT_TYPE type)
+{
+  ZeroMemory(variant, sizeof(EVT_VARIANT));
+  variant->Type = type;
+}
+
+// The values of a typical security audit event: strings, numbers,
+// flags, a logon GUID, a SID, a binary blob and a timestamp.
+void
+setup_values(BenchData* data)
+{
+  static const BYTE sid[] = { 1, 5, 0, 0, 0, 0, 0, 5, 21, 0, 0, 0, 0x8b, 0x2a, 0x1c, 0x5d,
+                              0x39, 0x9f, 0x43, 0x2c, 0x7e, 0x11, 0x0a, 0x6b, 0xe9,
+                              0x03, 0,    0 };
+  GUID guid = { 0x3c1e2d5a, 0x1b2c, 0x4d3e, { 0x8f, 0x4a, 0x5b, 0x6c, 0x7d, 0x8e, 0x9f, 0xa0 } };
+  const ULONGLONG fileTime = 133485408001234567ULL;
+
+  data->guid = guid;
+  memcpy(data->sid, sid, sizeof(sid));
+  for (size_t i = 0; i < sizeof(data->binary); i++) {
+    data->binary[i] = static_cast<BYTE>(i * 37 + 11);
+  }
+  for (size_t i = 0; i < sizeof(data->largeBinary); i++) {
+    data->largeBinary[i] = static_cast<BYTE>(i * 37 + 11);
+  }
+
+  EVT_VARIANT* values = data->userValues;
+  set_variant(&values[0], EvtVarTypeString);
+  values[0].StringVal = ASCII_STRING;
+  set_variant(&values[1], EvtVarTypeString);
+  values[1].StringVal = L"WORKSTATION01";
+  set_variant(&values[2], EvtVarTypeUInt32);
+  values[2].UInt32Val = 4624;
+  set_variant(&values[3], EvtVarTypeHexInt64);
+  values[3].UInt64Val = 0x8020000000000000ULL;
+  set_variant(&values[4], EvtVarTypeBoolean);
+  values[4].BooleanVal = TRUE;
+  set_variant(&values[5], EvtVarTypeGuid);
+  values[5].GuidVal = &data->guid;
+  set_variant(&values[6], EvtVarTypeSid);
+  values[6].SidVal = data->sid;
+  set_variant(&values[7], EvtVarTypeBinary);
+  values[7].BinaryVal = data->binary;
+  values[7].Count = sizeof(data->binary);
+  set_variant(&values[8], EvtVarTypeFileTime);
+  values[8].FileTimeVal = fileTime;
+
+  data->guidValue = values[5];
+  data->sidValue = values[6];
+  data->fileTimeValue = values[8];
+  data->hexInt64Value = values[3];
+  set_variant(&data->doubleValue, EvtVarTypeDouble);
+  data->doubleValue.DoubleVal = 1234.56789;
+}
+
+void
+setup_events(BenchData* data)
+{
+  EVT_HANDLE resultSet;
+
+  initialize_renderer(&data->renderer);
+
+  resultSet = winevt_backend->query(nullptr, L"Application", L"*", EvtQueryChannelPath);
+  if (resultSet == nullptr ||
+      !winevt_backend->next(
+        resultSet, BENCH_EVENT_COUNT, data->events, INFINITE, 0, &data->eventCount)) {
+    rb_raise(rb_eRuntimeError,
+             "Failed to read events from the %s backend with %lu",
+             winevt_backend->name,
+             GetLastError());
+  }
+  winevt_backend->close(resultSet);
+}
+
+VALUE
+bench_render_system_event(size_t i)
+{
+  return render_system_event(&benchData.renderer,
+                             benchData.events[i % benchData.eventCount],
+                             FALSE,
+                             TRUE,
+                             FALSE,
+                             FALSE);
+}
+
+VALUE
+bench_render_system_event_typed(size_t i)
+{
+  return render_system_event(&benchData.renderer,
+                             benchData.events[i % benchData.eventCount],
+                             FALSE,
+                             TRUE,
+                             FALSE,
+                             TRUE);
+}
+
+VALUE
+bench_extract_user_evt_variants(size_t i)
+{
+  return extract_user_evt_variants(benchData.userValues, _countof(benchData.userValues), FALSE);
+}
+
+VALUE
+bench_extract_user_evt_variants_typed(size_t i)
+{
+  return extract_user_evt_variants(benchData.userValues, _countof(benchData.userValues), TRUE);
+}
+
+VALUE
+bench_wstr_to_rb_str_ascii(size_t i)
+{
+  return wstr_to_rb_str(CP_UTF8, ASCII_STRING, -1);
+}
+
+VALUE
+bench_wstr_to_rb_str_non_ascii(size_t i)
+{
+  return wstr_to_rb_str(CP_UTF8, NON_ASCII_STRING, -1);
+}
+
+VALUE
+bench_make_displayable_binary_string(size_t i)
+{
+  return make_displayable_binary_string(benchData.binary, sizeof(benchData.binary));
+}
+
+VALUE
+bench_make_displayable_binary_string_4k(size_t i)
+{
+  return make_displayable_binary_string(benchData.largeBinary, sizeof(benchData.largeBinary));
+}
+
+VALUE
+bench_format_guid(size_t i)
+{
+  return extract_user_evt_variants(&benchData.guidValue, 1, FALSE);
+}
+
+VALUE
+bench_format_sid(size_t i)
+{
+  return extract_user_evt_variants(&benchData.sidValue, 1, FALSE);
+}
+
+VALUE
+bench_format_filetime(size_t i)
+{
+  return extract_user_evt_variants(&benchData.fileTimeValue, 1, FALSE);
+}
+
+VALUE
+bench_format_hexint64(size_t i)
+{
+  return extract_user_evt_variants(&benchData.hexInt64Value, 1, FALSE);
+}
+
+VALUE
+bench_format_double(size_t i)
+{
+  return extract_user_evt_variants(&benchData.doubleValue, 1, FALSE);
+}
+
+const struct
+{
+  const char* name;
+  VALUE (*func)(size_t i);
+} benchmarks[] = {
+  { "render_system_event", bench_render_system_event },
+  { "render_system_event/typed", bench_render_system_event_typed },
+  { "extract_user_evt_variants", bench_extract_user_evt_variants },
+  { "extract_user_evt_variants/typed", bench_extract_user_evt_variants_typed },
+  { "wstr_to_rb_str/ascii", bench_wstr_to_rb_str_ascii },
+  { "wstr_to_rb_str/non_ascii", bench_wstr_to_rb_str_non_ascii },
+  { "make_displayable_binary_string", bench_make_displayable_binary_string },
+  { "make_displayable_binary_string/4k", bench_make_displayable_binary_string_4k },
+  { "format/guid", bench_format_guid },
+  { "format/sid", bench_format_sid },
+  { "format/filetime", bench_format_filetime },
+  { "format/hexint64", bench_format_hexint64 },
+  { "format/double", bench_format_double },
+};
+
+/*
+ * Returns the names of the benchmarks.
+ *
+ * @return [Array<String>]
+ */
+VALUE
+rb_winevt_render_bench_names(VALUE self)
+{
+  VALUE names = rb_ary_new();
+
+  for (size_t i = 0; i < _countof(benchmarks); i++) {
+    rb_ary_push(names, rb_str_new_cstr(benchmarks[i].name));
+  }
+
+  return names;
+}
+
+/*
+ * Calls a benchmark iterations times and returns the elapsed time in
+ * nanoseconds. Each call renders one event or converts one value.
+ *
+ * @param name [String]
+ * @param iterations [Integer]
+ * @return [Integer]
+ */
+VALUE
+rb_winevt_render_bench_run(VALUE self, VALUE rb_name, VALUE rb_iterations)
+{
+  const char* name = StringValueCStr(rb_name);
+  size_t iterations = NUM2SIZET(rb_iterations);
+
+  for (size_t i = 0; i < _countof(benchmarks); i++) {
+    if (strcmp(benchmarks[i].name, name) != 0) {
+      continue;
+    }
+
+    VALUE (*func)(size_t) = benchmarks[i].func;
+    VALUE result = Qnil;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < iterations; n++) {
+      result = func(n);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    RB_GC_GUARD(result);
+
+    return ULL2NUM(static_cast<unsigned long long>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+  }
+
+  rb_raise(rb_eArgError, "Unknown benchmark: %s", name);
+}
+
+/*
+ * Returns the value which a benchmark produces, to check that it does
+ * what it is meant to.
+ *
+ * @param name [String]
+ * @return [Object]
+ */
+VALUE
+rb_winevt_render_bench_sample(VALUE self, VALUE rb_name)
+{
+  const char* name = StringValueCStr(rb_name);
+
+  for (size_t i = 0; i < _countof(benchmarks); i++) {
+    if (strcmp(benchmarks[i].name, name) == 0) {
+      return benchmarks[i].func(0);
+    }
+  }
+
+  rb_raise(rb_eArgError, "Unknown benchmark: %s", name);
+}
+
+} // namespace
+
+extern "C" void
+Init_winevt_render_bench(void)
+{
+  VALUE rb_mBench;
+
+  Init_winevt();
+
+  setup_values(&benchData);
+  setup_events(&benchData);
+
+  rb_mBench = rb_define_module_under(rb_define_module("Winevt"), "RenderBench");
+  rb_define_module_function(rb_mBench, "names", rb_winevt_render_bench_names, 0);
+  rb_define_module_function(rb_mBench, "run", rb_winevt_render_bench_run, 2);
+  rb_define_module_function(rb_mBench, "sample", rb_winevt_render_bench_sample, 1);
+}
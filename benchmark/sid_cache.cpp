@@ -0,0 +1,90 @@
+// Measures the throughput of WinevtSidCache, which
+// test/native/test_sid_cache.cpp checks, when 1 to N threads look up
+// and insert SIDs at the same time, like Query and Subscribe objects
+// read on several threads share the cache. This does not need Windows:
+//
+//   $ c++ -O2 -std=c++11 -pthread -Iext/winevt benchmark/sid_cache.cpp -o sid_cache
+//   $ ./sid_cache [max_threads] [sids] [operations_per_thread]
+//
+// Every thread looks up random SIDs out of `sids`, and inserts one when
+// it is missing, so that the hit rate depends on the capacity.
+#include <winevt_sid_cache.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+static void
+run_thread(WinevtSidCache* cache,
+           const std::vector<std::string>* sids,
+           unsigned seed,
+           size_t operations)
+{
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<size_t> pick(0, sids->size() - 1);
+  std::string account;
+
+  for (size_t i = 0; i < operations; i++) {
+    const std::string& sid = (*sids)[pick(rng)];
+    if (cache->lookup(sid, &account) == SID_CACHE_MISS) {
+      cache->insert(sid, "DOMAIN\\" + sid);
+    }
+  }
+}
+
+static void
+run_benchmark(size_t capacity,
+              const std::vector<std::string>& sids,
+              unsigned threads,
+              size_t operations)
+{
+  WinevtSidCache cache(capacity);
+  std::vector<std::thread> workers;
+
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned i = 0; i < threads; i++) {
+    workers.emplace_back(run_thread, &cache, &sids, i + 1, operations);
+  }
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  SidCacheStats stats = cache.stats();
+  double lookups = (double)(stats.hits + stats.negativeHits + stats.misses);
+  printf("capacity %6zu threads %3u %12.0f ops/s hit rate %5.1f%%\n",
+         capacity,
+         threads,
+         (double)threads * operations / elapsed.count(),
+         lookups == 0 ? 0.0 : 100.0 * stats.hits / lookups);
+}
+
+int
+main(int argc, char** argv)
+{
+  unsigned maxThreads = argc > 1 ? strtoul(argv[1], nullptr, 10)
+                                 : std::max(1u, std::thread::hardware_concurrency());
+  size_t count = argc > 2 ? strtoul(argv[2], nullptr, 10) : 8192;
+  size_t operations = argc > 3 ? strtoul(argv[3], nullptr, 10) : 1000000;
+  std::vector<std::string> sids;
+
+  for (size_t i = 0; i < count; i++) {
+    sids.push_back("S-1-5-21-3623811015-3361044348-30300820-" + std::to_string(1000 + i));
+  }
+
+  // With the default number of SIDs, the default capacity holds half of
+  // them, and twice it all of them.
+  const size_t capacities[] = { SID_CACHE_DEFAULT_CAPACITY,
+                                SID_CACHE_DEFAULT_CAPACITY * 2 };
+  for (size_t capacity : capacities) {
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+      run_benchmark(capacity, sids, threads, operations);
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,40 @@
+# Measures Query#each throughput when several queries run on separate
+# threads at the same time.
+#
+#   $ ridk exec bundle exec ruby benchmark/threads.rb [channel] [events_per_thread]
+#
+# With the fake backend, EvtNext takes next_latency_msec like EvtNext
+# of a remote session. The threads wait for it at the same time:
+#
+#   $ bundle exec ruby -Ilib benchmark/threads.rb Application 5000 [next_latency_msec]
+require 'benchmark'
+require 'winevt'
+
+channel = ARGV[0] || "Application"
+events_per_thread = (ARGV[1] || 5000).to_i
+if Winevt::EventLog.backend == "fake"
+  Winevt::EventLog::FakeBackend.reset(events_per_thread)
+  Winevt::EventLog::FakeBackend.next_latency = (ARGV[2] || 10).to_i
+end
+
+[1, 2, 4, 8].each do |thread_count|
+  total = 0
+  elapsed = Benchmark.realtime do
+    threads = thread_count.times.map do
+      Thread.new do
+        query = Winevt::EventLog::Query.new(channel, "*")
+        query.render_as_xml = false
+        count = 0
+        query.each do |eventlog, message, string_inserts|
+          count += 1
+          break if count >= events_per_thread
+        end
+        query.close
+        count
+      end
+    end
+    total = threads.sum(&:value)
+  end
+  printf("threads: %d  events: %7d  %10.1f events/s\n",
+         thread_count, total, total / elapsed)
+end
@@ -0,0 +1,62 @@
+// Measures the throughput of winevt_utf16_to_utf8, which
+// test/native/test_utf16.cpp checks. This does not need Windows:
+//
+//   $ c++ -O2 -std=c++11 -Iext/winevt benchmark/utf16_transcode.cpp -o utf16_transcode
+//   $ ./utf16_transcode [megabytes]
+#include <winevt_utf16.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+static std::vector<uint16_t>
+random_text(std::mt19937& rng, size_t len, int asciiPercent)
+{
+  std::vector<uint16_t> text(len);
+  std::uniform_int_distribution<int> percent(0, 99);
+  std::uniform_int_distribution<int> ascii(0x20, 0x7e);
+  std::uniform_int_distribution<int> unit(0x80, 0xffff);
+
+  for (size_t i = 0; i < len; i++) {
+    text[i] = percent(rng) < asciiPercent ? ascii(rng) : unit(rng);
+  }
+
+  return text;
+}
+
+static void
+run_benchmark(const char* name, const std::vector<uint16_t>& src, int iterations)
+{
+  std::string out(src.size() * WINEVT_UTF8_MAX_BYTES_PER_UTF16, '\0');
+  size_t written = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    written += winevt_utf16_to_utf8(src.data(), src.size(), &out[0]);
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  double megabytes = (double)src.size() * sizeof(uint16_t) * iterations / (1024 * 1024);
+  printf("%-12s %10.1f MB/s (UTF-16 input, %lu bytes written)\n",
+         name,
+         megabytes / elapsed.count(),
+         (unsigned long)written);
+}
+
+int
+main(int argc, char** argv)
+{
+  size_t megabytes = argc > 1 ? strtoul(argv[1], nullptr, 10) : 16;
+  size_t len = megabytes * 1024 * 1024 / sizeof(uint16_t);
+  std::mt19937 rng(1);
+
+  run_benchmark("ascii", random_text(rng, len, 100), 10);
+  run_benchmark("mostly ascii", random_text(rng, len, 99), 10);
+  run_benchmark("mixed", random_text(rng, len, 50), 10);
+  run_benchmark("non-ascii", random_text(rng, len, 0), 10);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,9 @@
+require 'winevt'
+
+# Reads an exported .evtx file. This works on platforms other than Windows, too.
+@file = Winevt::EventLog::File.new(ARGV[0] || "Application.evtx")
+@file.render_as_xml = false
+@file.each do |system, _message, string_inserts|
+  puts system["EventID"], string_inserts.inspect
+end
+@file.close
@@ -0,0 +1,18 @@
+#ifndef _WINEVT_COMPAT_SDDL_H_
+#define _WINEVT_COMPAT_SDDL_H_
+
+#include <windows.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+BOOL ConvertSidToStringSidW(PSID sid, LPWSTR* str);
+BOOL ConvertSidToStringSidA(PSID sid, LPSTR* str);
+#define ConvertSidToStringSid ConvertSidToStringSidA
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif // _WINEVT_COMPAT_SDDL_H_
@@ -0,0 +1,6 @@
+#ifndef _WINEVT_COMPAT_W32API_H_
+#define _WINEVT_COMPAT_W32API_H_
+
+#define WindowsVista 0x0600
+
+#endif // _WINEVT_COMPAT_W32API_H_
@@ -0,0 +1,279 @@
+#ifndef _WINEVT_COMPAT_WINDOWS_H_
+#define _WINEVT_COMPAT_WINDOWS_H_
+
+/*
+ * The subset of <windows.h> which the extension uses, for building it
+ * against the fake backend on platforms other than Windows. WCHAR is
+ * UTF-16 as on Windows, so sources are compiled with -fshort-wchar.
+ * The functions are implemented in winevt_compat.cpp.
+ */
+
+#ifdef _WIN32
+#error "Use the Windows SDK headers on Windows"
+#endif /* _WIN32 */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <wchar.h>
+#ifdef __cplusplus
+/* <cwchar> undefines the wcslen macro below, so it is included first. */
+#include <cwchar>
+#endif /* __cplusplus */
+
+typedef wchar_t WCHAR;
+typedef WCHAR *LPWSTR, *PWSTR, *LPOLESTR;
+typedef const WCHAR *LPCWSTR, *PCWSTR;
+typedef char CHAR;
+typedef CHAR* LPSTR;
+typedef const CHAR* LPCSTR;
+
+/* DWORD and LONG are unsigned long and long as with MinGW, so that
+ * "%lu" in format strings keeps matching them. */
+typedef unsigned long DWORD;
+typedef DWORD *PDWORD, *LPDWORD;
+typedef int BOOL;
+typedef unsigned long ULONG;
+typedef long LONG;
+typedef unsigned int UINT;
+typedef uint16_t WORD, USHORT, LANGID;
+typedef uint8_t BYTE, UCHAR, *PBYTE;
+typedef long long LONGLONG;
+typedef unsigned long long ULONGLONG;
+typedef int8_t INT8;
+typedef int16_t INT16;
+typedef int32_t INT32;
+typedef long long INT64;
+typedef uint8_t UINT8;
+typedef uint16_t UINT16;
+typedef uint32_t UINT32;
+typedef unsigned long long UINT64;
+typedef uintptr_t ULONG_PTR, SIZE_T;
+typedef void *HANDLE, *PVOID, *LPVOID, *PSID, *HLOCAL;
+typedef DWORD LCID;
+typedef long HRESULT;
+
+typedef struct _FILETIME
+{
+  DWORD dwLowDateTime;
+  DWORD dwHighDateTime;
+} FILETIME, *PFILETIME;
+
+typedef struct _SYSTEMTIME
+{
+  WORD wYear;
+  WORD wMonth;
+  WORD wDayOfWeek;
+  WORD wDay;
+  WORD wHour;
+  WORD wMinute;
+  WORD wSecond;
+  WORD wMilliseconds;
+} SYSTEMTIME, *PSYSTEMTIME;
+
+typedef struct _GUID
+{
+  uint32_t Data1;
+  uint16_t Data2;
+  uint16_t Data3;
+  uint8_t Data4[8];
+} GUID;
+
+typedef union _LARGE_INTEGER
+{
+  struct
+  {
+    uint32_t LowPart;
+    int32_t HighPart;
+  };
+  LONGLONG QuadPart;
+} LARGE_INTEGER;
+
+typedef enum _SID_NAME_USE
+{
+  SidTypeUser = 1,
+  SidTypeGroup,
+  SidTypeDomain,
+  SidTypeAlias,
+  SidTypeWellKnownGroup,
+  SidTypeDeletedAccount,
+  SidTypeInvalid,
+  SidTypeUnknown,
+  SidTypeComputer,
+  SidTypeLabel,
+} SID_NAME_USE, *PSID_NAME_USE;
+
+#ifndef TRUE
+#define TRUE 1
+#endif /* TRUE */
+#ifndef FALSE
+#define FALSE 0
+#endif /* FALSE */
+
+#define WINAPI
+#define INFINITE 0xffffffffUL
+#define MAXDWORD 0xffffffffUL
+#define CP_ACP 0
+#define CP_UTF8 65001
+
+#define ERROR_SUCCESS 0L
+#define ERROR_FILE_NOT_FOUND 2L
+#define ERROR_INVALID_HANDLE 6L
+#define ERROR_NOT_ENOUGH_MEMORY 8L
+#define ERROR_INVALID_DATA 13L
+#define ERROR_OUTOFMEMORY 14L
+#define ERROR_NOT_SUPPORTED 50L
+#define ERROR_INVALID_PARAMETER 87L
+#define ERROR_INSUFFICIENT_BUFFER 122L
+#define ERROR_NO_MORE_ITEMS 259L
+#define ERROR_NOT_FOUND 1168L
+#define ERROR_CANCELLED 1223L
+#define ERROR_NONE_MAPPED 1332L
+#define ERROR_TIMEOUT 1460L
+#define ERROR_RESOURCE_DATA_NOT_FOUND 1812L
+#define ERROR_RESOURCE_TYPE_NOT_FOUND 1813L
+#define ERROR_RESOURCE_NAME_NOT_FOUND 1814L
+#define ERROR_RESOURCE_LANG_NOT_FOUND 1815L
+#define ERROR_EVT_INVALID_QUERY 15001L
+#define ERROR_EVT_CHANNEL_NOT_FOUND 15007L
+#define ERROR_EVT_MESSAGE_NOT_FOUND 15027L
+#define ERROR_EVT_MESSAGE_ID_NOT_FOUND 15028L
+#define ERROR_EVT_UNRESOLVED_VALUE_INSERT 15029L
+#define ERROR_EVT_UNRESOLVED_PARAMETER_INSERT 15030L
+#define ERROR_EVT_MESSAGE_LOCALE_NOT_FOUND 15033L
+#define ERROR_MUI_FILE_NOT_FOUND 15100L
+
+#define WAIT_OBJECT_0 0UL
+#define WAIT_TIMEOUT 258UL
+#define WAIT_FAILED 0xffffffffUL
+
+#define FORMAT_MESSAGE_ALLOCATE_BUFFER 0x00000100
+#define FORMAT_MESSAGE_IGNORE_INSERTS 0x00000200
+#define FORMAT_MESSAGE_FROM_SYSTEM 0x00001000
+
+#define LANG_NEUTRAL 0x00
+#define LANG_BULGARIAN 0x02
+#define LANG_CHINESE 0x04
+#define LANG_CZECH 0x05
+#define LANG_DANISH 0x06
+#define LANG_GERMAN 0x07
+#define LANG_GREEK 0x08
+#define LANG_ENGLISH 0x09
+#define LANG_SPANISH 0x0a
+#define LANG_FINNISH 0x0b
+#define LANG_FRENCH 0x0c
+#define LANG_HUNGARIAN 0x0e
+#define LANG_ICELANDIC 0x0f
+#define LANG_ITALIAN 0x10
+#define LANG_JAPANESE 0x11
+#define LANG_KOREAN 0x12
+#define LANG_DUTCH 0x13
+#define LANG_NORWEGIAN 0x14
+#define LANG_POLISH 0x15
+#define LANG_PORTUGUESE 0x16
+#define LANG_ROMANIAN 0x18
+#define LANG_RUSSIAN 0x19
+#define LANG_CROATIAN 0x1a
+#define LANG_SLOVAK 0x1b
+#define LANG_SWEDISH 0x1d
+#define LANG_TURKISH 0x1f
+#define LANG_SLOVENIAN 0x24
+
+#define SUBLANG_NEUTRAL 0x00
+#define SUBLANG_DEFAULT 0x01
+#define SUBLANG_CHINESE_TRADITIONAL 0x01
+#define SUBLANG_CHINESE_SIMPLIFIED 0x02
+#define SUBLANG_CHINESE_HONGKONG 0x03
+#define SUBLANG_CHINESE_SINGAPORE 0x04
+#define SUBLANG_DUTCH 0x01
+#define SUBLANG_DUTCH_BELGIAN 0x02
+#define SUBLANG_ENGLISH_US 0x01
+#define SUBLANG_ENGLISH_UK 0x02
+#define SUBLANG_ENGLISH_AUS 0x03
+#define SUBLANG_ENGLISH_CAN 0x04
+#define SUBLANG_ENGLISH_NZ 0x05
+#define SUBLANG_ENGLISH_EIRE 0x06
+#define SUBLANG_FRENCH 0x01
+#define SUBLANG_FRENCH_BELGIAN 0x02
+#define SUBLANG_FRENCH_CANADIAN 0x03
+#define SUBLANG_FRENCH_SWISS 0x04
+#define SUBLANG_GERMAN 0x01
+#define SUBLANG_GERMAN_SWISS 0x02
+#define SUBLANG_GERMAN_AUSTRIAN 0x03
+#define SUBLANG_ITALIAN 0x01
+#define SUBLANG_ITALIAN_SWISS 0x02
+#define SUBLANG_NORWEGIAN_BOKMAL 0x01
+#define SUBLANG_NORWEGIAN_NYNORSK 0x02
+#define SUBLANG_PORTUGUESE_BRAZILIAN 0x01
+#define SUBLANG_PORTUGUESE 0x02
+#define SUBLANG_SPANISH 0x01
+#define SUBLANG_SPANISH_MEXICAN 0x02
+#define SUBLANG_SPANISH_MODERN 0x03
+#define SORT_DEFAULT 0x0
+
+#define MAKELANGID(p, s) ((((WORD)(s)) << 10) | (WORD)(p))
+#define MAKELCID(l, s) ((DWORD)((((DWORD)((WORD)(s))) << 16) | ((DWORD)((WORD)(l)))))
+#define MAKELONG(a, b) ((LONG)(((WORD)(a)) | ((DWORD)((WORD)(b))) << 16))
+#define FAILED(hr) (((HRESULT)(hr)) < 0)
+#define _countof(array) (sizeof(array) / sizeof((array)[0]))
+#define _TRUNCATE ((size_t)-1)
+
+#define ZeroMemory(p, n) memset((p), 0, (n))
+#define RtlZeroMemory(p, n) memset((p), 0, (n))
+#define SecureZeroMemory(p, n) memset((p), 0, (n))
+#define stricmp strcasecmp
+#define strnicmp strncasecmp
+#define _snprintf_s(buffer, size, count, ...) snprintf((buffer), (size), __VA_ARGS__)
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+DWORD GetLastError(void);
+void SetLastError(DWORD error);
+
+int MultiByteToWideChar(UINT codePage, DWORD flags, LPCSTR str, int len,
+                        LPWSTR wstr, int wlen);
+int WideCharToMultiByte(UINT codePage, DWORD flags, LPCWSTR wstr, int wlen,
+                        LPSTR str, int len, LPCSTR defaultChar, BOOL* usedDefaultChar);
+DWORD FormatMessageW(DWORD flags, const void* source, DWORD messageId, DWORD languageId,
+                     LPWSTR buffer, DWORD size, void* arguments);
+HLOCAL LocalFree(HLOCAL mem);
+
+BOOL FileTimeToSystemTime(const FILETIME* fileTime, SYSTEMTIME* systemTime);
+int StringFromGUID2(const GUID* guid, LPOLESTR str, int len);
+
+BOOL LookupAccountSidW(LPCWSTR systemName, PSID sid, LPWSTR name, LPDWORD nameSize,
+                       LPWSTR domainName, LPDWORD domainNameSize, PSID_NAME_USE use);
+DWORD GetLengthSid(PSID sid);
+
+HANDLE CreateEvent(void* attributes, BOOL manualReset, BOOL initialState, LPCSTR name);
+BOOL SetEvent(HANDLE event);
+BOOL ResetEvent(HANDLE event);
+DWORD WaitForSingleObject(HANDLE handle, DWORD milliseconds);
+BOOL CloseHandle(HANDLE handle);
+void Sleep(DWORD milliseconds);
+
+/* glibc's wide string functions work on 32-bit wchar_t. */
+size_t winevt_compat_wcslen(const WCHAR* str);
+size_t winevt_compat_wcsnlen(const WCHAR* str, size_t max);
+WCHAR* winevt_compat_wcsdup(const WCHAR* str);
+#define wcslen winevt_compat_wcslen
+#define wcsnlen winevt_compat_wcsnlen
+#define _wcsdup winevt_compat_wcsdup
+
+#ifdef __cplusplus
+}
+
+inline int
+StringFromGUID2(const GUID& guid, LPOLESTR str, int len)
+{
+  return StringFromGUID2(&guid, str, len);
+}
+#else
+#define StringFromGUID2(guid, str, len) StringFromGUID2(&(guid), (str), (len))
+#endif /* __cplusplus */
+
+#endif // _WINEVT_COMPAT_WINDOWS_H_
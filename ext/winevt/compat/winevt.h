@@ -0,0 +1,215 @@
+#ifndef _WINEVT_COMPAT_WINEVT_H_
+#define _WINEVT_COMPAT_WINEVT_H_
+
+/*
+ * Types and constants of <winevt.h> with the values of the Windows SDK,
+ * for building the extension against the fake backend on platforms
+ * other than Windows. The wevtapi functions themselves are not
+ * declared: they are only reachable through the fake backend table.
+ */
+
+#include <windows.h>
+
+typedef HANDLE EVT_HANDLE, *PEVT_HANDLE;
+
+typedef enum _EVT_VARIANT_TYPE
+{
+  EvtVarTypeNull = 0,
+  EvtVarTypeString = 1,
+  EvtVarTypeAnsiString = 2,
+  EvtVarTypeSByte = 3,
+  EvtVarTypeByte = 4,
+  EvtVarTypeInt16 = 5,
+  EvtVarTypeUInt16 = 6,
+  EvtVarTypeInt32 = 7,
+  EvtVarTypeUInt32 = 8,
+  EvtVarTypeInt64 = 9,
+  EvtVarTypeUInt64 = 10,
+  EvtVarTypeSingle = 11,
+  EvtVarTypeDouble = 12,
+  EvtVarTypeBoolean = 13,
+  EvtVarTypeBinary = 14,
+  EvtVarTypeGuid = 15,
+  EvtVarTypeSizeT = 16,
+  EvtVarTypeFileTime = 17,
+  EvtVarTypeSysTime = 18,
+  EvtVarTypeSid = 19,
+  EvtVarTypeHexInt32 = 20,
+  EvtVarTypeHexInt64 = 21,
+  EvtVarTypeEvtHandle = 32,
+  EvtVarTypeEvtXml = 35
+} EVT_VARIANT_TYPE;
+
+#define EVT_VARIANT_TYPE_MASK 0x7f
+#define EVT_VARIANT_TYPE_ARRAY 128
+
+/* Count and Type are 32-bit as on Windows, where DWORD is, so that
+ * rendered values have the 16 byte layout of the real EVT_VARIANT. */
+typedef struct _EVT_VARIANT
+{
+  union
+  {
+    BOOL BooleanVal;
+    INT8 SByteVal;
+    INT16 Int16Val;
+    INT32 Int32Val;
+    INT64 Int64Val;
+    UINT8 ByteVal;
+    UINT16 UInt16Val;
+    UINT32 UInt32Val;
+    UINT64 UInt64Val;
+    float SingleVal;
+    double DoubleVal;
+    ULONGLONG FileTimeVal;
+    SYSTEMTIME* SysTimeVal;
+    GUID* GuidVal;
+    LPCWSTR StringVal;
+    LPCSTR AnsiStringVal;
+    PBYTE BinaryVal;
+    PSID SidVal;
+    size_t SizeTVal;
+    EVT_HANDLE EvtHandleVal;
+    LPCWSTR XmlVal;
+  };
+  UINT32 Count;
+  UINT32 Type;
+} EVT_VARIANT, *PEVT_VARIANT;
+
+typedef enum _EVT_QUERY_FLAGS
+{
+  EvtQueryChannelPath = 0x1,
+  EvtQueryFilePath = 0x2,
+  EvtQueryForwardDirection = 0x100,
+  EvtQueryReverseDirection = 0x200,
+  EvtQueryTolerateQueryErrors = 0x1000
+} EVT_QUERY_FLAGS;
+
+typedef enum _EVT_SEEK_FLAGS
+{
+  EvtSeekRelativeToFirst = 1,
+  EvtSeekRelativeToLast = 2,
+  EvtSeekRelativeToCurrent = 3,
+  EvtSeekRelativeToBookmark = 4,
+  EvtSeekOriginMask = 7,
+  EvtSeekStrict = 0x10000
+} EVT_SEEK_FLAGS;
+
+typedef enum _EVT_SUBSCRIBE_FLAGS
+{
+  EvtSubscribeToFutureEvents = 1,
+  EvtSubscribeStartAtOldestRecord = 2,
+  EvtSubscribeStartAfterBookmark = 3,
+  EvtSubscribeOriginMask = 3,
+  EvtSubscribeTolerateQueryErrors = 0x1000,
+  EvtSubscribeStrict = 0x10000
+} EVT_SUBSCRIBE_FLAGS;
+
+typedef enum _EVT_SUBSCRIBE_NOTIFY_ACTION
+{
+  EvtSubscribeActionError = 0,
+  EvtSubscribeActionDeliver
+} EVT_SUBSCRIBE_NOTIFY_ACTION;
+
+typedef DWORD(WINAPI* EVT_SUBSCRIBE_CALLBACK)(EVT_SUBSCRIBE_NOTIFY_ACTION action,
+                                              PVOID userContext,
+                                              EVT_HANDLE event);
+
+typedef enum _EVT_RENDER_CONTEXT_FLAGS
+{
+  EvtRenderContextValues = 0,
+  EvtRenderContextSystem,
+  EvtRenderContextUser
+} EVT_RENDER_CONTEXT_FLAGS;
+
+typedef enum _EVT_RENDER_FLAGS
+{
+  EvtRenderEventValues = 0,
+  EvtRenderEventXml,
+  EvtRenderBookmark
+} EVT_RENDER_FLAGS;
+
+typedef enum _EVT_SYSTEM_PROPERTY_ID
+{
+  EvtSystemProviderName = 0,
+  EvtSystemProviderGuid,
+  EvtSystemEventID,
+  EvtSystemQualifiers,
+  EvtSystemLevel,
+  EvtSystemTask,
+  EvtSystemOpcode,
+  EvtSystemKeywords,
+  EvtSystemTimeCreated,
+  EvtSystemEventRecordId,
+  EvtSystemActivityID,
+  EvtSystemRelatedActivityID,
+  EvtSystemProcessID,
+  EvtSystemThreadID,
+  EvtSystemChannel,
+  EvtSystemComputer,
+  EvtSystemUserID,
+  EvtSystemVersion,
+  EvtSystemPropertyIdEND
+} EVT_SYSTEM_PROPERTY_ID;
+
+typedef enum _EVT_FORMAT_MESSAGE_FLAGS
+{
+  EvtFormatMessageEvent = 1,
+  EvtFormatMessageLevel,
+  EvtFormatMessageTask,
+  EvtFormatMessageOpcode,
+  EvtFormatMessageKeyword,
+  EvtFormatMessageChannel,
+  EvtFormatMessageProvider,
+  EvtFormatMessageId,
+  EvtFormatMessageXml
+} EVT_FORMAT_MESSAGE_FLAGS;
+
+typedef enum _EVT_LOGIN_CLASS
+{
+  EvtRpcLogin = 1
+} EVT_LOGIN_CLASS;
+
+typedef enum _EVT_RPC_LOGIN_FLAGS
+{
+  EvtRpcLoginAuthDefault = 0,
+  EvtRpcLoginAuthNegotiate,
+  EvtRpcLoginAuthKerberos,
+  EvtRpcLoginAuthNTLM
+} EVT_RPC_LOGIN_FLAGS;
+
+typedef struct _EVT_RPC_LOGIN
+{
+  LPWSTR Server;
+  LPWSTR User;
+  LPWSTR Domain;
+  LPWSTR Password;
+  DWORD Flags;
+} EVT_RPC_LOGIN;
+
+typedef enum _EVT_CHANNEL_CONFIG_PROPERTY_ID
+{
+  EvtChannelConfigEnabled = 0,
+  EvtChannelConfigIsolation,
+  EvtChannelConfigType,
+  EvtChannelConfigOwningPublisher,
+  EvtChannelConfigClassicEventlog,
+  EvtChannelConfigAccess,
+  EvtChannelLoggingConfigRetention,
+  EvtChannelLoggingConfigAutoBackup,
+  EvtChannelLoggingConfigMaxSize,
+  EvtChannelLoggingConfigLogFilePath,
+  EvtChannelPublishingConfigLevel,
+  EvtChannelPublishingConfigKeywords,
+  EvtChannelPublishingConfigControlGuid,
+  EvtChannelPublishingConfigBufferSize,
+  EvtChannelPublishingConfigMinBuffers,
+  EvtChannelPublishingConfigMaxBuffers,
+  EvtChannelPublishingConfigLatency,
+  EvtChannelPublishingConfigClockType,
+  EvtChannelPublishingConfigSidType,
+  EvtChannelPublisherList,
+  EvtChannelPublishingConfigFileMax,
+  EvtChannelConfigPropertyIdEND
+} EVT_CHANNEL_CONFIG_PROPERTY_ID;
+
+#endif // _WINEVT_COMPAT_WINEVT_H_
@@ -10,18 +10,72 @@ includedir = RbConfig::CONFIG["includedir"]
 
 dir_config("winevt", includedir, libdir)
 
-have_library("wevtapi")
-have_func("EvtQuery", "winevt.h")
-have_library("advapi32")
-have_library("ole32")
-if have_macro("RB_ALLOCV")
-  $CFLAGS << " -DHAVE_RB_ALLOCV=1 "
+have_func("rb_interned_str_cstr", "ruby.h")
+have_func("rb_enc_interned_str", "ruby.h")
+
+# The in-memory fake of wevtapi and Winevt::EventLog::FakeBackend are
+# only built with --enable-fake-backend.
+fake_backend = enable_config("fake-backend", false)
+all_srcs = Dir.glob(File.join(__dir__, "*.{c,cpp}")).map { |path| File.basename(path) }
+
+if RbConfig::CONFIG['host_os'] =~ /mingw|mswin/
+  if fake_backend
+    $defs << "-DWINEVT_FAKE_BACKEND"
+    $srcs = all_srcs
+  else
+    $srcs = all_srcs - %w[winevt_backend_fake.cpp]
+  end
+  have_library("wevtapi")
+  have_func("EvtQuery", "winevt.h")
+  have_library("advapi32")
+  have_library("ole32")
+  if have_macro("RB_ALLOCV")
+    $CFLAGS << " -DHAVE_RB_ALLOCV=1 "
+  end
+
+  $LDFLAGS << " -lwevtapi -ladvapi32 -lole32"
+elsif fake_backend
+  # Query, Subscribe and friends read the in-memory fake backend. The
+  # headers under compat/ stand in for the Windows SDK, and WCHAR must be
+  # 16 bits wide like on Windows.
+  $defs << "-DWINEVT_FAKE_BACKEND"
+  $INCFLAGS << " -I$(srcdir)/compat"
+  $CFLAGS << " -fshort-wchar "
+  $CXXFLAGS << " -fshort-wchar "
+  $srcs = all_srcs - %w[winevt_portable.c]
+  have_library("pthread")
+else
+  # Only the EVTX file reader is portable.
+  $srcs = %w[winevt_portable.c winevt_system_keys.c winevt_evtx.cpp winevt_evtx_pool.cpp winevt_file.cpp]
+  # EVTX chunks are decoded on std::thread workers.
+  have_library("pthread")
 end
 
-$LDFLAGS << " -lwevtapi -ladvapi32 -lole32"
 $CFLAGS << " -Wall -std=c99 -fPIC -fms-extensions "
 $CXXFLAGS << " -Wall -std=c++11 -fPIC -fms-extensions "
 # $CFLAGS << " -g -O0 -ggdb"
 # $CXXFLAGS << " -g -O0 -ggdb"
 
+# EVTX chunks are decoded on std::thread workers, and the caches are
+# locked with std::mutex. The win32 thread model of mingw-w64 does not
+# provide them.
+unless MakeMakefile["C++"].try_link(<<~SRC)
+  #include <condition_variable>
+  #include <mutex>
+  #include <thread>
+
+  int
+  main()
+  {
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::thread worker([&] { std::lock_guard<std::mutex> lock(mutex); ready.notify_one(); });
+    worker.join();
+    return 0;
+  }
+SRC
+  abort "std::thread, std::mutex and std::condition_variable are required. " \
+        "Use a C++ compiler with the posix thread model of mingw-w64."
+end
+
 create_makefile("winevt/winevt")
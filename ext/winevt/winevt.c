@@ -23,12 +23,16 @@ Init_winevt(void)
   rb_eRemoteHandlerError = rb_define_class_under(rb_cSubscribe, "RemoteHandlerError", rb_eRuntimeError);
   rb_eSubscribeHandlerError = rb_define_class_under(rb_cSubscribe, "SubscribeHandlerError", rb_eRuntimeError);
 
+  init_system_event_keys();
+
+  Init_winevt_backend(rb_cEventLog);
   Init_winevt_channel(rb_cEventLog);
   Init_winevt_bookmark(rb_cEventLog);
   Init_winevt_query(rb_cEventLog);
   Init_winevt_subscribe(rb_cEventLog);
   Init_winevt_locale(rb_cEventLog);
   Init_winevt_session(rb_cEventLog);
+  Init_winevt_file(rb_cEventLog);
 
   id_call = rb_intern("call");
 }
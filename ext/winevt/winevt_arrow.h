@@ -0,0 +1,509 @@
+#ifndef _WINEVT_ARROW_H_
+#define _WINEVT_ARROW_H_
+
+/*
+ * Writer of the Apache Arrow IPC streaming format.
+ *
+ * Events are appended to columns, which are written as a record batch
+ * message after a schema message. Only the types which events need are
+ * supported: unsigned integers, timestamps in nanoseconds, UTF-8
+ * strings and lists of UTF-8 strings. The FlatBuffers metadata of the
+ * messages is built here, too, so that nothing but the C++ standard
+ * library is needed.
+ *
+ * This header does not depend on Windows or Ruby headers so that the
+ * writer can be tested and benchmarked on any platform. Values are
+ * written in the byte order of the host, which must be little endian.
+ *
+ * See https://arrow.apache.org/docs/format/Columnar.html for the format
+ * and format/Schema.fbs and format/Message.fbs of Apache Arrow for the
+ * metadata.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+/*
+ * Builds a FlatBuffer from its end to its beginning as the FlatBuffers
+ * library does, so that an object is referred to by offsets from the
+ * objects which are built after it. Offsets returned by the builder are
+ * counted from the end of the buffer.
+ */
+class WinevtFlatBuilder
+{
+public:
+  WinevtFlatBuilder()
+    : buffer_(256)
+    , head_(256)
+    , minAlign_(1)
+    , tableEnd_(0)
+  {
+  }
+
+  uint32_t size() const { return static_cast<uint32_t>(buffer_.size() - head_); }
+
+  const uint8_t* data() const { return buffer_.data() + head_; }
+
+  /* Pads so that the buffer is aligned to align after additional bytes. */
+  void prep(size_t align, size_t additional)
+  {
+    if (align > minAlign_) {
+      minAlign_ = align;
+    }
+    size_t padding = (~(size() + additional) + 1) & (align - 1);
+    memset(push(padding), 0, padding);
+  }
+
+  template<typename T>
+  void pushScalar(T value)
+  {
+    memcpy(push(sizeof(T)), &value, sizeof(T));
+  }
+
+  void startTable()
+  {
+    fields_.clear();
+    tableEnd_ = size();
+  }
+
+  template<typename T>
+  void addScalar(uint16_t slot, T value)
+  {
+    prep(sizeof(T), 0);
+    pushScalar(value);
+    fields_.push_back(Field{ slot, size() });
+  }
+
+  void addOffset(uint16_t slot, uint32_t offset)
+  {
+    prep(4, 0);
+    pushScalar<uint32_t>(size() + 4 - offset);
+    fields_.push_back(Field{ slot, size() });
+  }
+
+  /* Writes the vtable of the table just before it. */
+  uint32_t endTable()
+  {
+    uint16_t slots = 0;
+    uint32_t table;
+
+    prep(4, 0);
+    pushScalar<int32_t>(0);
+    table = size();
+
+    for (const Field& field : fields_) {
+      if (field.slot + 1 > slots) {
+        slots = field.slot + 1;
+      }
+    }
+    std::vector<uint16_t> vtable(2 + slots, 0);
+    vtable[0] = static_cast<uint16_t>(vtable.size() * 2);
+    vtable[1] = static_cast<uint16_t>(table - tableEnd_);
+    for (const Field& field : fields_) {
+      vtable[2 + field.slot] = static_cast<uint16_t>(table - field.offset);
+    }
+    for (size_t i = vtable.size(); i > 0; i--) {
+      pushScalar(vtable[i - 1]);
+    }
+
+    int32_t vtableOffset = static_cast<int32_t>(size() - table);
+    memcpy(buffer_.data() + buffer_.size() - table, &vtableOffset, sizeof(vtableOffset));
+
+    return table;
+  }
+
+  uint32_t createString(const char* string)
+  {
+    size_t length = strlen(string);
+
+    prep(4, length + 1);
+    memset(push(1), 0, 1);
+    memcpy(push(length), string, length);
+    pushScalar<uint32_t>(static_cast<uint32_t>(length));
+
+    return size();
+  }
+
+  uint32_t createOffsetVector(const std::vector<uint32_t>& offsets)
+  {
+    prep(4, offsets.size() * 4);
+    for (size_t i = offsets.size(); i > 0; i--) {
+      pushScalar<uint32_t>(size() + 4 - offsets[i - 1]);
+    }
+    pushScalar<uint32_t>(static_cast<uint32_t>(offsets.size()));
+
+    return size();
+  }
+
+  /* A vector of structs whose fields are 8 bytes wide. */
+  uint32_t createStructVector(const std::vector<int64_t>& values, size_t fieldsPerStruct)
+  {
+    size_t bytes = values.size() * sizeof(int64_t);
+
+    prep(4, bytes);
+    prep(8, bytes);
+    if (bytes > 0) {
+      memcpy(push(bytes), values.data(), bytes);
+    }
+    pushScalar<uint32_t>(static_cast<uint32_t>(values.size() / fieldsPerStruct));
+
+    return size();
+  }
+
+  void finish(uint32_t root)
+  {
+    prep(minAlign_, 4);
+    pushScalar<uint32_t>(size() + 4 - root);
+  }
+
+private:
+  struct Field
+  {
+    uint16_t slot;
+    uint32_t offset;
+  };
+
+  uint8_t* push(size_t bytes)
+  {
+    if (head_ < bytes) {
+      size_t used = size();
+      size_t capacity = buffer_.size() * 2;
+      while (capacity - used < bytes) {
+        capacity *= 2;
+      }
+      std::vector<uint8_t> grown(capacity);
+      memcpy(grown.data() + capacity - used, data(), used);
+      buffer_.swap(grown);
+      head_ = capacity - used;
+    }
+    head_ -= bytes;
+
+    return buffer_.data() + head_;
+  }
+
+  std::vector<uint8_t> buffer_;
+  size_t head_;
+  size_t minAlign_;
+  uint32_t tableEnd_;
+  std::vector<Field> fields_;
+};
+
+enum WinevtArrowType
+{
+  WINEVT_ARROW_UINT8,
+  WINEVT_ARROW_UINT16,
+  WINEVT_ARROW_UINT32,
+  WINEVT_ARROW_UINT64,
+  /* Nanoseconds since the Unix epoch in UTC. */
+  WINEVT_ARROW_TIMESTAMP,
+  WINEVT_ARROW_UTF8,
+  /* A list of UTF-8 strings. */
+  WINEVT_ARROW_UTF8_LIST,
+};
+
+/* A nullable column of a record batch. */
+class WinevtArrowColumn
+{
+public:
+  WinevtArrowColumn(const char* name, WinevtArrowType type)
+    : name_(name)
+    , type_(type)
+    , length_(0)
+    , nullCount_(0)
+  {
+    if (type == WINEVT_ARROW_UTF8 || type == WINEVT_ARROW_UTF8_LIST) {
+      offsets_.push_back(0);
+    }
+    if (type == WINEVT_ARROW_UTF8_LIST) {
+      children_.push_back(WinevtArrowColumn("item", WINEVT_ARROW_UTF8));
+    }
+  }
+
+  const char* name() const { return name_; }
+  WinevtArrowType type() const { return type_; }
+  size_t length() const { return length_; }
+
+  void appendNull()
+  {
+    appendValidity(false);
+    switch (type_) {
+      case WINEVT_ARROW_UTF8:
+        offsets_.push_back(offsets_.back());
+        break;
+      case WINEVT_ARROW_UTF8_LIST:
+        offsets_.push_back(static_cast<int32_t>(children_[0].length()));
+        break;
+      default:
+        values_.append(valueWidth(), '\0');
+        break;
+    }
+  }
+
+  /* For the integer and timestamp columns. */
+  void appendInteger(uint64_t value)
+  {
+    appendValidity(true);
+    values_.append(reinterpret_cast<const char*>(&value), valueWidth());
+  }
+
+  void appendString(const char* value, size_t length)
+  {
+    memcpy(startString(length), value, length);
+    endString(length);
+  }
+
+  /*
+   * Returns where a string of maxLength bytes at most is written into.
+   * endString() must be called with its actual length.
+   */
+  char* startString(size_t maxLength)
+  {
+    values_.resize(offsets_.back() + maxLength);
+
+    return &values_[offsets_.back()];
+  }
+
+  void endString(size_t length)
+  {
+    values_.resize(offsets_.back() + length);
+    offsets_.push_back(static_cast<int32_t>(values_.size()));
+    appendValidity(true);
+  }
+
+  /* The strings of a list are appended to item() before endList(). */
+  WinevtArrowColumn& item() { return children_[0]; }
+
+  void endList()
+  {
+    offsets_.push_back(static_cast<int32_t>(children_[0].length()));
+    appendValidity(true);
+  }
+
+  void clear()
+  {
+    length_ = 0;
+    nullCount_ = 0;
+    validity_.clear();
+    values_.clear();
+    if (!offsets_.empty()) {
+      offsets_.resize(1);
+    }
+    for (WinevtArrowColumn& child : children_) {
+      child.clear();
+    }
+  }
+
+private:
+  friend class WinevtArrowWriter;
+
+  size_t valueWidth() const
+  {
+    switch (type_) {
+      case WINEVT_ARROW_UINT8:
+        return 1;
+      case WINEVT_ARROW_UINT16:
+        return 2;
+      case WINEVT_ARROW_UINT32:
+        return 4;
+      default:
+        return 8;
+    }
+  }
+
+  void appendValidity(bool valid)
+  {
+    if (length_ % 8 == 0) {
+      validity_.push_back('\0');
+    }
+    if (valid) {
+      validity_.back() = static_cast<char>(validity_.back() | (1 << (length_ % 8)));
+    } else {
+      nullCount_++;
+    }
+    length_++;
+  }
+
+  const char* name_;
+  WinevtArrowType type_;
+  size_t length_;
+  size_t nullCount_;
+  std::string validity_;
+  std::string values_;
+  std::vector<int32_t> offsets_;
+  std::vector<WinevtArrowColumn> children_;
+};
+
+/* Encapsulates schema and record batch messages of columns. */
+class WinevtArrowWriter
+{
+public:
+  /* Message.fbs */
+  enum
+  {
+    METADATA_VERSION_V5 = 4,
+    MESSAGE_HEADER_SCHEMA = 1,
+    MESSAGE_HEADER_RECORD_BATCH = 3,
+  };
+  /* Schema.fbs */
+  enum
+  {
+    TYPE_INT = 2,
+    TYPE_UTF8 = 5,
+    TYPE_TIMESTAMP = 10,
+    TYPE_LIST = 12,
+    TIME_UNIT_NANOSECOND = 3,
+  };
+
+  static void writeSchema(const std::vector<WinevtArrowColumn>& columns, std::string& out)
+  {
+    WinevtFlatBuilder builder;
+    std::vector<uint32_t> fields;
+
+    for (const WinevtArrowColumn& column : columns) {
+      fields.push_back(buildField(builder, column));
+    }
+    uint32_t fieldVector = builder.createOffsetVector(fields);
+
+    builder.startTable();
+    builder.addScalar<int16_t>(0, 0); // endianness: Little
+    builder.addOffset(1, fieldVector);
+    uint32_t schema = builder.endTable();
+
+    writeMessage(builder, MESSAGE_HEADER_SCHEMA, schema, 0, out);
+  }
+
+  static void writeRecordBatch(const std::vector<WinevtArrowColumn>& columns, std::string& out)
+  {
+    WinevtFlatBuilder builder;
+    std::vector<int64_t> nodes;
+    std::vector<int64_t> buffers;
+    std::string body;
+
+    for (const WinevtArrowColumn& column : columns) {
+      appendColumn(column, nodes, buffers, body);
+    }
+
+    uint32_t nodeVector = builder.createStructVector(nodes, 2);
+    uint32_t bufferVector = builder.createStructVector(buffers, 2);
+    builder.startTable();
+    builder.addScalar<int64_t>(0, columns.empty() ? 0 : columns[0].length());
+    builder.addOffset(1, nodeVector);
+    builder.addOffset(2, bufferVector);
+    uint32_t recordBatch = builder.endTable();
+
+    writeMessage(builder, MESSAGE_HEADER_RECORD_BATCH, recordBatch, body.size(), out);
+    out.append(body);
+  }
+
+  static void writeEndOfStream(std::string& out)
+  {
+    static const uint8_t END_OF_STREAM[] = { 0xff, 0xff, 0xff, 0xff, 0, 0, 0, 0 };
+
+    out.append(reinterpret_cast<const char*>(END_OF_STREAM), sizeof(END_OF_STREAM));
+  }
+
+private:
+  static uint32_t buildField(WinevtFlatBuilder& builder, const WinevtArrowColumn& column)
+  {
+    std::vector<uint32_t> children;
+    uint8_t typeType;
+    uint32_t type;
+
+    for (const WinevtArrowColumn& child : column.children_) {
+      children.push_back(buildField(builder, child));
+    }
+    uint32_t childVector = builder.createOffsetVector(children);
+    uint32_t name = builder.createString(column.name());
+    uint32_t timezone = column.type() == WINEVT_ARROW_TIMESTAMP ? builder.createString("UTC") : 0;
+
+    builder.startTable();
+    switch (column.type()) {
+      case WINEVT_ARROW_UTF8:
+        typeType = TYPE_UTF8;
+        break;
+      case WINEVT_ARROW_UTF8_LIST:
+        typeType = TYPE_LIST;
+        break;
+      case WINEVT_ARROW_TIMESTAMP:
+        typeType = TYPE_TIMESTAMP;
+        builder.addScalar<int16_t>(0, TIME_UNIT_NANOSECOND);
+        builder.addOffset(1, timezone);
+        break;
+      default:
+        typeType = TYPE_INT;
+        builder.addScalar<int32_t>(0, static_cast<int32_t>(column.valueWidth() * 8));
+        builder.addScalar<uint8_t>(1, 0); // is_signed
+        break;
+    }
+    type = builder.endTable();
+
+    builder.startTable();
+    builder.addOffset(0, name);
+    builder.addScalar<uint8_t>(1, 1); // nullable
+    builder.addScalar<uint8_t>(2, typeType);
+    builder.addOffset(3, type);
+    builder.addOffset(5, childVector);
+
+    return builder.endTable();
+  }
+
+  /* Buffers are padded to 8 bytes in the body. */
+  static void appendBuffer(const void* data, size_t length, std::vector<int64_t>& buffers,
+                           std::string& body)
+  {
+    buffers.push_back(static_cast<int64_t>(body.size()));
+    buffers.push_back(static_cast<int64_t>(length));
+    body.append(static_cast<const char*>(data), length);
+    body.append((8 - length % 8) % 8, '\0');
+  }
+
+  /* Field nodes and buffers are in the pre-order of the columns. */
+  static void appendColumn(const WinevtArrowColumn& column, std::vector<int64_t>& nodes,
+                           std::vector<int64_t>& buffers, std::string& body)
+  {
+    nodes.push_back(static_cast<int64_t>(column.length_));
+    nodes.push_back(static_cast<int64_t>(column.nullCount_));
+    // The validity bitmap can be omitted when there is no null.
+    appendBuffer(column.validity_.data(),
+                 column.nullCount_ > 0 ? column.validity_.size() : 0,
+                 buffers,
+                 body);
+    if (!column.offsets_.empty()) {
+      appendBuffer(column.offsets_.data(), column.offsets_.size() * sizeof(int32_t), buffers, body);
+    }
+    if (column.type() != WINEVT_ARROW_UTF8_LIST) {
+      appendBuffer(column.values_.data(), column.values_.size(), buffers, body);
+    }
+    for (const WinevtArrowColumn& child : column.children_) {
+      appendColumn(child, nodes, buffers, body);
+    }
+  }
+
+  /*
+   * An encapsulated message is the continuation marker, the length of
+   * the metadata which is padded to 8 bytes, the metadata and the body.
+   */
+  static void writeMessage(WinevtFlatBuilder& builder, uint8_t headerType, uint32_t header,
+                           size_t bodyLength, std::string& out)
+  {
+    static const uint8_t PADDING[8] = { 0 };
+
+    builder.startTable();
+    builder.addScalar<int64_t>(3, static_cast<int64_t>(bodyLength));
+    builder.addOffset(2, header);
+    builder.addScalar<int16_t>(0, METADATA_VERSION_V5);
+    builder.addScalar<uint8_t>(1, headerType);
+    builder.finish(builder.endTable());
+
+    uint32_t padding = (8 - builder.size() % 8) % 8;
+    uint32_t prefix[2] = { 0xffffffff, builder.size() + padding };
+    out.append(reinterpret_cast<const char*>(prefix), sizeof(prefix));
+    out.append(reinterpret_cast<const char*>(builder.data()), builder.size());
+    out.append(reinterpret_cast<const char*>(PADDING), padding);
+  }
+};
+
+#endif // _WINEVT_ARROW_H_
@@ -0,0 +1,321 @@
+#include <winevt_arrow.h>
+#include <winevt_format.h>
+#include <winevt_native.h>
+#include <winevt_utf16.h>
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/* FILETIME of the Unix epoch. */
+#define UNIX_EPOCH_FILETIME 116444736000000000LL
+
+/*
+ * Columns of the events which Query#write_arrow and Subscribe#write_arrow
+ * write. The system values have the types of their EVT_VARIANTs rather
+ * than the strings which #each yields for some of them.
+ */
+struct WinevtArrowEncoder
+{
+  std::vector<WinevtArrowColumn> columns;
+  /* Indexes of columns by SystemEventKey, or -1. */
+  int indexes[SYSTEM_EVENT_KEY_MAX];
+  BOOL preserveQualifiers;
+  BOOL preserveSID;
+  bool schemaWritten;
+  std::string text;
+};
+
+static void
+add_column(struct WinevtArrowEncoder* encoder, enum SystemEventKey key, WinevtArrowType type)
+{
+  encoder->indexes[key] = static_cast<int>(encoder->columns.size());
+  encoder->columns.push_back(WinevtArrowColumn(get_system_event_key_name(key), type));
+}
+
+struct WinevtArrowEncoder*
+arrow_encoder_create(DWORD fields, BOOL renderAsXML, BOOL preserveQualifiers, BOOL preserveSID)
+{
+  struct WinevtArrowEncoder* encoder = new WinevtArrowEncoder();
+
+  for (int i = 0; i < SYSTEM_EVENT_KEY_MAX; i++) {
+    encoder->indexes[i] = -1;
+  }
+  encoder->preserveQualifiers = preserveQualifiers;
+  encoder->preserveSID = preserveSID;
+  encoder->schemaWritten = false;
+
+  // fields= takes precedence over render_as_xml= as in #each.
+  if (fields) {
+    renderAsXML = (fields & WINEVT_FIELD_XML) != 0;
+  }
+  if (renderAsXML) {
+    if (!fields || (fields & WINEVT_FIELD_XML)) {
+      add_column(encoder, SYSTEM_EVENT_KEY_XML, WINEVT_ARROW_UTF8);
+    }
+  } else if (!fields || (fields & WINEVT_FIELD_SYSTEM)) {
+    add_column(encoder, SYSTEM_EVENT_KEY_PROVIDER_NAME, WINEVT_ARROW_UTF8);
+    add_column(encoder, SYSTEM_EVENT_KEY_PROVIDER_GUID, WINEVT_ARROW_UTF8);
+    if (preserveQualifiers) {
+      add_column(encoder, SYSTEM_EVENT_KEY_QUALIFIERS, WINEVT_ARROW_UINT16);
+    }
+    add_column(encoder, SYSTEM_EVENT_KEY_EVENT_ID, WINEVT_ARROW_UINT32);
+    add_column(encoder, SYSTEM_EVENT_KEY_VERSION, WINEVT_ARROW_UINT8);
+    add_column(encoder, SYSTEM_EVENT_KEY_LEVEL, WINEVT_ARROW_UINT8);
+    add_column(encoder, SYSTEM_EVENT_KEY_TASK, WINEVT_ARROW_UINT16);
+    add_column(encoder, SYSTEM_EVENT_KEY_OPCODE, WINEVT_ARROW_UINT8);
+    add_column(encoder, SYSTEM_EVENT_KEY_KEYWORDS, WINEVT_ARROW_UINT64);
+    add_column(encoder, SYSTEM_EVENT_KEY_TIME_CREATED, WINEVT_ARROW_TIMESTAMP);
+    add_column(encoder, SYSTEM_EVENT_KEY_EVENT_RECORD_ID, WINEVT_ARROW_UINT64);
+    add_column(encoder, SYSTEM_EVENT_KEY_ACTIVITY_ID, WINEVT_ARROW_UTF8);
+    add_column(encoder, SYSTEM_EVENT_KEY_RELATED_ACTIVITY_ID, WINEVT_ARROW_UTF8);
+    add_column(encoder, SYSTEM_EVENT_KEY_PROCESS_ID, WINEVT_ARROW_UINT32);
+    add_column(encoder, SYSTEM_EVENT_KEY_THREAD_ID, WINEVT_ARROW_UINT32);
+    add_column(encoder, SYSTEM_EVENT_KEY_CHANNEL, WINEVT_ARROW_UTF8);
+    add_column(encoder, SYSTEM_EVENT_KEY_COMPUTER, WINEVT_ARROW_UTF8);
+    if (preserveSID) {
+      add_column(encoder, SYSTEM_EVENT_KEY_USER_ID, WINEVT_ARROW_UTF8);
+    }
+    add_column(encoder, SYSTEM_EVENT_KEY_USER, WINEVT_ARROW_UTF8);
+  }
+  if (!fields || (fields & WINEVT_FIELD_MESSAGE)) {
+    add_column(encoder, SYSTEM_EVENT_KEY_MESSAGE, WINEVT_ARROW_UTF8);
+  }
+  if (!fields || (fields & WINEVT_FIELD_INSERTS)) {
+    add_column(encoder, SYSTEM_EVENT_KEY_STRING_INSERTS, WINEVT_ARROW_UTF8_LIST);
+  }
+
+  return encoder;
+}
+
+void
+arrow_encoder_destroy(struct WinevtArrowEncoder* encoder)
+{
+  delete encoder;
+}
+
+static WinevtArrowColumn*
+get_column(struct WinevtArrowEncoder* encoder, enum SystemEventKey key)
+{
+  return encoder->indexes[key] < 0 ? nullptr : &encoder->columns[encoder->indexes[key]];
+}
+
+/* Transcodes into the column without an intermediate string. */
+static void
+append_wstr(WinevtArrowColumn& column, const WCHAR* wstr)
+{
+  size_t wlen = wstr ? wcslen(wstr) : 0;
+  char* p = column.startString(wlen * WINEVT_UTF8_MAX_BYTES_PER_UTF16);
+
+  column.endString(winevt_utf16_to_utf8(reinterpret_cast<const uint16_t*>(wstr), wlen, p));
+}
+
+static void
+append_guid(WinevtArrowColumn& column, const EVT_VARIANT& variant)
+{
+  WCHAR wsGuid[50];
+
+  if (EvtVarTypeNull == variant.Type || variant.GuidVal == nullptr) {
+    column.appendNull();
+    return;
+  }
+  StringFromGUID2(*variant.GuidVal, wsGuid, _countof(wsGuid));
+  append_wstr(column, wsGuid);
+}
+
+static void
+append_byte(WinevtArrowColumn& column, const EVT_VARIANT& variant)
+{
+  column.appendInteger(EvtVarTypeNull == variant.Type ? 0 : variant.ByteVal);
+}
+
+/* Nanoseconds since the Unix epoch, which are null out of the range of
+ * int64_t. */
+static void
+append_filetime(WinevtArrowColumn& column, const EVT_VARIANT& variant)
+{
+  int64_t ticks;
+
+  if (EvtVarTypeNull == variant.Type || variant.FileTimeVal > INT64_MAX) {
+    column.appendNull();
+    return;
+  }
+  ticks = static_cast<int64_t>(variant.FileTimeVal) - UNIX_EPOCH_FILETIME;
+  if (ticks > INT64_MAX / 100 || ticks < INT64_MIN / 100) {
+    column.appendNull();
+    return;
+  }
+  column.appendInteger(static_cast<uint64_t>(ticks * 100));
+}
+
+static void
+append_system_values(struct WinevtArrowEncoder* encoder, struct WinevtRenderer* renderer,
+                     EVT_HANDLE event)
+{
+  PEVT_VARIANT values = render_system_variants(renderer, event);
+  WinevtArrowColumn* column;
+  DWORD eventID = values[EvtSystemEventID].UInt16Val;
+
+  append_wstr(*get_column(encoder, SYSTEM_EVENT_KEY_PROVIDER_NAME),
+              values[EvtSystemProviderName].StringVal);
+  append_guid(*get_column(encoder, SYSTEM_EVENT_KEY_PROVIDER_GUID), values[EvtSystemProviderGuid]);
+  if ((column = get_column(encoder, SYSTEM_EVENT_KEY_QUALIFIERS))) {
+    if (EvtVarTypeNull != values[EvtSystemQualifiers].Type) {
+      column->appendInteger(values[EvtSystemQualifiers].UInt16Val);
+    } else {
+      column->appendNull();
+    }
+  } else if (EvtVarTypeNull != values[EvtSystemQualifiers].Type) {
+    eventID = MAKELONG(values[EvtSystemEventID].UInt16Val, values[EvtSystemQualifiers].UInt16Val);
+  }
+  get_column(encoder, SYSTEM_EVENT_KEY_EVENT_ID)->appendInteger(eventID);
+  append_byte(*get_column(encoder, SYSTEM_EVENT_KEY_VERSION), values[EvtSystemVersion]);
+  append_byte(*get_column(encoder, SYSTEM_EVENT_KEY_LEVEL), values[EvtSystemLevel]);
+  get_column(encoder, SYSTEM_EVENT_KEY_TASK)
+    ->appendInteger(EvtVarTypeNull == values[EvtSystemTask].Type ? 0
+                                                                 : values[EvtSystemTask].UInt16Val);
+  append_byte(*get_column(encoder, SYSTEM_EVENT_KEY_OPCODE), values[EvtSystemOpcode]);
+
+  column = get_column(encoder, SYSTEM_EVENT_KEY_KEYWORDS);
+  if (EvtVarTypeNull == values[EvtSystemKeywords].Type) {
+    column->appendNull();
+  } else {
+    column->appendInteger(values[EvtSystemKeywords].UInt64Val);
+  }
+  append_filetime(*get_column(encoder, SYSTEM_EVENT_KEY_TIME_CREATED),
+                  values[EvtSystemTimeCreated]);
+  column = get_column(encoder, SYSTEM_EVENT_KEY_EVENT_RECORD_ID);
+  if (EvtVarTypeNull == values[EvtSystemEventRecordId].Type) {
+    column->appendNull();
+  } else {
+    column->appendInteger(values[EvtSystemEventRecordId].UInt64Val);
+  }
+  append_guid(*get_column(encoder, SYSTEM_EVENT_KEY_ACTIVITY_ID), values[EvtSystemActivityID]);
+  append_guid(*get_column(encoder, SYSTEM_EVENT_KEY_RELATED_ACTIVITY_ID),
+              values[EvtSystemRelatedActivityID]);
+  get_column(encoder, SYSTEM_EVENT_KEY_PROCESS_ID)
+    ->appendInteger(values[EvtSystemProcessID].UInt32Val);
+  get_column(encoder, SYSTEM_EVENT_KEY_THREAD_ID)->appendInteger(values[EvtSystemThreadID].UInt32Val);
+  append_wstr(*get_column(encoder, SYSTEM_EVENT_KEY_CHANNEL), values[EvtSystemChannel].StringVal);
+  append_wstr(*get_column(encoder, SYSTEM_EVENT_KEY_COMPUTER), values[EvtSystemComputer].StringVal);
+
+  struct WinevtUserSid user;
+  user.hasSid = false;
+  user.hasAccount = false;
+  if (EvtVarTypeNull != values[EvtSystemUserID].Type) {
+    render_user_sid(renderer, values[EvtSystemUserID].SidVal, &user);
+  }
+  if ((column = get_column(encoder, SYSTEM_EVENT_KEY_USER_ID))) {
+    if (user.hasSid) {
+      column->appendString(user.sid.data(), user.sid.size());
+    } else {
+      column->appendNull();
+    }
+  }
+  column = get_column(encoder, SYSTEM_EVENT_KEY_USER);
+  if (user.hasAccount) {
+    column->appendString(user.account.data(), user.account.size());
+  } else {
+    column->appendNull();
+  }
+}
+
+/* Insert values which are not strings are written as #each yields them
+ * with to_s. */
+static void
+append_string_inserts(struct WinevtArrowEncoder* encoder, WinevtArrowColumn& column,
+                      struct WinevtRenderer* renderer, EVT_HANDLE event)
+{
+  DWORD count = 0;
+  PEVT_VARIANT values = render_user_variants(renderer, event, &count);
+  WinevtArrowColumn& item = column.item();
+  char buffer[WINEVT_FORMAT_BUFFER_SIZE];
+  uint64_t integer = 0;
+
+  for (DWORD i = 0; i < count; i++) {
+    std::string& text = encoder->text;
+    text.clear();
+    switch (evt_variant_to_native(&values[i], text, &integer)) {
+      case WINEVT_VARIANT_NULL:
+        item.appendNull();
+        break;
+      case WINEVT_VARIANT_STRING:
+        item.appendString(text.data(), text.size());
+        break;
+      case WINEVT_VARIANT_SIGNED:
+        if (static_cast<int64_t>(integer) < 0) {
+          buffer[0] = '-';
+          item.appendString(buffer, 1 + winevt_format_uint(0 - integer, 1, buffer + 1));
+        } else {
+          item.appendString(buffer, winevt_format_uint(integer, 1, buffer));
+        }
+        break;
+      case WINEVT_VARIANT_UNSIGNED:
+        item.appendString(buffer, winevt_format_uint(integer, 1, buffer));
+        break;
+      case WINEVT_VARIANT_BOOLEAN:
+        item.appendString(integer ? "true" : "false", integer ? 4 : 5);
+        break;
+    }
+  }
+  column.endList();
+}
+
+void
+arrow_encoder_append(struct WinevtArrowEncoder* encoder, struct WinevtRenderer* renderer,
+                     EVT_HANDLE event, LANGID langID, EVT_HANDLE hRemote)
+{
+  WinevtArrowColumn* column;
+
+  if ((column = get_column(encoder, SYSTEM_EVENT_KEY_XML))) {
+    append_wstr(*column, render_xml_to_wstr(renderer, event));
+  }
+  if (get_column(encoder, SYSTEM_EVENT_KEY_PROVIDER_NAME)) {
+    append_system_values(encoder, renderer, event);
+  }
+  if ((column = get_column(encoder, SYSTEM_EVENT_KEY_MESSAGE))) {
+    append_wstr(*column, get_description_wstr(renderer, event, langID, hRemote));
+  }
+  if ((column = get_column(encoder, SYSTEM_EVENT_KEY_STRING_INSERTS))) {
+    append_string_inserts(encoder, *column, renderer, event);
+  }
+}
+
+long
+arrow_encoder_get_length(struct WinevtArrowEncoder* encoder)
+{
+  return encoder->columns.empty() ? 0 : static_cast<long>(encoder->columns[0].length());
+}
+
+/* Returns the record batch of the appended events, which is preceded by
+ * the schema for the first one. */
+VALUE
+arrow_encoder_flush(struct WinevtArrowEncoder* encoder)
+{
+  std::string out;
+
+  if (!encoder->schemaWritten) {
+    WinevtArrowWriter::writeSchema(encoder->columns, out);
+    encoder->schemaWritten = true;
+  }
+  if (arrow_encoder_get_length(encoder) > 0) {
+    WinevtArrowWriter::writeRecordBatch(encoder->columns, out);
+    for (WinevtArrowColumn& column : encoder->columns) {
+      column.clear();
+    }
+  }
+
+  return rb_str_new(out.data(), out.size());
+}
+
+/* Returns the rest of the stream. */
+VALUE
+arrow_encoder_finish(struct WinevtArrowEncoder* encoder)
+{
+  VALUE rb_str = arrow_encoder_flush(encoder);
+  std::string out;
+
+  WinevtArrowWriter::writeEndOfStream(out);
+
+  return rb_str_cat(rb_str, out.data(), out.size());
+}
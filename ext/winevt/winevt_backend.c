@@ -0,0 +1,190 @@
+#include <winevt_c.h>
+
+/* clang-format off */
+/*
+ * Document-module: Winevt::EventLog::FakeBackend
+ *
+ * Controls the in-memory event source which Query, Subscribe and
+ * Channel read when Winevt::EventLog.backend is "fake". It has the
+ * "Application", "System", "Security", "Setup" and
+ * "Winevt-Fake/Debug" channels with 1000 events each, or
+ * WINEVT_FAKE_EVENTS events when the environment variable is set.
+ *
+ * It is only defined when the extension is built with
+ * --enable-fake-backend, and then the fake backend is always used.
+ *
+ * @example
+ *  require 'winevt'
+ *
+ *  Winevt::EventLog::FakeBackend.reset(10)
+ *  query = Winevt::EventLog::Query.new("Application", "*")
+ *  query.each { |xml, message, inserts| puts xml }
+ * @since 0.12.0
+ */
+/* clang-format on */
+
+#ifdef WINEVT_FAKE_BACKEND
+VALUE rb_mFakeBackend;
+
+const struct WinevtBackend* winevt_backend = &winevt_fake_backend;
+#else
+static const struct WinevtBackend wevtapi_backend = {
+  "wevtapi",
+  EvtQuery,
+  EvtNext,
+  EvtSeek,
+  EvtRender,
+  EvtFormatMessage,
+  EvtSubscribe,
+  EvtCreateBookmark,
+  EvtUpdateBookmark,
+  EvtClose,
+  EvtCancel,
+  EvtCreateRenderContext,
+  EvtOpenPublisherMetadata,
+  EvtOpenSession,
+  EvtOpenChannelEnum,
+  EvtNextChannelPath,
+  EvtOpenChannelConfig,
+  EvtGetChannelConfigProperty,
+  LookupAccountSidW,
+  GetTickCount64,
+};
+
+const struct WinevtBackend* winevt_backend = &wevtapi_backend;
+#endif /* WINEVT_FAKE_BACKEND */
+
+/*
+ * This method returns the name of the backend which events are read
+ * from: "wevtapi" or "fake".
+ *
+ * @return [String]
+ * @since 0.12.0
+ */
+static VALUE
+rb_winevt_eventlog_backend(VALUE self)
+{
+  return rb_str_new_cstr(winevt_backend->name);
+}
+
+#ifdef WINEVT_FAKE_BACKEND
+/*
+ * This method sets the number of events in every channel, clears the
+ * numbers of calls and removes the latency of EvtNext. Events which
+ * are already read are not affected.
+ *
+ * @param events_per_channel [Integer]
+ * @return [nil]
+ */
+static VALUE
+rb_winevt_fake_backend_reset(int argc, VALUE* argv, VALUE self)
+{
+  VALUE rb_count;
+
+  rb_scan_args(argc, argv, "01", &rb_count);
+
+  winevt_fake_backend_reset(NIL_P(rb_count) ? 1000 : NUM2ULONG(rb_count));
+
+  return Qnil;
+}
+
+/*
+ * This method appends events to a channel and signals subscriptions
+ * to it.
+ *
+ * @param channel [String]
+ * @param count [Integer]
+ * @return [nil]
+ */
+static VALUE
+rb_winevt_fake_backend_write(int argc, VALUE* argv, VALUE self)
+{
+  VALUE rb_channel, rb_count;
+
+  rb_scan_args(argc, argv, "11", &rb_channel, &rb_count);
+  Check_Type(rb_channel, T_STRING);
+
+  if (!winevt_fake_backend_write(StringValueCStr(rb_channel),
+                                 NIL_P(rb_count) ? 1 : NUM2ULONG(rb_count))) {
+    raise_channel_not_found_error(rb_channel);
+  }
+
+  return Qnil;
+}
+
+/*
+ * This method returns the numbers of calls to the functions of the
+ * fake backend which are counted, e.g. "create_render_context" for
+ * EvtCreateRenderContext. "next_event" and "close_event" are the
+ * numbers of event handles which EvtNext returned and EvtClose closed,
+ * and "invalid_close" is the number of EvtClose calls with a handle
+ * which is not open.
+ *
+ * @return [Hash]
+ */
+static VALUE
+rb_winevt_fake_backend_calls(VALUE self)
+{
+  static const char* names[WINEVT_FAKE_CALL_END] = {
+    "create_render_context",
+    "lookup_account_sid",
+    "next_event",
+    "close_event",
+    "invalid_close",
+  };
+  VALUE hash = rb_hash_new();
+
+  for (int i = 0; i < WINEVT_FAKE_CALL_END; i++) {
+    rb_hash_aset(hash,
+                 rb_str_new_cstr(names[i]),
+                 ULL2NUM(winevt_fake_backend_calls((enum WinevtFakeBackendCall)i)));
+  }
+
+  return hash;
+}
+
+/*
+ * This method moves the clock of the fake backend, by which cached
+ * SIDs expire, forward.
+ *
+ * @param seconds [Integer]
+ * @return [nil]
+ */
+static VALUE
+rb_winevt_fake_backend_advance_clock(VALUE self, VALUE rb_seconds)
+{
+  winevt_fake_backend_advance_clock(NUM2ULL(rb_seconds) * 1000);
+
+  return Qnil;
+}
+
+/*
+ * This method sets how long EvtNext takes to return events, like
+ * EvtNext of a remote session.
+ *
+ * @param msec [Integer]
+ * @return [Integer]
+ */
+static VALUE
+rb_winevt_fake_backend_set_next_latency(VALUE self, VALUE rb_msec)
+{
+  winevt_fake_backend_set_next_latency(NUM2ULONG(rb_msec));
+
+  return rb_msec;
+}
+#endif /* WINEVT_FAKE_BACKEND */
+
+void
+Init_winevt_backend(VALUE rb_cEventLog)
+{
+  rb_define_singleton_method(rb_cEventLog, "backend", rb_winevt_eventlog_backend, 0);
+
+#ifdef WINEVT_FAKE_BACKEND
+  rb_mFakeBackend = rb_define_module_under(rb_cEventLog, "FakeBackend");
+  rb_define_module_function(rb_mFakeBackend, "reset", rb_winevt_fake_backend_reset, -1);
+  rb_define_module_function(rb_mFakeBackend, "write", rb_winevt_fake_backend_write, -1);
+  rb_define_module_function(rb_mFakeBackend, "calls", rb_winevt_fake_backend_calls, 0);
+  rb_define_module_function(rb_mFakeBackend, "advance_clock", rb_winevt_fake_backend_advance_clock, 1);
+  rb_define_module_function(rb_mFakeBackend, "next_latency=", rb_winevt_fake_backend_set_next_latency, 1);
+#endif /* WINEVT_FAKE_BACKEND */
+}
@@ -0,0 +1,104 @@
+#ifndef _WINEVT_BACKEND_H_
+#define _WINEVT_BACKEND_H_
+
+/*
+ * Table of the wevtapi functions which the extension calls.
+ *
+ * Query, Subscribe, Bookmark, Channel and the renderer never call
+ * wevtapi directly but through winevt_backend. It points to wevtapi on
+ * Windows, or to an in-memory event source when the extension is built
+ * or started for it (see winevt_backend.c). The members have the
+ * signatures of the functions they stand for, so that wevtapi can be
+ * put into the table as is.
+ */
+
+#include <winevt.h>
+
+struct WinevtBackend
+{
+  const char* name;
+
+  EVT_HANDLE (WINAPI* query)(EVT_HANDLE session, LPCWSTR path, LPCWSTR query,
+                             DWORD flags);
+  BOOL (WINAPI* next)(EVT_HANDLE resultSet, DWORD eventsSize, PEVT_HANDLE events,
+                      DWORD timeout, DWORD flags, PDWORD returned);
+  BOOL (WINAPI* seek)(EVT_HANDLE resultSet, LONGLONG position, EVT_HANDLE bookmark,
+                      DWORD timeout, DWORD flags);
+  BOOL (WINAPI* render)(EVT_HANDLE context, EVT_HANDLE fragment, DWORD flags,
+                        DWORD bufferSize, PVOID buffer, PDWORD bufferUsed,
+                        PDWORD propertyCount);
+  BOOL (WINAPI* formatMessage)(EVT_HANDLE publisherMetadata, EVT_HANDLE event,
+                               DWORD messageId, DWORD valueCount, PEVT_VARIANT values,
+                               DWORD flags, DWORD bufferSize, LPWSTR buffer,
+                               PDWORD bufferUsed);
+  EVT_HANDLE (WINAPI* subscribe)(EVT_HANDLE session, HANDLE signalEvent,
+                                 LPCWSTR channelPath, LPCWSTR query,
+                                 EVT_HANDLE bookmark, PVOID context,
+                                 EVT_SUBSCRIBE_CALLBACK callback, DWORD flags);
+  EVT_HANDLE (WINAPI* createBookmark)(LPCWSTR bookmarkXml);
+  BOOL (WINAPI* updateBookmark)(EVT_HANDLE bookmark, EVT_HANDLE event);
+  BOOL (WINAPI* close)(EVT_HANDLE object);
+  BOOL (WINAPI* cancel)(EVT_HANDLE object);
+
+  /* Handles which rendering and channel enumeration depend on. */
+  EVT_HANDLE (WINAPI* createRenderContext)(DWORD valuePathsCount, LPCWSTR* valuePaths,
+                                           DWORD flags);
+  EVT_HANDLE (WINAPI* openPublisherMetadata)(EVT_HANDLE session, LPCWSTR publisherId,
+                                             LPCWSTR logFilePath, LCID locale,
+                                             DWORD flags);
+  EVT_HANDLE (WINAPI* openSession)(EVT_LOGIN_CLASS loginClass, PVOID login,
+                                   DWORD timeout, DWORD flags);
+  EVT_HANDLE (WINAPI* openChannelEnum)(EVT_HANDLE session, DWORD flags);
+  BOOL (WINAPI* nextChannelPath)(EVT_HANDLE channelEnum, DWORD channelPathBufferSize,
+                                 LPWSTR channelPathBuffer,
+                                 PDWORD channelPathBufferUsed);
+  EVT_HANDLE (WINAPI* openChannelConfig)(EVT_HANDLE session, LPCWSTR channelPath,
+                                         DWORD flags);
+  BOOL (WINAPI* getChannelConfigProperty)(EVT_HANDLE channelConfig,
+                                          EVT_CHANNEL_CONFIG_PROPERTY_ID propertyId,
+                                          DWORD flags, DWORD propertyValueBufferSize,
+                                          PEVT_VARIANT propertyValueBuffer,
+                                          PDWORD propertyValueBufferUsed);
+
+  /* advapi32 and kernel32 functions which the SID cache depends on. */
+  BOOL (WINAPI* lookupAccountSid)(LPCWSTR systemName, PSID sid, LPWSTR name,
+                                  LPDWORD nameSize, LPWSTR referencedDomainName,
+                                  LPDWORD referencedDomainNameSize, PSID_NAME_USE use);
+  ULONGLONG (WINAPI* tickCount64)(void);
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+extern const struct WinevtBackend* winevt_backend;
+
+#ifdef WINEVT_FAKE_BACKEND
+extern const struct WinevtBackend winevt_fake_backend;
+
+/* Functions of winevt_fake_backend whose calls are counted. */
+enum WinevtFakeBackendCall
+{
+  WINEVT_FAKE_CALL_CREATE_RENDER_CONTEXT,
+  WINEVT_FAKE_CALL_LOOKUP_ACCOUNT_SID,
+  /* Event handles which EvtNext returns and EvtClose closes */
+  WINEVT_FAKE_CALL_NEXT_EVENT,
+  WINEVT_FAKE_CALL_CLOSE_EVENT,
+  /* EvtClose of a handle which is not open */
+  WINEVT_FAKE_CALL_INVALID_CLOSE,
+  WINEVT_FAKE_CALL_END,
+};
+
+/* Controls the in-memory event source of winevt_fake_backend. */
+void winevt_fake_backend_reset(DWORD eventsPerChannel);
+BOOL winevt_fake_backend_write(const char* channel, DWORD count);
+ULONGLONG winevt_fake_backend_calls(enum WinevtFakeBackendCall call);
+void winevt_fake_backend_advance_clock(ULONGLONG msec);
+void winevt_fake_backend_set_next_latency(DWORD msec);
+#endif /* WINEVT_FAKE_BACKEND */
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif // _WINEVT_BACKEND_H_
@@ -0,0 +1,1327 @@
+#include <winevt_c.h>
+
+#include <atomic>
+#include <chrono>
+#include <ctype.h>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+/*
+ * In-memory event source with the interface of wevtapi.
+ *
+ * Channels hold events whose contents are derived from their record
+ * IDs, so that nothing but the number of events is stored. Rendered
+ * values have the layout which wevtapi produces: an array of
+ * EVT_VARIANT followed by the strings, GUIDs, SIDs and binaries they
+ * point to, in the buffer of the caller. XPath queries are accepted
+ * but not evaluated, and subscriptions only support the pull model
+ * with a signal event.
+ */
+
+#define FAKE_DEFAULT_EVENTS_PER_CHANNEL 1000
+#define FAKE_PROVIDER_NAME "Winevt-Fake"
+#define FAKE_COMPUTER_NAME "fake-host"
+#define FAKE_USER_VALUE_COUNT 13
+/* 2024-01-01T00:00:00Z in 100-nanosecond intervals since 1601. */
+#define FAKE_BASE_FILETIME 133485408000000000ULL
+#define FAKE_CHANNEL_TYPE_ADMIN 0
+#define FAKE_CHANNEL_TYPE_DEBUG 2
+
+static const GUID fakeProviderGuid = {
+  0x3c1e2d5a, 0x1b2c, 0x4d3e, { 0x8f, 0x4a, 0x5b, 0x6c, 0x7d, 0x8e, 0x9f, 0xa0 }
+};
+
+/* S-1-5-18 (LocalSystem), S-1-5-19 (LocalService) and S-1-5-21-1-2-3-1001,
+ * which is not mapped to an account. */
+static const BYTE fakeSystemSid[] = { 1, 1, 0, 0, 0, 0, 0, 5, 18, 0, 0, 0 };
+static const BYTE fakeLocalServiceSid[] = { 1, 1, 0, 0, 0, 0, 0, 5, 19, 0, 0, 0 };
+static const BYTE fakeUserSid[] = { 1, 5, 0, 0, 0, 0, 0, 5, 21, 0, 0, 0, 1, 0, 0, 0,
+                                    2, 0, 0, 0, 3, 0, 0, 0, 0xe9, 3, 0, 0 };
+
+enum FakeObjectType
+{
+  FAKE_OBJECT_RENDER_CONTEXT,
+  FAKE_OBJECT_RESULT_SET,
+  FAKE_OBJECT_SUBSCRIPTION,
+  FAKE_OBJECT_EVENT,
+  FAKE_OBJECT_BOOKMARK,
+  FAKE_OBJECT_PUBLISHER,
+  FAKE_OBJECT_SESSION,
+  FAKE_OBJECT_CHANNEL_ENUM,
+  FAKE_OBJECT_CHANNEL_CONFIG,
+};
+
+struct FakeObject;
+
+/* Handles which are open, so that closing a handle twice is detected
+ * instead of deleting it again. */
+struct FakeHandles
+{
+  std::mutex lock;
+  std::set<FakeObject*> open;
+};
+
+static FakeHandles&
+fake_handles()
+{
+  static FakeHandles handles;
+  return handles;
+}
+
+/* Every handle of the fake backend points to a FakeObject. */
+struct FakeObject
+{
+  explicit FakeObject(FakeObjectType type)
+    : type(type)
+  {
+    FakeHandles& handles = fake_handles();
+    std::lock_guard<std::mutex> guard(handles.lock);
+    handles.open.insert(this);
+  }
+  virtual ~FakeObject()
+  {
+    FakeHandles& handles = fake_handles();
+    std::lock_guard<std::mutex> guard(handles.lock);
+    handles.open.erase(this);
+  }
+
+  FakeObjectType type;
+};
+
+struct FakeSubscription;
+
+struct FakeChannel
+{
+  const char* name;
+  DWORD type;
+  ULONGLONG count;
+  std::vector<FakeSubscription*> subscriptions;
+};
+
+struct FakeStore
+{
+  FakeStore();
+
+  std::mutex lock;
+  std::vector<FakeChannel> channels;
+};
+
+/* Numbers of calls, which tests check. They are cleared by
+ * winevt_fake_backend_reset(). */
+static std::atomic<ULONGLONG> fakeCalls[WINEVT_FAKE_CALL_END];
+/* Milliseconds which the clock is moved forward by. */
+static std::atomic<ULONGLONG> fakeClockOffset;
+/* Milliseconds which EvtNext takes to return events, like EvtNext of
+ * a remote session. */
+static std::atomic<DWORD> fakeNextLatency;
+
+static FakeStore&
+fake_store()
+{
+  static FakeStore store;
+  return store;
+}
+
+static DWORD
+default_events_per_channel()
+{
+  const char* env = getenv("WINEVT_FAKE_EVENTS");
+
+  if (env == nullptr || *env == '\0') {
+    return FAKE_DEFAULT_EVENTS_PER_CHANNEL;
+  }
+
+  return strtoul(env, nullptr, 10);
+}
+
+FakeStore::FakeStore()
+{
+  static const struct
+  {
+    const char* name;
+    DWORD type;
+  } definitions[] = {
+    { "Application", FAKE_CHANNEL_TYPE_ADMIN },
+    { "System", FAKE_CHANNEL_TYPE_ADMIN },
+    { "Security", FAKE_CHANNEL_TYPE_ADMIN },
+    { "Setup", FAKE_CHANNEL_TYPE_ADMIN },
+    { "Winevt-Fake/Debug", FAKE_CHANNEL_TYPE_DEBUG },
+  };
+  DWORD count = default_events_per_channel();
+
+  for (size_t i = 0; i < _countof(definitions); i++) {
+    FakeChannel channel;
+    channel.name = definitions[i].name;
+    channel.type = definitions[i].type;
+    channel.count = count;
+    channels.push_back(channel);
+  }
+}
+
+struct FakeRenderContext : FakeObject
+{
+  FakeRenderContext()
+    : FakeObject(FAKE_OBJECT_RENDER_CONTEXT)
+  {
+  }
+
+  DWORD flags;
+  // Paths of an EvtRenderContextValues context.
+  std::vector<std::string> paths;
+};
+
+struct FakeResultSet : FakeObject
+{
+  FakeResultSet()
+    : FakeObject(FAKE_OBJECT_RESULT_SET)
+  {
+  }
+
+  size_t channel;
+  bool reverse;
+  // Set by EvtCancel from other threads.
+  std::atomic<bool> cancelled;
+  // When the events which EvtNext waits for are ready.
+  ULONGLONG readyAt;
+  // Number of events at the time of the query, for reverse queries.
+  ULONGLONG total;
+  // Index of the next event in the direction of the query.
+  ULONGLONG position;
+};
+
+struct FakeSubscription : FakeObject
+{
+  FakeSubscription()
+    : FakeObject(FAKE_OBJECT_SUBSCRIPTION)
+  {
+  }
+  ~FakeSubscription();
+
+  size_t channel;
+  std::atomic<bool> cancelled;
+  ULONGLONG readyAt;
+  HANDLE signalEvent;
+  ULONGLONG nextRecordId;
+};
+
+struct FakeEvent : FakeObject
+{
+  FakeEvent(size_t channel, ULONGLONG recordId)
+    : FakeObject(FAKE_OBJECT_EVENT)
+    , channel(channel)
+    , recordId(recordId)
+  {
+  }
+
+  size_t channel;
+  ULONGLONG recordId;
+};
+
+struct FakeBookmark : FakeObject
+{
+  FakeBookmark()
+    : FakeObject(FAKE_OBJECT_BOOKMARK)
+    , channel(0)
+    , recordId(0)
+  {
+  }
+
+  std::string channelName;
+  size_t channel;
+  // 0 for an empty bookmark.
+  ULONGLONG recordId;
+};
+
+struct FakeHandle : FakeObject
+{
+  FakeHandle(FakeObjectType type, size_t index)
+    : FakeObject(type)
+    , index(index)
+  {
+  }
+
+  // Position of a channel enumeration, or the channel of its config.
+  size_t index;
+};
+
+FakeSubscription::~FakeSubscription()
+{
+  FakeStore& store = fake_store();
+  std::lock_guard<std::mutex> guard(store.lock);
+  std::vector<FakeSubscription*>& subscriptions = store.channels[channel].subscriptions;
+
+  for (size_t i = 0; i < subscriptions.size(); i++) {
+    if (subscriptions[i] == this) {
+      subscriptions.erase(subscriptions.begin() + i);
+      break;
+    }
+  }
+}
+
+template<typename T>
+static T*
+fake_object(EVT_HANDLE handle, FakeObjectType type)
+{
+  FakeObject* object = static_cast<FakeObject*>(handle);
+
+  if (object == nullptr || object->type != type) {
+    SetLastError(ERROR_INVALID_HANDLE);
+    return nullptr;
+  }
+
+  return static_cast<T*>(object);
+}
+
+static EVT_HANDLE
+succeed(FakeObject* object)
+{
+  SetLastError(ERROR_SUCCESS);
+  return object;
+}
+
+static BOOL
+succeed()
+{
+  SetLastError(ERROR_SUCCESS);
+  return TRUE;
+}
+
+static BOOL
+fail(DWORD status)
+{
+  SetLastError(status);
+  return FALSE;
+}
+
+/* Only ASCII is generated, so narrowing drops everything else. */
+static std::string
+narrow(LPCWSTR wstr)
+{
+  std::string str;
+
+  for (; wstr && *wstr; wstr++) {
+    str += (*wstr < 0x80) ? static_cast<char>(*wstr) : '?';
+  }
+
+  return str;
+}
+
+/* Channel names are case insensitive as in wevtapi. */
+static bool
+equal_ignoring_case(const char* a, const char* b)
+{
+  for (; *a && *b; a++, b++) {
+    if (tolower(static_cast<unsigned char>(*a)) != tolower(static_cast<unsigned char>(*b))) {
+      return false;
+    }
+  }
+
+  return *a == *b;
+}
+
+static bool
+find_channel(const FakeStore& store, const std::string& name, size_t* index)
+{
+  for (size_t i = 0; i < store.channels.size(); i++) {
+    if (equal_ignoring_case(store.channels[i].name, name.c_str())) {
+      *index = i;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/* Writes text as NUL terminated UTF-16 into the buffer of the caller.
+ * Sizes are in bytes. */
+static BOOL
+copy_wide(const std::string& text, DWORD bufferSize, PVOID buffer, PDWORD bufferUsed)
+{
+  DWORD needed = (text.size() + 1) * sizeof(WCHAR);
+
+  *bufferUsed = needed;
+  if (buffer == nullptr || bufferSize < needed) {
+    return fail(ERROR_INSUFFICIENT_BUFFER);
+  }
+
+  WCHAR* p = static_cast<WCHAR*>(buffer);
+  for (size_t i = 0; i < text.size(); i++) {
+    p[i] = static_cast<unsigned char>(text[i]);
+  }
+  p[text.size()] = 0;
+
+  return succeed();
+}
+
+/*
+ * Lays out EVT_VARIANTs and the data they point to as EvtRender does.
+ * Pointers are recorded as offsets into the data area and are fixed up
+ * when the values are copied into the buffer of the caller.
+ */
+class FakeValues
+{
+public:
+  explicit FakeValues(size_t count)
+    : variants_(count)
+  {
+    memset(variants_.data(), 0, count * sizeof(EVT_VARIANT));
+    data_.reserve(256);
+  }
+
+  EVT_VARIANT& operator[](size_t i) { return variants_[i]; }
+
+  void setString(size_t i, const std::string& value)
+  {
+    size_t offset = append(nullptr, (value.size() + 1) * sizeof(WCHAR));
+    for (size_t j = 0; j <= value.size(); j++) {
+      uint16_t c = j < value.size() ? static_cast<unsigned char>(value[j]) : 0;
+      memcpy(&data_[offset + j * sizeof(WCHAR)], &c, sizeof(c));
+    }
+    setPointer(i, EvtVarTypeString, offset, 0);
+  }
+
+  void setGuid(size_t i, const GUID& guid)
+  {
+    setPointer(i, EvtVarTypeGuid, append(&guid, sizeof(guid)), 0);
+  }
+
+  void setSid(size_t i, const BYTE* sid, size_t size)
+  {
+    setPointer(i, EvtVarTypeSid, append(sid, size), 0);
+  }
+
+  void setBinary(size_t i, const BYTE* bytes, size_t size)
+  {
+    setPointer(i, EvtVarTypeBinary, append(bytes, size), static_cast<UINT32>(size));
+  }
+
+  void setSysTime(size_t i, const SYSTEMTIME& time)
+  {
+    setPointer(i, EvtVarTypeSysTime, append(&time, sizeof(time)), 0);
+  }
+
+  BOOL copyTo(DWORD bufferSize, PVOID buffer, PDWORD bufferUsed, PDWORD propertyCount)
+  {
+    size_t header = variants_.size() * sizeof(EVT_VARIANT);
+    DWORD needed = header + data_.size();
+
+    *bufferUsed = needed;
+    *propertyCount = variants_.size();
+    if (buffer == nullptr || bufferSize < needed) {
+      return fail(ERROR_INSUFFICIENT_BUFFER);
+    }
+
+    BYTE* base = static_cast<BYTE*>(buffer);
+    memcpy(base + header, data_.data(), data_.size());
+    for (size_t i = 0; i < pointers_.size(); i++) {
+      variants_[pointers_[i].first].BinaryVal = base + header + pointers_[i].second;
+    }
+    memcpy(base, variants_.data(), header);
+
+    return succeed();
+  }
+
+private:
+  size_t append(const void* bytes, size_t size)
+  {
+    // Keep values 8 byte aligned as in the buffers of wevtapi.
+    size_t offset = (data_.size() + 7) & ~static_cast<size_t>(7);
+    data_.resize(offset + size);
+    if (bytes) {
+      memcpy(&data_[offset], bytes, size);
+    }
+    return offset;
+  }
+
+  void setPointer(size_t i, DWORD type, size_t offset, UINT32 count)
+  {
+    variants_[i].Type = type;
+    variants_[i].Count = count;
+    pointers_.push_back(std::make_pair(i, offset));
+  }
+
+  std::vector<EVT_VARIANT> variants_;
+  std::vector<BYTE> data_;
+  std::vector<std::pair<size_t, size_t>> pointers_;
+};
+
+/* Contents of an event, derived from its record ID. */
+struct FakeEventData
+{
+  explicit FakeEventData(const FakeChannel& channel, ULONGLONG recordId)
+    : channel(channel.name)
+    , recordId(recordId)
+    , eventId(static_cast<UINT16>(1000 + recordId % 16))
+    , level(static_cast<UINT8>(2 + recordId % 3))
+    , keywords(0x80000000000000ULL)
+    , timeCreated(FAKE_BASE_FILETIME + recordId * 10000000ULL + recordId % 10 * 1234)
+    , threadId(static_cast<UINT32>(100 + recordId % 8))
+    , hasActivityId(recordId % 2 == 1)
+    , sid(fakeSystemSid)
+    , sidSize(sizeof(fakeSystemSid))
+  {
+    char buffer[32];
+
+    // Events of accounts repeat as S-1-5-18, S-1-5-18, unmapped, S-1-5-18,
+    // S-1-5-19 and unmapped, so that caches of SIDs are exercised.
+    if (recordId % 3 == 0) {
+      sid = fakeUserSid;
+      sidSize = sizeof(fakeUserSid);
+    } else if (recordId % 6 == 5) {
+      sid = fakeLocalServiceSid;
+      sidSize = sizeof(fakeLocalServiceSid);
+    }
+    snprintf(buffer, sizeof(buffer), "value %llu", static_cast<unsigned long long>(recordId));
+    value = buffer;
+    activityId = fakeProviderGuid;
+    activityId.Data1 = static_cast<uint32_t>(recordId);
+    for (int i = 0; i < 8; i++) {
+      binary[i] = static_cast<BYTE>(recordId >> (i * 8));
+    }
+  }
+
+  std::string channel;
+  ULONGLONG recordId;
+  UINT16 eventId;
+  UINT8 level;
+  ULONGLONG keywords;
+  ULONGLONG timeCreated;
+  UINT32 threadId;
+  bool hasActivityId;
+  GUID activityId;
+  const BYTE* sid;
+  size_t sidSize;
+  std::string value;
+  BYTE binary[8];
+};
+
+static BOOL
+render_system_values(const FakeEventData& event, DWORD bufferSize, PVOID buffer,
+                     PDWORD bufferUsed, PDWORD propertyCount)
+{
+  FakeValues values(EvtSystemPropertyIdEND);
+
+  values.setString(EvtSystemProviderName, FAKE_PROVIDER_NAME);
+  values.setGuid(EvtSystemProviderGuid, fakeProviderGuid);
+  values[EvtSystemEventID].Type = EvtVarTypeUInt16;
+  values[EvtSystemEventID].UInt16Val = event.eventId;
+  values[EvtSystemQualifiers].Type = EvtVarTypeNull;
+  values[EvtSystemLevel].Type = EvtVarTypeByte;
+  values[EvtSystemLevel].ByteVal = event.level;
+  values[EvtSystemTask].Type = EvtVarTypeUInt16;
+  values[EvtSystemTask].UInt16Val = 0;
+  values[EvtSystemOpcode].Type = EvtVarTypeByte;
+  values[EvtSystemOpcode].ByteVal = 0;
+  values[EvtSystemKeywords].Type = EvtVarTypeHexInt64;
+  values[EvtSystemKeywords].UInt64Val = event.keywords;
+  values[EvtSystemTimeCreated].Type = EvtVarTypeFileTime;
+  values[EvtSystemTimeCreated].FileTimeVal = event.timeCreated;
+  values[EvtSystemEventRecordId].Type = EvtVarTypeUInt64;
+  values[EvtSystemEventRecordId].UInt64Val = event.recordId;
+  if (event.hasActivityId) {
+    values.setGuid(EvtSystemActivityID, event.activityId);
+  }
+  values[EvtSystemProcessID].Type = EvtVarTypeUInt32;
+  values[EvtSystemProcessID].UInt32Val = 4;
+  values[EvtSystemThreadID].Type = EvtVarTypeUInt32;
+  values[EvtSystemThreadID].UInt32Val = event.threadId;
+  values.setString(EvtSystemChannel, event.channel);
+  values.setString(EvtSystemComputer, FAKE_COMPUTER_NAME);
+  values.setSid(EvtSystemUserID, event.sid, event.sidSize);
+  values[EvtSystemVersion].Type = EvtVarTypeByte;
+  values[EvtSystemVersion].ByteVal = 0;
+
+  return values.copyTo(bufferSize, buffer, bufferUsed, propertyCount);
+}
+
+static BOOL
+render_user_values(const FakeEventData& event, DWORD bufferSize, PVOID buffer,
+                   PDWORD bufferUsed, PDWORD propertyCount)
+{
+  FakeValues values(FAKE_USER_VALUE_COUNT);
+
+  values.setString(0, event.value);
+  values[1].Type = EvtVarTypeUInt32;
+  values[1].UInt32Val = static_cast<UINT32>(event.recordId);
+  values[2].Type = EvtVarTypeHexInt64;
+  values[2].UInt64Val = event.recordId * 0x10001ULL;
+  values[3].Type = EvtVarTypeBoolean;
+  values[3].BooleanVal = event.recordId % 2 == 1;
+  values.setGuid(4, event.activityId);
+  values.setSid(5, event.sid, event.sidSize);
+  values.setBinary(6, event.binary, sizeof(event.binary));
+  values[7].Type = EvtVarTypeFileTime;
+  values[7].FileTimeVal = event.timeCreated;
+  values[8].Type = EvtVarTypeSByte;
+  values[8].SByteVal = static_cast<INT8>(-static_cast<int>(event.recordId % 100) - 1);
+  values[9].Type = EvtVarTypeSingle;
+  values[9].SingleVal = event.recordId / 3.0f;
+  values[10].Type = EvtVarTypeDouble;
+  values[10].DoubleVal = event.recordId / 7.0;
+  values[11].Type = EvtVarTypeHexInt32;
+  values[11].UInt32Val = static_cast<UINT32>((event.recordId - 1) % 4 * 0x1000);
+  FILETIME fileTime;
+  SYSTEMTIME sysTime;
+  fileTime.dwLowDateTime = static_cast<DWORD>(event.timeCreated);
+  fileTime.dwHighDateTime = static_cast<DWORD>(event.timeCreated >> 32);
+  FileTimeToSystemTime(&fileTime, &sysTime);
+  values.setSysTime(12, sysTime);
+
+  return values.copyTo(bufferSize, buffer, bufferUsed, propertyCount);
+}
+
+static BOOL
+render_path_values(const FakeRenderContext* context, const FakeEventData& event,
+                   DWORD bufferSize, PVOID buffer, PDWORD bufferUsed,
+                   PDWORD propertyCount)
+{
+  FakeValues values(context->paths.size());
+
+  for (size_t i = 0; i < context->paths.size(); i++) {
+    const std::string& path = context->paths[i];
+    if (path == "Event/System/Provider/@Name") {
+      values.setString(i, FAKE_PROVIDER_NAME);
+    } else if (path == "Event/System/Channel") {
+      values.setString(i, event.channel);
+    } else if (path == "Event/System/EventRecordID") {
+      values[i].Type = EvtVarTypeUInt64;
+      values[i].UInt64Val = event.recordId;
+    }
+  }
+
+  return values.copyTo(bufferSize, buffer, bufferUsed, propertyCount);
+}
+
+static std::string
+format_guid(const GUID& guid)
+{
+  char buffer[40];
+
+  snprintf(buffer,
+           sizeof(buffer),
+           "{%08X-%04X-%04X-%02X%02X-%02X%02X%02X%02X%02X%02X}",
+           static_cast<unsigned int>(guid.Data1),
+           guid.Data2,
+           guid.Data3,
+           guid.Data4[0],
+           guid.Data4[1],
+           guid.Data4[2],
+           guid.Data4[3],
+           guid.Data4[4],
+           guid.Data4[5],
+           guid.Data4[6],
+           guid.Data4[7]);
+
+  return buffer;
+}
+
+static std::string
+format_sid(const BYTE* sid)
+{
+  std::string str = "S-1-" + std::to_string(sid[7]);
+
+  for (int i = 0; i < sid[1]; i++) {
+    const BYTE* sub = sid + 8 + 4 * i;
+    str += "-" + std::to_string(sub[0] | (sub[1] << 8) | (sub[2] << 16) |
+                                (static_cast<uint32_t>(sub[3]) << 24));
+  }
+
+  return str;
+}
+
+static std::string
+render_event_xml(const FakeEventData& event)
+{
+  ULONGLONG seconds = event.timeCreated / 10000000ULL - 11644473600ULL;
+  time_t t = static_cast<time_t>(seconds);
+  struct tm tm;
+  char time[64];
+  char buffer[512];
+
+#ifdef _WIN32
+  gmtime_s(&tm, &t);
+#else
+  gmtime_r(&t, &tm);
+#endif /* _WIN32 */
+  snprintf(time,
+           sizeof(time),
+           "%04d-%02d-%02dT%02d:%02d:%02d.%07lluZ",
+           tm.tm_year + 1900,
+           tm.tm_mon + 1,
+           tm.tm_mday,
+           tm.tm_hour,
+           tm.tm_min,
+           tm.tm_sec,
+           static_cast<unsigned long long>(event.timeCreated % 10000000ULL));
+  snprintf(buffer,
+           sizeof(buffer),
+           "<Event xmlns='http://schemas.microsoft.com/win/2004/08/events/event'>"
+           "<System><Provider Name='" FAKE_PROVIDER_NAME "' Guid='%s'/>"
+           "<EventID>%u</EventID><Version>0</Version><Level>%u</Level>"
+           "<Task>0</Task><Opcode>0</Opcode><Keywords>0x%llx</Keywords>"
+           "<TimeCreated SystemTime='%s'/><EventRecordID>%llu</EventRecordID>",
+           format_guid(fakeProviderGuid).c_str(),
+           event.eventId,
+           event.level,
+           static_cast<unsigned long long>(event.keywords),
+           time,
+           static_cast<unsigned long long>(event.recordId));
+
+  std::string xml = buffer;
+  if (event.hasActivityId) {
+    xml += "<Correlation ActivityID='" + format_guid(event.activityId) + "'/>";
+  } else {
+    xml += "<Correlation/>";
+  }
+  snprintf(buffer,
+           sizeof(buffer),
+           "<Execution ProcessID='4' ThreadID='%u'/><Channel>%s</Channel>"
+           "<Computer>" FAKE_COMPUTER_NAME "</Computer>",
+           event.threadId,
+           event.channel.c_str());
+  xml += buffer;
+  xml += "<Security UserID='" + format_sid(event.sid) + "'/></System>";
+  xml += "<EventData><Data Name='Value'>" + event.value + "</Data>";
+  xml += "<Data Name='RecordId'>" + std::to_string(event.recordId) + "</Data>";
+  xml += "</EventData></Event>";
+
+  return xml;
+}
+
+static std::string
+render_bookmark_xml(const FakeBookmark* bookmark)
+{
+  std::string xml = "<BookmarkList>\r\n";
+
+  if (bookmark->recordId > 0) {
+    xml += "  <Bookmark Channel='" + bookmark->channelName + "' RecordId='" +
+           std::to_string(bookmark->recordId) + "' IsCurrent='true'/>\r\n";
+  }
+  xml += "</BookmarkList>";
+
+  return xml;
+}
+
+static bool
+parse_attribute(const std::string& xml, const char* name, std::string* value)
+{
+  std::string pattern = std::string(name) + "='";
+  size_t start = xml.find(pattern);
+
+  if (start == std::string::npos) {
+    return false;
+  }
+  start += pattern.size();
+
+  size_t end = xml.find('\'', start);
+  if (end == std::string::npos) {
+    return false;
+  }
+  *value = xml.substr(start, end - start);
+
+  return true;
+}
+
+static EVT_HANDLE WINAPI
+fake_create_bookmark(LPCWSTR bookmarkXml)
+{
+  FakeStore& store = fake_store();
+  FakeBookmark* bookmark = new FakeBookmark();
+  std::string xml = narrow(bookmarkXml);
+  std::string channel, recordId;
+
+  if (bookmarkXml == nullptr || xml.find("<Bookmark ") == std::string::npos) {
+    return succeed(bookmark);
+  }
+
+  if (!parse_attribute(xml, "Channel", &channel) ||
+      !parse_attribute(xml, "RecordId", &recordId) ||
+      !find_channel(store, channel, &bookmark->channel)) {
+    delete bookmark;
+    SetLastError(ERROR_INVALID_PARAMETER);
+    return nullptr;
+  }
+  bookmark->channelName = store.channels[bookmark->channel].name;
+  bookmark->recordId = strtoull(recordId.c_str(), nullptr, 10);
+
+  return succeed(bookmark);
+}
+
+static BOOL WINAPI
+fake_update_bookmark(EVT_HANDLE bookmarkHandle, EVT_HANDLE eventHandle)
+{
+  FakeBookmark* bookmark = fake_object<FakeBookmark>(bookmarkHandle, FAKE_OBJECT_BOOKMARK);
+  FakeEvent* event = fake_object<FakeEvent>(eventHandle, FAKE_OBJECT_EVENT);
+
+  if (bookmark == nullptr || event == nullptr) {
+    return FALSE;
+  }
+
+  bookmark->channel = event->channel;
+  bookmark->channelName = fake_store().channels[event->channel].name;
+  bookmark->recordId = event->recordId;
+
+  return succeed();
+}
+
+static EVT_HANDLE WINAPI
+fake_query(EVT_HANDLE session, LPCWSTR path, LPCWSTR query, DWORD flags)
+{
+  FakeStore& store = fake_store();
+  std::lock_guard<std::mutex> guard(store.lock);
+  size_t channel;
+
+  // XPath queries are not evaluated. Every event in the channel matches.
+  if (query != nullptr && query[0] == L'\0') {
+    SetLastError(ERROR_EVT_INVALID_QUERY);
+    return nullptr;
+  }
+  if ((flags & EvtQueryFilePath) || !find_channel(store, narrow(path), &channel)) {
+    SetLastError(ERROR_EVT_CHANNEL_NOT_FOUND);
+    return nullptr;
+  }
+
+  FakeResultSet* resultSet = new FakeResultSet();
+  resultSet->channel = channel;
+  resultSet->reverse = (flags & EvtQueryReverseDirection) != 0;
+  resultSet->cancelled = false;
+  resultSet->readyAt = 0;
+  resultSet->total = store.channels[channel].count;
+  resultSet->position = 0;
+
+  return succeed(resultSet);
+}
+
+static ULONGLONG
+steady_msec()
+{
+  std::chrono::milliseconds now = std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now().time_since_epoch());
+
+  return static_cast<ULONGLONG>(now.count());
+}
+
+/* Events are ready fakeNextLatency milliseconds after the first EvtNext
+ * which waits for them, even if that call times out. Returns false when
+ * they are not ready within timeout. */
+static bool
+wait_until_ready(ULONGLONG* readyAt, DWORD timeout)
+{
+  DWORD latency = fakeNextLatency;
+  ULONGLONG now = steady_msec();
+
+  if (latency == 0) {
+    return true;
+  }
+  if (*readyAt == 0) {
+    *readyAt = now + latency;
+  }
+
+  ULONGLONG wait = *readyAt > now ? *readyAt - now : 0;
+  if (timeout != INFINITE && wait > timeout) {
+    Sleep(timeout);
+    return false;
+  }
+  Sleep(static_cast<DWORD>(wait));
+  *readyAt = 0;
+
+  return true;
+}
+
+static BOOL WINAPI
+fake_next(EVT_HANDLE handle, DWORD eventsSize, PEVT_HANDLE events, DWORD timeout,
+          DWORD flags, PDWORD returned)
+{
+  FakeObject* object = static_cast<FakeObject*>(handle);
+  FakeStore& store = fake_store();
+  DWORD count = 0;
+
+  *returned = 0;
+  if (object == nullptr) {
+    return fail(ERROR_INVALID_HANDLE);
+  }
+
+  // Only the latency blocks in this backend. So, a cancellation is
+  // reported by the next call.
+  if (object->type == FAKE_OBJECT_RESULT_SET) {
+    FakeResultSet* resultSet = static_cast<FakeResultSet*>(object);
+    if (resultSet->cancelled.exchange(false)) {
+      return fail(ERROR_CANCELLED);
+    }
+    if (!wait_until_ready(&resultSet->readyAt, timeout)) {
+      return fail(ERROR_TIMEOUT);
+    }
+
+    std::lock_guard<std::mutex> guard(store.lock);
+    ULONGLONG available =
+      resultSet->reverse ? resultSet->total : store.channels[resultSet->channel].count;
+    for (; count < eventsSize && resultSet->position < available; count++) {
+      ULONGLONG recordId = resultSet->reverse ? resultSet->total - resultSet->position
+                                              : resultSet->position + 1;
+      events[count] = new FakeEvent(resultSet->channel, recordId);
+      resultSet->position++;
+    }
+  } else if (object->type == FAKE_OBJECT_SUBSCRIPTION) {
+    FakeSubscription* subscription = static_cast<FakeSubscription*>(object);
+    if (subscription->cancelled.exchange(false)) {
+      return fail(ERROR_CANCELLED);
+    }
+    if (!wait_until_ready(&subscription->readyAt, timeout)) {
+      return fail(ERROR_TIMEOUT);
+    }
+
+    std::lock_guard<std::mutex> guard(store.lock);
+    ULONGLONG available = store.channels[subscription->channel].count;
+    for (; count < eventsSize && subscription->nextRecordId <= available; count++) {
+      events[count] = new FakeEvent(subscription->channel, subscription->nextRecordId);
+      subscription->nextRecordId++;
+    }
+  } else {
+    return fail(ERROR_INVALID_HANDLE);
+  }
+
+  if (count == 0) {
+    return fail(ERROR_NO_MORE_ITEMS);
+  }
+
+  fakeCalls[WINEVT_FAKE_CALL_NEXT_EVENT] += count;
+  *returned = count;
+  return succeed();
+}
+
+static BOOL WINAPI
+fake_seek(EVT_HANDLE handle, LONGLONG position, EVT_HANDLE bookmarkHandle,
+          DWORD timeout, DWORD flags)
+{
+  FakeResultSet* resultSet = fake_object<FakeResultSet>(handle, FAKE_OBJECT_RESULT_SET);
+  LONGLONG origin;
+
+  if (resultSet == nullptr) {
+    return FALSE;
+  }
+  if (flags & ~(EvtSeekOriginMask | EvtSeekStrict)) {
+    return fail(ERROR_INVALID_PARAMETER);
+  }
+
+  switch (flags & EvtSeekOriginMask) {
+    case EvtSeekRelativeToFirst:
+      origin = 0;
+      break;
+    case EvtSeekRelativeToLast:
+      origin = static_cast<LONGLONG>(resultSet->total) - 1;
+      break;
+    case EvtSeekRelativeToCurrent:
+      origin = static_cast<LONGLONG>(resultSet->position);
+      break;
+    case EvtSeekRelativeToBookmark: {
+      FakeBookmark* bookmark =
+        fake_object<FakeBookmark>(bookmarkHandle, FAKE_OBJECT_BOOKMARK);
+      if (bookmark == nullptr) {
+        return FALSE;
+      }
+      if (bookmark->recordId == 0 || bookmark->channel != resultSet->channel ||
+          bookmark->recordId > resultSet->total) {
+        if (flags & EvtSeekStrict) {
+          return fail(ERROR_NOT_FOUND);
+        }
+        origin = resultSet->reverse ? 0 : static_cast<LONGLONG>(resultSet->total);
+        break;
+      }
+      origin = resultSet->reverse
+                 ? static_cast<LONGLONG>(resultSet->total - bookmark->recordId)
+                 : static_cast<LONGLONG>(bookmark->recordId - 1);
+      break;
+    }
+    default:
+      return fail(ERROR_INVALID_PARAMETER);
+  }
+
+  if (origin + position < 0) {
+    return fail(ERROR_INVALID_PARAMETER);
+  }
+  resultSet->position = origin + position;
+
+  return succeed();
+}
+
+static BOOL WINAPI
+fake_render(EVT_HANDLE contextHandle, EVT_HANDLE fragment, DWORD flags,
+            DWORD bufferSize, PVOID buffer, PDWORD bufferUsed, PDWORD propertyCount)
+{
+  FakeStore& store = fake_store();
+
+  *propertyCount = 0;
+  switch (flags) {
+    case EvtRenderBookmark: {
+      FakeBookmark* bookmark = fake_object<FakeBookmark>(fragment, FAKE_OBJECT_BOOKMARK);
+      if (bookmark == nullptr) {
+        return FALSE;
+      }
+      return copy_wide(render_bookmark_xml(bookmark), bufferSize, buffer, bufferUsed);
+    }
+    case EvtRenderEventXml: {
+      FakeEvent* event = fake_object<FakeEvent>(fragment, FAKE_OBJECT_EVENT);
+      if (event == nullptr) {
+        return FALSE;
+      }
+      FakeEventData data(store.channels[event->channel], event->recordId);
+      return copy_wide(render_event_xml(data), bufferSize, buffer, bufferUsed);
+    }
+    case EvtRenderEventValues: {
+      FakeRenderContext* context =
+        fake_object<FakeRenderContext>(contextHandle, FAKE_OBJECT_RENDER_CONTEXT);
+      FakeEvent* event = fake_object<FakeEvent>(fragment, FAKE_OBJECT_EVENT);
+      if (context == nullptr || event == nullptr) {
+        return FALSE;
+      }
+      FakeEventData data(store.channels[event->channel], event->recordId);
+      switch (context->flags) {
+        case EvtRenderContextSystem:
+          return render_system_values(data, bufferSize, buffer, bufferUsed, propertyCount);
+        case EvtRenderContextUser:
+          return render_user_values(data, bufferSize, buffer, bufferUsed, propertyCount);
+        default:
+          return render_path_values(
+            context, data, bufferSize, buffer, bufferUsed, propertyCount);
+      }
+    }
+    default:
+      return fail(ERROR_INVALID_PARAMETER);
+  }
+}
+
+static BOOL WINAPI
+fake_format_message(EVT_HANDLE publisherMetadata, EVT_HANDLE eventHandle,
+                    DWORD messageId, DWORD valueCount, PEVT_VARIANT values, DWORD flags,
+                    DWORD bufferSize, LPWSTR buffer, PDWORD bufferUsed)
+{
+  FakeEvent* event = fake_object<FakeEvent>(eventHandle, FAKE_OBJECT_EVENT);
+  DWORD bytesUsed = 0;
+  char message[128];
+
+  if (fake_object<FakeObject>(publisherMetadata, FAKE_OBJECT_PUBLISHER) == nullptr ||
+      event == nullptr) {
+    return FALSE;
+  }
+  if (flags != EvtFormatMessageEvent) {
+    return fail(ERROR_NOT_SUPPORTED);
+  }
+  // Like events of providers whose message files are missing.
+  if (event->recordId % 10 == 0) {
+    return fail(ERROR_EVT_MESSAGE_NOT_FOUND);
+  }
+
+  snprintf(message,
+           sizeof(message),
+           "Fake event %llu was written to %s.\r\n\r\nValue: value %llu",
+           static_cast<unsigned long long>(event->recordId),
+           fake_store().channels[event->channel].name,
+           static_cast<unsigned long long>(event->recordId));
+
+  // bufferSize and bufferUsed are in characters.
+  BOOL succeeded = copy_wide(message, bufferSize * sizeof(WCHAR), buffer, &bytesUsed);
+  *bufferUsed = bytesUsed / sizeof(WCHAR);
+  return succeeded;
+}
+
+static EVT_HANDLE WINAPI
+fake_subscribe(EVT_HANDLE session, HANDLE signalEvent, LPCWSTR channelPath,
+               LPCWSTR query, EVT_HANDLE bookmarkHandle, PVOID context,
+               EVT_SUBSCRIBE_CALLBACK callback, DWORD flags)
+{
+  FakeStore& store = fake_store();
+  FakeBookmark* bookmark = nullptr;
+  size_t channel;
+
+  if (callback != nullptr || signalEvent == nullptr) {
+    SetLastError(ERROR_NOT_SUPPORTED);
+    return nullptr;
+  }
+  if (query != nullptr && query[0] == L'\0') {
+    SetLastError(ERROR_EVT_INVALID_QUERY);
+    return nullptr;
+  }
+  if ((flags & EvtSubscribeOriginMask) == EvtSubscribeStartAfterBookmark) {
+    bookmark = fake_object<FakeBookmark>(bookmarkHandle, FAKE_OBJECT_BOOKMARK);
+    if (bookmark == nullptr) {
+      return nullptr;
+    }
+  }
+
+  std::lock_guard<std::mutex> guard(store.lock);
+  if (!find_channel(store, narrow(channelPath), &channel)) {
+    SetLastError(ERROR_EVT_CHANNEL_NOT_FOUND);
+    return nullptr;
+  }
+
+  FakeSubscription* subscription = new FakeSubscription();
+  subscription->channel = channel;
+  subscription->cancelled = false;
+  subscription->readyAt = 0;
+  subscription->signalEvent = signalEvent;
+  switch (flags & EvtSubscribeOriginMask) {
+    case EvtSubscribeStartAtOldestRecord:
+      subscription->nextRecordId = 1;
+      break;
+    case EvtSubscribeStartAfterBookmark:
+      subscription->nextRecordId =
+        bookmark->channel == channel ? bookmark->recordId + 1 : 1;
+      break;
+    default:
+      subscription->nextRecordId = store.channels[channel].count + 1;
+      break;
+  }
+  store.channels[channel].subscriptions.push_back(subscription);
+
+  return succeed(subscription);
+}
+
+static BOOL WINAPI
+fake_close(EVT_HANDLE handle)
+{
+  if (handle == nullptr) {
+    return fail(ERROR_INVALID_HANDLE);
+  }
+
+  FakeObject* object = static_cast<FakeObject*>(handle);
+  {
+    FakeHandles& handles = fake_handles();
+    std::lock_guard<std::mutex> guard(handles.lock);
+    if (handles.open.count(object) == 0) {
+      fakeCalls[WINEVT_FAKE_CALL_INVALID_CLOSE]++;
+      return fail(ERROR_INVALID_HANDLE);
+    }
+  }
+  if (object->type == FAKE_OBJECT_EVENT) {
+    fakeCalls[WINEVT_FAKE_CALL_CLOSE_EVENT]++;
+  }
+
+  delete object;
+  return succeed();
+}
+
+static BOOL WINAPI
+fake_cancel(EVT_HANDLE handle)
+{
+  FakeObject* object = static_cast<FakeObject*>(handle);
+
+  if (object && object->type == FAKE_OBJECT_RESULT_SET) {
+    static_cast<FakeResultSet*>(object)->cancelled = true;
+  } else if (object && object->type == FAKE_OBJECT_SUBSCRIPTION) {
+    static_cast<FakeSubscription*>(object)->cancelled = true;
+  } else {
+    return fail(ERROR_INVALID_HANDLE);
+  }
+
+  return succeed();
+}
+
+static EVT_HANDLE WINAPI
+fake_create_render_context(DWORD valuePathsCount, LPCWSTR* valuePaths, DWORD flags)
+{
+  FakeRenderContext* context = new FakeRenderContext();
+
+  fakeCalls[WINEVT_FAKE_CALL_CREATE_RENDER_CONTEXT]++;
+  context->flags = flags;
+  if (flags == EvtRenderContextValues) {
+    for (DWORD i = 0; i < valuePathsCount; i++) {
+      context->paths.push_back(narrow(valuePaths[i]));
+    }
+  }
+
+  return succeed(context);
+}
+
+static EVT_HANDLE WINAPI
+fake_open_publisher_metadata(EVT_HANDLE session, LPCWSTR publisherId,
+                             LPCWSTR logFilePath, LCID locale, DWORD flags)
+{
+  if (narrow(publisherId) != FAKE_PROVIDER_NAME) {
+    SetLastError(ERROR_FILE_NOT_FOUND);
+    return nullptr;
+  }
+
+  return succeed(new FakeObject(FAKE_OBJECT_PUBLISHER));
+}
+
+static EVT_HANDLE WINAPI
+fake_open_session(EVT_LOGIN_CLASS loginClass, PVOID login, DWORD timeout, DWORD flags)
+{
+  if (loginClass != EvtRpcLogin || login == nullptr) {
+    SetLastError(ERROR_INVALID_PARAMETER);
+    return nullptr;
+  }
+
+  return succeed(new FakeObject(FAKE_OBJECT_SESSION));
+}
+
+static EVT_HANDLE WINAPI
+fake_open_channel_enum(EVT_HANDLE session, DWORD flags)
+{
+  return succeed(new FakeHandle(FAKE_OBJECT_CHANNEL_ENUM, 0));
+}
+
+static BOOL WINAPI
+fake_next_channel_path(EVT_HANDLE handle, DWORD channelPathBufferSize,
+                       LPWSTR channelPathBuffer, PDWORD channelPathBufferUsed)
+{
+  FakeHandle* channelEnum = fake_object<FakeHandle>(handle, FAKE_OBJECT_CHANNEL_ENUM);
+  FakeStore& store = fake_store();
+  DWORD bytesUsed = 0;
+
+  if (channelEnum == nullptr) {
+    return FALSE;
+  }
+  if (channelEnum->index >= store.channels.size()) {
+    return fail(ERROR_NO_MORE_ITEMS);
+  }
+
+  // Sizes are in characters.
+  BOOL succeeded = copy_wide(store.channels[channelEnum->index].name,
+                             channelPathBufferSize * sizeof(WCHAR),
+                             channelPathBuffer,
+                             &bytesUsed);
+  *channelPathBufferUsed = bytesUsed / sizeof(WCHAR);
+  if (succeeded) {
+    channelEnum->index++;
+  }
+
+  return succeeded;
+}
+
+static EVT_HANDLE WINAPI
+fake_open_channel_config(EVT_HANDLE session, LPCWSTR channelPath, DWORD flags)
+{
+  FakeStore& store = fake_store();
+  size_t channel;
+
+  if (!find_channel(store, narrow(channelPath), &channel)) {
+    SetLastError(ERROR_EVT_CHANNEL_NOT_FOUND);
+    return nullptr;
+  }
+
+  return succeed(new FakeHandle(FAKE_OBJECT_CHANNEL_CONFIG, channel));
+}
+
+static BOOL WINAPI
+fake_get_channel_config_property(EVT_HANDLE handle,
+                                 EVT_CHANNEL_CONFIG_PROPERTY_ID propertyId,
+                                 DWORD flags, DWORD propertyValueBufferSize,
+                                 PEVT_VARIANT propertyValueBuffer,
+                                 PDWORD propertyValueBufferUsed)
+{
+  FakeHandle* config = fake_object<FakeHandle>(handle, FAKE_OBJECT_CHANNEL_CONFIG);
+
+  if (config == nullptr) {
+    return FALSE;
+  }
+
+  *propertyValueBufferUsed = sizeof(EVT_VARIANT);
+  if (propertyValueBuffer == nullptr || propertyValueBufferSize < sizeof(EVT_VARIANT)) {
+    return fail(ERROR_INSUFFICIENT_BUFFER);
+  }
+
+  // Only the type of channels is known. Other properties are empty.
+  memset(propertyValueBuffer, 0, sizeof(EVT_VARIANT));
+  if (propertyId == EvtChannelConfigType) {
+    propertyValueBuffer->Type = EvtVarTypeUInt32;
+    propertyValueBuffer->UInt32Val = fake_store().channels[config->index].type;
+  }
+
+  return succeed();
+}
+
+/* Well-known SIDs are resolved as on Windows. */
+static BOOL WINAPI
+fake_lookup_account_sid(LPCWSTR systemName, PSID sid, LPWSTR name, LPDWORD nameSize,
+                        LPWSTR referencedDomainName, LPDWORD referencedDomainNameSize,
+                        PSID_NAME_USE use)
+{
+  fakeCalls[WINEVT_FAKE_CALL_LOOKUP_ACCOUNT_SID]++;
+
+  return LookupAccountSidW(
+    systemName, sid, name, nameSize, referencedDomainName, referencedDomainNameSize, use);
+}
+
+static ULONGLONG WINAPI
+fake_tick_count64()
+{
+  return steady_msec() + fakeClockOffset;
+}
+
+const struct WinevtBackend winevt_fake_backend = {
+  "fake",
+  fake_query,
+  fake_next,
+  fake_seek,
+  fake_render,
+  fake_format_message,
+  fake_subscribe,
+  fake_create_bookmark,
+  fake_update_bookmark,
+  fake_close,
+  fake_cancel,
+  fake_create_render_context,
+  fake_open_publisher_metadata,
+  fake_open_session,
+  fake_open_channel_enum,
+  fake_next_channel_path,
+  fake_open_channel_config,
+  fake_get_channel_config_property,
+  fake_lookup_account_sid,
+  fake_tick_count64,
+};
+
+void
+winevt_fake_backend_reset(DWORD eventsPerChannel)
+{
+  FakeStore& store = fake_store();
+  std::lock_guard<std::mutex> guard(store.lock);
+
+  for (FakeChannel& channel : store.channels) {
+    channel.count = eventsPerChannel;
+  }
+  for (std::atomic<ULONGLONG>& calls : fakeCalls) {
+    calls = 0;
+  }
+  fakeNextLatency = 0;
+}
+
+BOOL
+winevt_fake_backend_write(const char* name, DWORD count)
+{
+  FakeStore& store = fake_store();
+  std::lock_guard<std::mutex> guard(store.lock);
+  size_t channel;
+
+  if (!find_channel(store, name, &channel)) {
+    return fail(ERROR_EVT_CHANNEL_NOT_FOUND);
+  }
+
+  store.channels[channel].count += count;
+  for (FakeSubscription* subscription : store.channels[channel].subscriptions) {
+    SetEvent(subscription->signalEvent);
+  }
+
+  return succeed();
+}
+
+ULONGLONG
+winevt_fake_backend_calls(enum WinevtFakeBackendCall call)
+{
+  return fakeCalls[call];
+}
+
+void
+winevt_fake_backend_advance_clock(ULONGLONG msec)
+{
+  fakeClockOffset += msec;
+}
+
+void
+winevt_fake_backend_set_next_latency(DWORD msec)
+{
+  fakeNextLatency = msec;
+}
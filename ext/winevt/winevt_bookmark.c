@@ -38,7 +38,7 @@ bookmark_free(void* ptr)
 {
   struct WinevtBookmark* winevtBookmark = (struct WinevtBookmark*)ptr;
   if (winevtBookmark->bookmark)
-    EvtClose(winevtBookmark->bookmark);
+    winevt_backend->close(winevtBookmark->bookmark);
 
   xfree(ptr);
 }
@@ -73,7 +73,7 @@ rb_winevt_bookmark_initialize(int argc, VALUE* argv, VALUE self)
     self, struct WinevtBookmark, &rb_winevt_bookmark_type, winevtBookmark);
 
   if (argc == 0) {
-    winevtBookmark->bookmark = EvtCreateBookmark(NULL);
+    winevtBookmark->bookmark = winevt_backend->createBookmark(NULL);
   } else if (argc == 1) {
     VALUE rb_bookmarkXml;
     rb_scan_args(argc, argv, "10", &rb_bookmarkXml);
@@ -90,7 +90,7 @@ rb_winevt_bookmark_initialize(int argc, VALUE* argv, VALUE self)
                         bookmarkXml,
                         len);
     bookmarkXml[len] = L'\0';
-    winevtBookmark->bookmark = EvtCreateBookmark(bookmarkXml);
+    winevtBookmark->bookmark = winevt_backend->createBookmark(bookmarkXml);
     ALLOCV_END(wbookmarkXmlBuf);
   }
 
@@ -114,8 +114,9 @@ rb_winevt_bookmark_update(VALUE self, VALUE event)
   TypedData_Get_Struct(
     self, struct WinevtBookmark, &rb_winevt_bookmark_type, winevtBookmark);
 
-  for (int i = 0; i < winevtQuery->count; i++) {
-    if (!EvtUpdateBookmark(winevtBookmark->bookmark, winevtQuery->hEvents[i]))
+  for (ULONG i = 0; i < winevtQuery->count; i++) {
+    if (!winevt_backend->updateBookmark(winevtBookmark->bookmark,
+                                        winevtQuery->hEvents[i]))
       return Qfalse;
   }
   return Qtrue;
@@ -23,6 +23,8 @@
 
 #include <time.h>
 #include <winevt.h>
+#include <winevt_backend.h>
+#include <winevt_system_keys.h>
 #define EventQuery(object) ((struct WinevtQuery*)DATA_PTR(object))
 #define EventBookMark(object) ((struct WinevtBookmark*)DATA_PTR(object))
 #define EventChannel(object) ((struct WinevtChannel*)DATA_PTR(object))
@@ -34,6 +36,82 @@ typedef struct {
   CHAR* description;
 } LocaleInfo;
 
+#define PUBLISHER_CACHE_DEFAULT_CAPACITY 256
+
+/* Parts of an event which are computed by #each. 0 means all parts,
+ * with the event rendered as specified by #render_as_xml=. */
+#define WINEVT_FIELD_XML     (1 << 0)
+#define WINEVT_FIELD_SYSTEM  (1 << 1)
+#define WINEVT_FIELD_MESSAGE (1 << 2)
+#define WINEVT_FIELD_INSERTS (1 << 3)
+
+struct WinevtPublisherCache;
+struct WinevtSidCache;
+struct WinevtArrowEncoder;
+struct WinevtMsgpackEncoder;
+struct WinevtJsonEncoder;
+
+/* What #each_batch yields for a batch. */
+enum WinevtBatchFormat
+{
+  WINEVT_BATCH_FORMAT_COLUMNS,
+  WINEVT_BATCH_FORMAT_MSGPACK,
+};
+
+/* Grow-only buffer which is reused for rendering every event. */
+struct WinevtRenderBuffer
+{
+  PVOID data;
+  DWORD size;
+};
+
+/* Cumulative counters of where a Query/Subscribe object spends its
+ * time. Nothing is counted and no clock is read unless enabled. */
+struct WinevtStats
+{
+  BOOL enabled;
+  ULONGLONG events;
+  ULONGLONG batches;
+  ULONGLONG renderedBytes;
+  ULONGLONG nextNsec;
+  ULONGLONG renderNsec;
+  ULONGLONG formatMessageNsec;
+  ULONGLONG sidLookupNsec;
+  ULONGLONG yieldNsec;
+};
+
+#define WINEVT_STATS_START(stats) ((stats)->enabled ? winevt_stats_clock() : 0)
+#define WINEVT_STATS_ADD(stats, counter, start)                                \
+  do {                                                                         \
+    if ((stats)->enabled) {                                                    \
+      (stats)->counter += winevt_stats_clock() - (start);                      \
+    }                                                                          \
+  } while (0)
+#define WINEVT_STATS_COUNT(stats, counter, n)                                  \
+  do {                                                                         \
+    if ((stats)->enabled) {                                                    \
+      (stats)->counter += (n);                                                 \
+    }                                                                          \
+  } while (0)
+
+/* Render contexts are not tied to a particular event. So, they are
+ * created once per Query/Subscribe object and reused for every event.
+ * Render buffers only grow and are released with the renderer. */
+struct WinevtRenderer
+{
+  EVT_HANDLE hSystemContext;
+  EVT_HANDLE hUserContext;
+  EVT_HANDLE hProviderNameContext;
+  struct WinevtPublisherCache* publisherCache;
+  struct WinevtSidCache* sidCache;
+  struct WinevtRenderBuffer xmlBuffer;
+  struct WinevtRenderBuffer systemBuffer;
+  struct WinevtRenderBuffer userBuffer;
+  struct WinevtRenderBuffer providerNameBuffer;
+  struct WinevtRenderBuffer messageBuffer;
+  struct WinevtStats stats;
+};
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
@@ -48,14 +126,92 @@ VALUE wstr_to_rb_str(UINT cp, const WCHAR* wstr, int clen);
 void raise_system_error(VALUE error, DWORD errorCode);
 void raise_channel_not_found_error(VALUE channelPath);
 VALUE render_to_rb_str(EVT_HANDLE handle, DWORD flags);
+VALUE render_xml_to_rb_str(struct WinevtRenderer* renderer, EVT_HANDLE handle);
 EVT_HANDLE connect_to_remote(LPWSTR computerName, LPWSTR domain,
                              LPWSTR username, LPWSTR password,
                              EVT_RPC_LOGIN_FLAGS flags,
                              DWORD *error_code);
-WCHAR* get_description(EVT_HANDLE handle, LANGID langID, EVT_HANDLE hRemote);
-VALUE get_values(EVT_HANDLE handle);
-VALUE render_system_event(EVT_HANDLE handle, BOOL preserve_qualifiers, BOOL preserveSID);
+void initialize_renderer(struct WinevtRenderer* renderer);
+void finalize_renderer(struct WinevtRenderer* renderer);
+struct WinevtPublisherCache* renderer_publisher_cache(struct WinevtRenderer* renderer);
+struct WinevtSidCache* renderer_sid_cache(struct WinevtRenderer* renderer);
+VALUE get_description(struct WinevtRenderer* renderer, EVT_HANDLE handle,
+                      LANGID langID, EVT_HANDLE hRemote);
+VALUE get_values(struct WinevtRenderer* renderer, EVT_HANDLE handle,
+                 BOOL typedValues);
+VALUE render_system_event(struct WinevtRenderer* renderer, EVT_HANDLE handle,
+                          BOOL preserve_qualifiers, BOOL preserveSID,
+                          BOOL symbolize_keys, BOOL typedValues);
+void append_system_event_columns(struct WinevtRenderer* renderer, EVT_HANDLE handle,
+                                 BOOL preserve_qualifiers, BOOL preserveSID,
+                                 BOOL typedValues, VALUE* columns, long index,
+                                 long count);
+VALUE batch_columns_to_rb_hash(const VALUE* columns, BOOL symbolize_keys);
 LocaleInfo* get_locale_info_from_rb_str(VALUE rb_locale_str);
+DWORD get_fields_from_rb_ary(VALUE rb_fields);
+VALUE fields_to_rb_ary(DWORD fields);
+long get_count_option(VALUE rb_opts, const char* name);
+void get_batch_options(VALUE rb_opts, long* max, enum WinevtBatchFormat* format);
+
+BOOL EvtNextWithoutGVL(EVT_HANDLE resultSet, DWORD eventsSize, PEVT_HANDLE events,
+                       DWORD timeout, DWORD flags, PDWORD returned);
+BOOL LookupAccountSidWithoutGVL(LPCWSTR systemName, PSID sid, LPWSTR name,
+                                LPDWORD nameSize, LPWSTR referencedDomainName,
+                                LPDWORD referencedDomainNameSize, PSID_NAME_USE use);
+EVT_HANDLE EvtOpenPublisherMetadataWithoutGVL(EVT_HANDLE session, LPCWSTR publisherId,
+                                              LPCWSTR logFilePath, LCID locale,
+                                              DWORD flags);
+BOOL EvtFormatMessageWithoutGVL(EVT_HANDLE publisherMetadata, EVT_HANDLE event,
+                                DWORD messageId, DWORD valueCount, PEVT_VARIANT values,
+                                DWORD flags, DWORD bufferSize, LPWSTR buffer,
+                                PDWORD bufferUsed);
+
+struct WinevtPublisherCache* publisher_cache_create(size_t capacity);
+void publisher_cache_destroy(struct WinevtPublisherCache* cache);
+void publisher_cache_clear(struct WinevtPublisherCache* cache);
+size_t publisher_cache_get_capacity(struct WinevtPublisherCache* cache);
+void publisher_cache_set_capacity(struct WinevtPublisherCache* cache, size_t capacity);
+EVT_HANDLE publisher_cache_open(struct WinevtPublisherCache* cache, EVT_HANDLE hRemote,
+                                LPCWSTR provider, LANGID langID);
+VALUE publisher_cache_stats(struct WinevtPublisherCache* cache);
+
+struct WinevtSidCache* sid_cache_create(void);
+void sid_cache_destroy(struct WinevtSidCache* cache);
+size_t sid_cache_get_capacity(struct WinevtSidCache* cache);
+void sid_cache_set_capacity(struct WinevtSidCache* cache, size_t capacity);
+ULONGLONG sid_cache_get_ttl(struct WinevtSidCache* cache);
+void sid_cache_set_ttl(struct WinevtSidCache* cache, ULONGLONG seconds);
+ULONGLONG sid_cache_get_negative_ttl(struct WinevtSidCache* cache);
+void sid_cache_set_negative_ttl(struct WinevtSidCache* cache, ULONGLONG seconds);
+VALUE sid_cache_stats(struct WinevtSidCache* cache);
+
+struct WinevtArrowEncoder* arrow_encoder_create(DWORD fields, BOOL renderAsXML,
+                                                BOOL preserveQualifiers, BOOL preserveSID);
+void arrow_encoder_destroy(struct WinevtArrowEncoder* encoder);
+void arrow_encoder_append(struct WinevtArrowEncoder* encoder, struct WinevtRenderer* renderer,
+                          EVT_HANDLE event, LANGID langID, EVT_HANDLE hRemote);
+long arrow_encoder_get_length(struct WinevtArrowEncoder* encoder);
+VALUE arrow_encoder_flush(struct WinevtArrowEncoder* encoder);
+VALUE arrow_encoder_finish(struct WinevtArrowEncoder* encoder);
+
+struct WinevtMsgpackEncoder* msgpack_encoder_create(DWORD fields, BOOL renderAsXML,
+                                                    BOOL preserveQualifiers, BOOL preserveSID);
+void msgpack_encoder_destroy(struct WinevtMsgpackEncoder* encoder);
+void msgpack_encoder_append(struct WinevtMsgpackEncoder* encoder,
+                            struct WinevtRenderer* renderer, EVT_HANDLE event, LANGID langID,
+                            EVT_HANDLE hRemote);
+VALUE msgpack_encoder_flush(struct WinevtMsgpackEncoder* encoder);
+
+struct WinevtJsonEncoder* json_encoder_create(DWORD fields, BOOL renderAsXML,
+                                              BOOL preserveQualifiers, BOOL preserveSID);
+void json_encoder_destroy(struct WinevtJsonEncoder* encoder);
+void json_encoder_append(struct WinevtJsonEncoder* encoder, struct WinevtRenderer* renderer,
+                         EVT_HANDLE event, LANGID langID, EVT_HANDLE hRemote);
+void json_encoder_flush(struct WinevtJsonEncoder* encoder, VALUE io);
+
+ULONGLONG winevt_stats_clock(void);
+void winevt_stats_reset(struct WinevtStats* stats);
+VALUE winevt_stats_to_hash(struct WinevtRenderer* renderer);
 
 #ifdef __cplusplus
 }
@@ -99,22 +255,29 @@ struct WinevtBookmark
 };
 
 #define QUERY_ARRAY_SIZE 10
+#define QUERY_ARRAY_MAX_SIZE 1024
 
 struct WinevtQuery
 {
   EVT_HANDLE query;
-  EVT_HANDLE hEvents[QUERY_ARRAY_SIZE];
+  EVT_HANDLE* hEvents;
+  ULONG batchSize;
   ULONG count;
   LONG offset;
   LONG timeout;
   BOOL renderAsXML;
   BOOL preserveQualifiers;
   BOOL preserveSID;
+  BOOL symbolizeKeys;
+  BOOL typedValues;
+  DWORD fields;
   LocaleInfo *localeInfo;
   EVT_HANDLE remoteHandle;
+  struct WinevtRenderer renderer;
 };
 
 #define SUBSCRIBE_ARRAY_SIZE 10
+#define SUBSCRIBE_ARRAY_MAX_SIZE 1024
 #define SUBSCRIBE_RATE_INFINITE -1
 
 struct WinevtSubscribe
@@ -122,7 +285,8 @@ struct WinevtSubscribe
   HANDLE signalEvent;
   EVT_HANDLE subscription;
   EVT_HANDLE bookmark;
-  EVT_HANDLE hEvents[SUBSCRIBE_ARRAY_SIZE];
+  EVT_HANDLE* hEvents;
+  DWORD batchSize;
   DWORD count;
   DWORD flags;
   BOOL readExistingEvents;
@@ -132,8 +296,12 @@ struct WinevtSubscribe
   BOOL renderAsXML;
   BOOL preserveQualifiers;
   BOOL preserveSID;
+  BOOL symbolizeKeys;
+  BOOL typedValues;
+  DWORD fields;
   LocaleInfo* localeInfo;
   EVT_HANDLE remoteHandle;
+  struct WinevtRenderer renderer;
 };
 
 void Init_winevt_query(VALUE rb_cEventLog);
@@ -142,5 +310,7 @@ void Init_winevt_bookmark(VALUE rb_cEventLog);
 void Init_winevt_subscribe(VALUE rb_cEventLog);
 void Init_winevt_locale(VALUE rb_cEventLog);
 void Init_winevt_session(VALUE rb_cEventLog);
+void Init_winevt_file(VALUE rb_cEventLog);
+void Init_winevt_backend(VALUE rb_cEventLog);
 
 #endif // _WINEVT_C_H
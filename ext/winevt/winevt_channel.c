@@ -40,7 +40,7 @@ channel_free(void* ptr)
 {
   struct WinevtChannel* winevtChannel = (struct WinevtChannel*)ptr;
   if (winevtChannel->channels)
-    EvtClose(winevtChannel->channels);
+    winevt_backend->close(winevtChannel->channels);
 
   xfree(ptr);
 }
@@ -121,7 +121,7 @@ DWORD is_subscribable_channel_p(EVT_HANDLE hChannel, BOOL force_enumerate)
   DWORD status = ERROR_SUCCESS;
 
   for (int Id = 0; Id < EvtChannelConfigPropertyIdEND; Id++) {
-    if (!EvtGetChannelConfigProperty(hChannel, (EVT_CHANNEL_CONFIG_PROPERTY_ID)Id, 0, dwBufferSize, pProperty, &dwBufferUsed)) {
+    if (!winevt_backend->getChannelConfigProperty(hChannel, (EVT_CHANNEL_CONFIG_PROPERTY_ID)Id, 0, dwBufferSize, pProperty, &dwBufferUsed)) {
       status = GetLastError();
       if (ERROR_INSUFFICIENT_BUFFER == status) {
         dwBufferSize = dwBufferUsed;
@@ -129,7 +129,7 @@ DWORD is_subscribable_channel_p(EVT_HANDLE hChannel, BOOL force_enumerate)
         if (pTemp) {
           pProperty = pTemp;
           pTemp = NULL;
-          EvtGetChannelConfigProperty(hChannel, (EVT_CHANNEL_CONFIG_PROPERTY_ID)Id, 0, dwBufferSize, pProperty, &dwBufferUsed);
+          winevt_backend->getChannelConfigProperty(hChannel, (EVT_CHANNEL_CONFIG_PROPERTY_ID)Id, 0, dwBufferSize, pProperty, &dwBufferUsed);
           status = GetLastError();
         } else {
           free(pProperty);
@@ -205,7 +205,7 @@ rb_winevt_channel_each(VALUE self)
   TypedData_Get_Struct(
     self, struct WinevtChannel, &rb_winevt_channel_type, winevtChannel);
 
-  hChannels = EvtOpenChannelEnum(NULL, 0);
+  hChannels = winevt_backend->openChannelEnum(NULL, 0);
 
   if (hChannels) {
     winevtChannel->channels = hChannels;
@@ -219,7 +219,7 @@ rb_winevt_channel_each(VALUE self)
   }
 
   while (1) {
-    if (!EvtNextChannelPath(winevtChannel->channels, bufferSize, buffer, &bufferUsed)) {
+    if (!winevt_backend->nextChannelPath(winevtChannel->channels, bufferSize, buffer, &bufferUsed)) {
       status = GetLastError();
 
       if (ERROR_NO_MORE_ITEMS == status) {
@@ -231,13 +231,13 @@ rb_winevt_channel_each(VALUE self)
           continue;
         } else {
           free(buffer);
-          EvtClose(winevtChannel->channels);
+          winevt_backend->close(winevtChannel->channels);
           winevtChannel->channels = NULL;
           rb_raise(rb_eRuntimeError, "realloc failed");
         }
       } else {
         free(buffer);
-        EvtClose(winevtChannel->channels);
+        winevt_backend->close(winevtChannel->channels);
         winevtChannel->channels = NULL;
         _snprintf_s(errBuf,
                     _countof(errBuf),
@@ -247,7 +247,7 @@ rb_winevt_channel_each(VALUE self)
         rb_raise(rb_eRuntimeError, errBuf);
       }
     }
-    hChannelConfig = EvtOpenChannelConfig(NULL, buffer, 0);
+    hChannelConfig = winevt_backend->openChannelConfig(NULL, buffer, 0);
     if (NULL == hChannelConfig) {
       _snprintf_s(errBuf,
                   _countof(errBuf),
@@ -255,7 +255,7 @@ rb_winevt_channel_each(VALUE self)
                   "EvtOpenChannelConfig failed with %lu.\n",
                   GetLastError());
 
-      EvtClose(winevtChannel->channels);
+      winevt_backend->close(winevtChannel->channels);
       winevtChannel->channels = NULL;
 
       free(buffer);
@@ -266,7 +266,7 @@ rb_winevt_channel_each(VALUE self)
     }
 
     status = is_subscribable_channel_p(hChannelConfig, winevtChannel->force_enumerate);
-    EvtClose(hChannelConfig);
+    winevt_backend->close(hChannelConfig);
 
     if (status == ERROR_INVALID_DATA) {
       free(buffer);
@@ -277,7 +277,7 @@ rb_winevt_channel_each(VALUE self)
     }
 
     if (status == ERROR_OUTOFMEMORY) {
-      EvtClose(winevtChannel->channels);
+      winevt_backend->close(winevtChannel->channels);
       winevtChannel->channels = NULL;
 
       free(buffer);
@@ -286,7 +286,7 @@ rb_winevt_channel_each(VALUE self)
 
       rb_raise(rb_eRuntimeError, "realloc failed\n");
     } else if (status != ERROR_SUCCESS) {
-      EvtClose(winevtChannel->channels);
+      winevt_backend->close(winevtChannel->channels);
       winevtChannel->channels = NULL;
 
       free(buffer);
@@ -306,7 +306,7 @@ rb_winevt_channel_each(VALUE self)
   }
 
   if (winevtChannel->channels) {
-    EvtClose(winevtChannel->channels);
+    winevt_backend->close(winevtChannel->channels);
     winevtChannel->channels = NULL;
   }
 
@@ -0,0 +1,534 @@
+/*
+ * Implementation of the Win32 functions which the extension calls, for
+ * building it against the fake backend on platforms other than
+ * Windows. See compat/windows.h. Only what the extension relies on is
+ * implemented: strings are always converted as UTF-8, and only a few
+ * well-known SIDs are resolved to account names.
+ */
+#ifndef _WIN32
+
+#include <sddl.h>
+#include <windows.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+
+static thread_local DWORD lastError = ERROR_SUCCESS;
+
+DWORD
+GetLastError(void)
+{
+  return lastError;
+}
+
+void
+SetLastError(DWORD error)
+{
+  lastError = error;
+}
+
+size_t
+winevt_compat_wcslen(const WCHAR* str)
+{
+  const WCHAR* p = str;
+
+  while (*p) {
+    p++;
+  }
+
+  return p - str;
+}
+
+size_t
+winevt_compat_wcsnlen(const WCHAR* str, size_t max)
+{
+  size_t len = 0;
+
+  while (len < max && str[len]) {
+    len++;
+  }
+
+  return len;
+}
+
+WCHAR*
+winevt_compat_wcsdup(const WCHAR* str)
+{
+  size_t size = (winevt_compat_wcslen(str) + 1) * sizeof(WCHAR);
+  WCHAR* copy = static_cast<WCHAR*>(malloc(size));
+
+  if (copy) {
+    memcpy(copy, str, size);
+  }
+
+  return copy;
+}
+
+/* Decodes the code point at str[*i], replacing invalid sequences with
+ * U+FFFD. */
+static uint32_t
+decode_utf8(const unsigned char* str, size_t len, size_t* i)
+{
+  unsigned char c = str[(*i)++];
+  uint32_t cp;
+  int extra;
+
+  if (c < 0x80) {
+    return c;
+  } else if ((c & 0xe0) == 0xc0) {
+    cp = c & 0x1f;
+    extra = 1;
+  } else if ((c & 0xf0) == 0xe0) {
+    cp = c & 0x0f;
+    extra = 2;
+  } else if ((c & 0xf8) == 0xf0) {
+    cp = c & 0x07;
+    extra = 3;
+  } else {
+    return 0xfffd;
+  }
+
+  for (; extra > 0; extra--) {
+    if (*i >= len || (str[*i] & 0xc0) != 0x80) {
+      return 0xfffd;
+    }
+    cp = (cp << 6) | (str[(*i)++] & 0x3f);
+  }
+
+  return cp > 0x10ffff || (cp >= 0xd800 && cp <= 0xdfff) ? 0xfffd : cp;
+}
+
+int
+MultiByteToWideChar(UINT codePage, DWORD flags, LPCSTR str, int len, LPWSTR wstr,
+                    int wlen)
+{
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(str);
+  size_t size = len < 0 ? strlen(str) + 1 : static_cast<size_t>(len);
+  size_t i = 0;
+  int needed = 0;
+
+  while (i < size) {
+    uint32_t cp = decode_utf8(p, size, &i);
+    int units = cp >= 0x10000 ? 2 : 1;
+
+    if (wlen > 0) {
+      if (needed + units > wlen) {
+        SetLastError(ERROR_INSUFFICIENT_BUFFER);
+        return 0;
+      }
+      if (units == 2) {
+        cp -= 0x10000;
+        wstr[needed] = static_cast<WCHAR>(0xd800 | (cp >> 10));
+        wstr[needed + 1] = static_cast<WCHAR>(0xdc00 | (cp & 0x3ff));
+      } else {
+        wstr[needed] = static_cast<WCHAR>(cp);
+      }
+    }
+    needed += units;
+  }
+
+  return needed;
+}
+
+int
+WideCharToMultiByte(UINT codePage, DWORD flags, LPCWSTR wstr, int wlen, LPSTR str,
+                    int len, LPCSTR defaultChar, BOOL* usedDefaultChar)
+{
+  size_t size = wlen < 0 ? winevt_compat_wcslen(wstr) + 1 : static_cast<size_t>(wlen);
+  int needed = 0;
+
+  for (size_t i = 0; i < size; i++) {
+    uint32_t cp = static_cast<uint16_t>(wstr[i]);
+    char bytes[4];
+    int n;
+
+    if (cp >= 0xd800 && cp <= 0xdbff && i + 1 < size &&
+        static_cast<uint16_t>(wstr[i + 1]) >= 0xdc00 &&
+        static_cast<uint16_t>(wstr[i + 1]) <= 0xdfff) {
+      cp = 0x10000 + ((cp - 0xd800) << 10) + (static_cast<uint16_t>(wstr[++i]) - 0xdc00);
+    } else if (cp >= 0xd800 && cp <= 0xdfff) {
+      cp = 0xfffd;
+    }
+
+    if (cp < 0x80) {
+      bytes[0] = static_cast<char>(cp);
+      n = 1;
+    } else if (cp < 0x800) {
+      bytes[0] = static_cast<char>(0xc0 | (cp >> 6));
+      bytes[1] = static_cast<char>(0x80 | (cp & 0x3f));
+      n = 2;
+    } else if (cp < 0x10000) {
+      bytes[0] = static_cast<char>(0xe0 | (cp >> 12));
+      bytes[1] = static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+      bytes[2] = static_cast<char>(0x80 | (cp & 0x3f));
+      n = 3;
+    } else {
+      bytes[0] = static_cast<char>(0xf0 | (cp >> 18));
+      bytes[1] = static_cast<char>(0x80 | ((cp >> 12) & 0x3f));
+      bytes[2] = static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+      bytes[3] = static_cast<char>(0x80 | (cp & 0x3f));
+      n = 4;
+    }
+
+    if (len > 0) {
+      if (needed + n > len) {
+        SetLastError(ERROR_INSUFFICIENT_BUFFER);
+        return 0;
+      }
+      memcpy(str + needed, bytes, n);
+    }
+    needed += n;
+  }
+
+  return needed;
+}
+
+static const struct
+{
+  DWORD code;
+  const char* message;
+} systemMessages[] = {
+  { ERROR_SUCCESS, "The operation completed successfully." },
+  { ERROR_FILE_NOT_FOUND, "The system cannot find the file specified." },
+  { ERROR_INVALID_HANDLE, "The handle is invalid." },
+  { ERROR_NOT_ENOUGH_MEMORY, "Not enough memory resources are available to process this command." },
+  { ERROR_INVALID_DATA, "The data is invalid." },
+  { ERROR_OUTOFMEMORY, "Not enough memory resources are available to complete this operation." },
+  { ERROR_NOT_SUPPORTED, "The request is not supported." },
+  { ERROR_INVALID_PARAMETER, "The parameter is incorrect." },
+  { ERROR_INSUFFICIENT_BUFFER, "The data area passed to a system call is too small." },
+  { ERROR_NO_MORE_ITEMS, "No more data is available." },
+  { ERROR_NOT_FOUND, "Element not found." },
+  { ERROR_CANCELLED, "The operation was canceled by the user." },
+  { ERROR_NONE_MAPPED, "No mapping between account names and security IDs was done." },
+  { ERROR_EVT_INVALID_QUERY, "The specified query is invalid." },
+  { ERROR_EVT_CHANNEL_NOT_FOUND, "The specified channel could not be found." },
+  { ERROR_EVT_MESSAGE_NOT_FOUND,
+    "The message resource is present but the message was not found in the message table." },
+};
+
+DWORD
+FormatMessageW(DWORD flags, const void* source, DWORD messageId, DWORD languageId,
+               LPWSTR buffer, DWORD size, void* arguments)
+{
+  const char* message = nullptr;
+  std::string text;
+
+  for (size_t i = 0; i < _countof(systemMessages); i++) {
+    if (systemMessages[i].code == messageId) {
+      message = systemMessages[i].message;
+      break;
+    }
+  }
+  if (!(flags & FORMAT_MESSAGE_FROM_SYSTEM) || message == nullptr) {
+    SetLastError(ERROR_NOT_FOUND);
+    return 0;
+  }
+
+  text = message;
+  text += "\r\n";
+
+  int len = MultiByteToWideChar(CP_UTF8, 0, text.c_str(), -1, nullptr, 0);
+  if (flags & FORMAT_MESSAGE_ALLOCATE_BUFFER) {
+    WCHAR* allocated = static_cast<WCHAR*>(malloc(len * sizeof(WCHAR)));
+    if (allocated == nullptr) {
+      SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+      return 0;
+    }
+    MultiByteToWideChar(CP_UTF8, 0, text.c_str(), -1, allocated, len);
+    *reinterpret_cast<WCHAR**>(buffer) = allocated;
+  } else if (MultiByteToWideChar(CP_UTF8, 0, text.c_str(), -1, buffer, size) == 0) {
+    return 0;
+  }
+
+  return len - 1;
+}
+
+HLOCAL
+LocalFree(HLOCAL mem)
+{
+  free(mem);
+  return nullptr;
+}
+
+/* Howard Hinnant's civil_from_days. */
+BOOL
+FileTimeToSystemTime(const FILETIME* fileTime, SYSTEMTIME* systemTime)
+{
+  uint64_t ticks =
+    (static_cast<uint64_t>(fileTime->dwHighDateTime) << 32) | fileTime->dwLowDateTime;
+
+  if (ticks > 0x7fffffffffffffffULL) {
+    SetLastError(ERROR_INVALID_PARAMETER);
+    return FALSE;
+  }
+
+  uint64_t msec = ticks / 10000;
+  uint64_t secs = msec / 1000;
+  // Days since 1601-01-01, shifted to start from 0000-03-01.
+  int64_t z = static_cast<int64_t>(secs / 86400) + 584694;
+  int64_t era = z / 146097;
+  int64_t doe = z - era * 146097;
+  int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  int64_t mp = (5 * doy + 2) / 153;
+  int64_t month = mp < 10 ? mp + 3 : mp - 9;
+
+  systemTime->wYear = static_cast<WORD>(yoe + era * 400 + (month <= 2));
+  systemTime->wMonth = static_cast<WORD>(month);
+  systemTime->wDay = static_cast<WORD>(doy - (153 * mp + 2) / 5 + 1);
+  // 1601-01-01 was a Monday.
+  systemTime->wDayOfWeek = static_cast<WORD>((secs / 86400 + 1) % 7);
+  systemTime->wHour = static_cast<WORD>(secs % 86400 / 3600);
+  systemTime->wMinute = static_cast<WORD>(secs % 3600 / 60);
+  systemTime->wSecond = static_cast<WORD>(secs % 60);
+  systemTime->wMilliseconds = static_cast<WORD>(msec % 1000);
+
+  return TRUE;
+}
+
+int
+StringFromGUID2(const GUID* guid, LPOLESTR str, int len)
+{
+  char buffer[40];
+
+  if (len < 39) {
+    return 0;
+  }
+
+  snprintf(buffer,
+           sizeof(buffer),
+           "{%08X-%04X-%04X-%02X%02X-%02X%02X%02X%02X%02X%02X}",
+           guid->Data1,
+           guid->Data2,
+           guid->Data3,
+           guid->Data4[0],
+           guid->Data4[1],
+           guid->Data4[2],
+           guid->Data4[3],
+           guid->Data4[4],
+           guid->Data4[5],
+           guid->Data4[6],
+           guid->Data4[7]);
+
+  return MultiByteToWideChar(CP_UTF8, 0, buffer, -1, str, len);
+}
+
+/* Binary SIDs are laid out as on Windows: revision, sub-authority
+ * count, 48-bit big-endian identifier authority and 32-bit
+ * little-endian sub-authorities. */
+DWORD
+GetLengthSid(PSID sid)
+{
+  return 8 + 4 * static_cast<const BYTE*>(sid)[1];
+}
+
+static BOOL
+sid_to_string(PSID sid, std::string* str)
+{
+  const BYTE* p = static_cast<const BYTE*>(sid);
+  uint64_t authority = 0;
+  char buffer[32];
+
+  if (p == nullptr || p[0] != 1 || p[1] > 15) {
+    SetLastError(ERROR_INVALID_PARAMETER);
+    return FALSE;
+  }
+
+  for (int i = 2; i < 8; i++) {
+    authority = (authority << 8) | p[i];
+  }
+  snprintf(buffer,
+           sizeof(buffer),
+           authority >= (1ULL << 32) ? "S-1-0x%llX" : "S-1-%llu",
+           static_cast<unsigned long long>(authority));
+  *str = buffer;
+
+  for (int i = 0; i < p[1]; i++) {
+    const BYTE* sub = p + 8 + 4 * i;
+    uint32_t value = sub[0] | (sub[1] << 8) | (sub[2] << 16) | (static_cast<uint32_t>(sub[3]) << 24);
+    snprintf(buffer, sizeof(buffer), "-%u", value);
+    *str += buffer;
+  }
+
+  return TRUE;
+}
+
+BOOL
+ConvertSidToStringSidA(PSID sid, LPSTR* str)
+{
+  std::string sidString;
+
+  if (!sid_to_string(sid, &sidString)) {
+    return FALSE;
+  }
+
+  *str = strdup(sidString.c_str());
+  return TRUE;
+}
+
+BOOL
+ConvertSidToStringSidW(PSID sid, LPWSTR* str)
+{
+  std::string sidString;
+
+  if (!sid_to_string(sid, &sidString)) {
+    return FALSE;
+  }
+
+  int len = MultiByteToWideChar(CP_UTF8, 0, sidString.c_str(), -1, nullptr, 0);
+  *str = static_cast<LPWSTR>(malloc(len * sizeof(WCHAR)));
+  MultiByteToWideChar(CP_UTF8, 0, sidString.c_str(), -1, *str, len);
+  return TRUE;
+}
+
+static const struct
+{
+  const char* sid;
+  const char* domain;
+  const char* name;
+  SID_NAME_USE use;
+} wellKnownAccounts[] = {
+  { "S-1-5-18", "NT AUTHORITY", "SYSTEM", SidTypeWellKnownGroup },
+  { "S-1-5-19", "NT AUTHORITY", "LOCAL SERVICE", SidTypeWellKnownGroup },
+  { "S-1-5-20", "NT AUTHORITY", "NETWORK SERVICE", SidTypeWellKnownGroup },
+  { "S-1-5-32-544", "BUILTIN", "Administrators", SidTypeAlias },
+};
+
+BOOL
+LookupAccountSidW(LPCWSTR systemName, PSID sid, LPWSTR name, LPDWORD nameSize,
+                  LPWSTR domainName, LPDWORD domainNameSize, PSID_NAME_USE use)
+{
+  std::string sidString;
+
+  if (!sid_to_string(sid, &sidString)) {
+    return FALSE;
+  }
+
+  for (size_t i = 0; i < _countof(wellKnownAccounts); i++) {
+    if (sidString != wellKnownAccounts[i].sid) {
+      continue;
+    }
+
+    // nameSize and domainNameSize can be the same variable.
+    DWORD nameCapacity = *nameSize;
+    DWORD domainCapacity = *domainNameSize;
+    DWORD nameLen = strlen(wellKnownAccounts[i].name) + 1;
+    DWORD domainLen = strlen(wellKnownAccounts[i].domain) + 1;
+
+    if (nameCapacity < nameLen || domainCapacity < domainLen) {
+      *nameSize = nameLen;
+      *domainNameSize = domainLen;
+      SetLastError(ERROR_INSUFFICIENT_BUFFER);
+      return FALSE;
+    }
+
+    MultiByteToWideChar(CP_UTF8, 0, wellKnownAccounts[i].name, -1, name, nameCapacity);
+    MultiByteToWideChar(
+      CP_UTF8, 0, wellKnownAccounts[i].domain, -1, domainName, domainCapacity);
+    *nameSize = nameLen - 1;
+    *domainNameSize = domainLen - 1;
+    *use = wellKnownAccounts[i].use;
+    return TRUE;
+  }
+
+  SetLastError(ERROR_NONE_MAPPED);
+  return FALSE;
+}
+
+/* Event objects. Handles which are not created by CreateEvent are not
+ * supported by the functions below. */
+struct CompatEvent
+{
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool manualReset;
+  bool signaled;
+};
+
+HANDLE
+CreateEvent(void* attributes, BOOL manualReset, BOOL initialState, LPCSTR name)
+{
+  CompatEvent* event = new CompatEvent();
+
+  event->manualReset = manualReset != FALSE;
+  event->signaled = initialState != FALSE;
+
+  return event;
+}
+
+BOOL
+SetEvent(HANDLE handle)
+{
+  CompatEvent* event = static_cast<CompatEvent*>(handle);
+
+  {
+    std::lock_guard<std::mutex> lock(event->mutex);
+    event->signaled = true;
+  }
+  event->condition.notify_all();
+
+  return TRUE;
+}
+
+BOOL
+ResetEvent(HANDLE handle)
+{
+  CompatEvent* event = static_cast<CompatEvent*>(handle);
+  std::lock_guard<std::mutex> lock(event->mutex);
+
+  event->signaled = false;
+
+  return TRUE;
+}
+
+DWORD
+WaitForSingleObject(HANDLE handle, DWORD milliseconds)
+{
+  CompatEvent* event = static_cast<CompatEvent*>(handle);
+
+  if (event == nullptr) {
+    SetLastError(ERROR_INVALID_HANDLE);
+    return WAIT_FAILED;
+  }
+
+  std::unique_lock<std::mutex> lock(event->mutex);
+
+  if (milliseconds == INFINITE) {
+    event->condition.wait(lock, [event] { return event->signaled; });
+  } else if (!event->condition.wait_for(lock,
+                                        std::chrono::milliseconds(milliseconds),
+                                        [event] { return event->signaled; })) {
+    return WAIT_TIMEOUT;
+  }
+
+  if (!event->manualReset) {
+    event->signaled = false;
+  }
+
+  return WAIT_OBJECT_0;
+}
+
+BOOL
+CloseHandle(HANDLE handle)
+{
+  if (handle == nullptr) {
+    SetLastError(ERROR_INVALID_HANDLE);
+    return FALSE;
+  }
+
+  delete static_cast<CompatEvent*>(handle);
+  return TRUE;
+}
+
+void
+Sleep(DWORD milliseconds)
+{
+  std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+}
+
+#endif /* _WIN32 */
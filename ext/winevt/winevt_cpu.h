@@ -0,0 +1,120 @@
+#ifndef _WINEVT_CPU_H_
+#define _WINEVT_CPU_H_
+
+/*
+ * Detects x86 instruction set extensions at run time.
+ *
+ * extconf.rb builds for the baseline of the platform, so vectorized
+ * code which needs more than SSE2 is compiled per function with
+ * WINEVT_TARGET() and only called when winevt_cpu_features() has the
+ * extensions it uses. WINEVT_CPU_X86 is not defined on other
+ * architectures, where winevt_cpu_features() is always 0.
+ *
+ * This header does not depend on Windows or Ruby headers, and is for
+ * C++ only.
+ */
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#include <immintrin.h>
+#define WINEVT_CPU_X86 1
+#define WINEVT_TARGET(features) __attribute__((target(features)))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define WINEVT_CPU_X86 1
+/* MSVC allows every intrinsic in any function. */
+#define WINEVT_TARGET(features)
+#endif
+
+#define WINEVT_CPU_SSSE3 (1u << 0)
+#define WINEVT_CPU_SSE4_1 (1u << 1)
+#define WINEVT_CPU_PCLMUL (1u << 2)
+#define WINEVT_CPU_AVX2 (1u << 3)
+
+#ifdef WINEVT_CPU_X86
+static inline void
+winevt_cpuid(unsigned int leaf, unsigned int subleaf, unsigned int regs[4])
+{
+#if defined(_MSC_VER)
+  int values[4];
+
+  __cpuidex(values, static_cast<int>(leaf), static_cast<int>(subleaf));
+  for (int i = 0; i < 4; i++) {
+    regs[i] = static_cast<unsigned int>(values[i]);
+  }
+#else
+  __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+/* Returns XCR0, which tells the registers the OS saves. */
+static inline unsigned long long
+winevt_xgetbv0()
+{
+#if defined(_MSC_VER)
+  return _xgetbv(0);
+#else
+  unsigned int eax, edx;
+
+  __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+}
+
+static inline unsigned int
+winevt_cpu_detect()
+{
+  unsigned int regs[4];
+  unsigned int maxLeaf;
+  unsigned int features = 0;
+
+  winevt_cpuid(0, 0, regs);
+  maxLeaf = regs[0];
+  if (maxLeaf < 1) {
+    return 0;
+  }
+
+  winevt_cpuid(1, 0, regs);
+  if (regs[2] & (1u << 9)) {
+    features |= WINEVT_CPU_SSSE3;
+  }
+  if (regs[2] & (1u << 19)) {
+    features |= WINEVT_CPU_SSE4_1;
+  }
+  if (regs[2] & (1u << 1)) {
+    features |= WINEVT_CPU_PCLMUL;
+  }
+  // AVX2 also needs OSXSAVE, AVX and the OS saving XMM and YMM registers.
+  if ((regs[2] & (1u << 27)) && (regs[2] & (1u << 28)) && (winevt_xgetbv0() & 6) == 6 &&
+      maxLeaf >= 7) {
+    winevt_cpuid(7, 0, regs);
+    if (regs[1] & (1u << 5)) {
+      features |= WINEVT_CPU_AVX2;
+    }
+  }
+
+  return features;
+}
+#endif /* WINEVT_CPU_X86 */
+
+/* Returns the WINEVT_CPU_* flags of the extensions the CPU has. */
+static inline unsigned int
+winevt_cpu_features()
+{
+#ifdef WINEVT_CPU_X86
+  static const unsigned int features = winevt_cpu_detect();
+
+  return features;
+#else
+  return 0;
+#endif
+}
+
+/* Returns whether the CPU has all of the WINEVT_CPU_* flags of features. */
+static inline bool
+winevt_cpu_has(unsigned int features)
+{
+  return (winevt_cpu_features() & features) == features;
+}
+
+#endif // _WINEVT_CPU_H_
@@ -0,0 +1,193 @@
+#ifndef _WINEVT_CRC32_H_
+#define _WINEVT_CRC32_H_
+
+/*
+ * CRC-32 (ISO 3309, the polynomial of zlib) which EVTX files use for
+ * their checksums.
+ *
+ * This header does not depend on Windows or Ruby headers so that the
+ * checksum can be tested and benchmarked on any platform. Data is
+ * processed 8 bytes at a time with slicing-by-8 tables, or 64 bytes at
+ * a time with carry-less multiplication when the CPU has PCLMULQDQ and
+ * SSE4.1. The crc32 instruction of SSE4.2 computes CRC-32C, which is a
+ * different polynomial, so it is not used.
+ */
+
+#include <winevt_cpu.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef WINEVT_CPU_X86
+#define WINEVT_CRC32_PCLMUL 1
+#endif
+
+#define WINEVT_CRC32_POLYNOMIAL 0xedb88320u
+
+struct WinevtCrc32Table
+{
+  uint32_t slices[8][256];
+
+  WinevtCrc32Table()
+  {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t crc = i;
+      for (int bit = 0; bit < 8; bit++) {
+        crc = (crc >> 1) ^ ((crc & 1) ? WINEVT_CRC32_POLYNOMIAL : 0);
+      }
+      slices[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+      for (int slice = 1; slice < 8; slice++) {
+        uint32_t previous = slices[slice - 1][i];
+        slices[slice][i] = (previous >> 8) ^ slices[0][previous & 0xff];
+      }
+    }
+  }
+};
+
+static inline const WinevtCrc32Table&
+winevt_crc32_table()
+{
+  static const WinevtCrc32Table table;
+  return table;
+}
+
+/* Updates crc, which is not inverted, byte by byte. */
+static inline uint32_t
+winevt_crc32_bytes(uint32_t crc, const uint8_t* p, size_t len)
+{
+  const WinevtCrc32Table& table = winevt_crc32_table();
+
+  for (size_t i = 0; i < len; i++) {
+    crc = (crc >> 8) ^ table.slices[0][(crc ^ p[i]) & 0xff];
+  }
+
+  return crc;
+}
+
+/* Updates crc, which is not inverted, with slicing-by-8. */
+static inline uint32_t
+winevt_crc32_slicing_by_8(uint32_t crc, const uint8_t* p, size_t len)
+{
+  const WinevtCrc32Table& table = winevt_crc32_table();
+
+  for (; len >= 8; p += 8, len -= 8) {
+    uint32_t low = crc ^ (static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+                          (static_cast<uint32_t>(p[2]) << 16) |
+                          (static_cast<uint32_t>(p[3]) << 24));
+    uint32_t high = static_cast<uint32_t>(p[4]) | (static_cast<uint32_t>(p[5]) << 8) |
+                    (static_cast<uint32_t>(p[6]) << 16) | (static_cast<uint32_t>(p[7]) << 24);
+    crc = table.slices[7][low & 0xff] ^ table.slices[6][(low >> 8) & 0xff] ^
+          table.slices[5][(low >> 16) & 0xff] ^ table.slices[4][low >> 24] ^
+          table.slices[3][high & 0xff] ^ table.slices[2][(high >> 8) & 0xff] ^
+          table.slices[1][(high >> 16) & 0xff] ^ table.slices[0][high >> 24];
+  }
+
+  return winevt_crc32_bytes(crc, p, len);
+}
+
+#ifdef WINEVT_CRC32_PCLMUL
+/*
+ * Folds 64 bytes at a time with carry-less multiplication as in "Fast
+ * CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction"
+ * (Intel). len must be a multiple of 16 and at least 64.
+ */
+WINEVT_TARGET("pclmul,sse4.1")
+static inline uint32_t
+winevt_crc32_pclmul(uint32_t crc, const uint8_t* p, size_t len)
+{
+  const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+  const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+  const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124);
+  const __m128i poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+  const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+  __m128i x1, x2, x3, x4, x5, x6, x7, x8;
+
+  x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x00));
+  x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x10));
+  x3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x20));
+  x4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x30));
+  x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(static_cast<int>(crc)));
+  p += 64;
+  len -= 64;
+
+  for (; len >= 64; p += 64, len -= 64) {
+    x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+    x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+    x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+    x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+    x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+    x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+    x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x5),
+                       _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x00)));
+    x2 = _mm_xor_si128(_mm_xor_si128(x2, x6),
+                       _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x10)));
+    x3 = _mm_xor_si128(_mm_xor_si128(x3, x7),
+                       _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x20)));
+    x4 = _mm_xor_si128(_mm_xor_si128(x4, x8),
+                       _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x30)));
+  }
+
+  // Fold into 128 bits.
+  x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+  x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+  x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+  for (; len >= 16; p += 16, len -= 16) {
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x5),
+                       _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+  }
+
+  // Fold 128 bits into 64 bits.
+  x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+  x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+  x2 = _mm_srli_si128(x1, 4);
+  x1 = _mm_and_si128(x1, mask32);
+  x1 = _mm_clmulepi64_si128(x1, k5k0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  // Barrett reduction into 32 bits
+  x2 = _mm_and_si128(x1, mask32);
+  x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+  x2 = _mm_and_si128(x2, mask32);
+  x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  return static_cast<uint32_t>(_mm_extract_epi32(x1, 1));
+}
+#endif /* WINEVT_CRC32_PCLMUL */
+
+/* Returns the CRC-32 of len bytes at data, continuing from crc. Pass 0
+ * as crc to start. This is compatible with crc32() of zlib. */
+static inline uint32_t
+winevt_crc32(uint32_t crc, const void* data, size_t len)
+{
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+
+  crc = ~crc;
+#ifdef WINEVT_CRC32_PCLMUL
+  if (len >= 64 && winevt_cpu_has(WINEVT_CPU_PCLMUL | WINEVT_CPU_SSE4_1)) {
+    size_t blocks = len & ~static_cast<size_t>(15);
+    crc = winevt_crc32_pclmul(crc, p, blocks);
+    p += blocks;
+    len -= blocks;
+  }
+#endif /* WINEVT_CRC32_PCLMUL */
+  crc = winevt_crc32_slicing_by_8(crc, p, len);
+
+  return ~crc;
+}
+
+#endif // _WINEVT_CRC32_H_
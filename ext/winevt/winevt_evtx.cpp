@@ -0,0 +1,1558 @@
+#include <winevt_crc32.h>
+#include <winevt_evtx.h>
+#include <winevt_format.h>
+#include <winevt_hex.h>
+#include <winevt_utf16.h>
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif /* _WIN32 */
+
+#define EVTX_MAX_NESTING 64
+
+static const char EVTX_FILE_SIGNATURE[8] = { 'E', 'l', 'f', 'F', 'i', 'l', 'e', '\0' };
+static const char EVTX_CHUNK_SIGNATURE[8] = { 'E', 'l', 'f', 'C', 'h', 'n', 'k', '\0' };
+static const uint32_t EVTX_RECORD_SIGNATURE = 0x00002a2a;
+
+enum BinXmlToken
+{
+  BINXML_TOKEN_EOF = 0x00,
+  BINXML_TOKEN_OPEN_START_ELEMENT = 0x01,
+  BINXML_TOKEN_CLOSE_START_ELEMENT = 0x02,
+  BINXML_TOKEN_CLOSE_EMPTY_ELEMENT = 0x03,
+  BINXML_TOKEN_END_ELEMENT = 0x04,
+  BINXML_TOKEN_VALUE = 0x05,
+  BINXML_TOKEN_ATTRIBUTE = 0x06,
+  BINXML_TOKEN_CDATA_SECTION = 0x07,
+  BINXML_TOKEN_CHAR_REF = 0x08,
+  BINXML_TOKEN_ENTITY_REF = 0x09,
+  BINXML_TOKEN_PI_TARGET = 0x0a,
+  BINXML_TOKEN_PI_DATA = 0x0b,
+  BINXML_TOKEN_TEMPLATE_INSTANCE = 0x0c,
+  BINXML_TOKEN_NORMAL_SUBSTITUTION = 0x0d,
+  BINXML_TOKEN_OPTIONAL_SUBSTITUTION = 0x0e,
+  BINXML_TOKEN_FRAGMENT_HEADER = 0x0f,
+  // Set on OpenStartElement with attributes and on tokens which are
+  // followed by more data of the same kind.
+  BINXML_TOKEN_MORE_FLAG = 0x40,
+};
+
+// EVTX is little-endian.
+static inline uint16_t
+read_u16(const uint8_t* p)
+{
+  return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t
+read_u32(const uint8_t* p)
+{
+  return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+         (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+static inline uint64_t
+read_u64(const uint8_t* p)
+{
+  return static_cast<uint64_t>(read_u32(p)) | (static_cast<uint64_t>(read_u32(p + 4)) << 32);
+}
+
+static void
+append_utf16(const uint8_t* chars, size_t length, std::string& out)
+{
+  size_t offset = out.size();
+
+  out.resize(offset + length * WINEVT_UTF8_MAX_BYTES_PER_UTF16);
+  size_t written =
+    winevt_utf16_to_utf8(reinterpret_cast<const uint16_t*>(chars), length, &out[offset]);
+  out.resize(offset + written);
+}
+
+bool
+EvtxName::equals(const char* ascii) const
+{
+  for (uint16_t i = 0; i < length; i++) {
+    if (ascii[i] == '\0' || read_u16(chars + i * 2) != static_cast<uint8_t>(ascii[i]))
+      return false;
+  }
+
+  return ascii[length] == '\0';
+}
+
+void
+evtx_name_to_utf8(const EvtxName& name, std::string& out)
+{
+  append_utf16(name.chars, name.length, out);
+}
+
+static inline void
+check_range(uint32_t offset, uint32_t size, uint32_t end)
+{
+  if (offset > end || size > end - offset)
+    throw EvtxError("Binary XML is truncated");
+}
+
+static inline bool
+is_null_value(const EvtxValue& value)
+{
+  return value.type == EVTX_VALUE_NULL || value.size == 0;
+}
+
+/* Names are stored in the string table of the chunk. A name which is
+ * used for the first time follows its reference immediately. */
+static EvtxName
+read_name(const uint8_t* chunk, uint32_t& pos, uint32_t end)
+{
+  EvtxName name;
+
+  check_range(pos, 4, end);
+  uint32_t offset = read_u32(chunk + pos);
+  pos += 4;
+
+  check_range(offset, 8, EVTX_CHUNK_SIZE);
+  name.length = read_u16(chunk + offset + 6);
+  name.chars = chunk + offset + 8;
+  check_range(offset + 8, (name.length + 1) * 2, EVTX_CHUNK_SIZE);
+
+  if (offset == pos) {
+    pos += 8 + (name.length + 1) * 2;
+    check_range(offset, pos - offset, end);
+  }
+
+  return name;
+}
+
+enum TemplateOpCode
+{
+  TEMPLATE_OP_START_ELEMENT,
+  TEMPLATE_OP_ATTRIBUTE,
+  TEMPLATE_OP_CLOSE_START_ELEMENT,
+  TEMPLATE_OP_CLOSE_EMPTY_ELEMENT,
+  TEMPLATE_OP_END_ELEMENT,
+  TEMPLATE_OP_CONTENT,
+  TEMPLATE_OP_ENTITY_REFERENCE,
+  TEMPLATE_OP_SUBSTITUTION,
+};
+
+struct EvtxTemplateOp
+{
+  uint8_t code;
+  // Substitutions which are omitted when their value is empty. An
+  // optional attribute is omitted together with the substitution which
+  // follows it.
+  bool optional;
+  uint16_t index;
+  EvtxName name;
+  EvtxValue value;
+};
+
+/* A template definition as a flat list of operations. Names and
+ * constant values are copied, so that the template outlives its
+ * chunk. */
+struct EvtxCompiledTemplate
+{
+  // false when the definition has tokens which are not compiled, such
+  // as nested template instances. Such definitions are parsed every
+  // time.
+  bool compiled;
+  std::vector<EvtxTemplateOp> ops;
+  std::vector<uint8_t> storage;
+};
+
+#define EVTX_MAX_CACHED_TEMPLATES 4096
+
+static const EvtxCompiledTemplate EVTX_UNCOMPILED_TEMPLATE = { false, {}, {} };
+
+static void
+compile_template(const uint8_t* chunk, uint32_t pos, uint32_t end, EvtxCompiledTemplate& compiled)
+{
+  // Offsets of the copied bytes in storage. Pointers are set at the end,
+  // because storage grows while compiling.
+  std::vector<uint32_t> offsets;
+
+  compiled.compiled = true;
+
+  while (pos < end) {
+    uint8_t token = chunk[pos];
+    EvtxTemplateOp op;
+    const uint8_t* bytes = nullptr;
+    uint32_t size = 0;
+
+    op.optional = false;
+    op.index = 0;
+    op.name.chars = nullptr;
+    op.name.length = 0;
+    op.value.type = EVTX_VALUE_NULL;
+    op.value.data = nullptr;
+    op.value.size = 0;
+
+    switch (token & ~BINXML_TOKEN_MORE_FLAG) {
+      case BINXML_TOKEN_EOF:
+        pos = end;
+        continue;
+      case BINXML_TOKEN_OPEN_START_ELEMENT:
+        check_range(pos, 7, end);
+        pos += 7;
+        op.code = TEMPLATE_OP_START_ELEMENT;
+        op.name = read_name(chunk, pos, end);
+        if (token & BINXML_TOKEN_MORE_FLAG) {
+          check_range(pos, 4, end);
+          pos += 4;
+        }
+        break;
+      case BINXML_TOKEN_CLOSE_START_ELEMENT:
+        pos++;
+        op.code = TEMPLATE_OP_CLOSE_START_ELEMENT;
+        break;
+      case BINXML_TOKEN_CLOSE_EMPTY_ELEMENT:
+        pos++;
+        op.code = TEMPLATE_OP_CLOSE_EMPTY_ELEMENT;
+        break;
+      case BINXML_TOKEN_END_ELEMENT:
+        pos++;
+        op.code = TEMPLATE_OP_END_ELEMENT;
+        break;
+      case BINXML_TOKEN_VALUE:
+        check_range(pos, 4, end);
+        if (chunk[pos + 1] != EVTX_VALUE_WSTRING)
+          throw EvtxError("Unsupported value type in binary XML");
+        op.code = TEMPLATE_OP_CONTENT;
+        op.value.type = EVTX_VALUE_WSTRING;
+        op.value.size = read_u16(chunk + pos + 2) * 2;
+        check_range(pos + 4, op.value.size, end);
+        op.value.data = chunk + pos + 4;
+        pos += 4 + op.value.size;
+        break;
+      case BINXML_TOKEN_ATTRIBUTE:
+        pos++;
+        op.code = TEMPLATE_OP_ATTRIBUTE;
+        op.name = read_name(chunk, pos, end);
+        if (pos + 4 <= end && chunk[pos] == BINXML_TOKEN_OPTIONAL_SUBSTITUTION) {
+          op.optional = true;
+          op.index = read_u16(chunk + pos + 1);
+        }
+        break;
+      case BINXML_TOKEN_CDATA_SECTION:
+        check_range(pos, 3, end);
+        op.code = TEMPLATE_OP_CONTENT;
+        op.value.type = EVTX_VALUE_WSTRING;
+        op.value.size = read_u16(chunk + pos + 1) * 2;
+        check_range(pos + 3, op.value.size, end);
+        op.value.data = chunk + pos + 3;
+        pos += 3 + op.value.size;
+        break;
+      case BINXML_TOKEN_CHAR_REF:
+        check_range(pos, 3, end);
+        op.code = TEMPLATE_OP_CONTENT;
+        op.value.type = EVTX_VALUE_WSTRING;
+        op.value.size = 2;
+        op.value.data = chunk + pos + 1;
+        pos += 3;
+        break;
+      case BINXML_TOKEN_ENTITY_REF:
+        pos++;
+        op.code = TEMPLATE_OP_ENTITY_REFERENCE;
+        op.name = read_name(chunk, pos, end);
+        break;
+      case BINXML_TOKEN_PI_TARGET:
+        pos++;
+        read_name(chunk, pos, end);
+        continue;
+      case BINXML_TOKEN_PI_DATA:
+        check_range(pos, 3, end);
+        pos += 3 + read_u16(chunk + pos + 1) * 2;
+        continue;
+      case BINXML_TOKEN_TEMPLATE_INSTANCE:
+        compiled.compiled = false;
+        return;
+      case BINXML_TOKEN_NORMAL_SUBSTITUTION:
+      case BINXML_TOKEN_OPTIONAL_SUBSTITUTION:
+        check_range(pos, 4, end);
+        op.code = TEMPLATE_OP_SUBSTITUTION;
+        op.optional = token == BINXML_TOKEN_OPTIONAL_SUBSTITUTION;
+        op.index = read_u16(chunk + pos + 1);
+        pos += 4;
+        break;
+      case BINXML_TOKEN_FRAGMENT_HEADER:
+        pos += 4;
+        continue;
+      default:
+        throw EvtxError("Unknown binary XML token");
+    }
+
+    if (op.name.chars) {
+      bytes = op.name.chars;
+      size = op.name.length * 2;
+    } else if (op.value.data) {
+      bytes = op.value.data;
+      size = op.value.size;
+    }
+    offsets.push_back(static_cast<uint32_t>(compiled.storage.size()));
+    compiled.storage.insert(compiled.storage.end(), bytes, bytes + size);
+    compiled.ops.push_back(op);
+  }
+
+  for (size_t i = 0; i < compiled.ops.size(); i++) {
+    EvtxTemplateOp& op = compiled.ops[i];
+    const uint8_t* copy = compiled.storage.data() + offsets[i];
+    if (op.name.chars) {
+      op.name.chars = copy;
+    } else if (op.value.data) {
+      op.value.data = copy;
+    }
+  }
+}
+
+EvtxTemplateCache::EvtxTemplateCache()
+  : hits_(0)
+  , misses_(0)
+{
+}
+
+EvtxTemplateCache::~EvtxTemplateCache() {}
+
+const EvtxCompiledTemplate&
+EvtxTemplateCache::get(const uint8_t* chunk, uint32_t offset)
+{
+  EvtxTemplateKey key;
+
+  // next template offset, GUID and data size
+  check_range(offset, 24, EVTX_CHUNK_SIZE);
+  memcpy(key.guid, chunk + offset + 4, sizeof(key.guid));
+  key.size = read_u32(chunk + offset + 20);
+
+  auto it = templates_.find(key);
+  if (it != templates_.end()) {
+    hits_++;
+    return *it->second;
+  }
+
+  misses_++;
+  // Templates are referred to while they are rendered. So, they are not
+  // evicted.
+  if (templates_.size() >= EVTX_MAX_CACHED_TEMPLATES)
+    return EVTX_UNCOMPILED_TEMPLATE;
+
+  std::unique_ptr<EvtxCompiledTemplate> compiled(new EvtxCompiledTemplate());
+  check_range(offset + 24, key.size, EVTX_CHUNK_SIZE);
+  compile_template(chunk, offset + 24, offset + 24 + key.size, *compiled);
+
+  std::unique_ptr<EvtxCompiledTemplate>& entry = templates_[key];
+  entry = std::move(compiled);
+  return *entry;
+}
+
+void
+EvtxTemplateCache::clear()
+{
+  templates_.clear();
+  hits_ = 0;
+  misses_ = 0;
+}
+
+/* Parses binary XML in a chunk and passes it to a visitor. */
+class BinXmlParser
+{
+public:
+  BinXmlParser(const uint8_t* chunk, EvtxVisitor& visitor, EvtxTemplateCache* cache)
+    : chunk_(chunk)
+    , visitor_(visitor)
+    , cache_(cache)
+    , nesting_(0)
+  {
+  }
+
+  void parse(uint32_t offset, uint32_t size) { parseTokens(offset, offset + size, 0, 0); }
+
+private:
+  void check(uint32_t offset, uint32_t size, uint32_t end) const
+  {
+    check_range(offset, size, end);
+  }
+
+  bool isNull(const EvtxValue& value) const { return is_null_value(value); }
+
+  EvtxName readName(uint32_t& pos, uint32_t end) { return read_name(chunk_, pos, end); }
+  uint32_t parseTokens(uint32_t pos, uint32_t end, size_t valuesBase, size_t valuesCount);
+  uint32_t parseTemplateInstance(uint32_t pos, uint32_t end);
+  void renderTemplate(const EvtxCompiledTemplate& compiled,
+                      size_t valuesBase,
+                      size_t valuesCount);
+  void substitute(const EvtxValue& value);
+
+  const uint8_t* chunk_;
+  EvtxVisitor& visitor_;
+  EvtxTemplateCache* cache_;
+  // Substitution values of the template instances being parsed
+  std::vector<EvtxValue> values_;
+  int nesting_;
+};
+
+void
+BinXmlParser::substitute(const EvtxValue& value)
+{
+  if (value.type == EVTX_VALUE_BINXML) {
+    // Nested binary XML has its own template instances.
+    uint32_t offset = static_cast<uint32_t>(value.data - chunk_);
+    parseTokens(offset, offset + value.size, 0, 0);
+  } else {
+    visitor_.content(value);
+  }
+}
+
+uint32_t
+BinXmlParser::parseTokens(uint32_t pos, uint32_t end, size_t valuesBase, size_t valuesCount)
+{
+  if (++nesting_ > EVTX_MAX_NESTING)
+    throw EvtxError("Binary XML is nested too deeply");
+
+  while (pos < end) {
+    uint8_t token = chunk_[pos];
+
+    switch (token & ~BINXML_TOKEN_MORE_FLAG) {
+      case BINXML_TOKEN_EOF:
+        nesting_--;
+        return pos + 1;
+      case BINXML_TOKEN_OPEN_START_ELEMENT: {
+        // token, dependency identifier and data size
+        check(pos, 7, end);
+        pos += 7;
+        EvtxName name = readName(pos, end);
+        if (token & BINXML_TOKEN_MORE_FLAG) {
+          // attribute list size
+          check(pos, 4, end);
+          pos += 4;
+        }
+        visitor_.startElement(name);
+        break;
+      }
+      case BINXML_TOKEN_CLOSE_START_ELEMENT:
+        pos++;
+        visitor_.closeStartElement(false);
+        break;
+      case BINXML_TOKEN_CLOSE_EMPTY_ELEMENT:
+        pos++;
+        visitor_.closeStartElement(true);
+        break;
+      case BINXML_TOKEN_END_ELEMENT:
+        pos++;
+        visitor_.endElement();
+        break;
+      case BINXML_TOKEN_VALUE: {
+        EvtxValue value;
+        check(pos, 4, end);
+        value.type = chunk_[pos + 1];
+        if (value.type != EVTX_VALUE_WSTRING)
+          throw EvtxError("Unsupported value type in binary XML");
+        value.size = read_u16(chunk_ + pos + 2) * 2;
+        value.data = chunk_ + pos + 4;
+        check(pos + 4, value.size, end);
+        pos += 4 + value.size;
+        visitor_.content(value);
+        break;
+      }
+      case BINXML_TOKEN_ATTRIBUTE: {
+        pos++;
+        EvtxName name = readName(pos, end);
+        // Attributes whose value is an empty optional substitution are
+        // omitted.
+        if (pos + 4 <= end && chunk_[pos] == BINXML_TOKEN_OPTIONAL_SUBSTITUTION) {
+          uint16_t index = read_u16(chunk_ + pos + 1);
+          if (index >= valuesCount || isNull(values_[valuesBase + index])) {
+            pos += 4;
+            break;
+          }
+        }
+        visitor_.attribute(name);
+        break;
+      }
+      case BINXML_TOKEN_CDATA_SECTION: {
+        EvtxValue value;
+        check(pos, 3, end);
+        value.type = EVTX_VALUE_WSTRING;
+        value.size = read_u16(chunk_ + pos + 1) * 2;
+        value.data = chunk_ + pos + 3;
+        check(pos + 3, value.size, end);
+        pos += 3 + value.size;
+        visitor_.content(value);
+        break;
+      }
+      case BINXML_TOKEN_CHAR_REF: {
+        EvtxValue value;
+        check(pos, 3, end);
+        value.type = EVTX_VALUE_WSTRING;
+        value.size = 2;
+        value.data = chunk_ + pos + 1;
+        pos += 3;
+        visitor_.content(value);
+        break;
+      }
+      case BINXML_TOKEN_ENTITY_REF: {
+        pos++;
+        visitor_.entityReference(readName(pos, end));
+        break;
+      }
+      case BINXML_TOKEN_PI_TARGET:
+        // Processing instructions are not rendered.
+        pos++;
+        readName(pos, end);
+        break;
+      case BINXML_TOKEN_PI_DATA:
+        check(pos, 3, end);
+        pos += 3 + read_u16(chunk_ + pos + 1) * 2;
+        break;
+      case BINXML_TOKEN_TEMPLATE_INSTANCE:
+        pos = parseTemplateInstance(pos, end);
+        break;
+      case BINXML_TOKEN_NORMAL_SUBSTITUTION:
+      case BINXML_TOKEN_OPTIONAL_SUBSTITUTION: {
+        check(pos, 4, end);
+        uint16_t index = read_u16(chunk_ + pos + 1);
+        pos += 4;
+        if (index >= valuesCount)
+          throw EvtxError("Substitution index is out of range");
+        // Copy the value. Parsing nested binary XML can grow values_.
+        EvtxValue value = values_[valuesBase + index];
+        if (token == BINXML_TOKEN_OPTIONAL_SUBSTITUTION && isNull(value))
+          break;
+        substitute(value);
+        break;
+      }
+      case BINXML_TOKEN_FRAGMENT_HEADER:
+        // token, major version, minor version and flags
+        pos += 4;
+        break;
+      default:
+        throw EvtxError("Unknown binary XML token");
+    }
+  }
+
+  nesting_--;
+  return pos;
+}
+
+/*
+ * A template instance refers to a template definition in the chunk and
+ * is followed by the substitution values. A template definition which
+ * is used for the first time in the chunk follows the reference.
+ */
+uint32_t
+BinXmlParser::parseTemplateInstance(uint32_t pos, uint32_t end)
+{
+  // token, unknown, template identifier and definition offset
+  check(pos, 10, end);
+  uint32_t definition = read_u32(chunk_ + pos + 6);
+  pos += 10;
+
+  // next template offset, GUID and data size
+  check(definition, 24, EVTX_CHUNK_SIZE);
+  uint32_t bodySize = read_u32(chunk_ + definition + 20);
+  uint32_t body = definition + 24;
+  check(body, bodySize, EVTX_CHUNK_SIZE);
+  if (definition == pos) {
+    pos = body + bodySize;
+    check(definition, pos - definition, end);
+  }
+
+  check(pos, 4, end);
+  uint32_t count = read_u32(chunk_ + pos);
+  pos += 4;
+  if (count > (end - pos) / 4)
+    throw EvtxError("Too many substitution values");
+
+  size_t valuesBase = values_.size();
+  uint32_t data = pos + count * 4;
+  for (uint32_t i = 0; i < count; i++) {
+    EvtxValue value;
+    value.size = read_u16(chunk_ + pos);
+    value.type = chunk_[pos + 2];
+    value.data = chunk_ + data;
+    check(data, value.size, end);
+    values_.push_back(value);
+    pos += 4;
+    data += value.size;
+  }
+
+  const EvtxCompiledTemplate& compiled =
+    cache_ ? cache_->get(chunk_, definition) : EVTX_UNCOMPILED_TEMPLATE;
+  if (compiled.compiled) {
+    renderTemplate(compiled, valuesBase, count);
+  } else {
+    parseTokens(body, body + bodySize, valuesBase, count);
+  }
+  values_.resize(valuesBase);
+
+  return data;
+}
+
+void
+BinXmlParser::renderTemplate(const EvtxCompiledTemplate& compiled,
+                             size_t valuesBase,
+                             size_t valuesCount)
+{
+  if (++nesting_ > EVTX_MAX_NESTING)
+    throw EvtxError("Binary XML is nested too deeply");
+
+  const EvtxTemplateOp* ops = compiled.ops.data();
+  size_t size = compiled.ops.size();
+  for (size_t i = 0; i < size; i++) {
+    const EvtxTemplateOp& op = ops[i];
+
+    switch (op.code) {
+      case TEMPLATE_OP_START_ELEMENT:
+        visitor_.startElement(op.name);
+        break;
+      case TEMPLATE_OP_ATTRIBUTE:
+        if (op.optional &&
+            (op.index >= valuesCount || isNull(values_[valuesBase + op.index]))) {
+          // Skip the substitution, too.
+          i++;
+          break;
+        }
+        visitor_.attribute(op.name);
+        break;
+      case TEMPLATE_OP_CLOSE_START_ELEMENT:
+        visitor_.closeStartElement(false);
+        break;
+      case TEMPLATE_OP_CLOSE_EMPTY_ELEMENT:
+        visitor_.closeStartElement(true);
+        break;
+      case TEMPLATE_OP_END_ELEMENT:
+        visitor_.endElement();
+        break;
+      case TEMPLATE_OP_CONTENT:
+        visitor_.content(op.value);
+        break;
+      case TEMPLATE_OP_ENTITY_REFERENCE:
+        visitor_.entityReference(op.name);
+        break;
+      case TEMPLATE_OP_SUBSTITUTION: {
+        if (op.index >= valuesCount)
+          throw EvtxError("Substitution index is out of range");
+        EvtxValue value = values_[valuesBase + op.index];
+        if (op.optional && isNull(value))
+          break;
+        substitute(value);
+        break;
+      }
+    }
+  }
+
+  nesting_--;
+}
+
+bool
+EvtxChunk::valid() const
+{
+  return memcmp(data_, EVTX_CHUNK_SIGNATURE, sizeof(EVTX_CHUNK_SIGNATURE)) == 0;
+}
+
+/* The checksum covers the header except for the checksum itself and
+ * the flags. */
+bool
+EvtxChunk::headerChecksumValid() const
+{
+  uint32_t crc = winevt_crc32(0, data_, 120);
+
+  crc = winevt_crc32(crc, data_ + 128, EVTX_CHUNK_HEADER_SIZE - 128);
+
+  return crc == read_u32(data_ + 124);
+}
+
+bool
+EvtxChunk::recordsChecksumValid() const
+{
+  uint32_t freeSpace = read_u32(data_ + 48);
+
+  if (freeSpace < EVTX_CHUNK_HEADER_SIZE || freeSpace > EVTX_CHUNK_SIZE)
+    return false;
+
+  return winevt_crc32(0, data_ + EVTX_CHUNK_HEADER_SIZE, freeSpace - EVTX_CHUNK_HEADER_SIZE) ==
+         read_u32(data_ + 52);
+}
+
+void
+EvtxChunk::records(std::vector<EvtxRecord>& records) const
+{
+  uint32_t freeSpace = read_u32(data_ + 48);
+  uint32_t end = freeSpace < EVTX_CHUNK_SIZE ? freeSpace : EVTX_CHUNK_SIZE;
+  uint32_t pos = EVTX_CHUNK_HEADER_SIZE;
+
+  while (pos + EVTX_RECORD_HEADER_SIZE + 4 <= end) {
+    if (read_u32(data_ + pos) != EVTX_RECORD_SIGNATURE)
+      break;
+
+    uint32_t size = read_u32(data_ + pos + 4);
+    if (size < EVTX_RECORD_HEADER_SIZE + 4 || size > end - pos)
+      break;
+
+    EvtxRecord record;
+    record.id = read_u64(data_ + pos + 8);
+    record.writtenTime = read_u64(data_ + pos + 16);
+    record.dataOffset = pos + EVTX_RECORD_HEADER_SIZE;
+    // The record ends with a copy of its size.
+    record.dataSize = size - EVTX_RECORD_HEADER_SIZE - 4;
+    records.push_back(record);
+
+    pos += size;
+  }
+}
+
+void
+EvtxChunk::render(const EvtxRecord& record, EvtxVisitor& visitor, EvtxTemplateCache* cache) const
+{
+  BinXmlParser parser(data_, visitor, cache);
+
+  parser.parse(record.dataOffset, record.dataSize);
+}
+
+EvtxFile::EvtxFile()
+  : fp_(nullptr)
+  , current_(nullptr)
+  , map_(nullptr)
+  , mapSize_(0)
+  , mapOffset_(EVTX_FILE_HEADER_SIZE)
+  , chunkIndex_(0)
+  , checksumMode_(EVTX_CHECKSUM_WARN)
+  , fileHeaderChecksumValid_(true)
+{
+}
+
+EvtxFile::~EvtxFile()
+{
+  close();
+}
+
+void
+EvtxFile::open(const char* path, bool mapped)
+{
+  uint8_t header[EVTX_FILE_HEADER_SIZE];
+
+  close();
+
+#ifdef _WIN32
+  int length = MultiByteToWideChar(CP_UTF8, 0, path, -1, nullptr, 0);
+  std::vector<wchar_t> wpath(length > 0 ? length : 1);
+  MultiByteToWideChar(CP_UTF8, 0, path, -1, wpath.data(), length);
+  fp_ = _wfopen(wpath.data(), L"rb");
+#else
+  fp_ = fopen(path, "rb");
+#endif /* _WIN32 */
+  if (fp_ == nullptr)
+    throw EvtxError(std::string("Cannot open ") + path + ": " + strerror(errno));
+
+  if (fread(header, 1, sizeof(header), fp_) != sizeof(header) ||
+      memcmp(header, EVTX_FILE_SIGNATURE, sizeof(EVTX_FILE_SIGNATURE)) != 0) {
+    close();
+    throw EvtxError(std::string("Not an EVTX file: ") + path);
+  }
+  fileHeaderChecksumValid_ = winevt_crc32(0, header, 120) == read_u32(header + 124);
+
+  if (mapped && map()) {
+    // The mapping stays valid after the file is closed.
+    fclose(fp_);
+    fp_ = nullptr;
+  } else if (chunk_.empty()) {
+    chunk_.resize(EVTX_CHUNK_SIZE);
+  }
+}
+
+#ifdef _WIN32
+bool
+EvtxFile::map()
+{
+  HANDLE file = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(fp_)));
+  LARGE_INTEGER size;
+
+  if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size) ||
+      static_cast<uint64_t>(size.QuadPart) > SIZE_MAX)
+    return false;
+
+  HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping == nullptr)
+    return false;
+  void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  // The view keeps the mapping object alive.
+  CloseHandle(mapping);
+  if (view == nullptr)
+    return false;
+
+  map_ = static_cast<const uint8_t*>(view);
+  mapSize_ = static_cast<uint64_t>(size.QuadPart);
+  return true;
+}
+
+void
+EvtxFile::unmap()
+{
+  UnmapViewOfFile(map_);
+}
+
+void
+EvtxFile::releasePages(uint64_t offset, uint64_t size)
+{
+  // Unlocking pages which are not locked removes them from the working
+  // set.
+  VirtualUnlock(const_cast<uint8_t*>(map_ + offset), static_cast<SIZE_T>(size));
+}
+#else
+bool
+EvtxFile::map()
+{
+  struct stat st;
+
+  if (fstat(fileno(fp_), &st) != 0 || !S_ISREG(st.st_mode) ||
+      static_cast<uint64_t>(st.st_size) > SIZE_MAX)
+    return false;
+
+  void* view = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fileno(fp_), 0);
+  if (view == MAP_FAILED)
+    return false;
+  madvise(view, st.st_size, MADV_SEQUENTIAL);
+
+  map_ = static_cast<const uint8_t*>(view);
+  mapSize_ = static_cast<uint64_t>(st.st_size);
+  return true;
+}
+
+void
+EvtxFile::unmap()
+{
+  munmap(const_cast<uint8_t*>(map_), mapSize_);
+}
+
+void
+EvtxFile::releasePages(uint64_t offset, uint64_t size)
+{
+  static const uint64_t pageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+  uint64_t begin = (offset + pageSize - 1) / pageSize * pageSize;
+  uint64_t end = (offset + size) / pageSize * pageSize;
+
+  // The pages stay in the page cache and are read again on access.
+  if (begin < end)
+    madvise(const_cast<uint8_t*>(map_ + begin), end - begin, MADV_DONTNEED);
+}
+#endif /* _WIN32 */
+
+void
+EvtxFile::close()
+{
+  if (fp_) {
+    fclose(fp_);
+    fp_ = nullptr;
+  }
+  if (map_) {
+    unmap();
+    map_ = nullptr;
+    mapSize_ = 0;
+  }
+  current_ = nullptr;
+  mapOffset_ = EVTX_FILE_HEADER_SIZE;
+  chunkIndex_ = 0;
+  warnings_.clear();
+}
+
+void
+EvtxFile::rewind()
+{
+  if (fp_)
+    fseek(fp_, EVTX_FILE_HEADER_SIZE, SEEK_SET);
+  mapOffset_ = EVTX_FILE_HEADER_SIZE;
+  chunkIndex_ = 0;
+}
+
+/* Returns whether the data can be used. */
+bool
+EvtxFile::verify(bool valid,
+                 const char* message,
+                 uint64_t index,
+                 std::vector<std::string>& warnings) const
+{
+  if (valid)
+    return true;
+
+  char text[128];
+  snprintf(text, sizeof(text), message, static_cast<unsigned long long>(index));
+  if (checksumMode_ == EVTX_CHECKSUM_STRICT)
+    throw EvtxError(text);
+  warnings.push_back(text);
+
+  return false;
+}
+
+bool
+EvtxFile::verifyChunk(const uint8_t* data,
+                      uint64_t index,
+                      std::vector<std::string>& warnings) const
+{
+  if (checksumMode_ == EVTX_CHECKSUM_SKIP)
+    return true;
+
+  // The file header is checked before the first chunk. Records are
+  // read even if it is broken.
+  if (index == 0)
+    verify(
+      fileHeaderChecksumValid_, "The file header has an invalid checksum", index, warnings);
+
+  EvtxChunk chunk(data);
+  return verify(chunk.headerChecksumValid(),
+                "Chunk %llu has an invalid header checksum",
+                index,
+                warnings) &&
+         verify(chunk.recordsChecksumValid(),
+                "Chunk %llu has an invalid records checksum",
+                index,
+                warnings);
+}
+
+void
+EvtxFile::releaseChunk(const uint8_t* data)
+{
+  if (map_ != nullptr && data >= map_ && data < map_ + mapSize_)
+    releasePages(data - map_, EVTX_CHUNK_SIZE);
+}
+
+bool
+EvtxFile::nextChunk()
+{
+  if (map_) {
+    while (mapOffset_ + EVTX_CHUNK_SIZE <= mapSize_) {
+      if (current_ != nullptr)
+        releaseChunk(current_);
+      current_ = map_ + mapOffset_;
+      mapOffset_ += EVTX_CHUNK_SIZE;
+      // Chunks which have never been written are filled with zero.
+      bool valid = chunk().valid() && verifyChunk(current_, chunkIndex_, warnings_);
+      chunkIndex_++;
+      if (valid)
+        return true;
+    }
+    return false;
+  }
+
+  if (fp_ == nullptr)
+    return false;
+
+  current_ = chunk_.data();
+  while (fread(chunk_.data(), 1, EVTX_CHUNK_SIZE, fp_) == EVTX_CHUNK_SIZE) {
+    // Chunks which have never been written are filled with zero.
+    bool valid = chunk().valid() && verifyChunk(current_, chunkIndex_, warnings_);
+    chunkIndex_++;
+    if (valid)
+      return true;
+  }
+
+  return false;
+}
+
+bool
+EvtxFile::claimChunk(uint8_t* buffer, const uint8_t** data, uint64_t* index)
+{
+  for (;;) {
+    if (map_) {
+      if (mapOffset_ + EVTX_CHUNK_SIZE > mapSize_)
+        return false;
+      *data = map_ + mapOffset_;
+      mapOffset_ += EVTX_CHUNK_SIZE;
+    } else {
+      if (fp_ == nullptr || fread(buffer, 1, EVTX_CHUNK_SIZE, fp_) != EVTX_CHUNK_SIZE)
+        return false;
+      *data = buffer;
+    }
+    *index = chunkIndex_++;
+    // Chunks which have never been written are filled with zero.
+    if (EvtxChunk(*data).valid())
+      return true;
+    releaseChunk(*data);
+  }
+}
+
+static void
+append_format(std::string& out, const char* format, ...)
+{
+  char buffer[64];
+  va_list args;
+
+  va_start(args, format);
+  int length = vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+
+  if (length > 0)
+    out.append(buffer, length < static_cast<int>(sizeof(buffer)) ? length : sizeof(buffer) - 1);
+}
+
+static void
+append_filetime(uint64_t filetime, std::string& out)
+{
+  WinevtCivilTime time;
+
+  winevt_filetime_to_civil(filetime, &time);
+  append_format(out,
+                "%04u-%02u-%02uT%02u:%02u:%02u.%07uZ",
+                time.year,
+                time.month,
+                time.day,
+                time.hour,
+                time.minute,
+                time.second,
+                time.fraction);
+}
+
+static void
+append_guid(const uint8_t* p, std::string& out)
+{
+  append_format(out,
+                "{%08X-%04X-%04X-%02X%02X-%02X%02X%02X%02X%02X%02X}",
+                read_u32(p),
+                read_u16(p + 4),
+                read_u16(p + 6),
+                p[8],
+                p[9],
+                p[10],
+                p[11],
+                p[12],
+                p[13],
+                p[14],
+                p[15]);
+}
+
+static void
+append_sid(const uint8_t* p, uint32_t size, std::string& out)
+{
+  if (size < 8 || size < 8u + p[1] * 4u)
+    return;
+
+  uint64_t authority = 0;
+  for (int i = 2; i < 8; i++) {
+    authority = (authority << 8) | p[i];
+  }
+
+  append_format(out, "S-%u-", p[0]);
+  if (authority >= (UINT64_C(1) << 32)) {
+    append_format(out, "0x%012" PRIX64, authority);
+  } else {
+    append_format(out, "%" PRIu64, authority);
+  }
+  for (uint8_t i = 0; i < p[1]; i++) {
+    append_format(out, "-%u", read_u32(p + 8 + i * 4));
+  }
+}
+
+static void
+append_hex(const uint8_t* p, uint32_t size, std::string& out)
+{
+  size_t offset = out.size();
+
+  out.resize(offset + size * 2);
+  winevt_hex_encode(p, size, &out[offset]);
+}
+
+static uint32_t
+value_type_size(uint8_t type)
+{
+  switch (type) {
+    case EVTX_VALUE_INT8:
+    case EVTX_VALUE_UINT8:
+      return 1;
+    case EVTX_VALUE_INT16:
+    case EVTX_VALUE_UINT16:
+      return 2;
+    case EVTX_VALUE_INT32:
+    case EVTX_VALUE_UINT32:
+    case EVTX_VALUE_REAL32:
+    case EVTX_VALUE_BOOL:
+    case EVTX_VALUE_HEXINT32:
+      return 4;
+    case EVTX_VALUE_INT64:
+    case EVTX_VALUE_UINT64:
+    case EVTX_VALUE_REAL64:
+    case EVTX_VALUE_FILETIME:
+    case EVTX_VALUE_HEXINT64:
+      return 8;
+    case EVTX_VALUE_GUID:
+    case EVTX_VALUE_SYSTIME:
+      return 16;
+    default:
+      return 0;
+  }
+}
+
+static void
+append_array(const EvtxValue& value, std::string& out)
+{
+  uint8_t type = value.type & ~EVTX_VALUE_ARRAY;
+
+  if (type == EVTX_VALUE_WSTRING || type == EVTX_VALUE_STRING) {
+    // Strings are separated with NUL.
+    uint32_t unit = type == EVTX_VALUE_WSTRING ? 2 : 1;
+    uint32_t start = 0;
+    bool first = true;
+    for (uint32_t i = 0; i + unit <= value.size; i += unit) {
+      bool nul = unit == 2 ? read_u16(value.data + i) == 0 : value.data[i] == 0;
+      if (nul || i + unit == value.size) {
+        uint32_t stop = nul ? i : i + unit;
+        if (!first)
+          out += ',';
+        EvtxValue element = { type, value.data + start, stop - start };
+        evtx_value_to_utf8(element, out);
+        first = false;
+        start = i + unit;
+      }
+    }
+    return;
+  }
+
+  uint32_t size = value_type_size(type);
+  if (size == 0)
+    return;
+  for (uint32_t i = 0; i + size <= value.size; i += size) {
+    if (i > 0)
+      out += ',';
+    EvtxValue element = { type, value.data + i, size };
+    evtx_value_to_utf8(element, out);
+  }
+}
+
+void
+evtx_value_to_utf8(const EvtxValue& value, std::string& out)
+{
+  const uint8_t* p = value.data;
+  uint32_t size = value.size;
+
+  if (value.type & EVTX_VALUE_ARRAY) {
+    append_array(value, out);
+    return;
+  }
+
+  if (size < value_type_size(value.type))
+    return;
+
+  switch (value.type) {
+    case EVTX_VALUE_WSTRING: {
+      size_t length = size / 2;
+      // Strings in substitution values can be NUL terminated.
+      while (length > 0 && read_u16(p + (length - 1) * 2) == 0) {
+        length--;
+      }
+      append_utf16(p, length, out);
+      break;
+    }
+    case EVTX_VALUE_STRING:
+      out.append(reinterpret_cast<const char*>(p), strnlen(reinterpret_cast<const char*>(p), size));
+      break;
+    case EVTX_VALUE_INT8:
+      append_format(out, "%d", static_cast<int8_t>(p[0]));
+      break;
+    case EVTX_VALUE_UINT8:
+      append_format(out, "%u", p[0]);
+      break;
+    case EVTX_VALUE_INT16:
+      append_format(out, "%d", static_cast<int16_t>(read_u16(p)));
+      break;
+    case EVTX_VALUE_UINT16:
+      append_format(out, "%u", read_u16(p));
+      break;
+    case EVTX_VALUE_INT32:
+      append_format(out, "%d", static_cast<int32_t>(read_u32(p)));
+      break;
+    case EVTX_VALUE_UINT32:
+      append_format(out, "%u", read_u32(p));
+      break;
+    case EVTX_VALUE_INT64:
+      append_format(out, "%" PRId64, static_cast<int64_t>(read_u64(p)));
+      break;
+    case EVTX_VALUE_UINT64:
+      append_format(out, "%" PRIu64, read_u64(p));
+      break;
+    case EVTX_VALUE_REAL32: {
+      uint32_t bits = read_u32(p);
+      float real;
+      memcpy(&real, &bits, sizeof(real));
+      append_format(out, "%g", real);
+      break;
+    }
+    case EVTX_VALUE_REAL64: {
+      uint64_t bits = read_u64(p);
+      double real;
+      memcpy(&real, &bits, sizeof(real));
+      append_format(out, "%g", real);
+      break;
+    }
+    case EVTX_VALUE_BOOL:
+      out += read_u32(p) ? "true" : "false";
+      break;
+    case EVTX_VALUE_BINARY:
+      append_hex(p, size, out);
+      break;
+    case EVTX_VALUE_GUID:
+      append_guid(p, out);
+      break;
+    case EVTX_VALUE_SIZET:
+      append_format(out, "0x%" PRIx64, size >= 8 ? read_u64(p) : read_u32(p));
+      break;
+    case EVTX_VALUE_FILETIME:
+      append_filetime(read_u64(p), out);
+      break;
+    case EVTX_VALUE_SYSTIME:
+      append_format(out,
+                    "%04u-%02u-%02uT%02u:%02u:%02u.%03u0000Z",
+                    read_u16(p),
+                    read_u16(p + 2),
+                    read_u16(p + 6),
+                    read_u16(p + 8),
+                    read_u16(p + 10),
+                    read_u16(p + 12),
+                    read_u16(p + 14));
+      break;
+    case EVTX_VALUE_SID:
+      append_sid(p, size, out);
+      break;
+    case EVTX_VALUE_HEXINT32:
+      append_format(out, "0x%x", read_u32(p));
+      break;
+    case EVTX_VALUE_HEXINT64:
+      append_format(out, "0x%" PRIx64, read_u64(p));
+      break;
+    default:
+      break;
+  }
+}
+
+bool
+evtx_value_to_uint64(const EvtxValue& value, uint64_t* result)
+{
+  const uint8_t* p = value.data;
+
+  if (value.size < value_type_size(value.type))
+    return false;
+
+  switch (value.type) {
+    case EVTX_VALUE_INT8:
+      *result = static_cast<uint64_t>(static_cast<int8_t>(p[0]));
+      return true;
+    case EVTX_VALUE_UINT8:
+      *result = p[0];
+      return true;
+    case EVTX_VALUE_INT16:
+      *result = static_cast<uint64_t>(static_cast<int16_t>(read_u16(p)));
+      return true;
+    case EVTX_VALUE_UINT16:
+      *result = read_u16(p);
+      return true;
+    case EVTX_VALUE_INT32:
+      *result = static_cast<uint64_t>(static_cast<int32_t>(read_u32(p)));
+      return true;
+    case EVTX_VALUE_UINT32:
+    case EVTX_VALUE_BOOL:
+    case EVTX_VALUE_HEXINT32:
+      *result = read_u32(p);
+      return true;
+    case EVTX_VALUE_INT64:
+    case EVTX_VALUE_UINT64:
+    case EVTX_VALUE_HEXINT64:
+    case EVTX_VALUE_FILETIME:
+      *result = read_u64(p);
+      return true;
+    case EVTX_VALUE_SIZET:
+      *result = value.size >= 8 ? read_u64(p) : read_u32(p);
+      return true;
+    case EVTX_VALUE_WSTRING:
+    case EVTX_VALUE_STRING: {
+      std::string text;
+      evtx_value_to_utf8(value, text);
+      if (text.empty())
+        return false;
+      char* stop = nullptr;
+      *result = strtoull(text.c_str(), &stop, 0);
+      return *stop == '\0';
+    }
+    default:
+      return false;
+  }
+}
+
+void
+EvtxXmlWriter::endAttribute()
+{
+  if (inAttribute_) {
+    out_ += '\'';
+    inAttribute_ = false;
+  }
+}
+
+/* Escapes the characters which were appended after from. */
+void
+EvtxXmlWriter::escape(size_t from)
+{
+  size_t i = out_.find_first_of("&<>'\"", from);
+
+  if (i == std::string::npos)
+    return;
+
+  std::string escaped(out_, i);
+  out_.resize(i);
+  for (char c : escaped) {
+    switch (c) {
+      case '&':
+        out_ += "&amp;";
+        break;
+      case '<':
+        out_ += "&lt;";
+        break;
+      case '>':
+        out_ += "&gt;";
+        break;
+      case '\'':
+        out_ += "&apos;";
+        break;
+      case '"':
+        out_ += "&quot;";
+        break;
+      default:
+        out_ += c;
+        break;
+    }
+  }
+}
+
+void
+EvtxXmlWriter::startElement(const EvtxName& name)
+{
+  out_ += '<';
+  evtx_name_to_utf8(name, out_);
+  elements_.push_back(name);
+}
+
+void
+EvtxXmlWriter::attribute(const EvtxName& name)
+{
+  endAttribute();
+  out_ += ' ';
+  evtx_name_to_utf8(name, out_);
+  out_ += "='";
+  inAttribute_ = true;
+}
+
+void
+EvtxXmlWriter::closeStartElement(bool empty)
+{
+  endAttribute();
+  if (empty) {
+    out_ += "/>";
+    if (!elements_.empty())
+      elements_.pop_back();
+  } else {
+    out_ += '>';
+  }
+}
+
+void
+EvtxXmlWriter::endElement()
+{
+  if (elements_.empty())
+    throw EvtxError("Unbalanced end element in binary XML");
+
+  out_ += "</";
+  evtx_name_to_utf8(elements_.back(), out_);
+  out_ += '>';
+  elements_.pop_back();
+}
+
+void
+EvtxXmlWriter::content(const EvtxValue& value)
+{
+  size_t from = out_.size();
+
+  evtx_value_to_utf8(value, out_);
+  escape(from);
+}
+
+void
+EvtxXmlWriter::entityReference(const EvtxName& name)
+{
+  out_ += '&';
+  evtx_name_to_utf8(name, out_);
+  out_ += ';';
+}
+
+EvtxValueCollector::EvtxValueCollector(EvtxSystemValues* system,
+                                       std::vector<EvtxValue>* inserts,
+                                       std::vector<EvtxValue>* names)
+  : system_(system)
+  , inserts_(inserts)
+  , names_(inserts ? names : nullptr)
+  , depth_(0)
+  , section_(SECTION_NONE)
+  , elementSlot_(nullptr)
+  , attributeSlot_(nullptr)
+  , inAttribute_(false)
+  , inNameAttribute_(false)
+  , userData_(false)
+  , insertDepth_(0)
+{
+  element_.chars = nullptr;
+  element_.length = 0;
+  if (system_)
+    memset(system_, 0, sizeof(*system_));
+}
+
+EvtxValue*
+EvtxValueCollector::systemSlot(const EvtxName& name)
+{
+  if (name.equals("EventID"))
+    return &system_->eventID;
+  if (name.equals("Version"))
+    return &system_->version;
+  if (name.equals("Level"))
+    return &system_->level;
+  if (name.equals("Task"))
+    return &system_->task;
+  if (name.equals("Opcode"))
+    return &system_->opcode;
+  if (name.equals("Keywords"))
+    return &system_->keywords;
+  if (name.equals("EventRecordID"))
+    return &system_->eventRecordID;
+  if (name.equals("Channel"))
+    return &system_->channel;
+  if (name.equals("Computer"))
+    return &system_->computer;
+  return nullptr;
+}
+
+EvtxValue*
+EvtxValueCollector::systemAttributeSlot(const EvtxName& name)
+{
+  if (element_.equals("Provider")) {
+    if (name.equals("Name"))
+      return &system_->providerName;
+    if (name.equals("Guid"))
+      return &system_->providerGuid;
+  } else if (element_.equals("EventID")) {
+    if (name.equals("Qualifiers"))
+      return &system_->qualifiers;
+  } else if (element_.equals("TimeCreated")) {
+    if (name.equals("SystemTime"))
+      return &system_->timeCreated;
+  } else if (element_.equals("Correlation")) {
+    if (name.equals("ActivityID"))
+      return &system_->activityID;
+    if (name.equals("RelatedActivityID"))
+      return &system_->relatedActivityID;
+  } else if (element_.equals("Execution")) {
+    if (name.equals("ProcessID"))
+      return &system_->processID;
+    if (name.equals("ThreadID"))
+      return &system_->threadID;
+  } else if (element_.equals("Security")) {
+    if (name.equals("UserID"))
+      return &system_->userID;
+  }
+  return nullptr;
+}
+
+void
+EvtxValueCollector::startElement(const EvtxName& name)
+{
+  depth_++;
+  inAttribute_ = false;
+
+  if (depth_ == 2) {
+    if (name.equals("System")) {
+      section_ = SECTION_SYSTEM;
+    } else if (name.equals("EventData")) {
+      section_ = SECTION_EVENT_DATA;
+    } else if (name.equals("UserData")) {
+      section_ = SECTION_USER_DATA;
+      userData_ = true;
+    } else {
+      section_ = SECTION_NONE;
+    }
+  } else if (depth_ == 3 && section_ == SECTION_SYSTEM && system_) {
+    element_ = name;
+    elementSlot_ = systemSlot(name);
+  }
+
+  if (inserts_ && ((section_ == SECTION_EVENT_DATA && depth_ == 3) ||
+                   (section_ == SECTION_USER_DATA && depth_ == 4))) {
+    EvtxValue null = { EVTX_VALUE_NULL, nullptr, 0 };
+    inserts_->push_back(null);
+    insertDepth_ = depth_;
+    if (names_) {
+      if (section_ == SECTION_USER_DATA) {
+        // Names point into the chunk as well as values.
+        EvtxValue elementName = { EVTX_VALUE_WSTRING, name.chars, name.length * 2u };
+        names_->push_back(elementName);
+      } else {
+        names_->push_back(null);
+      }
+    }
+  }
+}
+
+void
+EvtxValueCollector::attribute(const EvtxName& name)
+{
+  inAttribute_ = true;
+  attributeSlot_ = nullptr;
+  inNameAttribute_ = false;
+  if (depth_ == 3 && section_ == SECTION_SYSTEM && system_)
+    attributeSlot_ = systemAttributeSlot(name);
+  if (names_ && insertDepth_ == depth_ && section_ == SECTION_EVENT_DATA)
+    inNameAttribute_ = name.equals("Name");
+}
+
+void
+EvtxValueCollector::closeStartElement(bool empty)
+{
+  inAttribute_ = false;
+  attributeSlot_ = nullptr;
+  inNameAttribute_ = false;
+  if (empty)
+    endElement();
+}
+
+void
+EvtxValueCollector::endElement()
+{
+  if (depth_ == insertDepth_)
+    insertDepth_ = 0;
+  if (depth_ == 3)
+    elementSlot_ = nullptr;
+  if (depth_ == 2)
+    section_ = SECTION_NONE;
+  depth_--;
+}
+
+void
+EvtxValueCollector::content(const EvtxValue& value)
+{
+  if (inAttribute_) {
+    if (attributeSlot_ && attributeSlot_->type == EVTX_VALUE_NULL)
+      *attributeSlot_ = value;
+    if (inNameAttribute_ && names_->back().type == EVTX_VALUE_NULL)
+      names_->back() = value;
+    return;
+  }
+
+  if (elementSlot_ && elementSlot_->type == EVTX_VALUE_NULL)
+    *elementSlot_ = value;
+  if (insertDepth_ && depth_ == insertDepth_ && inserts_->back().type == EVTX_VALUE_NULL)
+    inserts_->back() = value;
+}
+
+void
+EvtxValueCollector::entityReference(const EvtxName&)
+{
+}
@@ -0,0 +1,425 @@
+#ifndef _WINEVT_EVTX_H_
+#define _WINEVT_EVTX_H_
+
+/*
+ * Reader for EVTX files.
+ *
+ * This header does not depend on Windows or Ruby headers so that
+ * exported event logs can be read on any platform. An EVTX file is a
+ * 4KiB file header followed by 64KiB chunks. Each chunk has its own
+ * string and template tables, and holds event records as binary XML.
+ * Offsets in binary XML are relative to the beginning of the chunk.
+ */
+
+#include <memory>
+#include <stdexcept>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define EVTX_FILE_HEADER_SIZE 4096
+#define EVTX_CHUNK_SIZE 65536
+#define EVTX_CHUNK_HEADER_SIZE 512
+#define EVTX_RECORD_HEADER_SIZE 24
+
+enum EvtxValueType
+{
+  EVTX_VALUE_NULL = 0x00,
+  EVTX_VALUE_WSTRING = 0x01,
+  EVTX_VALUE_STRING = 0x02,
+  EVTX_VALUE_INT8 = 0x03,
+  EVTX_VALUE_UINT8 = 0x04,
+  EVTX_VALUE_INT16 = 0x05,
+  EVTX_VALUE_UINT16 = 0x06,
+  EVTX_VALUE_INT32 = 0x07,
+  EVTX_VALUE_UINT32 = 0x08,
+  EVTX_VALUE_INT64 = 0x09,
+  EVTX_VALUE_UINT64 = 0x0a,
+  EVTX_VALUE_REAL32 = 0x0b,
+  EVTX_VALUE_REAL64 = 0x0c,
+  EVTX_VALUE_BOOL = 0x0d,
+  EVTX_VALUE_BINARY = 0x0e,
+  EVTX_VALUE_GUID = 0x0f,
+  EVTX_VALUE_SIZET = 0x10,
+  EVTX_VALUE_FILETIME = 0x11,
+  EVTX_VALUE_SYSTIME = 0x12,
+  EVTX_VALUE_SID = 0x13,
+  EVTX_VALUE_HEXINT32 = 0x14,
+  EVTX_VALUE_HEXINT64 = 0x15,
+  EVTX_VALUE_BINXML = 0x21,
+  EVTX_VALUE_ARRAY = 0x80,
+};
+
+/* A value which points into the chunk it was read from. */
+struct EvtxValue
+{
+  uint8_t type;
+  const uint8_t* data;
+  uint32_t size;
+};
+
+/* An element, attribute or entity name. chars is UTF-16LE. */
+struct EvtxName
+{
+  const uint8_t* chars;
+  uint16_t length;
+
+  bool equals(const char* ascii) const;
+};
+
+class EvtxError : public std::runtime_error
+{
+public:
+  explicit EvtxError(const std::string& message)
+    : std::runtime_error(message)
+  {
+  }
+};
+
+/*
+ * Receives a record as a stream of XML events. Attribute values and
+ * element contents are passed to content(). Attribute values end at
+ * the next attribute() or closeStartElement().
+ */
+class EvtxVisitor
+{
+public:
+  virtual ~EvtxVisitor() {}
+  virtual void startElement(const EvtxName& name) = 0;
+  virtual void attribute(const EvtxName& name) = 0;
+  virtual void closeStartElement(bool empty) = 0;
+  virtual void endElement() = 0;
+  virtual void content(const EvtxValue& value) = 0;
+  virtual void entityReference(const EvtxName& name) = 0;
+};
+
+struct EvtxRecord
+{
+  uint64_t id;
+  uint64_t writtenTime;
+  // Binary XML of the record. The offset is relative to the chunk.
+  uint32_t dataOffset;
+  uint32_t dataSize;
+};
+
+struct EvtxCompiledTemplate;
+
+/* GUID and data size of a template definition */
+struct EvtxTemplateKey
+{
+  uint64_t guid[2];
+  uint32_t size;
+
+  bool operator==(const EvtxTemplateKey& other) const
+  {
+    return guid[0] == other.guid[0] && guid[1] == other.guid[1] && size == other.size;
+  }
+};
+
+struct EvtxTemplateKeyHash
+{
+  size_t operator()(const EvtxTemplateKey& key) const
+  {
+    return static_cast<size_t>(key.guid[0] ^ (key.guid[1] * 31) ^ key.size);
+  }
+};
+
+/*
+ * Template definitions which are compiled into flat lists of
+ * operations. Template definitions are identified by their GUID, so a
+ * template is compiled once and reused by the following chunks. A cache
+ * must not be shared between threads.
+ */
+class EvtxTemplateCache
+{
+public:
+  EvtxTemplateCache();
+  ~EvtxTemplateCache();
+
+  /* Returns the compiled template of the definition at offset in
+   * chunk. */
+  const EvtxCompiledTemplate& get(const uint8_t* chunk, uint32_t offset);
+  void clear();
+
+  uint64_t hits() const { return hits_; }
+  uint64_t misses() const { return misses_; }
+  size_t size() const { return templates_.size(); }
+
+private:
+  EvtxTemplateCache(const EvtxTemplateCache&);
+  EvtxTemplateCache& operator=(const EvtxTemplateCache&);
+
+  std::unordered_map<EvtxTemplateKey, std::unique_ptr<EvtxCompiledTemplate>, EvtxTemplateKeyHash>
+    templates_;
+  uint64_t hits_;
+  uint64_t misses_;
+};
+
+class EvtxChunk
+{
+public:
+  explicit EvtxChunk(const uint8_t* data)
+    : data_(data)
+  {
+  }
+
+  bool valid() const;
+  const uint8_t* data() const { return data_; }
+  /* Whether the CRC-32 of the chunk header matches. */
+  bool headerChecksumValid() const;
+  /* Whether the CRC-32 of the event records matches. */
+  bool recordsChecksumValid() const;
+  /* Appends the records of this chunk to records. */
+  void records(std::vector<EvtxRecord>& records) const;
+  /* Parses the binary XML of record and passes it to visitor. Template
+   * instances are rendered from cache when it is given. */
+  void render(const EvtxRecord& record,
+              EvtxVisitor& visitor,
+              EvtxTemplateCache* cache = nullptr) const;
+
+private:
+  const uint8_t* data_;
+};
+
+enum EvtxChecksumMode
+{
+  // Corrupted chunks raise EvtxError.
+  EVTX_CHECKSUM_STRICT,
+  // Corrupted chunks are skipped with a warning.
+  EVTX_CHECKSUM_WARN,
+  // Checksums are not verified.
+  EVTX_CHECKSUM_SKIP,
+};
+
+/*
+ * Reads chunks of an EVTX file. When the file is mapped into memory,
+ * chunks are views into the mapping and are never copied. Pages of the
+ * chunks which have been read are released from the working set, so the
+ * resident memory does not grow with the size of the file. Otherwise,
+ * chunks are read into a buffer one by one.
+ */
+class EvtxFile
+{
+public:
+  EvtxFile();
+  ~EvtxFile();
+
+  /* path is UTF-8. Falls back to buffered reads when the file cannot be
+   * mapped. */
+  void open(const char* path, bool mapped = true);
+  void close();
+  void rewind();
+  /* Reads the next chunk which has the chunk signature. Returns false
+   * at the end of the file. */
+  bool nextChunk();
+  EvtxChunk chunk() const { return EvtxChunk(current_); }
+  bool mapped() const { return map_ != nullptr; }
+  /* Claims the next chunk which has the chunk signature without
+   * checking its checksums, so that another thread can check and
+   * decode it. data points into the mapping, or into buffer of
+   * EVTX_CHUNK_SIZE bytes when the file is not mapped. index is the
+   * index of the chunk in the file. Returns false at the end of the
+   * file. */
+  bool claimChunk(uint8_t* buffer, const uint8_t** data, uint64_t* index);
+  /* Checks the checksums of a claimed chunk in the checksum mode and
+   * returns whether its records can be read. Warnings are added to
+   * warnings, or thrown as EvtxError in EVTX_CHECKSUM_STRICT mode.
+   * This can be called on any thread. */
+  bool verifyChunk(const uint8_t* data,
+                   uint64_t index,
+                   std::vector<std::string>& warnings) const;
+  /* Releases the pages of a claimed chunk which is no longer used. */
+  void releaseChunk(const uint8_t* data);
+
+  void setChecksumMode(EvtxChecksumMode mode) { checksumMode_ = mode; }
+  /* Warnings about corrupted chunks in EVTX_CHECKSUM_WARN mode. */
+  std::vector<std::string>& warnings() { return warnings_; }
+
+private:
+  EvtxFile(const EvtxFile&);
+  EvtxFile& operator=(const EvtxFile&);
+
+  bool map();
+  void unmap();
+  void releasePages(uint64_t offset, uint64_t size);
+  bool verify(bool valid,
+              const char* message,
+              uint64_t index,
+              std::vector<std::string>& warnings) const;
+
+  FILE* fp_;
+  std::vector<uint8_t> chunk_;
+  const uint8_t* current_;
+  // Mapping of the whole file
+  const uint8_t* map_;
+  uint64_t mapSize_;
+  // Offset of the next chunk in the mapping
+  uint64_t mapOffset_;
+  // Index of the chunk which is read next
+  uint64_t chunkIndex_;
+  EvtxChecksumMode checksumMode_;
+  bool fileHeaderChecksumValid_;
+  std::vector<std::string> warnings_;
+};
+
+/* Appends the textual representation of value to out as UTF-8. This is
+ * the same representation as the XML which EvtRender produces. */
+void evtx_value_to_utf8(const EvtxValue& value, std::string& out);
+void evtx_name_to_utf8(const EvtxName& name, std::string& out);
+/* Returns integer values and numeric strings as uint64_t. */
+bool evtx_value_to_uint64(const EvtxValue& value, uint64_t* result);
+
+/*
+ * Renders records as XML. The output is the same as EvtRender with
+ * EvtRenderEventXml.
+ */
+class EvtxXmlWriter : public EvtxVisitor
+{
+public:
+  explicit EvtxXmlWriter(std::string& out)
+    : out_(out)
+    , inAttribute_(false)
+  {
+  }
+
+  void startElement(const EvtxName& name);
+  void attribute(const EvtxName& name);
+  void closeStartElement(bool empty);
+  void endElement();
+  void content(const EvtxValue& value);
+  void entityReference(const EvtxName& name);
+
+private:
+  void endAttribute();
+  void escape(size_t from);
+
+  std::string& out_;
+  std::vector<EvtxName> elements_;
+  bool inAttribute_;
+};
+
+/* Passes events to two visitors, so that a record is parsed once. */
+class EvtxVisitorPair : public EvtxVisitor
+{
+public:
+  EvtxVisitorPair(EvtxVisitor& first, EvtxVisitor& second)
+    : first_(first)
+    , second_(second)
+  {
+  }
+
+  void startElement(const EvtxName& name)
+  {
+    first_.startElement(name);
+    second_.startElement(name);
+  }
+  void attribute(const EvtxName& name)
+  {
+    first_.attribute(name);
+    second_.attribute(name);
+  }
+  void closeStartElement(bool empty)
+  {
+    first_.closeStartElement(empty);
+    second_.closeStartElement(empty);
+  }
+  void endElement()
+  {
+    first_.endElement();
+    second_.endElement();
+  }
+  void content(const EvtxValue& value)
+  {
+    first_.content(value);
+    second_.content(value);
+  }
+  void entityReference(const EvtxName& name)
+  {
+    first_.entityReference(name);
+    second_.entityReference(name);
+  }
+
+private:
+  EvtxVisitor& first_;
+  EvtxVisitor& second_;
+};
+
+/* Values of the System element which are used for system event hashes. */
+struct EvtxSystemValues
+{
+  EvtxValue providerName;
+  EvtxValue providerGuid;
+  EvtxValue eventID;
+  EvtxValue qualifiers;
+  EvtxValue version;
+  EvtxValue level;
+  EvtxValue task;
+  EvtxValue opcode;
+  EvtxValue keywords;
+  EvtxValue timeCreated;
+  EvtxValue eventRecordID;
+  EvtxValue activityID;
+  EvtxValue relatedActivityID;
+  EvtxValue processID;
+  EvtxValue threadID;
+  EvtxValue channel;
+  EvtxValue computer;
+  EvtxValue userID;
+};
+
+/*
+ * Collects System values and string inserts, which are the values of
+ * EventData/Data elements or of the elements in UserData. When names
+ * is given, it receives the name of each insert: the Name attribute of
+ * Data elements, which is null when it is missing, or the name of the
+ * element in UserData.
+ */
+class EvtxValueCollector : public EvtxVisitor
+{
+public:
+  EvtxValueCollector(EvtxSystemValues* system,
+                     std::vector<EvtxValue>* inserts,
+                     std::vector<EvtxValue>* names = nullptr);
+
+  /* Whether the inserts are read from UserData instead of EventData. */
+  bool userData() const { return userData_; }
+
+  void startElement(const EvtxName& name);
+  void attribute(const EvtxName& name);
+  void closeStartElement(bool empty);
+  void endElement();
+  void content(const EvtxValue& value);
+  void entityReference(const EvtxName& name);
+
+private:
+  enum Section
+  {
+    SECTION_NONE,
+    SECTION_SYSTEM,
+    SECTION_EVENT_DATA,
+    SECTION_USER_DATA,
+  };
+
+  EvtxValue* systemSlot(const EvtxName& name);
+  EvtxValue* systemAttributeSlot(const EvtxName& name);
+
+  EvtxSystemValues* system_;
+  std::vector<EvtxValue>* inserts_;
+  std::vector<EvtxValue>* names_;
+  int depth_;
+  Section section_;
+  // The child element of System which is being read
+  EvtxName element_;
+  EvtxValue* elementSlot_;
+  EvtxValue* attributeSlot_;
+  bool inAttribute_;
+  // Whether the Name attribute of EventData/Data is being read
+  bool inNameAttribute_;
+  bool userData_;
+  // Depth of the element which holds the current string insert
+  int insertDepth_;
+};
+
+#endif // _WINEVT_EVTX_H_
@@ -0,0 +1,265 @@
+#include <winevt_evtx_pool.h>
+
+#include <iterator>
+
+// Chunks which are being decoded or waiting to be handed out, per worker
+#define EVTX_POOL_CHUNKS_PER_WORKER 4
+
+void
+EvtxDecodedChunk::decode(bool renderAsXML, bool collectNames, EvtxTemplateCache* cache)
+{
+  EvtxChunk chunk(data);
+  std::vector<EvtxRecord> headers;
+
+  chunk.records(headers);
+  records.resize(headers.size());
+  for (size_t i = 0; i < headers.size(); i++) {
+    EvtxDecodedRecord& record = records[i];
+    record.id = headers[i].id;
+    record.xml.clear();
+    record.inserts.clear();
+    record.names.clear();
+    record.userData = false;
+    record.error.clear();
+    try {
+      if (renderAsXML) {
+        EvtxXmlWriter writer(record.xml);
+        EvtxValueCollector collector(nullptr, &record.inserts);
+        EvtxVisitorPair visitor(writer, collector);
+        chunk.render(headers[i], visitor, cache);
+      } else {
+        EvtxValueCollector collector(
+          &record.system, &record.inserts, collectNames ? &record.names : nullptr);
+        chunk.render(headers[i], collector, cache);
+        record.userData = collector.userData();
+      }
+    } catch (const EvtxError& e) {
+      record.error = e.what();
+    }
+  }
+}
+
+EvtxDecoderPool::EvtxDecoderPool(EvtxFile& file,
+                                 const std::vector<EvtxTemplateCache*>& caches,
+                                 bool ordered,
+                                 bool renderAsXML,
+                                 bool collectNames)
+  : file_(file)
+  , ordered_(ordered)
+  , renderAsXML_(renderAsXML)
+  , collectNames_(collectNames)
+  , maxInFlight_(caches.size() * EVTX_POOL_CHUNKS_PER_WORKER)
+  , inFlight_(0)
+  , running_(caches.size())
+  , nextRead_(0)
+  , nextDeliver_(0)
+  , errorSequence_(UINT64_MAX)
+  , eof_(false)
+  , stopped_(false)
+  , interrupted_(false)
+{
+  for (EvtxTemplateCache* cache : caches) {
+    threads_.push_back(std::thread(&EvtxDecoderPool::work, this, cache));
+  }
+}
+
+EvtxDecoderPool::~EvtxDecoderPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+  }
+  space_.notify_all();
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+
+  for (EvtxDecodedChunk* chunk : free_) {
+    delete chunk;
+  }
+  for (auto& entry : decoded_) {
+    delete entry.second;
+  }
+}
+
+void
+EvtxDecoderPool::work(EvtxTemplateCache* cache)
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  std::vector<std::string> warnings;
+
+  while (!stopped_ && !eof_) {
+    space_.wait(lock, [this] { return stopped_ || eof_ || inFlight_ < maxInFlight_; });
+    if (stopped_ || eof_)
+      break;
+
+    EvtxDecodedChunk* chunk;
+    if (free_.empty()) {
+      chunk = new EvtxDecodedChunk();
+    } else {
+      chunk = free_.back();
+      free_.pop_back();
+    }
+    if (!file_.mapped() && chunk->buffer.empty())
+      chunk->buffer.resize(EVTX_CHUNK_SIZE);
+
+    // Claiming chunks is serialized. Checksums and decoding run in
+    // parallel.
+    uint64_t index;
+    if (!file_.claimChunk(chunk->buffer.data(), &chunk->data, &index)) {
+      free_.push_back(chunk);
+      eof_ = true;
+      break;
+    }
+    chunk->sequence = nextRead_++;
+    inFlight_++;
+    verifying_.insert(chunk->sequence);
+
+    lock.unlock();
+    bool valid = false;
+    std::string error;
+    try {
+      valid = file_.verifyChunk(chunk->data, index, warnings);
+    } catch (const EvtxError& e) {
+      error = e.what();
+    }
+    lock.lock();
+
+    // Chunks after this one can be handed out of order while it is
+    // decoded.
+    verifying_.erase(chunk->sequence);
+    for (const std::string& warning : warnings) {
+      warnings_.insert(std::make_pair(chunk->sequence, warning));
+    }
+    warnings.clear();
+    if (!error.empty() && chunk->sequence < errorSequence_) {
+      // A corrupted chunk in EVTX_CHECKSUM_STRICT mode ends the file.
+      // Chunks after it may have been claimed already.
+      error_ = error;
+      errorSequence_ = chunk->sequence;
+      eof_ = true;
+      while (!decoded_.empty() && decoded_.rbegin()->first > errorSequence_) {
+        auto last = std::prev(decoded_.end());
+        if (last->second)
+          release(last->second);
+        decoded_.erase(last);
+      }
+    }
+    if (valid && chunk->sequence < errorSequence_) {
+      ready_.notify_all();
+      lock.unlock();
+      chunk->decode(renderAsXML_, collectNames_, cache);
+      lock.lock();
+    }
+    // A chunk before this one may have ended the file while it was
+    // decoded.
+    if (valid && chunk->sequence < errorSequence_) {
+      decoded_[chunk->sequence] = chunk;
+    } else {
+      // Keep the place of a skipped chunk for the order of the others.
+      if (chunk->sequence <= errorSequence_)
+        decoded_[chunk->sequence] = nullptr;
+      release(chunk);
+    }
+    ready_.notify_all();
+  }
+
+  running_--;
+  // Wake up the other workers and next() at the end of the file.
+  space_.notify_all();
+  ready_.notify_all();
+}
+
+/* Returns chunk to the free list. mutex_ must be locked. */
+void
+EvtxDecoderPool::release(EvtxDecodedChunk* chunk)
+{
+  file_.releaseChunk(chunk->data);
+  free_.push_back(chunk);
+  inFlight_--;
+  space_.notify_one();
+}
+
+EvtxDecodedChunk*
+EvtxDecoderPool::next()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  for (;;) {
+    if (interrupted_) {
+      interrupted_ = false;
+      return nullptr;
+    }
+
+    if (!decoded_.empty()) {
+      auto it = decoded_.begin();
+      // decoded_ is sorted by sequence. Out of order, a chunk still waits
+      // until the checksums of the chunks before it are checked, which
+      // may end the file in EVTX_CHECKSUM_STRICT mode, but not until they
+      // are decoded.
+      if (ordered_ ? it->first == nextDeliver_
+                   : verifying_.empty() || *verifying_.begin() > it->first) {
+        EvtxDecodedChunk* chunk = it->second;
+        decoded_.erase(it);
+        nextDeliver_++;
+        if (chunk == nullptr)
+          continue;
+        return chunk;
+      }
+    }
+
+    if (running_ == 0 && decoded_.empty())
+      return nullptr;
+
+    ready_.wait(lock);
+  }
+}
+
+void
+EvtxDecoderPool::recycle(EvtxDecodedChunk* chunk)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  release(chunk);
+}
+
+void
+EvtxDecoderPool::interrupt()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    interrupted_ = true;
+  }
+  ready_.notify_all();
+}
+
+bool
+EvtxDecoderPool::finished()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  return running_ == 0 && decoded_.empty();
+}
+
+std::string
+EvtxDecoderPool::error()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  return error_;
+}
+
+void
+EvtxDecoderPool::takeWarnings(std::vector<std::string>& warnings)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  // Warnings are taken in file order, so not after a chunk before them
+  // is checked.
+  auto end =
+    verifying_.empty() ? warnings_.end() : warnings_.lower_bound(*verifying_.begin());
+  for (auto it = warnings_.begin(); it != end; ++it) {
+    warnings.push_back(it->second);
+  }
+  warnings_.erase(warnings_.begin(), end);
+}
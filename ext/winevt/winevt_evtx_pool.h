@@ -0,0 +1,116 @@
+#ifndef _WINEVT_EVTX_POOL_H_
+#define _WINEVT_EVTX_POOL_H_
+
+/*
+ * Decodes chunks of an EVTX file on worker threads.
+ *
+ * Chunks are independent of each other, because each chunk has its own
+ * string and template tables. Workers claim chunks from the file one at
+ * a time, and check their checksums and render their records without
+ * the lock or any Ruby objects. Chunks of a mapped file are read in
+ * place. Decoded chunks are handed out in file order, or in the order
+ * they are finished. The number of chunks in flight is bounded, so the
+ * memory does not grow with the size of the file.
+ */
+
+#include <winevt_evtx.h>
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+
+struct EvtxDecodedRecord
+{
+  uint64_t id;
+  // Rendered XML when the chunk is decoded as XML
+  std::string xml;
+  EvtxSystemValues system;
+  std::vector<EvtxValue> inserts;
+  // Names of inserts when they are collected
+  std::vector<EvtxValue> names;
+  bool userData;
+  // Set when the binary XML of the record is broken
+  std::string error;
+};
+
+/* A chunk and its decoded records. data points into the mapping of the
+ * file, or into buffer when the file is not mapped. Values in records
+ * point into data. */
+struct EvtxDecodedChunk
+{
+  uint64_t sequence;
+  const uint8_t* data;
+  std::vector<uint8_t> buffer;
+  std::vector<EvtxDecodedRecord> records;
+
+  void decode(bool renderAsXML, bool collectNames, EvtxTemplateCache* cache);
+};
+
+class EvtxDecoderPool
+{
+public:
+  /* Starts a worker for each template cache. file and caches must
+   * outlive the pool. Names of inserts are collected when collectNames
+   * is true and chunks are not rendered as XML. */
+  EvtxDecoderPool(EvtxFile& file,
+                  const std::vector<EvtxTemplateCache*>& caches,
+                  bool ordered,
+                  bool renderAsXML,
+                  bool collectNames = false);
+  ~EvtxDecoderPool();
+
+  /* Blocks until a decoded chunk is available. Returns nullptr at the
+   * end of the file or when interrupt() is called. Pass the chunk to
+   * recycle() when it is no longer used. */
+  EvtxDecodedChunk* next();
+  void recycle(EvtxDecodedChunk* chunk);
+  /* Wakes up next(). This can be called from any thread. */
+  void interrupt();
+  /* Whether every chunk has been handed out by next(). */
+  bool finished();
+  /* The error which stopped reading the file, or an empty string. */
+  std::string error();
+  /* Moves the checksum warnings of the file into warnings. */
+  void takeWarnings(std::vector<std::string>& warnings);
+
+private:
+  EvtxDecoderPool(const EvtxDecoderPool&);
+  EvtxDecoderPool& operator=(const EvtxDecoderPool&);
+
+  void work(EvtxTemplateCache* cache);
+  void release(EvtxDecodedChunk* chunk);
+
+  EvtxFile& file_;
+  bool ordered_;
+  bool renderAsXML_;
+  bool collectNames_;
+  size_t maxInFlight_;
+
+  std::mutex mutex_;
+  std::condition_variable ready_;
+  std::condition_variable space_;
+  std::vector<std::thread> threads_;
+  std::vector<EvtxDecodedChunk*> free_;
+  // Decoded chunks which are not handed out yet, by sequence. Chunks
+  // which are skipped are nullptr.
+  std::map<uint64_t, EvtxDecodedChunk*> decoded_;
+  // Sequences of the chunks whose checksums are being checked
+  std::set<uint64_t> verifying_;
+  // Checksum warnings, by the sequence of their chunk
+  std::multimap<uint64_t, std::string> warnings_;
+  size_t inFlight_;
+  size_t running_;
+  uint64_t nextRead_;
+  uint64_t nextDeliver_;
+  std::string error_;
+  // The sequence of the chunk which had error_. The chunks after it are
+  // not handed out.
+  uint64_t errorSequence_;
+  bool eof_;
+  bool stopped_;
+  bool interrupted_;
+};
+
+#endif // _WINEVT_EVTX_POOL_H_
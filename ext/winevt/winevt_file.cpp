@@ -0,0 +1,1108 @@
+#include <winevt_evtx.h>
+#include <winevt_evtx_pool.h>
+#include <winevt_format.h>
+#include <winevt_hex.h>
+#include <winevt_system_keys.h>
+
+#include <ruby.h>
+#include <ruby/encoding.h>
+#include <ruby/thread.h>
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+/* This file does not depend on Windows headers. EVTX files can be read
+ * on any platform. */
+
+static VALUE rb_cEventLogFile;
+static VALUE rb_eEventLogFileError;
+
+struct WinevtFile
+{
+  EvtxFile* file;
+  // Records in the current chunk of the file
+  std::vector<EvtxRecord>* records;
+  int renderAsXML;
+  int preserveQualifiers;
+  int preserveSID;
+  // Whether system hashes have the names and values of inserts
+  int includeEventData;
+  // Chunks are decoded on this many threads when it is more than 1.
+  unsigned int workers;
+  int ordered;
+  EvtxDecoderPool* pool;
+  // The decoded chunk which is being yielded
+  EvtxDecodedChunk* decodedChunk;
+  // A template cache for each worker. The first one is also used
+  // without workers.
+  std::vector<std::unique_ptr<EvtxTemplateCache>>* templateCaches;
+  EvtxChecksumMode checksumMode;
+};
+
+#define WINEVT_FILE_MAX_WORKERS 256
+
+static const struct {
+  const char* name;
+  EvtxChecksumMode mode;
+} checksumModeNames[] = {
+  { "strict", EVTX_CHECKSUM_STRICT },
+  { "warn", EVTX_CHECKSUM_WARN },
+  { "skip", EVTX_CHECKSUM_SKIP },
+};
+
+static void file_free(void* ptr);
+
+static const rb_data_type_t rb_winevt_file_type = { "winevt/file",
+                                                    {
+                                                      0,
+                                                      file_free,
+                                                      0,
+                                                    },
+                                                    NULL,
+                                                    NULL,
+                                                    RUBY_TYPED_FREE_IMMEDIATELY };
+
+static void
+file_free(void* ptr)
+{
+  struct WinevtFile* winevtFile = (struct WinevtFile*)ptr;
+
+  delete winevtFile->pool;
+  delete winevtFile->decodedChunk;
+  delete winevtFile->file;
+  delete winevtFile->records;
+  delete winevtFile->templateCaches;
+
+  xfree(ptr);
+}
+
+static VALUE
+rb_winevt_file_alloc(VALUE klass)
+{
+  VALUE obj;
+  struct WinevtFile* winevtFile;
+  obj = TypedData_Make_Struct(klass, struct WinevtFile, &rb_winevt_file_type, winevtFile);
+  return obj;
+}
+
+/*
+ * Initalize EventLog::File class.
+ *
+ * @overload initialize(path, mmap=true)
+ *   @param path [String] path of an EVTX file
+ *   @param mmap [Boolean] Map the file into memory instead of reading
+ *     chunks into a buffer.
+ * @raise Winevt::EventLog::File::Error when the file is not an EVTX file
+ * @return [File]
+ *
+ */
+static VALUE
+rb_winevt_file_initialize(int argc, VALUE* argv, VALUE self)
+{
+  struct WinevtFile* winevtFile;
+  VALUE rb_path, rb_mmap;
+  VALUE rb_error = Qnil;
+
+  rb_scan_args(argc, argv, "11", &rb_path, &rb_mmap);
+
+  TypedData_Get_Struct(self, struct WinevtFile, &rb_winevt_file_type, winevtFile);
+
+  FilePathValue(rb_path);
+  rb_path = rb_str_export_to_enc(rb_path, rb_utf8_encoding());
+
+  if (winevtFile->file == nullptr) {
+    winevtFile->file = new EvtxFile();
+    winevtFile->records = new std::vector<EvtxRecord>();
+    winevtFile->templateCaches = new std::vector<std::unique_ptr<EvtxTemplateCache>>();
+  }
+  // Templates are identified by GUID only in a file.
+  winevtFile->templateCaches->clear();
+  winevtFile->templateCaches->emplace_back(new EvtxTemplateCache());
+  winevtFile->renderAsXML = TRUE;
+  winevtFile->preserveQualifiers = FALSE;
+  winevtFile->preserveSID = TRUE;
+  winevtFile->includeEventData = FALSE;
+  winevtFile->workers = 1;
+  winevtFile->ordered = TRUE;
+  winevtFile->checksumMode = EVTX_CHECKSUM_WARN;
+
+  try {
+    winevtFile->file->open(StringValueCStr(rb_path), NIL_P(rb_mmap) || RTEST(rb_mmap));
+  } catch (const EvtxError& e) {
+    rb_error = rb_utf8_str_new_cstr(e.what());
+  }
+  if (!NIL_P(rb_error)) {
+    rb_exc_raise(rb_exc_new_str(rb_eEventLogFileError, rb_error));
+  }
+
+  return Qnil;
+}
+
+static std::vector<EvtxTemplateCache*>
+get_template_caches(struct WinevtFile* winevtFile, unsigned int count)
+{
+  std::vector<EvtxTemplateCache*> caches;
+
+  while (winevtFile->templateCaches->size() < count) {
+    winevtFile->templateCaches->emplace_back(new EvtxTemplateCache());
+  }
+  for (unsigned int i = 0; i < count; i++) {
+    caches.push_back((*winevtFile->templateCaches)[i].get());
+  }
+
+  return caches;
+}
+
+static void
+emit_checksum_warnings(VALUE rb_warnings)
+{
+  for (long i = 0; i < RARRAY_LEN(rb_warnings); i++) {
+    VALUE rb_warning = rb_ary_entry(rb_warnings, i);
+    rb_warn("%s", StringValueCStr(rb_warning));
+  }
+}
+
+static VALUE
+checksum_warnings_to_rb_ary(std::vector<std::string>& warnings)
+{
+  VALUE rb_warnings = rb_ary_new_capa(warnings.size());
+
+  for (const std::string& warning : warnings) {
+    rb_ary_push(rb_warnings, rb_utf8_str_new(warning.data(), warning.size()));
+  }
+  warnings.clear();
+
+  return rb_warnings;
+}
+
+struct WinevtFileRead
+{
+  EvtxFile* file;
+  int read;
+  // Set when a chunk is corrupted in the strict checksum mode
+  char error[128];
+};
+
+static void*
+read_next_chunk(void* ptr)
+{
+  struct WinevtFileRead* read = static_cast<struct WinevtFileRead*>(ptr);
+
+  try {
+    read->read = read->file->nextChunk();
+  } catch (const EvtxError& e) {
+    snprintf(read->error, sizeof(read->error), "%s", e.what());
+  }
+
+  return nullptr;
+}
+
+static VALUE
+rb_winevt_file_next(VALUE self)
+{
+  struct WinevtFile* winevtFile;
+  struct WinevtFileRead read;
+
+  TypedData_Get_Struct(self, struct WinevtFile, &rb_winevt_file_type, winevtFile);
+
+  winevtFile->records->clear();
+
+  for (;;) {
+    read.file = winevtFile->file;
+    read.read = FALSE;
+    read.error[0] = '\0';
+    // Reading a chunk from disk and verifying it does not need the GVL.
+    rb_thread_call_without_gvl(read_next_chunk, &read, RUBY_UBF_IO, nullptr);
+    emit_checksum_warnings(checksum_warnings_to_rb_ary(winevtFile->file->warnings()));
+    if (read.error[0] != '\0') {
+      rb_raise(rb_eEventLogFileError, "%s", read.error);
+    }
+    if (!read.read) {
+      return Qfalse;
+    }
+
+    winevtFile->file->chunk().records(*winevtFile->records);
+    if (!winevtFile->records->empty()) {
+      return Qtrue;
+    }
+  }
+}
+
+static VALUE
+evtx_value_to_rb_str(const EvtxValue& value)
+{
+  std::string text;
+
+  evtx_value_to_utf8(value, text);
+
+  return rb_utf8_str_new(text.data(), text.size());
+}
+
+static VALUE
+evtx_value_to_rb_str_or_nil(const EvtxValue& value)
+{
+  if (value.type == EVTX_VALUE_NULL) {
+    return Qnil;
+  }
+
+  return evtx_value_to_rb_str(value);
+}
+
+static uint64_t
+evtx_value_to_ull(const EvtxValue& value)
+{
+  uint64_t result = 0;
+
+  if (!evtx_value_to_uint64(value, &result)) {
+    return 0;
+  }
+
+  return result;
+}
+
+/* Converts inserts to the same Ruby objects as Query does without
+ * typed values, in the same encodings. Values of arrays are "?" as
+ * EvtRender does not give their elements to Query either. */
+static VALUE
+evtx_insert_to_rb(const EvtxValue& value)
+{
+  uint64_t number = 0;
+  char buffer[WINEVT_FORMAT_BUFFER_SIZE];
+  WinevtCivilTime time;
+
+  switch (value.type) {
+    case EVTX_VALUE_NULL:
+      return Qnil;
+    case EVTX_VALUE_WSTRING:
+    case EVTX_VALUE_STRING:
+    case EVTX_VALUE_GUID:
+    case EVTX_VALUE_SID:
+    case EVTX_VALUE_BINXML:
+      return evtx_value_to_rb_str(value);
+    case EVTX_VALUE_INT8:
+    case EVTX_VALUE_UINT8:
+    case EVTX_VALUE_INT16:
+    case EVTX_VALUE_INT32:
+      // Query widens SByte through UINT32 into INT2NUM.
+      evtx_value_to_uint64(value, &number);
+      return INT2NUM(static_cast<int32_t>(number));
+    case EVTX_VALUE_UINT16:
+    case EVTX_VALUE_UINT32:
+      evtx_value_to_uint64(value, &number);
+      return UINT2NUM(static_cast<uint32_t>(number));
+    case EVTX_VALUE_INT64:
+      evtx_value_to_uint64(value, &number);
+      return LL2NUM(static_cast<int64_t>(number));
+    case EVTX_VALUE_UINT64:
+    case EVTX_VALUE_SIZET:
+      evtx_value_to_uint64(value, &number);
+      return ULL2NUM(number);
+    case EVTX_VALUE_REAL32: {
+      // "%f" of large values is longer than WINEVT_FORMAT_BUFFER_SIZE.
+      char text[256];
+      float real = 0;
+      if (value.size >= sizeof(real)) {
+        memcpy(&real, value.data, sizeof(real));
+      }
+      return rb_utf8_str_new(text, winevt_format_fixed(real, text, sizeof(text)));
+    }
+    case EVTX_VALUE_REAL64: {
+      char text[256];
+      double real = 0;
+      if (value.size >= sizeof(real)) {
+        memcpy(&real, value.data, sizeof(real));
+      }
+      return rb_utf8_str_new(text, winevt_format_fixed(real, text, sizeof(text)));
+    }
+    case EVTX_VALUE_BOOL:
+      evtx_value_to_uint64(value, &number);
+      return number ? Qtrue : Qfalse;
+    case EVTX_VALUE_FILETIME:
+      evtx_value_to_uint64(value, &number);
+      if (number > 0x7FFFFFFFFFFFFFFFULL) {
+        return rb_utf8_str_new_cstr("?");
+      }
+      winevt_filetime_to_civil(number, &time);
+      return rb_utf8_str_new(buffer, winevt_format_insert_time(&time, buffer));
+    case EVTX_VALUE_SYSTIME: {
+      // SYSTEMTIME: year, month, day of week, day, hour, minute, second
+      // and milliseconds as little-endian WORDs.
+      uint16_t fields[8];
+      if (value.size < sizeof(fields)) {
+        return rb_utf8_str_new_cstr("?");
+      }
+      for (int i = 0; i < 8; i++) {
+        fields[i] = value.data[i * 2] | (value.data[i * 2 + 1] << 8);
+      }
+      time.year = fields[0];
+      time.month = fields[1];
+      time.day = fields[3];
+      time.hour = fields[4];
+      time.minute = fields[5];
+      time.second = fields[6];
+      time.fraction = fields[7] * 10000U;
+      return rb_utf8_str_new(buffer, winevt_format_insert_time(&time, buffer));
+    }
+    case EVTX_VALUE_HEXINT32:
+      evtx_value_to_uint64(value, &number);
+      // "%#x" has no prefix for 0.
+      if (number == 0) {
+        return rb_str_new("0", 1);
+      }
+      return rb_str_new(buffer, winevt_format_hex_prefixed(number, 1, buffer));
+    case EVTX_VALUE_HEXINT64:
+      evtx_value_to_uint64(value, &number);
+      return rb_str_new(buffer, winevt_format_hex_prefixed(number, 16, buffer));
+    case EVTX_VALUE_BINARY: {
+      if (value.size == 0) {
+        return rb_str_new2("(NULL)");
+      }
+      VALUE str = rb_str_new(NULL, static_cast<long>(value.size) * 2);
+      winevt_hex_encode(value.data, value.size, RSTRING_PTR(str));
+      return str;
+    }
+    default:
+      return rb_utf8_str_new_cstr("?");
+  }
+}
+
+static VALUE
+render_inserts(const std::vector<EvtxValue>& inserts)
+{
+  VALUE userValues = rb_ary_new_capa(inserts.size());
+
+  for (const EvtxValue& value : inserts) {
+    rb_ary_push(userValues, evtx_insert_to_rb(value));
+  }
+
+  return userValues;
+}
+
+/* Builds the same hash as Query does with render_as_xml = false. */
+static VALUE
+render_system_values(const EvtxSystemValues& system, int preserveQualifiers, int preserveSID)
+{
+  const VALUE* keys = get_system_event_keys(FALSE);
+  VALUE hash = rb_hash_new();
+  uint64_t eventID = evtx_value_to_ull(system.eventID) & 0xffff;
+  uint64_t number = 0;
+  char buffer[WINEVT_FORMAT_BUFFER_SIZE];
+
+  rb_hash_aset(
+    hash, keys[SYSTEM_EVENT_KEY_PROVIDER_NAME], evtx_value_to_rb_str(system.providerName));
+  rb_hash_aset(hash,
+               keys[SYSTEM_EVENT_KEY_PROVIDER_GUID],
+               evtx_value_to_rb_str_or_nil(system.providerGuid));
+
+  if (preserveQualifiers) {
+    if (system.qualifiers.type != EVTX_VALUE_NULL) {
+      rb_hash_aset(hash,
+                   keys[SYSTEM_EVENT_KEY_QUALIFIERS],
+                   INT2NUM(evtx_value_to_ull(system.qualifiers) & 0xffff));
+    } else {
+      rb_hash_aset(hash, keys[SYSTEM_EVENT_KEY_QUALIFIERS], rb_str_new2(""));
+    }
+    rb_hash_aset(hash, keys[SYSTEM_EVENT_KEY_EVENT_ID], INT2NUM(eventID));
+  } else {
+    if (system.qualifiers.type != EVTX_VALUE_NULL) {
+      eventID |= (evtx_value_to_ull(system.qualifiers) & 0xffff) << 16;
+    }
+    rb_hash_aset(hash, keys[SYSTEM_EVENT_KEY_EVENT_ID], ULONG2NUM(eventID));
+  }
+
+  rb_hash_aset(
+    hash, keys[SYSTEM_EVENT_KEY_VERSION], INT2NUM(evtx_value_to_ull(system.version)));
+  rb_hash_aset(hash, keys[SYSTEM_EVENT_KEY_LEVEL], INT2NUM(evtx_value_to_ull(system.level)));
+  rb_hash_aset(hash, keys[SYSTEM_EVENT_KEY_TASK], INT2NUM(evtx_value_to_ull(system.task)));
+  rb_hash_aset(hash, keys[SYSTEM_EVENT_KEY_OPCODE], INT2NUM(evtx_value_to_ull(system.opcode)));
+  if (evtx_value_to_uint64(system.keywords, &number)) {
+    rb_hash_aset(hash,
+                 keys[SYSTEM_EVENT_KEY_KEYWORDS],
+                 rb_str_new(buffer, winevt_format_hex_prefixed(number, 1, buffer)));
+  } else {
+    rb_hash_aset(hash, keys[SYSTEM_EVENT_KEY_KEYWORDS], Qnil);
+  }
+
+  if (evtx_value_to_uint64(system.timeCreated, &number)) {
+    WinevtCivilTime time;
+    winevt_filetime_to_civil(number, &time);
+    rb_hash_aset(hash,
+                 keys[SYSTEM_EVENT_KEY_TIME_CREATED],
+                 rb_str_new(buffer, winevt_format_time_created(&time, buffer)));
+  } else {
+    rb_hash_aset(hash, keys[SYSTEM_EVENT_KEY_TIME_CREATED], Qnil);
+  }
+
+  if (evtx_value_to_uint64(system.eventRecordID, &number)) {
+    rb_hash_aset(hash,
+                 keys[SYSTEM_EVENT_KEY_EVENT_RECORD_ID],
+                 rb_str_new(buffer, winevt_format_uint(number, 1, buffer)));
+  } else {
+    rb_hash_aset(hash, keys[SYSTEM_EVENT_KEY_EVENT_RECORD_ID], Qnil);
+  }
+
+  if (system.activityID.type != EVTX_VALUE_NULL) {
+    rb_hash_aset(
+      hash, keys[SYSTEM_EVENT_KEY_ACTIVITY_ID], evtx_value_to_rb_str(system.activityID));
+  }
+  if (system.relatedActivityID.type != EVTX_VALUE_NULL) {
+    rb_hash_aset(hash,
+                 keys[SYSTEM_EVENT_KEY_RELATED_ACTIVITY_ID],
+                 evtx_value_to_rb_str(system.relatedActivityID));
+  }
+
+  rb_hash_aset(
+    hash, keys[SYSTEM_EVENT_KEY_PROCESS_ID], UINT2NUM(evtx_value_to_ull(system.processID)));
+  rb_hash_aset(
+    hash, keys[SYSTEM_EVENT_KEY_THREAD_ID], UINT2NUM(evtx_value_to_ull(system.threadID)));
+  rb_hash_aset(hash, keys[SYSTEM_EVENT_KEY_CHANNEL], evtx_value_to_rb_str(system.channel));
+  rb_hash_aset(hash, keys[SYSTEM_EVENT_KEY_COMPUTER], evtx_value_to_rb_str(system.computer));
+
+  // SIDs cannot be resolved to account names without the machine which
+  // wrote the file. So, "User" is not set.
+  if (preserveSID && system.userID.type != EVTX_VALUE_NULL) {
+    rb_hash_aset(hash, keys[SYSTEM_EVENT_KEY_USER_ID], evtx_value_to_rb_str(system.userID));
+  }
+
+  return hash;
+}
+
+static VALUE
+event_data_name_to_rb_str(const std::string& name)
+{
+#ifdef HAVE_RB_ENC_INTERNED_STR
+  // Names repeat in every event. Interned strings are not allocated
+  // again, and rb_hash_aset does not dup them.
+  return rb_enc_interned_str(name.data(), name.size(), rb_utf8_encoding());
+#else
+  return rb_utf8_str_new(name.data(), name.size());
+#endif /* HAVE_RB_ENC_INTERNED_STR */
+}
+
+/* Builds {name => value} of EventData/Data elements, or of the elements
+ * in UserData. Data elements without a Name attribute are named
+ * "param1", "param2" and so on by their position. */
+static VALUE
+render_event_data(const std::vector<EvtxValue>& inserts, const std::vector<EvtxValue>& names)
+{
+  VALUE hash = rb_hash_new();
+  std::string name;
+
+  for (size_t i = 0; i < inserts.size(); i++) {
+    name.clear();
+    if (i < names.size() && names[i].type != EVTX_VALUE_NULL) {
+      evtx_value_to_utf8(names[i], name);
+    } else {
+      char param[32];
+      snprintf(param, sizeof(param), "param%lu", static_cast<unsigned long>(i + 1));
+      name = param;
+    }
+    rb_hash_aset(hash, event_data_name_to_rb_str(name), evtx_insert_to_rb(inserts[i]));
+  }
+
+  return hash;
+}
+
+static VALUE
+render_event_hash(struct WinevtFile* winevtFile,
+                  const EvtxSystemValues& system,
+                  const std::vector<EvtxValue>& inserts,
+                  const std::vector<EvtxValue>& names,
+                  bool userData)
+{
+  VALUE hash =
+    render_system_values(system, winevtFile->preserveQualifiers, winevtFile->preserveSID);
+
+  if (winevtFile->includeEventData && !inserts.empty()) {
+    const VALUE* keys = get_system_event_keys(FALSE);
+    rb_hash_aset(hash,
+                 keys[userData ? SYSTEM_EVENT_KEY_USER_DATA : SYSTEM_EVENT_KEY_EVENT_DATA],
+                 render_event_data(inserts, names));
+  }
+
+  return hash;
+}
+
+static void
+rb_winevt_file_render(struct WinevtFile* winevtFile, const EvtxRecord& record,
+                      VALUE* rb_event, VALUE* rb_inserts)
+{
+  VALUE rb_error = Qnil;
+  EvtxChunk chunk = winevtFile->file->chunk();
+  EvtxTemplateCache* cache = winevtFile->templateCaches->front().get();
+
+  try {
+    std::vector<EvtxValue> inserts;
+    if (winevtFile->renderAsXML) {
+      std::string xml;
+      EvtxXmlWriter writer(xml);
+      EvtxValueCollector collector(nullptr, &inserts);
+      EvtxVisitorPair visitor(writer, collector);
+      chunk.render(record, visitor, cache);
+      *rb_event = rb_utf8_str_new(xml.data(), xml.size());
+    } else {
+      // Values are collected straight from binary XML without any XML
+      // text.
+      EvtxSystemValues system;
+      std::vector<EvtxValue> names;
+      EvtxValueCollector collector(
+        &system, &inserts, winevtFile->includeEventData ? &names : nullptr);
+      chunk.render(record, collector, cache);
+      *rb_event = render_event_hash(winevtFile, system, inserts, names, collector.userData());
+    }
+    *rb_inserts = render_inserts(inserts);
+  } catch (const EvtxError& e) {
+    rb_error = rb_sprintf("%s (record %" PRIu64 ")", e.what(), record.id);
+  }
+  if (!NIL_P(rb_error)) {
+    rb_exc_raise(rb_exc_new_str(rb_eEventLogFileError, rb_error));
+  }
+}
+
+static VALUE
+rb_winevt_file_each_yield(VALUE self)
+{
+  struct WinevtFile* winevtFile;
+
+  TypedData_Get_Struct(self, struct WinevtFile, &rb_winevt_file_type, winevtFile);
+
+  for (size_t i = 0; i < winevtFile->records->size(); i++) {
+    VALUE rb_event = Qnil;
+    VALUE rb_inserts = Qnil;
+
+    rb_winevt_file_render(winevtFile, (*winevtFile->records)[i], &rb_event, &rb_inserts);
+    // Messages cannot be formatted without the publisher metadata of
+    // the machine which wrote the file.
+    rb_yield_values(3, rb_event, Qnil, rb_inserts);
+  }
+
+  return Qnil;
+}
+
+static void
+stop_decoder_pool(struct WinevtFile* winevtFile)
+{
+  // Joins the workers.
+  delete winevtFile->pool;
+  winevtFile->pool = nullptr;
+  delete winevtFile->decodedChunk;
+  winevtFile->decodedChunk = nullptr;
+}
+
+static void*
+wait_decoded_chunk(void* ptr)
+{
+  EvtxDecoderPool* pool = static_cast<EvtxDecoderPool*>(ptr);
+
+  return pool->next();
+}
+
+static void
+interrupt_decoder_pool(void* ptr)
+{
+  EvtxDecoderPool* pool = static_cast<EvtxDecoderPool*>(ptr);
+
+  pool->interrupt();
+}
+
+static VALUE
+take_pool_warnings(EvtxDecoderPool* pool)
+{
+  std::vector<std::string> warnings;
+
+  pool->takeWarnings(warnings);
+
+  return checksum_warnings_to_rb_ary(warnings);
+}
+
+static VALUE
+take_pool_error(EvtxDecoderPool* pool)
+{
+  std::string error = pool->error();
+
+  if (error.empty()) {
+    return Qnil;
+  }
+
+  return rb_utf8_str_new(error.data(), error.size());
+}
+
+static VALUE
+rb_winevt_file_each_decoded_yield(VALUE self)
+{
+  struct WinevtFile* winevtFile;
+
+  TypedData_Get_Struct(self, struct WinevtFile, &rb_winevt_file_type, winevtFile);
+
+  for (;;) {
+    EvtxDecoderPool* pool = winevtFile->pool;
+    EvtxDecodedChunk* chunk = static_cast<EvtxDecodedChunk*>(rb_thread_call_without_gvl(
+      wait_decoded_chunk, pool, interrupt_decoder_pool, pool));
+    emit_checksum_warnings(take_pool_warnings(pool));
+    if (chunk == nullptr) {
+      if (pool->finished()) {
+        VALUE rb_error = take_pool_error(pool);
+        if (!NIL_P(rb_error)) {
+          rb_exc_raise(rb_exc_new_str(rb_eEventLogFileError, rb_error));
+        }
+        break;
+      }
+      // Interrupted. Raises if an exception is pending.
+      rb_thread_check_ints();
+      continue;
+    }
+    winevtFile->decodedChunk = chunk;
+
+    for (size_t i = 0; i < chunk->records.size(); i++) {
+      const EvtxDecodedRecord& record = chunk->records[i];
+      VALUE rb_event;
+
+      if (!record.error.empty()) {
+        rb_raise(rb_eEventLogFileError,
+                 "%s (record %" PRIu64 ")",
+                 record.error.c_str(),
+                 record.id);
+      }
+
+      if (winevtFile->renderAsXML) {
+        rb_event = rb_utf8_str_new(record.xml.data(), record.xml.size());
+      } else {
+        rb_event = render_event_hash(
+          winevtFile, record.system, record.inserts, record.names, record.userData);
+      }
+      rb_yield_values(3, rb_event, Qnil, render_inserts(record.inserts));
+
+      // The block closed the file.
+      if (winevtFile->pool == nullptr) {
+        return Qnil;
+      }
+    }
+
+    winevtFile->decodedChunk = nullptr;
+    pool->recycle(chunk);
+  }
+
+  return Qnil;
+}
+
+static VALUE
+rb_winevt_file_each_decoded_ensure(VALUE self)
+{
+  struct WinevtFile* winevtFile;
+
+  TypedData_Get_Struct(self, struct WinevtFile, &rb_winevt_file_type, winevtFile);
+
+  stop_decoder_pool(winevtFile);
+
+  return Qnil;
+}
+
+/*
+ * Enumerate to obtain events in the EVTX file from the beginning.
+ * The second block parameter is always nil, because messages cannot
+ * be formatted without the publisher metadata of the machine which
+ * wrote the file. The third block parameter has the same values as
+ * Query yields without typed values.
+ *
+ * When workers is more than 1, chunks are decoded on that many native
+ * threads without the GVL.
+ *
+ * @raise Winevt::EventLog::File::Error when a chunk is corrupted in
+ *   the strict checksum mode
+ *
+ * @yield (String,nil,Array)
+ *
+ */
+static VALUE
+rb_winevt_file_each(VALUE self)
+{
+  struct WinevtFile* winevtFile;
+
+  RETURN_ENUMERATOR(self, 0, 0);
+
+  TypedData_Get_Struct(self, struct WinevtFile, &rb_winevt_file_type, winevtFile);
+
+  if (winevtFile->pool) {
+    rb_raise(rb_eEventLogFileError, "each is already running");
+  }
+
+  winevtFile->file->rewind();
+  winevtFile->file->setChecksumMode(winevtFile->checksumMode);
+
+  if (winevtFile->workers > 1) {
+    winevtFile->pool = new EvtxDecoderPool(*winevtFile->file,
+                                           get_template_caches(winevtFile, winevtFile->workers),
+                                           winevtFile->ordered,
+                                           winevtFile->renderAsXML,
+                                           winevtFile->includeEventData);
+    rb_ensure(rb_winevt_file_each_decoded_yield, self, rb_winevt_file_each_decoded_ensure, self);
+    return Qnil;
+  }
+
+  while (rb_winevt_file_next(self)) {
+    rb_winevt_file_each_yield(self);
+  }
+
+  return Qnil;
+}
+
+/*
+ * This method returns the number of threads which decode chunks.
+ *
+ * @return [Integer]
+ */
+static VALUE
+rb_winevt_file_get_workers(VALUE self)
+{
+  struct WinevtFile* winevtFile;
+
+  TypedData_Get_Struct(self, struct WinevtFile, &rb_winevt_file_type, winevtFile);
+
+  return UINT2NUM(winevtFile->workers);
+}
+
+/*
+ * This method specifies the number of threads which decode chunks.
+ * 1 decodes chunks on the calling thread.
+ *
+ * @param rb_workers [Integer] 1 to 256
+ */
+static VALUE
+rb_winevt_file_set_workers(VALUE self, VALUE rb_workers)
+{
+  struct WinevtFile* winevtFile;
+  int workers = NUM2INT(rb_workers);
+
+  TypedData_Get_Struct(self, struct WinevtFile, &rb_winevt_file_type, winevtFile);
+
+  if (workers < 1 || workers > WINEVT_FILE_MAX_WORKERS) {
+    rb_raise(rb_eArgError, "workers must be between 1 and %d", WINEVT_FILE_MAX_WORKERS);
+  }
+
+  winevtFile->workers = workers;
+
+  return Qnil;
+}
+
+/*
+ * This method returns whether events are yielded in record order or
+ * not when workers is more than 1.
+ *
+ * @return [Boolean]
+ */
+static VALUE
+rb_winevt_file_ordered_p(VALUE self)
+{
+  struct WinevtFile* winevtFile;
+
+  TypedData_Get_Struct(self, struct WinevtFile, &rb_winevt_file_type, winevtFile);
+
+  return winevtFile->ordered ? Qtrue : Qfalse;
+}
+
+/*
+ * This method specifies whether events are yielded in record order or
+ * not when workers is more than 1. Unordered, chunks are yielded as
+ * soon as they are decoded. Records in a chunk are always in order.
+ *
+ * @param rb_ordered [Boolean]
+ */
+static VALUE
+rb_winevt_file_set_ordered(VALUE self, VALUE rb_ordered)
+{
+  struct WinevtFile* winevtFile;
+
+  TypedData_Get_Struct(self, struct WinevtFile, &rb_winevt_file_type, winevtFile);
+
+  winevtFile->ordered = RTEST(rb_ordered);
+
+  return Qnil;
+}
+
+/*
+ * This method returns how the checksums of chunks are verified.
+ *
+ * @return [Symbol] :strict, :warn or :skip
+ */
+static VALUE
+rb_winevt_file_get_checksum_mode(VALUE self)
+{
+  struct WinevtFile* winevtFile;
+
+  TypedData_Get_Struct(self, struct WinevtFile, &rb_winevt_file_type, winevtFile);
+
+  for (size_t i = 0; i < sizeof(checksumModeNames) / sizeof(checksumModeNames[0]); i++) {
+    if (checksumModeNames[i].mode == winevtFile->checksumMode) {
+      return ID2SYM(rb_intern(checksumModeNames[i].name));
+    }
+  }
+
+  return Qnil;
+}
+
+/*
+ * This method specifies how the CRC-32 checksums of the file header
+ * and chunks are verified.
+ *
+ * * :strict raises Winevt::EventLog::File::Error on a corrupted chunk.
+ * * :warn skips corrupted chunks with a warning. This is the default.
+ * * :skip does not verify checksums. Use this for trusted files.
+ *
+ * @param rb_mode [Symbol] :strict, :warn or :skip
+ */
+static VALUE
+rb_winevt_file_set_checksum_mode(VALUE self, VALUE rb_mode)
+{
+  struct WinevtFile* winevtFile;
+  VALUE rb_name = rb_mode;
+
+  TypedData_Get_Struct(self, struct WinevtFile, &rb_winevt_file_type, winevtFile);
+
+  if (SYMBOL_P(rb_name)) {
+    rb_name = rb_sym2str(rb_name);
+  }
+  Check_Type(rb_name, T_STRING);
+
+  for (size_t i = 0; i < sizeof(checksumModeNames) / sizeof(checksumModeNames[0]); i++) {
+    if (strcmp(StringValueCStr(rb_name), checksumModeNames[i].name) == 0) {
+      winevtFile->checksumMode = checksumModeNames[i].mode;
+      return Qnil;
+    }
+  }
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat="
+#pragma GCC diagnostic ignored "-Wformat-extra-args"
+  rb_raise(rb_eArgError, "Unknown checksum mode: %" PRIsVALUE, rb_name);
+#pragma GCC diagnostic pop
+}
+
+/*
+ * This method returns whether render as xml or not.
+ *
+ * @return [Boolean]
+ */
+static VALUE
+rb_winevt_file_render_as_xml_p(VALUE self)
+{
+  struct WinevtFile* winevtFile;
+
+  TypedData_Get_Struct(self, struct WinevtFile, &rb_winevt_file_type, winevtFile);
+
+  return winevtFile->renderAsXML ? Qtrue : Qfalse;
+}
+
+/*
+ * This method specifies whether render as xml or not.
+ *
+ * @param rb_render_as_xml [Boolean]
+ */
+static VALUE
+rb_winevt_file_set_render_as_xml(VALUE self, VALUE rb_render_as_xml)
+{
+  struct WinevtFile* winevtFile;
+
+  TypedData_Get_Struct(self, struct WinevtFile, &rb_winevt_file_type, winevtFile);
+
+  winevtFile->renderAsXML = RTEST(rb_render_as_xml);
+
+  return Qnil;
+}
+
+/*
+ * This method specifies whether preserving qualifiers key or not.
+ *
+ * @param rb_preserve_qualifiers [Boolean]
+ */
+static VALUE
+rb_winevt_file_set_preserve_qualifiers(VALUE self, VALUE rb_preserve_qualifiers)
+{
+  struct WinevtFile* winevtFile;
+
+  TypedData_Get_Struct(self, struct WinevtFile, &rb_winevt_file_type, winevtFile);
+
+  winevtFile->preserveQualifiers = RTEST(rb_preserve_qualifiers);
+
+  return Qnil;
+}
+
+/*
+ * This method returns whether preserving qualifiers or not.
+ *
+ * @return [Boolean]
+ */
+static VALUE
+rb_winevt_file_get_preserve_qualifiers_p(VALUE self)
+{
+  struct WinevtFile* winevtFile;
+
+  TypedData_Get_Struct(self, struct WinevtFile, &rb_winevt_file_type, winevtFile);
+
+  return winevtFile->preserveQualifiers ? Qtrue : Qfalse;
+}
+
+/*
+ * This method specifies whether preserving SID or not.
+ *
+ * @param rb_preserve_sid_p [Boolean]
+ */
+static VALUE
+rb_winevt_file_set_preserve_sid(VALUE self, VALUE rb_preserve_sid_p)
+{
+  struct WinevtFile* winevtFile;
+
+  TypedData_Get_Struct(self, struct WinevtFile, &rb_winevt_file_type, winevtFile);
+
+  winevtFile->preserveSID = RTEST(rb_preserve_sid_p);
+
+  return Qnil;
+}
+
+/*
+ * This method returns whether preserving SID or not.
+ *
+ * @return [Boolean]
+ */
+static VALUE
+rb_winevt_file_preserve_sid_p(VALUE self)
+{
+  struct WinevtFile* winevtFile;
+
+  TypedData_Get_Struct(self, struct WinevtFile, &rb_winevt_file_type, winevtFile);
+
+  return winevtFile->preserveSID ? Qtrue : Qfalse;
+}
+
+/*
+ * This method specifies whether system hashes have the names and
+ * values of inserts or not. When render_as_xml is false, the values of
+ * EventData/Data elements are added as a hash under "EventData" keyed
+ * by their Name attributes, or the values of the elements in UserData
+ * under "UserData" keyed by element names. Values are decoded straight
+ * from binary XML without rendering XML.
+ *
+ * @param rb_include_event_data [Boolean]
+ */
+static VALUE
+rb_winevt_file_set_include_event_data(VALUE self, VALUE rb_include_event_data)
+{
+  struct WinevtFile* winevtFile;
+
+  TypedData_Get_Struct(self, struct WinevtFile, &rb_winevt_file_type, winevtFile);
+
+  winevtFile->includeEventData = RTEST(rb_include_event_data);
+
+  return Qnil;
+}
+
+/*
+ * This method returns whether system hashes have the names and values
+ * of inserts or not.
+ *
+ * @return [Boolean]
+ */
+static VALUE
+rb_winevt_file_include_event_data_p(VALUE self)
+{
+  struct WinevtFile* winevtFile;
+
+  TypedData_Get_Struct(self, struct WinevtFile, &rb_winevt_file_type, winevtFile);
+
+  return winevtFile->includeEventData ? Qtrue : Qfalse;
+}
+
+/*
+ * This method returns the counters of the template cache. Templates
+ * are compiled once and reused by the records which refer to them.
+ *
+ * @return [Hash] hits, misses and the number of cached templates
+ */
+static VALUE
+rb_winevt_file_template_cache_stats(VALUE self)
+{
+  struct WinevtFile* winevtFile;
+  uint64_t hits = 0, misses = 0, templates = 0;
+  VALUE rb_stats = rb_hash_new();
+
+  TypedData_Get_Struct(self, struct WinevtFile, &rb_winevt_file_type, winevtFile);
+
+  if (winevtFile->templateCaches) {
+    for (const std::unique_ptr<EvtxTemplateCache>& cache : *winevtFile->templateCaches) {
+      hits += cache->hits();
+      misses += cache->misses();
+      templates += cache->size();
+    }
+  }
+
+  rb_hash_aset(rb_stats, ID2SYM(rb_intern("hits")), ULL2NUM(hits));
+  rb_hash_aset(rb_stats, ID2SYM(rb_intern("misses")), ULL2NUM(misses));
+  rb_hash_aset(rb_stats, ID2SYM(rb_intern("templates")), ULL2NUM(templates));
+
+  return rb_stats;
+}
+
+/*
+ * This method returns whether the file is mapped into memory or not.
+ * Files which cannot be mapped are read into a buffer chunk by chunk.
+ *
+ * @return [Boolean]
+ */
+static VALUE
+rb_winevt_file_mmap_p(VALUE self)
+{
+  struct WinevtFile* winevtFile;
+
+  TypedData_Get_Struct(self, struct WinevtFile, &rb_winevt_file_type, winevtFile);
+
+  return winevtFile->file && winevtFile->file->mapped() ? Qtrue : Qfalse;
+}
+
+/*
+ * This method closes the EVTX file.
+ */
+static VALUE
+rb_winevt_file_close(VALUE self)
+{
+  struct WinevtFile* winevtFile;
+
+  TypedData_Get_Struct(self, struct WinevtFile, &rb_winevt_file_type, winevtFile);
+
+  stop_decoder_pool(winevtFile);
+  if (winevtFile->file) {
+    winevtFile->file->close();
+    winevtFile->records->clear();
+  }
+
+  return Qnil;
+}
+
+extern "C" void
+Init_winevt_file(VALUE rb_cEventLog)
+{
+  rb_cEventLogFile = rb_define_class_under(rb_cEventLog, "File", rb_cObject);
+  rb_eEventLogFileError =
+    rb_define_class_under(rb_cEventLogFile, "Error", rb_eStandardError);
+
+  rb_define_alloc_func(rb_cEventLogFile, rb_winevt_file_alloc);
+
+  rb_define_method(rb_cEventLogFile, "initialize", RUBY_METHOD_FUNC(rb_winevt_file_initialize), -1);
+  rb_define_method(rb_cEventLogFile, "each", RUBY_METHOD_FUNC(rb_winevt_file_each), 0);
+  rb_define_method(rb_cEventLogFile, "render_as_xml?", RUBY_METHOD_FUNC(rb_winevt_file_render_as_xml_p), 0);
+  rb_define_method(rb_cEventLogFile, "render_as_xml=", RUBY_METHOD_FUNC(rb_winevt_file_set_render_as_xml), 1);
+  rb_define_method(rb_cEventLogFile, "preserve_qualifiers=", RUBY_METHOD_FUNC(rb_winevt_file_set_preserve_qualifiers), 1);
+  rb_define_method(rb_cEventLogFile, "preserve_qualifiers?", RUBY_METHOD_FUNC(rb_winevt_file_get_preserve_qualifiers_p), 0);
+  rb_define_method(rb_cEventLogFile, "preserve_sid?", RUBY_METHOD_FUNC(rb_winevt_file_preserve_sid_p), 0);
+  rb_define_method(rb_cEventLogFile, "preserve_sid=", RUBY_METHOD_FUNC(rb_winevt_file_set_preserve_sid), 1);
+  rb_define_method(rb_cEventLogFile, "include_event_data?", RUBY_METHOD_FUNC(rb_winevt_file_include_event_data_p), 0);
+  rb_define_method(rb_cEventLogFile, "include_event_data=", RUBY_METHOD_FUNC(rb_winevt_file_set_include_event_data), 1);
+  rb_define_method(rb_cEventLogFile, "workers", RUBY_METHOD_FUNC(rb_winevt_file_get_workers), 0);
+  rb_define_method(rb_cEventLogFile, "workers=", RUBY_METHOD_FUNC(rb_winevt_file_set_workers), 1);
+  rb_define_method(rb_cEventLogFile, "ordered?", RUBY_METHOD_FUNC(rb_winevt_file_ordered_p), 0);
+  rb_define_method(rb_cEventLogFile, "ordered=", RUBY_METHOD_FUNC(rb_winevt_file_set_ordered), 1);
+  rb_define_method(rb_cEventLogFile, "checksum_mode", RUBY_METHOD_FUNC(rb_winevt_file_get_checksum_mode), 0);
+  rb_define_method(rb_cEventLogFile, "checksum_mode=", RUBY_METHOD_FUNC(rb_winevt_file_set_checksum_mode), 1);
+  rb_define_method(rb_cEventLogFile, "template_cache_stats", RUBY_METHOD_FUNC(rb_winevt_file_template_cache_stats), 0);
+  rb_define_method(rb_cEventLogFile, "mmap?", RUBY_METHOD_FUNC(rb_winevt_file_mmap_p), 0);
+  rb_define_method(rb_cEventLogFile, "close", RUBY_METHOD_FUNC(rb_winevt_file_close), 0);
+}
@@ -0,0 +1,309 @@
+#ifndef _WINEVT_FORMAT_H_
+#define _WINEVT_FORMAT_H_
+
+/*
+ * Formatters for the numbers, hexadecimal values and timestamps of
+ * rendered events. Each one writes into a buffer of the caller and
+ * returns the number of characters written, without NUL terminating
+ * it. The output is the same as the printf formats they replace.
+ *
+ * This header does not depend on Windows or Ruby headers so that the
+ * formatters can be tested and benchmarked on any platform.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Large enough for any formatter but winevt_format_fixed(). */
+#define WINEVT_FORMAT_BUFFER_SIZE 64
+
+struct WinevtFormatTable
+{
+  char decimal[100][2];
+  char hex[256][2];
+
+  WinevtFormatTable()
+  {
+    for (int i = 0; i < 100; i++) {
+      decimal[i][0] = static_cast<char>('0' + i / 10);
+      decimal[i][1] = static_cast<char>('0' + i % 10);
+    }
+    for (int i = 0; i < 256; i++) {
+      hex[i][0] = "0123456789abcdef"[i >> 4];
+      hex[i][1] = "0123456789abcdef"[i & 0x0f];
+    }
+  }
+};
+
+static inline const WinevtFormatTable&
+winevt_format_table()
+{
+  static const WinevtFormatTable table;
+  return table;
+}
+
+/* printf("%0*llu", width, value) */
+static inline size_t
+winevt_format_uint(uint64_t value, int width, char* buf)
+{
+  const WinevtFormatTable& table = winevt_format_table();
+  char digits[20];
+  char* p = digits + sizeof(digits);
+  size_t length;
+
+  while (value >= 100) {
+    p -= 2;
+    memcpy(p, table.decimal[value % 100], 2);
+    value /= 100;
+  }
+  if (value >= 10) {
+    p -= 2;
+    memcpy(p, table.decimal[value], 2);
+  } else {
+    *--p = static_cast<char>('0' + value);
+  }
+
+  length = digits + sizeof(digits) - p;
+  if (length < static_cast<size_t>(width)) {
+    memset(buf, '0', width - length);
+    buf += width - length;
+  }
+  memcpy(buf, p, length);
+
+  return length < static_cast<size_t>(width) ? width : length;
+}
+
+/* printf("%0*llx", width, value) with 1 <= width <= 16. */
+static inline size_t
+winevt_format_hex(uint64_t value, int width, char* buf)
+{
+  const WinevtFormatTable& table = winevt_format_table();
+  char digits[16];
+  int start = 0;
+
+  for (int i = 0; i < 8; i++) {
+    memcpy(digits + i * 2, table.hex[(value >> (56 - i * 8)) & 0xff], 2);
+  }
+  while (start < 16 - width && digits[start] == '0') {
+    start++;
+  }
+  memcpy(buf, digits + start, 16 - start);
+
+  return 16 - start;
+}
+
+/* "0x" followed by winevt_format_hex(). */
+static inline size_t
+winevt_format_hex_prefixed(uint64_t value, int width, char* buf)
+{
+  buf[0] = '0';
+  buf[1] = 'x';
+
+  return 2 + winevt_format_hex(value, width, buf + 2);
+}
+
+/* Multiplies a and b into the 128-bit *high:*low. */
+static inline void
+winevt_format_mul64(uint64_t a, uint64_t b, uint64_t* high, uint64_t* low)
+{
+  uint64_t aLow = a & 0xffffffff, aHigh = a >> 32;
+  uint64_t bLow = b & 0xffffffff, bHigh = b >> 32;
+  uint64_t ll = aLow * bLow, lh = aLow * bHigh, hl = aHigh * bLow, hh = aHigh * bHigh;
+  uint64_t middle = (ll >> 32) + (lh & 0xffffffff) + (hl & 0xffffffff);
+
+  *low = (middle << 32) | (ll & 0xffffffff);
+  *high = hh + (lh >> 32) + (hl >> 32) + (middle >> 32);
+}
+
+/*
+ * printf("%f", value): the exact binary value rounded half to even to
+ * 6 decimal places. Values whose magnitude is 2^43 or more, infinities
+ * and NaNs are passed to snprintf, so buf must hold size characters,
+ * which must be at least WINEVT_FORMAT_BUFFER_SIZE.
+ */
+static inline size_t
+winevt_format_fixed(double value, char* buf, size_t size)
+{
+  uint64_t bits;
+  uint64_t mantissa, high, low, quotient, remainder, half;
+  int exponent, shift;
+  size_t length = 0;
+
+  memcpy(&bits, &value, sizeof(bits));
+  exponent = static_cast<int>((bits >> 52) & 0x7ff);
+  mantissa = bits & ((1ULL << 52) - 1);
+  if (exponent >= 1023 + 43) {
+    int written = snprintf(buf, size, "%f", value);
+    if (written < 0) {
+      return 0;
+    }
+    return static_cast<size_t>(written) < size ? written : size - 1;
+  }
+  if (exponent == 0) {
+    exponent = 1;
+  } else {
+    mantissa |= 1ULL << 52;
+  }
+
+  // value * 10^6 = high:low / 2^shift, where high:low < 2^73 and
+  // shift >= 10.
+  shift = 1075 - exponent;
+  winevt_format_mul64(mantissa, 1000000, &high, &low);
+  if (shift >= 74) {
+    // Less than a half.
+    quotient = 0;
+  } else if (shift < 64) {
+    quotient = (high << (64 - shift)) | (low >> shift);
+    remainder = low & ((1ULL << shift) - 1);
+    half = 1ULL << (shift - 1);
+    quotient += remainder > half || (remainder == half && (quotient & 1));
+  } else {
+    int highShift = shift - 64;
+    uint64_t remainderHigh = high & ((1ULL << highShift) - 1);
+    uint64_t halfHigh = highShift > 0 ? 1ULL << (highShift - 1) : 0;
+    half = highShift > 0 ? 0 : 1ULL << 63;
+    quotient = high >> highShift;
+    quotient += remainderHigh > halfHigh ||
+                (remainderHigh == halfHigh && (low > half || (low == half && (quotient & 1))));
+  }
+
+  if (bits >> 63) {
+    buf[length++] = '-';
+  }
+  length += winevt_format_uint(quotient / 1000000, 1, buf + length);
+  buf[length++] = '.';
+  length += winevt_format_uint(quotient % 1000000, 6, buf + length);
+
+  return length;
+}
+
+/* A FILETIME in UTC. fraction is in 100 nanoseconds. */
+struct WinevtCivilTime
+{
+  uint32_t year;
+  uint32_t month;
+  uint32_t day;
+  uint32_t hour;
+  uint32_t minute;
+  uint32_t second;
+  uint32_t fraction;
+};
+
+/*
+ * Converts 100 nanoseconds since 1601-01-01 into a civil time with
+ * civil_from_days of http://howardhinnant.github.io/date_algorithms.html.
+ * Days are counted from 0000-03-01, where the 400 year eras start, so
+ * that they are never negative and no step needs a branch.
+ */
+static inline void
+winevt_filetime_to_civil(uint64_t filetime, WinevtCivilTime* time)
+{
+  uint64_t seconds = filetime / 10000000;
+  uint32_t days = static_cast<uint32_t>(seconds / 86400) + 584694;
+  uint32_t secondOfDay = static_cast<uint32_t>(seconds % 86400);
+  uint32_t era = days / 146097;
+  uint32_t dayOfEra = days - era * 146097;
+  uint32_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+  uint32_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+  uint32_t mp = (5 * dayOfYear + 2) / 153;
+
+  time->day = dayOfYear - (153 * mp + 2) / 5 + 1;
+  time->month = mp + 3 - 12 * (mp >= 10);
+  time->year = yearOfEra + era * 400 + (time->month <= 2);
+  time->hour = secondOfDay / 3600;
+  time->minute = secondOfDay / 60 % 60;
+  time->second = secondOfDay % 60;
+  time->fraction = static_cast<uint32_t>(filetime % 10000000);
+}
+
+/*
+ * Converts a civil time into 100 nanoseconds since 1601-01-01 with
+ * days_from_civil, the inverse of winevt_filetime_to_civil(). As
+ * SystemTimeToFileTime does, it returns false for times which do not
+ * exist or are outside of 1601 to 30827.
+ */
+static inline bool
+winevt_civil_to_filetime(const WinevtCivilTime* time, uint64_t* filetime)
+{
+  static const uint8_t DAYS_IN_MONTH[] = { 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+  uint32_t year, era, yearOfEra, dayOfYear, dayOfEra;
+  uint64_t days;
+
+  if (time->year < 1601 || time->year > 30827 || time->month < 1 || time->month > 12 ||
+      time->day < 1 || time->day > DAYS_IN_MONTH[time->month - 1] || time->hour > 23 ||
+      time->minute > 59 || time->second > 59 || time->fraction > 9999999) {
+    return false;
+  }
+  if (time->month == 2 && time->day == 29 &&
+      (time->year % 4 != 0 || (time->year % 100 == 0 && time->year % 400 != 0))) {
+    return false;
+  }
+
+  year = time->year - (time->month <= 2);
+  era = year / 400;
+  yearOfEra = year - era * 400;
+  dayOfYear = (153 * ((time->month + 9) % 12) + 2) / 5 + time->day - 1;
+  dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+  days = static_cast<uint64_t>(era) * 146097 + dayOfEra - 584694;
+
+  *filetime = ((days * 86400 + time->hour * 3600 + time->minute * 60 + time->second) * 10000000) +
+              time->fraction;
+
+  return true;
+}
+
+/* hh:mm:ss. */
+static inline size_t
+winevt_format_clock(const WinevtCivilTime* time, char* buf)
+{
+  size_t length = winevt_format_uint(time->hour, 2, buf);
+
+  buf[length++] = ':';
+  length += winevt_format_uint(time->minute, 2, buf + length);
+  buf[length++] = ':';
+  length += winevt_format_uint(time->second, 2, buf + length);
+  buf[length++] = '.';
+
+  return length;
+}
+
+/* "%04d-%02d-%02d %02d:%02d:%02d.%dZ" with milliseconds, which
+ * string inserts of FileTime and SysTime use. */
+static inline size_t
+winevt_format_insert_time(const WinevtCivilTime* time, char* buf)
+{
+  size_t length = winevt_format_uint(time->year, 4, buf);
+
+  buf[length++] = '-';
+  length += winevt_format_uint(time->month, 2, buf + length);
+  buf[length++] = '-';
+  length += winevt_format_uint(time->day, 2, buf + length);
+  buf[length++] = ' ';
+  length += winevt_format_clock(time, buf + length);
+  length += winevt_format_uint(time->fraction / 10000, 1, buf + length);
+  buf[length++] = 'Z';
+
+  return length;
+}
+
+/* "%02d/%02d/%02d %02d:%02d:%02d.%llu" with nanoseconds, which
+ * TimeCreated of the system values uses. */
+static inline size_t
+winevt_format_time_created(const WinevtCivilTime* time, char* buf)
+{
+  size_t length = winevt_format_uint(time->year, 2, buf);
+
+  buf[length++] = '/';
+  length += winevt_format_uint(time->month, 2, buf + length);
+  buf[length++] = '/';
+  length += winevt_format_uint(time->day, 2, buf + length);
+  buf[length++] = ' ';
+  length += winevt_format_clock(time, buf + length);
+  length += winevt_format_uint(static_cast<uint64_t>(time->fraction) * 100, 1, buf + length);
+
+  return length;
+}
+
+#endif // _WINEVT_FORMAT_H_
@@ -0,0 +1,321 @@
+#include <winevt_c.h>
+
+#include <ruby/thread.h>
+
+/*
+ * Wrappers which call blocking wevtapi/advapi32 functions without
+ * holding the GVL. They take the same arguments as the wrapped
+ * functions and restore the last error code after the GVL is
+ * reacquired, so that callers can keep using GetLastError().
+ *
+ * EvtRender and EvtFormatMessage of local events are called with the
+ * GVL. They return soon for every event, and releasing the GVL per
+ * event would cost more than it saves. EvtFormatMessage of a remote
+ * session and EvtOpenPublisherMetadata, which is called when the
+ * publisher cache misses, are round trips to the remote machine or
+ * load resource files, and are called without the GVL.
+ */
+
+/* EvtNext waits for this long at most before interrupts of the
+ * calling thread are checked. */
+#define EVT_NEXT_POLL_MSEC 100
+
+struct EvtNextArgs
+{
+  EVT_HANDLE resultSet;
+  DWORD eventsSize;
+  PEVT_HANDLE events;
+  DWORD timeout;
+  DWORD flags;
+  PDWORD returned;
+  BOOL succeeded;
+  DWORD status;
+  BOOL finished;
+  volatile BOOL interrupted;
+};
+
+/* Waits in short slices of the timeout, so that an interrupt of the
+ * thread is noticed without cancelling the result set. */
+static void*
+evt_next_func(void* ptr)
+{
+  struct EvtNextArgs* args = (struct EvtNextArgs*)ptr;
+
+  while (!args->interrupted) {
+    DWORD slice = args->timeout < EVT_NEXT_POLL_MSEC ? args->timeout : EVT_NEXT_POLL_MSEC;
+
+    args->succeeded = winevt_backend->next(args->resultSet,
+                                           args->eventsSize,
+                                           args->events,
+                                           slice,
+                                           args->flags,
+                                           args->returned);
+    args->status = args->succeeded ? ERROR_SUCCESS : GetLastError();
+    if (args->status != ERROR_TIMEOUT || args->timeout == slice) {
+      args->finished = TRUE;
+      break;
+    }
+    if (args->timeout != INFINITE) {
+      args->timeout -= slice;
+    }
+  }
+
+  return NULL;
+}
+
+/* EvtCancel is not called here. It would cancel the result set for
+ * good, and Thread#wakeup or a rescued Thread#raise must not end the
+ * iteration. */
+static void
+evt_next_ubf(void* ptr)
+{
+  struct EvtNextArgs* args = (struct EvtNextArgs*)ptr;
+
+  args->interrupted = TRUE;
+}
+
+static VALUE
+check_ints(VALUE unused)
+{
+  rb_thread_check_ints();
+
+  return Qnil;
+}
+
+BOOL
+EvtNextWithoutGVL(EVT_HANDLE resultSet,
+                  DWORD eventsSize,
+                  PEVT_HANDLE events,
+                  DWORD timeout,
+                  DWORD flags,
+                  PDWORD returned)
+{
+  struct EvtNextArgs args;
+  int state = 0;
+
+  args.resultSet = resultSet;
+  args.eventsSize = eventsSize;
+  args.events = events;
+  args.timeout = timeout;
+  args.flags = flags;
+  args.returned = returned;
+  args.succeeded = FALSE;
+  args.status = ERROR_CANCELLED;
+  args.finished = FALSE;
+
+  do {
+    args.interrupted = FALSE;
+    /* Unlike rb_thread_call_without_gvl, this does not check interrupts
+     * after EvtNext returns, which would leak the events it returned. */
+    rb_thread_call_without_gvl2(evt_next_func, &args, evt_next_ubf, &args);
+
+    /* Interrupts such as Thread#raise are handled here. Waiting goes on
+     * after the others such as Thread#wakeup. */
+    rb_protect(check_ints, Qnil, &state);
+    if (state) {
+      /* The events are dropped, and the caller must not close them
+       * again. */
+      if (args.succeeded) {
+        for (DWORD i = 0; i < *returned; i++) {
+          winevt_backend->close(events[i]);
+          events[i] = NULL;
+        }
+      }
+      *returned = 0;
+      rb_jump_tag(state);
+    }
+  } while (!args.finished);
+
+  SetLastError(args.status);
+  return args.succeeded;
+}
+
+struct LookupAccountSidArgs
+{
+  LPCWSTR systemName;
+  PSID sid;
+  LPWSTR name;
+  LPDWORD nameSize;
+  LPWSTR referencedDomainName;
+  LPDWORD referencedDomainNameSize;
+  PSID_NAME_USE use;
+  BOOL succeeded;
+  DWORD status;
+};
+
+static void*
+lookup_account_sid_func(void* ptr)
+{
+  struct LookupAccountSidArgs* args = (struct LookupAccountSidArgs*)ptr;
+
+  args->succeeded = winevt_backend->lookupAccountSid(args->systemName,
+                                                     args->sid,
+                                                     args->name,
+                                                     args->nameSize,
+                                                     args->referencedDomainName,
+                                                     args->referencedDomainNameSize,
+                                                     args->use);
+  args->status = args->succeeded ? ERROR_SUCCESS : GetLastError();
+
+  return NULL;
+}
+
+BOOL
+LookupAccountSidWithoutGVL(LPCWSTR systemName,
+                           PSID sid,
+                           LPWSTR name,
+                           LPDWORD nameSize,
+                           LPWSTR referencedDomainName,
+                           LPDWORD referencedDomainNameSize,
+                           PSID_NAME_USE use)
+{
+  struct LookupAccountSidArgs args;
+
+  args.systemName = systemName;
+  args.sid = sid;
+  args.name = name;
+  args.nameSize = nameSize;
+  args.referencedDomainName = referencedDomainName;
+  args.referencedDomainNameSize = referencedDomainNameSize;
+  args.use = use;
+  args.succeeded = FALSE;
+  args.status = ERROR_CANCELLED;
+
+  /* LookupAccountSidW cannot be cancelled. So, there is no unblocking function. */
+  rb_thread_call_without_gvl(lookup_account_sid_func, &args, NULL, NULL);
+
+  rb_thread_check_ints();
+
+  SetLastError(args.status);
+  return args.succeeded;
+}
+
+/* Calls func without the GVL. Interrupts are not checked here, because
+ * raising would leak the handle which func opened. They are checked by
+ * the next blocking call or when the method returns.
+ * rb_thread_call_without_gvl2 does not call func when an interrupt is
+ * pending, and then func is called with the GVL. */
+static void
+call_without_gvl_unchecked(void* (*func)(void*), void* args, BOOL* called)
+{
+  *called = FALSE;
+  rb_thread_call_without_gvl2(func, args, NULL, NULL);
+  if (!*called) {
+    func(args);
+  }
+}
+
+struct EvtOpenPublisherMetadataArgs
+{
+  EVT_HANDLE session;
+  LPCWSTR publisherId;
+  LPCWSTR logFilePath;
+  LCID locale;
+  DWORD flags;
+  EVT_HANDLE result;
+  DWORD status;
+  BOOL called;
+};
+
+static void*
+evt_open_publisher_metadata_func(void* ptr)
+{
+  struct EvtOpenPublisherMetadataArgs* args = (struct EvtOpenPublisherMetadataArgs*)ptr;
+
+  args->called = TRUE;
+  args->result = winevt_backend->openPublisherMetadata(
+    args->session, args->publisherId, args->logFilePath, args->locale, args->flags);
+  args->status = args->result ? ERROR_SUCCESS : GetLastError();
+
+  return NULL;
+}
+
+EVT_HANDLE
+EvtOpenPublisherMetadataWithoutGVL(EVT_HANDLE session,
+                                   LPCWSTR publisherId,
+                                   LPCWSTR logFilePath,
+                                   LCID locale,
+                                   DWORD flags)
+{
+  struct EvtOpenPublisherMetadataArgs args;
+
+  args.session = session;
+  args.publisherId = publisherId;
+  args.logFilePath = logFilePath;
+  args.locale = locale;
+  args.flags = flags;
+  args.result = NULL;
+  args.status = ERROR_CANCELLED;
+
+  call_without_gvl_unchecked(evt_open_publisher_metadata_func, &args, &args.called);
+
+  SetLastError(args.status);
+  return args.result;
+}
+
+struct EvtFormatMessageArgs
+{
+  EVT_HANDLE publisherMetadata;
+  EVT_HANDLE event;
+  DWORD messageId;
+  DWORD valueCount;
+  PEVT_VARIANT values;
+  DWORD flags;
+  DWORD bufferSize;
+  LPWSTR buffer;
+  PDWORD bufferUsed;
+  BOOL succeeded;
+  DWORD status;
+  BOOL called;
+};
+
+static void*
+evt_format_message_func(void* ptr)
+{
+  struct EvtFormatMessageArgs* args = (struct EvtFormatMessageArgs*)ptr;
+
+  args->called = TRUE;
+  args->succeeded = winevt_backend->formatMessage(args->publisherMetadata,
+                                                  args->event,
+                                                  args->messageId,
+                                                  args->valueCount,
+                                                  args->values,
+                                                  args->flags,
+                                                  args->bufferSize,
+                                                  args->buffer,
+                                                  args->bufferUsed);
+  args->status = args->succeeded ? ERROR_SUCCESS : GetLastError();
+
+  return NULL;
+}
+
+BOOL
+EvtFormatMessageWithoutGVL(EVT_HANDLE publisherMetadata,
+                           EVT_HANDLE event,
+                           DWORD messageId,
+                           DWORD valueCount,
+                           PEVT_VARIANT values,
+                           DWORD flags,
+                           DWORD bufferSize,
+                           LPWSTR buffer,
+                           PDWORD bufferUsed)
+{
+  struct EvtFormatMessageArgs args;
+
+  args.publisherMetadata = publisherMetadata;
+  args.event = event;
+  args.messageId = messageId;
+  args.valueCount = valueCount;
+  args.values = values;
+  args.flags = flags;
+  args.bufferSize = bufferSize;
+  args.buffer = buffer;
+  args.bufferUsed = bufferUsed;
+  args.succeeded = FALSE;
+  args.status = ERROR_CANCELLED;
+
+  call_without_gvl_unchecked(evt_format_message_func, &args, &args.called);
+
+  SetLastError(args.status);
+  return args.succeeded;
+}
@@ -0,0 +1,135 @@
+#ifndef _WINEVT_HEX_H_
+#define _WINEVT_HEX_H_
+
+/*
+ * Encodes binary event data as upper case hexadecimal, which is how
+ * EvtVarTypeBinary values are displayed.
+ *
+ * This header does not depend on Windows or Ruby headers so that the
+ * encoder can be tested and benchmarked on any platform. On x86, data
+ * is processed 32 bytes at a time when the CPU has AVX2, or 16 bytes at
+ * a time when it has SSSE3, by looking the nibbles up with a byte
+ * shuffle. The rest is looked up two characters at a time.
+ */
+
+#include <winevt_cpu.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef WINEVT_CPU_X86
+#define WINEVT_HEX_SSSE3 1
+#define WINEVT_HEX_AVX2 1
+#endif
+
+#define WINEVT_HEX_DIGITS "0123456789ABCDEF"
+
+struct WinevtHexTable
+{
+  char pairs[256][2];
+
+  WinevtHexTable()
+  {
+    for (int i = 0; i < 256; i++) {
+      pairs[i][0] = WINEVT_HEX_DIGITS[i >> 4];
+      pairs[i][1] = WINEVT_HEX_DIGITS[i & 0x0f];
+    }
+  }
+};
+
+static inline const WinevtHexTable&
+winevt_hex_table()
+{
+  static const WinevtHexTable table;
+  return table;
+}
+
+/* Encodes len bytes at src into len * 2 characters at dst, two
+ * characters per byte. */
+static inline void
+winevt_hex_encode_scalar(const uint8_t* src, size_t len, char* dst)
+{
+  const WinevtHexTable& table = winevt_hex_table();
+
+  for (size_t i = 0; i < len; i++) {
+    memcpy(dst + i * 2, table.pairs[src[i]], 2);
+  }
+}
+
+#ifdef WINEVT_HEX_SSSE3
+/* len must be a multiple of 16. */
+WINEVT_TARGET("ssse3")
+static inline void
+winevt_hex_encode_ssse3(const uint8_t* src, size_t len, char* dst)
+{
+  const __m128i digits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(WINEVT_HEX_DIGITS));
+  const __m128i mask = _mm_set1_epi8(0x0f);
+
+  for (; len >= 16; src += 16, dst += 32, len -= 16) {
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+    __m128i high = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(bytes, 4), mask));
+    __m128i low = _mm_shuffle_epi8(digits, _mm_and_si128(bytes, mask));
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_unpacklo_epi8(high, low));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16), _mm_unpackhi_epi8(high, low));
+  }
+}
+#endif /* WINEVT_HEX_SSSE3 */
+
+#ifdef WINEVT_HEX_AVX2
+/* len must be a multiple of 32. */
+WINEVT_TARGET("avx2")
+static inline void
+winevt_hex_encode_avx2(const uint8_t* src, size_t len, char* dst)
+{
+  const __m256i digits = _mm256_broadcastsi128_si256(
+    _mm_loadu_si128(reinterpret_cast<const __m128i*>(WINEVT_HEX_DIGITS)));
+  const __m256i mask = _mm256_set1_epi8(0x0f);
+
+  for (; len >= 32; src += 32, dst += 64, len -= 32) {
+    __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+    __m256i high = _mm256_shuffle_epi8(digits, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), mask));
+    __m256i low = _mm256_shuffle_epi8(digits, _mm256_and_si256(bytes, mask));
+    // The unpacks work within each 128-bit lane, so the lanes are
+    // put back in order before storing.
+    __m256i first = _mm256_unpacklo_epi8(high, low);
+    __m256i second = _mm256_unpackhi_epi8(high, low);
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst),
+                        _mm256_permute2x128_si256(first, second, 0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 32),
+                        _mm256_permute2x128_si256(first, second, 0x31));
+  }
+}
+#endif /* WINEVT_HEX_AVX2 */
+
+/* Encodes len bytes at src into len * 2 upper case hexadecimal
+ * characters at dst. dst is not NUL terminated. */
+static inline void
+winevt_hex_encode(const void* src, size_t len, char* dst)
+{
+  const uint8_t* p = static_cast<const uint8_t*>(src);
+
+#ifdef WINEVT_HEX_AVX2
+  if (len >= 32 && winevt_cpu_has(WINEVT_CPU_AVX2)) {
+    size_t blocks = len & ~static_cast<size_t>(31);
+    winevt_hex_encode_avx2(p, blocks, dst);
+    p += blocks;
+    dst += blocks * 2;
+    len -= blocks;
+  }
+#endif /* WINEVT_HEX_AVX2 */
+#ifdef WINEVT_HEX_SSSE3
+  if (len >= 16 && winevt_cpu_has(WINEVT_CPU_SSSE3)) {
+    size_t blocks = len & ~static_cast<size_t>(15);
+    winevt_hex_encode_ssse3(p, blocks, dst);
+    p += blocks;
+    dst += blocks * 2;
+    len -= blocks;
+  }
+#endif /* WINEVT_HEX_SSSE3 */
+  winevt_hex_encode_scalar(p, len, dst);
+}
+
+#endif // _WINEVT_HEX_H_
@@ -0,0 +1,362 @@
+#ifndef _WINEVT_JSON_H_
+#define _WINEVT_JSON_H_
+
+/*
+ * Writer of JSON text.
+ *
+ * Strings are escaped while they are written, from UTF-8 or directly
+ * from UTF-16LE, so that UTF-16 strings need no intermediate UTF-8
+ * copy. Runs of ASCII which need no escaping are copied 16 code units
+ * at a time with SSE2, or 32 when the CPU has AVX2. Only the characters which JSON requires
+ * to be escaped are escaped: quotation marks, backslashes and control
+ * characters. Unpaired surrogates are replaced with U+FFFD as in
+ * winevt_utf16_to_utf8().
+ *
+ * This header does not depend on Windows or Ruby headers so that the
+ * writer can be tested and benchmarked on any platform.
+ */
+
+#include <winevt_format.h>
+#include <winevt_utf16.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+
+/* A control character is escaped to 6 bytes such as \u001f. */
+#define WINEVT_JSON_MAX_BYTES_PER_CHAR 6
+
+/* Returns the escape of c if it needs one, or 0. */
+static inline char
+winevt_json_short_escape(uint32_t c)
+{
+  switch (c) {
+    case '"':
+      return '"';
+    case '\\':
+      return '\\';
+    case '\b':
+      return 'b';
+    case '\f':
+      return 'f';
+    case '\n':
+      return 'n';
+    case '\r':
+      return 'r';
+    case '\t':
+      return 't';
+    default:
+      return 0;
+  }
+}
+
+static inline bool
+winevt_json_needs_escape(uint32_t c)
+{
+  return c < 0x20 || c == '"' || c == '\\';
+}
+
+static inline size_t
+winevt_json_escape_char(uint32_t c, char* dst)
+{
+  static const char HEX[] = "0123456789abcdef";
+  char escape = winevt_json_short_escape(c);
+
+  dst[0] = '\\';
+  if (escape) {
+    dst[1] = escape;
+    return 2;
+  }
+  memcpy(dst + 1, "u00", 3);
+  dst[4] = HEX[c >> 4];
+  dst[5] = HEX[c & 0xf];
+  return 6;
+}
+
+// Code units above 0x7fff are negative as signed 16-bit integers, so
+// they fail the signed comparisons with 0x1f below, too.
+
+#ifdef WINEVT_UTF16_AVX2
+/* Copies blocks of 32 code units while they are ASCII which needs no
+ * escaping. Returns the number of code units copied. */
+WINEVT_TARGET("avx2")
+static inline size_t
+winevt_json_ascii_blocks_avx2(const uint16_t* src, size_t len, char* dst)
+{
+  const __m256i space = _mm256_set1_epi16(0x1f);
+  const __m256i del = _mm256_set1_epi16(0x80);
+  const __m256i quote = _mm256_set1_epi16('"');
+  const __m256i backslash = _mm256_set1_epi16('\\');
+  size_t i = 0;
+
+  for (; i + 32 <= len; i += 32) {
+    __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 16));
+    __m256i good0 = _mm256_andnot_si256(
+      _mm256_or_si256(_mm256_cmpeq_epi16(v0, quote), _mm256_cmpeq_epi16(v0, backslash)),
+      _mm256_and_si256(_mm256_cmpgt_epi16(v0, space), _mm256_cmpgt_epi16(del, v0)));
+    __m256i good1 = _mm256_andnot_si256(
+      _mm256_or_si256(_mm256_cmpeq_epi16(v1, quote), _mm256_cmpeq_epi16(v1, backslash)),
+      _mm256_and_si256(_mm256_cmpgt_epi16(v1, space), _mm256_cmpgt_epi16(del, v1)));
+    if (_mm256_movemask_epi8(_mm256_and_si256(good0, good1)) != -1)
+      break;
+    // packus works per 128-bit lane. Restore the order of 64-bit blocks.
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(v0, v1), 0xd8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), packed);
+  }
+
+  return i;
+}
+#endif /* WINEVT_UTF16_AVX2 */
+
+#ifdef WINEVT_UTF16_SSE2
+/* Copies blocks of 16 code units while they are ASCII which needs no
+ * escaping. Returns the number of code units copied. */
+static inline size_t
+winevt_json_ascii_blocks_sse2(const uint16_t* src, size_t len, char* dst)
+{
+  const __m128i space = _mm_set1_epi16(0x1f);
+  const __m128i del = _mm_set1_epi16(0x80);
+  const __m128i quote = _mm_set1_epi16('"');
+  const __m128i backslash = _mm_set1_epi16('\\');
+  size_t i = 0;
+
+  for (; i + 16 <= len; i += 16) {
+    __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8));
+    __m128i good0 =
+      _mm_andnot_si128(_mm_or_si128(_mm_cmpeq_epi16(v0, quote), _mm_cmpeq_epi16(v0, backslash)),
+                       _mm_and_si128(_mm_cmpgt_epi16(v0, space), _mm_cmplt_epi16(v0, del)));
+    __m128i good1 =
+      _mm_andnot_si128(_mm_or_si128(_mm_cmpeq_epi16(v1, quote), _mm_cmpeq_epi16(v1, backslash)),
+                       _mm_and_si128(_mm_cmpgt_epi16(v1, space), _mm_cmplt_epi16(v1, del)));
+    if (_mm_movemask_epi8(_mm_and_si128(good0, good1)) != 0xffff)
+      break;
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(v0, v1));
+  }
+
+  return i;
+}
+#endif /* WINEVT_UTF16_SSE2 */
+
+/* Copies the leading ASCII characters which need no escaping. */
+static inline size_t
+winevt_json_ascii_prefix(const uint16_t* src, size_t len, char* dst)
+{
+  size_t i = 0;
+
+#ifdef WINEVT_UTF16_AVX2
+  if (winevt_cpu_has(WINEVT_CPU_AVX2)) {
+    i = winevt_json_ascii_blocks_avx2(src, len, dst);
+  }
+#endif
+#ifdef WINEVT_UTF16_SSE2
+  i += winevt_json_ascii_blocks_sse2(src + i, len - i, dst + i);
+#endif
+
+  for (; i < len && src[i] < 0x80 && !winevt_json_needs_escape(src[i]); i++) {
+    dst[i] = static_cast<char>(src[i]);
+  }
+
+  return i;
+}
+
+/*
+ * Escapes len code units from src into dst as the content of a JSON
+ * string and returns the number of bytes written. dst must have room
+ * for len * WINEVT_JSON_MAX_BYTES_PER_CHAR bytes.
+ */
+static inline size_t
+winevt_utf16_to_json(const uint16_t* src, size_t len, char* dst)
+{
+  char* out = dst;
+  size_t i = 0;
+
+  while (i < len) {
+    uint16_t c = src[i];
+
+    if (c >= 0x80) {
+      size_t n = 1;
+      if (c >= 0xd800 && c <= 0xdbff && i + 1 < len && src[i + 1] >= 0xdc00 &&
+          src[i + 1] <= 0xdfff) {
+        n = 2;
+      }
+      out += winevt_utf16_to_utf8(src + i, n, out);
+      i += n;
+    } else if (winevt_json_needs_escape(c)) {
+      out += winevt_json_escape_char(c, out);
+      i++;
+    } else {
+      size_t n = winevt_json_ascii_prefix(src + i, len - i, out);
+      i += n;
+      out += n;
+    }
+  }
+
+  return static_cast<size_t>(out - dst);
+}
+
+/* Escapes UTF-8 as winevt_utf16_to_json() does UTF-16. */
+static inline size_t
+winevt_utf8_to_json(const char* src, size_t len, char* dst)
+{
+  char* out = dst;
+
+  for (size_t i = 0; i < len; i++) {
+    unsigned char c = static_cast<unsigned char>(src[i]);
+
+    if (winevt_json_needs_escape(c)) {
+      out += winevt_json_escape_char(c, out);
+    } else {
+      *out++ = static_cast<char>(c);
+    }
+  }
+
+  return static_cast<size_t>(out - dst);
+}
+
+/*
+ * Appends JSON values to a buffer. Commas between the members of
+ * objects and the elements of arrays are written as needed.
+ */
+class WinevtJsonWriter
+{
+public:
+  WinevtJsonWriter()
+    : first_(true)
+  {
+  }
+
+  const std::string& buffer() const { return buffer_; }
+  size_t size() const { return buffer_.size(); }
+  void clear()
+  {
+    buffer_.clear();
+    first_ = true;
+  }
+
+  void startObject()
+  {
+    separate();
+    buffer_.push_back('{');
+    first_ = true;
+  }
+
+  void endObject()
+  {
+    buffer_.push_back('}');
+    first_ = false;
+  }
+
+  void startArray()
+  {
+    separate();
+    buffer_.push_back('[');
+    first_ = true;
+  }
+
+  void endArray()
+  {
+    buffer_.push_back(']');
+    first_ = false;
+  }
+
+  /* Names the next member of an object. */
+  void key(const char* name, size_t length)
+  {
+    writeString(name, length);
+    buffer_.push_back(':');
+    first_ = true;
+  }
+
+  /* Ends a line of JSON lines. */
+  void newline()
+  {
+    buffer_.push_back('\n');
+    first_ = true;
+  }
+
+  void writeNull()
+  {
+    separate();
+    buffer_.append("null", 4);
+  }
+
+  void writeBoolean(bool value)
+  {
+    separate();
+    if (value) {
+      buffer_.append("true", 4);
+    } else {
+      buffer_.append("false", 5);
+    }
+  }
+
+  void writeUnsigned(uint64_t value)
+  {
+    char digits[WINEVT_FORMAT_BUFFER_SIZE];
+
+    separate();
+    buffer_.append(digits, winevt_format_uint(value, 1, digits));
+  }
+
+  void writeSigned(int64_t value)
+  {
+    char digits[WINEVT_FORMAT_BUFFER_SIZE];
+
+    separate();
+    if (value < 0) {
+      buffer_.push_back('-');
+      buffer_.append(digits, winevt_format_uint(0 - static_cast<uint64_t>(value), 1, digits));
+    } else {
+      buffer_.append(digits, winevt_format_uint(static_cast<uint64_t>(value), 1, digits));
+    }
+  }
+
+  void writeString(const char* value, size_t length)
+  {
+    size_t start = startString(length);
+
+    endString(start, winevt_utf8_to_json(value, length, &buffer_[start]));
+  }
+
+  void writeUtf16(const uint16_t* value, size_t length)
+  {
+    size_t start = startString(length);
+
+    endString(start, winevt_utf16_to_json(value, length, &buffer_[start]));
+  }
+
+private:
+  void separate()
+  {
+    if (!first_) {
+      buffer_.push_back(',');
+    }
+    first_ = false;
+  }
+
+  /* Reserves room for length escaped characters after the quotation
+   * mark and returns where they start. */
+  size_t startString(size_t length)
+  {
+    separate();
+    buffer_.push_back('"');
+    size_t start = buffer_.size();
+    buffer_.resize(start + length * WINEVT_JSON_MAX_BYTES_PER_CHAR + 1);
+
+    return start;
+  }
+
+  void endString(size_t start, size_t length)
+  {
+    buffer_.resize(start + length);
+    buffer_.push_back('"');
+  }
+
+  std::string buffer_;
+  bool first_;
+};
+
+#endif // _WINEVT_JSON_H_
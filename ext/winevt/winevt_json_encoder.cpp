@@ -0,0 +1,94 @@
+#include <winevt_json.h>
+#include <winevt_record.h>
+
+#include <stdint.h>
+#include <string>
+
+/*
+ * JSON lines which Query#write_json and Subscribe#write_json write. An
+ * event is a JSON object of winevt_record.h on a line.
+ */
+struct WinevtJsonEncoder
+{
+  WinevtJsonWriter writer;
+  struct WinevtRecordFields fields;
+  std::string text;
+};
+
+/* The record writer of winevt_record.h for JSON. */
+class JsonRecordWriter
+{
+public:
+  explicit JsonRecordWriter(WinevtJsonWriter& writer)
+    : writer_(writer)
+  {
+  }
+
+  void startMap(uint32_t) { writer_.startObject(); }
+  void endMap() { writer_.endObject(); }
+  void startArray(uint32_t) { writer_.startArray(); }
+  void endArray() { writer_.endArray(); }
+
+  void key(enum SystemEventKey key)
+  {
+    const char* name = get_system_event_key_name(key);
+
+    writer_.key(name, strlen(name));
+  }
+
+  void writeNull() { writer_.writeNull(); }
+  void writeBoolean(bool value) { writer_.writeBoolean(value); }
+  void writeUnsigned(uint64_t value) { writer_.writeUnsigned(value); }
+  void writeSigned(int64_t value) { writer_.writeSigned(value); }
+  void writeString(const char* value, size_t length) { writer_.writeString(value, length); }
+
+  void writeWstr(const WCHAR* wstr)
+  {
+    writer_.writeUtf16(reinterpret_cast<const uint16_t*>(wstr), wstr ? wcslen(wstr) : 0);
+  }
+
+private:
+  WinevtJsonWriter& writer_;
+};
+
+struct WinevtJsonEncoder*
+json_encoder_create(DWORD fields, BOOL renderAsXML, BOOL preserveQualifiers, BOOL preserveSID)
+{
+  struct WinevtJsonEncoder* encoder = new WinevtJsonEncoder();
+
+  record_fields_init(&encoder->fields, fields, renderAsXML, preserveQualifiers, preserveSID);
+
+  return encoder;
+}
+
+void
+json_encoder_destroy(struct WinevtJsonEncoder* encoder)
+{
+  delete encoder;
+}
+
+void
+json_encoder_append(struct WinevtJsonEncoder* encoder, struct WinevtRenderer* renderer,
+                    EVT_HANDLE event, LANGID langID, EVT_HANDLE hRemote)
+{
+  JsonRecordWriter writer(encoder->writer);
+
+  write_record(writer, encoder->fields, renderer, event, langID, hRemote, encoder->text);
+  encoder->writer.newline();
+}
+
+/*
+ * Writes the appended lines to io with a single write and clears the
+ * buffer, which keeps its capacity for the next batch.
+ */
+void
+json_encoder_flush(struct WinevtJsonEncoder* encoder, VALUE io)
+{
+  const std::string& buffer = encoder->writer.buffer();
+
+  if (buffer.empty()) {
+    return;
+  }
+  rb_io_write(io, rb_utf8_str_new(buffer.data(), buffer.size()));
+  encoder->writer.clear();
+}
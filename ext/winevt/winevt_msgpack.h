@@ -0,0 +1,180 @@
+#ifndef _WINEVT_MSGPACK_H_
+#define _WINEVT_MSGPACK_H_
+
+/*
+ * Writer of MessagePack.
+ *
+ * Values are appended to a byte string in the smallest format which
+ * holds them, as the MessagePack specification recommends. Strings can
+ * be written into the buffer directly, e.g. while they are transcoded
+ * from UTF-16, with startString() and endString().
+ *
+ * This header does not depend on Windows or Ruby headers so that the
+ * writer can be tested and benchmarked on any platform.
+ *
+ * See https://github.com/msgpack/msgpack/blob/master/spec.md for the
+ * format.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+
+class WinevtMsgpackWriter
+{
+public:
+  WinevtMsgpackWriter()
+    : stringStart_(0)
+    , reservedHeaderSize_(0)
+  {
+  }
+
+  const std::string& buffer() const { return buffer_; }
+  size_t size() const { return buffer_.size(); }
+  void clear() { buffer_.clear(); }
+
+  void packNil() { buffer_.push_back(static_cast<char>(0xc0)); }
+
+  void packBoolean(bool value) { buffer_.push_back(static_cast<char>(value ? 0xc3 : 0xc2)); }
+
+  void packUnsigned(uint64_t value)
+  {
+    if (value < 0x80) {
+      buffer_.push_back(static_cast<char>(value));
+    } else if (value <= UINT8_MAX) {
+      putHeader(0xcc, value, 1);
+    } else if (value <= UINT16_MAX) {
+      putHeader(0xcd, value, 2);
+    } else if (value <= UINT32_MAX) {
+      putHeader(0xce, value, 4);
+    } else {
+      putHeader(0xcf, value, 8);
+    }
+  }
+
+  void packSigned(int64_t value)
+  {
+    if (value >= 0) {
+      packUnsigned(static_cast<uint64_t>(value));
+    } else if (value >= -32) {
+      buffer_.push_back(static_cast<char>(value));
+    } else if (value >= INT8_MIN) {
+      putHeader(0xd0, static_cast<uint64_t>(value), 1);
+    } else if (value >= INT16_MIN) {
+      putHeader(0xd1, static_cast<uint64_t>(value), 2);
+    } else if (value >= INT32_MIN) {
+      putHeader(0xd2, static_cast<uint64_t>(value), 4);
+    } else {
+      putHeader(0xd3, static_cast<uint64_t>(value), 8);
+    }
+  }
+
+  void packString(const char* value, size_t length)
+  {
+    char header[5];
+
+    buffer_.append(header, formatStringHeader(length, header));
+    buffer_.append(value, length);
+  }
+
+  /*
+   * Returns where a string of maxLength bytes at most is written into.
+   * endString() must be called with its actual length.
+   */
+  char* startString(size_t maxLength)
+  {
+    stringStart_ = buffer_.size();
+    reservedHeaderSize_ = stringHeaderSize(maxLength);
+    buffer_.resize(stringStart_ + reservedHeaderSize_ + maxLength);
+
+    return &buffer_[stringStart_ + reservedHeaderSize_];
+  }
+
+  /* Moves the string when its header is shorter than the reserved one. */
+  void endString(size_t length)
+  {
+    size_t headerSize = formatStringHeader(length, &buffer_[stringStart_]);
+
+    if (headerSize != reservedHeaderSize_) {
+      memmove(&buffer_[stringStart_ + headerSize],
+              &buffer_[stringStart_ + reservedHeaderSize_],
+              length);
+    }
+    buffer_.resize(stringStart_ + headerSize + length);
+  }
+
+  void packArrayHeader(uint32_t count)
+  {
+    if (count < 16) {
+      buffer_.push_back(static_cast<char>(0x90 | count));
+    } else if (count <= UINT16_MAX) {
+      putHeader(0xdc, count, 2);
+    } else {
+      putHeader(0xdd, count, 4);
+    }
+  }
+
+  void packMapHeader(uint32_t count)
+  {
+    if (count < 16) {
+      buffer_.push_back(static_cast<char>(0x80 | count));
+    } else if (count <= UINT16_MAX) {
+      putHeader(0xde, count, 2);
+    } else {
+      putHeader(0xdf, count, 4);
+    }
+  }
+
+private:
+  static size_t stringHeaderSize(size_t length)
+  {
+    if (length < 32) {
+      return 1;
+    } else if (length <= UINT8_MAX) {
+      return 2;
+    } else if (length <= UINT16_MAX) {
+      return 3;
+    } else {
+      return 5;
+    }
+  }
+
+  static size_t formatStringHeader(size_t length, char* bytes)
+  {
+    if (length < 32) {
+      bytes[0] = static_cast<char>(0xa0 | length);
+      return 1;
+    } else if (length <= UINT8_MAX) {
+      return formatHeader(0xd9, length, 1, bytes);
+    } else if (length <= UINT16_MAX) {
+      return formatHeader(0xda, length, 2, bytes);
+    } else {
+      return formatHeader(0xdb, length, 4, bytes);
+    }
+  }
+
+  /* A type byte followed by size bytes of value in big endian. */
+  static size_t formatHeader(uint8_t type, uint64_t value, size_t size, char* bytes)
+  {
+    bytes[0] = static_cast<char>(type);
+    for (size_t i = 0; i < size; i++) {
+      bytes[size - i] = static_cast<char>(value >> (i * 8));
+    }
+
+    return 1 + size;
+  }
+
+  void putHeader(uint8_t type, uint64_t value, size_t size)
+  {
+    char bytes[9];
+
+    buffer_.append(bytes, formatHeader(type, value, size, bytes));
+  }
+
+  std::string buffer_;
+  size_t stringStart_;
+  size_t reservedHeaderSize_;
+};
+
+#endif // _WINEVT_MSGPACK_H_
@@ -0,0 +1,94 @@
+#include <winevt_msgpack.h>
+#include <winevt_record.h>
+#include <winevt_utf16.h>
+
+#include <stdint.h>
+#include <string>
+
+/*
+ * Events which Query#each_batch and Subscribe#each_batch yield with
+ * format: :msgpack. An event is a map of winevt_record.h.
+ */
+struct WinevtMsgpackEncoder
+{
+  WinevtMsgpackWriter writer;
+  struct WinevtRecordFields fields;
+  std::string text;
+};
+
+/* The record writer of winevt_record.h for MessagePack. */
+class MsgpackRecordWriter
+{
+public:
+  explicit MsgpackRecordWriter(WinevtMsgpackWriter& writer)
+    : writer_(writer)
+  {
+  }
+
+  void startMap(uint32_t count) { writer_.packMapHeader(count); }
+  void endMap() {}
+  void startArray(uint32_t count) { writer_.packArrayHeader(count); }
+  void endArray() {}
+
+  void key(enum SystemEventKey key)
+  {
+    const char* name = get_system_event_key_name(key);
+
+    writer_.packString(name, strlen(name));
+  }
+
+  void writeNull() { writer_.packNil(); }
+  void writeBoolean(bool value) { writer_.packBoolean(value); }
+  void writeUnsigned(uint64_t value) { writer_.packUnsigned(value); }
+  void writeSigned(int64_t value) { writer_.packSigned(value); }
+  void writeString(const char* value, size_t length) { writer_.packString(value, length); }
+
+  /* Transcodes into the buffer without an intermediate string. */
+  void writeWstr(const WCHAR* wstr)
+  {
+    size_t wlen = wstr ? wcslen(wstr) : 0;
+    char* p = writer_.startString(wlen * WINEVT_UTF8_MAX_BYTES_PER_UTF16);
+
+    writer_.endString(winevt_utf16_to_utf8(reinterpret_cast<const uint16_t*>(wstr), wlen, p));
+  }
+
+private:
+  WinevtMsgpackWriter& writer_;
+};
+
+struct WinevtMsgpackEncoder*
+msgpack_encoder_create(DWORD fields, BOOL renderAsXML, BOOL preserveQualifiers, BOOL preserveSID)
+{
+  struct WinevtMsgpackEncoder* encoder = new WinevtMsgpackEncoder();
+
+  record_fields_init(&encoder->fields, fields, renderAsXML, preserveQualifiers, preserveSID);
+
+  return encoder;
+}
+
+void
+msgpack_encoder_destroy(struct WinevtMsgpackEncoder* encoder)
+{
+  delete encoder;
+}
+
+void
+msgpack_encoder_append(struct WinevtMsgpackEncoder* encoder, struct WinevtRenderer* renderer,
+                       EVT_HANDLE event, LANGID langID, EVT_HANDLE hRemote)
+{
+  MsgpackRecordWriter writer(encoder->writer);
+
+  write_record(writer, encoder->fields, renderer, event, langID, hRemote, encoder->text);
+}
+
+/* Returns the appended events as a binary String. */
+VALUE
+msgpack_encoder_flush(struct WinevtMsgpackEncoder* encoder)
+{
+  const std::string& buffer = encoder->writer.buffer();
+  VALUE rb_str = rb_str_new(buffer.data(), buffer.size());
+
+  encoder->writer.clear();
+
+  return rb_str;
+}
@@ -0,0 +1,47 @@
+#ifndef _WINEVT_NATIVE_H_
+#define _WINEVT_NATIVE_H_
+
+/*
+ * Rendering of events into native buffers for the encoders which write
+ * events without making Ruby objects for them. Strings are UTF-8 and
+ * the values are the same as #each yields without typed values.
+ *
+ * This header is for C++ only.
+ */
+
+#include <winevt_c.h>
+
+#include <stdint.h>
+#include <string>
+
+/* How evt_variant_to_native() returned an insert value. */
+enum WinevtVariantKind
+{
+  WINEVT_VARIANT_NULL,
+  WINEVT_VARIANT_STRING,
+  WINEVT_VARIANT_SIGNED,
+  WINEVT_VARIANT_UNSIGNED,
+  WINEVT_VARIANT_BOOLEAN,
+};
+
+/* The UserID and User system values of a SID. */
+struct WinevtUserSid
+{
+  bool hasSid;
+  std::string sid;
+  bool hasAccount;
+  std::string account;
+};
+
+void append_wstr_to_utf8(const WCHAR* wstr, std::string& out);
+const WCHAR* render_xml_to_wstr(struct WinevtRenderer* renderer, EVT_HANDLE handle);
+PEVT_VARIANT render_system_variants(struct WinevtRenderer* renderer, EVT_HANDLE handle);
+PEVT_VARIANT render_user_variants(struct WinevtRenderer* renderer, EVT_HANDLE handle,
+                                  DWORD* count);
+const WCHAR* get_description_wstr(struct WinevtRenderer* renderer, EVT_HANDLE handle,
+                                  LANGID langID, EVT_HANDLE hRemote);
+void render_user_sid(struct WinevtRenderer* renderer, PSID sid, struct WinevtUserSid* user);
+WinevtVariantKind evt_variant_to_native(const EVT_VARIANT* variant, std::string& text,
+                                        uint64_t* integer);
+
+#endif // _WINEVT_NATIVE_H_
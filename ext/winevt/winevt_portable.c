@@ -0,0 +1,23 @@
+#include <winevt_system_keys.h>
+
+/* Entry point on platforms other than Windows. Only EventLog::File is
+ * available there, because the other classes need wevtapi. */
+#ifndef _WIN32
+
+VALUE rb_mWinevt;
+VALUE rb_cEventLog;
+
+void Init_winevt_file(VALUE rb_cEventLog);
+
+void
+Init_winevt(void)
+{
+  rb_mWinevt = rb_define_module("Winevt");
+  rb_cEventLog = rb_define_class_under(rb_mWinevt, "EventLog", rb_cObject);
+
+  init_system_event_keys();
+
+  Init_winevt_file(rb_cEventLog);
+}
+
+#endif /* _WIN32 */
@@ -0,0 +1,165 @@
+#include <winevt_c.h>
+
+#include <list>
+#include <string>
+#include <unordered_map>
+
+/* Publisher metadata handles are keyed by provider name, LANGID and
+ * the remote session handle which was used to open them. The provider
+ * name is kept as its UTF-16 bytes. */
+struct PublisherCacheKey
+{
+  std::string provider;
+  LANGID langID;
+  EVT_HANDLE hRemote;
+
+  bool operator==(const PublisherCacheKey& other) const
+  {
+    return langID == other.langID && hRemote == other.hRemote &&
+           provider == other.provider;
+  }
+};
+
+struct PublisherCacheKeyHash
+{
+  size_t operator()(const PublisherCacheKey& key) const
+  {
+    size_t h = std::hash<std::string>()(key.provider);
+    h ^= std::hash<size_t>()(key.langID) + 0x9e3779b9 + (h << 6) + (h >> 2);
+    h ^= std::hash<void*>()(key.hRemote) + 0x9e3779b9 + (h << 6) + (h >> 2);
+    return h;
+  }
+};
+
+typedef std::pair<PublisherCacheKey, EVT_HANDLE> PublisherCacheEntry;
+typedef std::list<PublisherCacheEntry> PublisherCacheList;
+
+struct WinevtPublisherCache
+{
+  size_t capacity;
+  ULONGLONG hits;
+  ULONGLONG misses;
+  ULONGLONG evictions;
+  // Most recently used entry is placed at the front.
+  PublisherCacheList entries;
+  std::unordered_map<PublisherCacheKey,
+                     PublisherCacheList::iterator,
+                     PublisherCacheKeyHash>
+    index;
+};
+
+static void
+evict_publisher_cache_entries(struct WinevtPublisherCache* cache, size_t capacity)
+{
+  while (cache->entries.size() > capacity) {
+    PublisherCacheEntry& victim = cache->entries.back();
+    winevt_backend->close(victim.second);
+    cache->index.erase(victim.first);
+    cache->entries.pop_back();
+    cache->evictions++;
+  }
+}
+
+struct WinevtPublisherCache*
+publisher_cache_create(size_t capacity)
+{
+  struct WinevtPublisherCache* cache = new WinevtPublisherCache();
+  cache->capacity = capacity;
+  cache->hits = 0;
+  cache->misses = 0;
+  cache->evictions = 0;
+
+  return cache;
+}
+
+void
+publisher_cache_destroy(struct WinevtPublisherCache* cache)
+{
+  if (cache == nullptr)
+    return;
+
+  publisher_cache_clear(cache);
+  delete cache;
+}
+
+void
+publisher_cache_clear(struct WinevtPublisherCache* cache)
+{
+  for (PublisherCacheEntry& entry : cache->entries) {
+    winevt_backend->close(entry.second);
+  }
+  cache->entries.clear();
+  cache->index.clear();
+}
+
+size_t
+publisher_cache_get_capacity(struct WinevtPublisherCache* cache)
+{
+  return cache->capacity;
+}
+
+void
+publisher_cache_set_capacity(struct WinevtPublisherCache* cache, size_t capacity)
+{
+  cache->capacity = capacity;
+  evict_publisher_cache_entries(cache, capacity);
+}
+
+/*
+ * Returns a publisher metadata handle which is owned by the cache.
+ * Callers must not close it. It stays valid until the next call which
+ * can evict entries from the cache.
+ */
+EVT_HANDLE
+publisher_cache_open(struct WinevtPublisherCache* cache,
+                     EVT_HANDLE hRemote,
+                     LPCWSTR provider,
+                     LANGID langID)
+{
+  EVT_HANDLE hMetadata = nullptr;
+  PublisherCacheKey key;
+
+  key.provider.assign(reinterpret_cast<const char*>(provider),
+                      wcslen(provider) * sizeof(WCHAR));
+  key.langID = langID;
+  key.hRemote = hRemote;
+
+  auto found = cache->index.find(key);
+  if (found != cache->index.end()) {
+    cache->hits++;
+    cache->entries.splice(cache->entries.begin(), cache->entries, found->second);
+    return found->second->second;
+  }
+
+  cache->misses++;
+  hMetadata = EvtOpenPublisherMetadataWithoutGVL(
+    hRemote, provider, nullptr, MAKELCID(langID, SORT_DEFAULT), 0);
+  if (hMetadata == nullptr) {
+    return nullptr;
+  }
+
+  cache->entries.emplace_front(key, hMetadata);
+  cache->index[key] = cache->entries.begin();
+  evict_publisher_cache_entries(cache, cache->capacity);
+
+  return hMetadata;
+}
+
+VALUE
+publisher_cache_stats(struct WinevtPublisherCache* cache)
+{
+  VALUE hash = rb_hash_new();
+
+  rb_hash_aset(hash, rb_str_new2("hits"), ULL2NUM(cache->hits));
+  rb_hash_aset(hash, rb_str_new2("misses"), ULL2NUM(cache->misses));
+  rb_hash_aset(hash, rb_str_new2("evictions"), ULL2NUM(cache->evictions));
+  rb_hash_aset(hash, rb_str_new2("size"), SIZET2NUM(cache->entries.size()));
+  rb_hash_aset(hash, rb_str_new2("capacity"), SIZET2NUM(cache->capacity));
+  rb_hash_aset(hash,
+               rb_str_new2("hit_rate"),
+               DBL2NUM(cache->hits + cache->misses == 0
+                         ? 0.0
+                         : (double)cache->hits / (double)(cache->hits + cache->misses)));
+
+  return hash;
+}
@@ -31,23 +31,36 @@ static const rb_data_type_t rb_winevt_query_type = { "winevt/query",
                                                      NULL,
                                                      RUBY_TYPED_FREE_IMMEDIATELY };
 
+static void
+close_event_handles(struct WinevtQuery* winevtQuery)
+{
+  if (winevtQuery->hEvents == NULL)
+    return;
+
+  for (ULONG i = 0; i < winevtQuery->count; i++) {
+    if (winevtQuery->hEvents[i]) {
+      winevt_backend->close(winevtQuery->hEvents[i]);
+      winevtQuery->hEvents[i] = NULL;
+    }
+  }
+}
+
 static void
 close_handles(struct WinevtQuery* winevtQuery)
 {
   if (winevtQuery->query) {
-    EvtClose(winevtQuery->query);
+    winevt_backend->close(winevtQuery->query);
     winevtQuery->query = NULL;
   }
 
-  for (int i = 0; i < winevtQuery->count; i++) {
-    if (winevtQuery->hEvents[i]) {
-      EvtClose(winevtQuery->hEvents[i]);
-      winevtQuery->hEvents[i] = NULL;
-    }
+  close_event_handles(winevtQuery);
+
+  if (winevtQuery->renderer.publisherCache) {
+    publisher_cache_clear(winevtQuery->renderer.publisherCache);
   }
 
   if (winevtQuery->remoteHandle) {
-    EvtClose(winevtQuery->remoteHandle);
+    winevt_backend->close(winevtQuery->remoteHandle);
     winevtQuery->remoteHandle = NULL;
   }
 }
@@ -57,6 +70,10 @@ query_free(void* ptr)
 {
   struct WinevtQuery* winevtQuery = (struct WinevtQuery*)ptr;
   close_handles(winevtQuery);
+  finalize_renderer(&winevtQuery->renderer);
+
+  if (winevtQuery->hEvents)
+    xfree(winevtQuery->hEvents);
 
   xfree(ptr);
 }
@@ -82,7 +99,7 @@ rb_winevt_query_alloc(VALUE klass)
  *
  */
 static VALUE
-rb_winevt_query_initialize(VALUE argc, VALUE *argv, VALUE self)
+rb_winevt_query_initialize(int argc, VALUE* argv, VALUE self)
 {
   PWSTR evtChannel, evtXPath;
   VALUE channel, xpath, session, rb_flags;
@@ -138,7 +155,14 @@ rb_winevt_query_initialize(VALUE argc, VALUE *argv, VALUE self)
 
   TypedData_Get_Struct(self, struct WinevtQuery, &rb_winevt_query_type, winevtQuery);
 
-  winevtQuery->query = EvtQuery(
+  initialize_renderer(&winevtQuery->renderer);
+
+  if (winevtQuery->hEvents == NULL) {
+    winevtQuery->batchSize = QUERY_ARRAY_SIZE;
+    winevtQuery->hEvents = ZALLOC_N(EVT_HANDLE, winevtQuery->batchSize);
+  }
+
+  winevtQuery->query = winevt_backend->query(
     hRemoteHandle, evtChannel, evtXPath, flags);
   err = GetLastError();
   if (err != ERROR_SUCCESS) {
@@ -154,6 +178,9 @@ rb_winevt_query_initialize(VALUE argc, VALUE *argv, VALUE self)
   winevtQuery->localeInfo = &default_locale;
   winevtQuery->remoteHandle = hRemoteHandle;
   winevtQuery->preserveSID = TRUE;
+  winevtQuery->symbolizeKeys = FALSE;
+  winevtQuery->typedValues = FALSE;
+  winevtQuery->fields = 0;
 
   ALLOCV_END(wchannelBuf);
   ALLOCV_END(wpathBuf);
@@ -236,28 +263,33 @@ rb_winevt_query_set_timeout(VALUE self, VALUE timeout)
 static VALUE
 rb_winevt_query_next(VALUE self)
 {
-  EVT_HANDLE hEvents[QUERY_ARRAY_SIZE];
-  ULONG count;
+  ULONG count = 0;
   DWORD status = ERROR_SUCCESS;
   struct WinevtQuery* winevtQuery;
+  ULONGLONG start;
 
   TypedData_Get_Struct(self, struct WinevtQuery, &rb_winevt_query_type, winevtQuery);
 
-  if (!EvtNext(winevtQuery->query, QUERY_ARRAY_SIZE, hEvents, INFINITE, 0, &count)) {
+  /* Handles of the previous batch which are not consumed by #each
+   * should not be leaked. The count is of the new batch from here, even
+   * if EvtNext raises. */
+  close_event_handles(winevtQuery);
+  winevtQuery->count = 0;
+
+  start = WINEVT_STATS_START(&winevtQuery->renderer.stats);
+  if (!EvtNextWithoutGVL(winevtQuery->query,
+                         winevtQuery->batchSize,
+                         winevtQuery->hEvents,
+                         INFINITE,
+                         0,
+                         &count)) {
     status = GetLastError();
-    if (ERROR_CANCELLED == status) {
-      return Qfalse;
-    }
-    if (ERROR_NO_MORE_ITEMS != status) {
-      return Qfalse;
-    }
   }
+  WINEVT_STATS_ADD(&winevtQuery->renderer.stats, nextNsec, start);
 
   if (status == ERROR_SUCCESS) {
     winevtQuery->count = count;
-    for (int i = 0; i < count; i++) {
-      winevtQuery->hEvents[i] = hEvents[i];
-    }
+    WINEVT_STATS_COUNT(&winevtQuery->renderer.stats, batches, 1);
 
     return Qtrue;
   }
@@ -269,34 +301,40 @@ static VALUE
 rb_winevt_query_render(VALUE self, EVT_HANDLE event)
 {
   struct WinevtQuery* winevtQuery;
+  BOOL renderAsXML;
 
   TypedData_Get_Struct(self, struct WinevtQuery, &rb_winevt_query_type, winevtQuery);
 
-  if (winevtQuery->renderAsXML) {
-    return render_to_rb_str(event, EvtRenderEventXml);
+  // fields= takes precedence over render_as_xml=.
+  if (winevtQuery->fields) {
+    renderAsXML = (winevtQuery->fields & WINEVT_FIELD_XML) != 0;
   } else {
-    return render_system_event(event, winevtQuery->preserveQualifiers,
-                               winevtQuery->preserveSID);
+    renderAsXML = winevtQuery->renderAsXML;
+  }
+
+  if (renderAsXML) {
+    return render_xml_to_rb_str(&winevtQuery->renderer, event);
+  } else {
+    return render_system_event(&winevtQuery->renderer, event,
+                               winevtQuery->preserveQualifiers,
+                               winevtQuery->preserveSID,
+                               winevtQuery->symbolizeKeys,
+                               winevtQuery->typedValues);
   }
 }
 
 static VALUE
-rb_winevt_query_message(EVT_HANDLE event, LocaleInfo* localeInfo, EVT_HANDLE hRemote)
+rb_winevt_query_message(struct WinevtRenderer* renderer, EVT_HANDLE event,
+                        LocaleInfo* localeInfo, EVT_HANDLE hRemote)
 {
-  WCHAR* wResult;
-  VALUE utf8str;
-
-  wResult = get_description(event, localeInfo->langID, hRemote);
-  utf8str = wstr_to_rb_str(CP_UTF8, wResult, -1);
-  free(wResult);
-
-  return utf8str;
+  return get_description(renderer, event, localeInfo->langID, hRemote);
 }
 
 static VALUE
-rb_winevt_query_string_inserts(EVT_HANDLE event)
+rb_winevt_query_string_inserts(struct WinevtRenderer* renderer, EVT_HANDLE event,
+                               BOOL typedValues)
 {
-  return get_values(event);
+  return get_values(renderer, event, typedValues);
 }
 
 static DWORD
@@ -352,15 +390,15 @@ rb_winevt_query_seek(VALUE self, VALUE bookmark_or_flag)
 
   if (winevtBookmark) {
     TypedData_Get_Struct(self, struct WinevtQuery, &rb_winevt_query_type, winevtQuery);
-    if (EvtSeek(winevtQuery->query,
-                winevtQuery->offset,
-                winevtBookmark->bookmark,
-                winevtQuery->timeout,
-                EvtSeekRelativeToBookmark))
+    if (winevt_backend->seek(winevtQuery->query,
+                             winevtQuery->offset,
+                             winevtBookmark->bookmark,
+                             winevtQuery->timeout,
+                             EvtSeekRelativeToBookmark))
       return Qtrue;
   } else {
     TypedData_Get_Struct(self, struct WinevtQuery, &rb_winevt_query_type, winevtQuery);
-    if (EvtSeek(
+    if (winevt_backend->seek(
           winevtQuery->query, winevtQuery->offset, NULL, winevtQuery->timeout, flag)) {
       return Qtrue;
     }
@@ -376,12 +414,7 @@ rb_winevt_query_close_handle(VALUE self)
 
   TypedData_Get_Struct(self, struct WinevtQuery, &rb_winevt_query_type, winevtQuery);
 
-  for (int i = 0; i < winevtQuery->count; i++) {
-    if (winevtQuery->hEvents[i] != NULL) {
-      EvtClose(winevtQuery->hEvents[i]);
-      winevtQuery->hEvents[i] = NULL;
-    }
-  }
+  close_event_handles(winevtQuery);
 
   return Qnil;
 }
@@ -395,12 +428,32 @@ rb_winevt_query_each_yield(VALUE self)
 
   TypedData_Get_Struct(self, struct WinevtQuery, &rb_winevt_query_type, winevtQuery);
 
-  for (int i = 0; i < winevtQuery->count; i++) {
-    rb_yield_values(3,
-                    rb_winevt_query_render(self, winevtQuery->hEvents[i]),
-                    rb_winevt_query_message(winevtQuery->hEvents[i], winevtQuery->localeInfo,
-                                            winevtQuery->remoteHandle),
-                    rb_winevt_query_string_inserts(winevtQuery->hEvents[i]));
+  for (ULONG i = 0; i < winevtQuery->count; i++) {
+    DWORD fields = winevtQuery->fields;
+    VALUE event = Qnil;
+    VALUE message = Qnil;
+    VALUE stringInserts = Qnil;
+    ULONGLONG start;
+
+    if (!fields || (fields & (WINEVT_FIELD_XML | WINEVT_FIELD_SYSTEM))) {
+      event = rb_winevt_query_render(self, winevtQuery->hEvents[i]);
+    }
+    if (!fields || (fields & WINEVT_FIELD_MESSAGE)) {
+      message = rb_winevt_query_message(&winevtQuery->renderer,
+                                        winevtQuery->hEvents[i],
+                                        winevtQuery->localeInfo,
+                                        winevtQuery->remoteHandle);
+    }
+    if (!fields || (fields & WINEVT_FIELD_INSERTS)) {
+      stringInserts =
+        rb_winevt_query_string_inserts(&winevtQuery->renderer,
+                                       winevtQuery->hEvents[i],
+                                       winevtQuery->typedValues);
+    }
+    WINEVT_STATS_COUNT(&winevtQuery->renderer.stats, events, 1);
+    start = WINEVT_STATS_START(&winevtQuery->renderer.stats);
+    rb_yield_values(3, event, message, stringInserts);
+    WINEVT_STATS_ADD(&winevtQuery->renderer.stats, yieldNsec, start);
   }
   return Qnil;
 }
@@ -427,6 +480,419 @@ rb_winevt_query_each(VALUE self)
   return Qnil;
 }
 
+/* Arguments of rb_winevt_query_each_batch_yield(). */
+struct WinevtQueryBatch
+{
+  VALUE self;
+  long max;
+  /* NULL unless format: :msgpack is given. */
+  struct WinevtMsgpackEncoder* msgpack;
+};
+
+static VALUE
+rb_winevt_query_each_batch_yield(VALUE rb_batch)
+{
+  struct WinevtQueryBatch* batch = (struct WinevtQueryBatch*)rb_batch;
+  VALUE self = batch->self;
+  struct WinevtQuery* winevtQuery;
+  DWORD fields;
+  BOOL renderAsXML;
+
+  TypedData_Get_Struct(self, struct WinevtQuery, &rb_winevt_query_type, winevtQuery);
+
+  fields = winevtQuery->fields;
+  if (fields) {
+    renderAsXML = (fields & WINEVT_FIELD_XML) != 0;
+  } else {
+    renderAsXML = winevtQuery->renderAsXML;
+  }
+
+  for (long offset = 0; offset < (long)winevtQuery->count;) {
+    long count = (long)winevtQuery->count - offset;
+    VALUE columns[SYSTEM_EVENT_KEY_MAX];
+    ULONGLONG start;
+
+    if (batch->max > 0 && count > batch->max) {
+      count = batch->max;
+    }
+    if (batch->msgpack) {
+      for (long i = 0; i < count; i++) {
+        msgpack_encoder_append(batch->msgpack,
+                               &winevtQuery->renderer,
+                               winevtQuery->hEvents[offset + i],
+                               winevtQuery->localeInfo->langID,
+                               winevtQuery->remoteHandle);
+      }
+      offset += count;
+
+      WINEVT_STATS_COUNT(&winevtQuery->renderer.stats, events, count);
+      start = WINEVT_STATS_START(&winevtQuery->renderer.stats);
+      rb_yield(msgpack_encoder_flush(batch->msgpack));
+      WINEVT_STATS_ADD(&winevtQuery->renderer.stats, yieldNsec, start);
+      continue;
+    }
+    for (int i = 0; i < SYSTEM_EVENT_KEY_MAX; i++) {
+      columns[i] = Qnil;
+    }
+    if (renderAsXML && (!fields || (fields & WINEVT_FIELD_XML))) {
+      columns[SYSTEM_EVENT_KEY_XML] = rb_ary_new_capa(count);
+    }
+    if (!fields || (fields & WINEVT_FIELD_MESSAGE)) {
+      columns[SYSTEM_EVENT_KEY_MESSAGE] = rb_ary_new_capa(count);
+    }
+    if (!fields || (fields & WINEVT_FIELD_INSERTS)) {
+      columns[SYSTEM_EVENT_KEY_STRING_INSERTS] = rb_ary_new_capa(count);
+    }
+
+    for (long i = 0; i < count; i++) {
+      EVT_HANDLE event = winevtQuery->hEvents[offset + i];
+
+      if (renderAsXML) {
+        if (!fields || (fields & WINEVT_FIELD_XML)) {
+          rb_ary_push(columns[SYSTEM_EVENT_KEY_XML],
+                      render_xml_to_rb_str(&winevtQuery->renderer, event));
+        }
+      } else if (!fields || (fields & WINEVT_FIELD_SYSTEM)) {
+        append_system_event_columns(&winevtQuery->renderer,
+                                    event,
+                                    winevtQuery->preserveQualifiers,
+                                    winevtQuery->preserveSID,
+                                    winevtQuery->typedValues,
+                                    columns,
+                                    i,
+                                    count);
+      }
+      if (!fields || (fields & WINEVT_FIELD_MESSAGE)) {
+        rb_ary_push(columns[SYSTEM_EVENT_KEY_MESSAGE],
+                    rb_winevt_query_message(&winevtQuery->renderer,
+                                            event,
+                                            winevtQuery->localeInfo,
+                                            winevtQuery->remoteHandle));
+      }
+      if (!fields || (fields & WINEVT_FIELD_INSERTS)) {
+        rb_ary_push(columns[SYSTEM_EVENT_KEY_STRING_INSERTS],
+                    rb_winevt_query_string_inserts(&winevtQuery->renderer,
+                                                   event,
+                                                   winevtQuery->typedValues));
+      }
+    }
+    offset += count;
+
+    WINEVT_STATS_COUNT(&winevtQuery->renderer.stats, events, count);
+    start = WINEVT_STATS_START(&winevtQuery->renderer.stats);
+    rb_yield(batch_columns_to_rb_hash(columns, winevtQuery->symbolizeKeys));
+    WINEVT_STATS_ADD(&winevtQuery->renderer.stats, yieldNsec, start);
+  }
+
+  return Qnil;
+}
+
+static VALUE
+rb_winevt_query_each_batch_body(VALUE rb_batch)
+{
+  struct WinevtQueryBatch* batch = (struct WinevtQueryBatch*)rb_batch;
+
+  while (rb_winevt_query_next(batch->self)) {
+    rb_ensure(rb_winevt_query_each_batch_yield,
+              rb_batch,
+              rb_winevt_query_close_handle,
+              batch->self);
+  }
+
+  return Qnil;
+}
+
+static VALUE
+rb_winevt_query_each_batch_ensure(VALUE rb_batch)
+{
+  struct WinevtQueryBatch* batch = (struct WinevtQueryBatch*)rb_batch;
+
+  if (batch->msgpack) {
+    msgpack_encoder_destroy(batch->msgpack);
+  }
+
+  return Qnil;
+}
+
+/*
+ * Enumerate to obtain Windows EventLog contents a batch at a time.
+ *
+ * This method yields a Hash of columns for each batch of events which
+ * EvtNext returns, so that the block is called once per batch instead
+ * of once per event. Each column is an Array with one element per
+ * event in the batch:
+ *
+ * - the system values such as "EventID" and "TimeCreated", which are
+ *   nil for events which do not have them and are omitted when no
+ *   event in the batch has them, unless XML is rendered
+ * - "XML" when XML is rendered
+ * - "Message" and "StringInserts"
+ *
+ * Columns follow fields, render_as_xml, symbolize_keys and
+ * typed_values as #each does.
+ *
+ * With format: :msgpack, a binary String of MessagePack is yielded
+ * instead. It has a map for each event in the batch, whose keys and
+ * values are those of the Hash #each yields, with "Message" and
+ * "StringInserts" besides, or "XML" when XML is rendered. The events
+ * are written into the String straight from the rendered values
+ * without making Ruby objects for them. Keys are always Strings and
+ * typed_values is not applied.
+ *
+ * @param max [Integer] The maximum number of events in a yielded
+ *   batch. Batches of EvtNext which have more events are yielded in
+ *   parts. By default, whole batches of EvtNext are yielded.
+ * @param format [Symbol] :columns, the default, or :msgpack.
+ * @yield (Hash) or (String) with format: :msgpack
+ * @since 0.12.0
+ */
+static VALUE
+rb_winevt_query_each_batch(int argc, VALUE* argv, VALUE self)
+{
+  struct WinevtQueryBatch batch;
+  struct WinevtQuery* winevtQuery;
+  enum WinevtBatchFormat format;
+  VALUE rb_opts = Qnil;
+
+#ifdef RETURN_ENUMERATOR_KW
+  RETURN_ENUMERATOR_KW(self, argc, argv, RB_PASS_CALLED_KEYWORDS);
+#else
+  RETURN_ENUMERATOR(self, argc, argv);
+#endif /* RETURN_ENUMERATOR_KW */
+
+  rb_scan_args(argc, argv, "0:", &rb_opts);
+  get_batch_options(rb_opts, &batch.max, &format);
+
+  TypedData_Get_Struct(self, struct WinevtQuery, &rb_winevt_query_type, winevtQuery);
+
+  batch.self = self;
+  batch.msgpack = NULL;
+  if (format == WINEVT_BATCH_FORMAT_MSGPACK) {
+    batch.msgpack = msgpack_encoder_create(winevtQuery->fields,
+                                           winevtQuery->renderAsXML,
+                                           winevtQuery->preserveQualifiers,
+                                           winevtQuery->preserveSID);
+  }
+  rb_ensure(rb_winevt_query_each_batch_body,
+            (VALUE)&batch,
+            rb_winevt_query_each_batch_ensure,
+            (VALUE)&batch);
+
+  return Qnil;
+}
+
+/* Arguments of rb_winevt_query_write_arrow_body(). */
+struct WinevtQueryArrow
+{
+  VALUE self;
+  VALUE io;
+  long rows;
+  long events;
+  struct WinevtArrowEncoder* encoder;
+};
+
+static VALUE
+rb_winevt_query_write_arrow_batch(VALUE rb_arrow)
+{
+  struct WinevtQueryArrow* arrow = (struct WinevtQueryArrow*)rb_arrow;
+  VALUE self = arrow->self;
+  struct WinevtQuery* winevtQuery;
+
+  TypedData_Get_Struct(self, struct WinevtQuery, &rb_winevt_query_type, winevtQuery);
+
+  for (ULONG i = 0; i < winevtQuery->count; i++) {
+    arrow_encoder_append(arrow->encoder,
+                         &winevtQuery->renderer,
+                         winevtQuery->hEvents[i],
+                         winevtQuery->localeInfo->langID,
+                         winevtQuery->remoteHandle);
+    arrow->events++;
+    if (arrow->rows > 0 && arrow_encoder_get_length(arrow->encoder) >= arrow->rows) {
+      rb_io_write(arrow->io, arrow_encoder_flush(arrow->encoder));
+    }
+  }
+  WINEVT_STATS_COUNT(&winevtQuery->renderer.stats, events, winevtQuery->count);
+  if (arrow->rows == 0) {
+    rb_io_write(arrow->io, arrow_encoder_flush(arrow->encoder));
+  }
+
+  return Qnil;
+}
+
+static VALUE
+rb_winevt_query_write_arrow_body(VALUE rb_arrow)
+{
+  struct WinevtQueryArrow* arrow = (struct WinevtQueryArrow*)rb_arrow;
+
+  while (rb_winevt_query_next(arrow->self)) {
+    rb_ensure(rb_winevt_query_write_arrow_batch,
+              rb_arrow,
+              rb_winevt_query_close_handle,
+              arrow->self);
+  }
+  rb_io_write(arrow->io, arrow_encoder_finish(arrow->encoder));
+
+  return Qnil;
+}
+
+static VALUE
+rb_winevt_query_write_arrow_ensure(VALUE rb_arrow)
+{
+  struct WinevtQueryArrow* arrow = (struct WinevtQueryArrow*)rb_arrow;
+
+  arrow_encoder_destroy(arrow->encoder);
+
+  return Qnil;
+}
+
+/*
+ * Write events to io in the Apache Arrow IPC streaming format.
+ *
+ * The stream has a schema and record batches whose columns are the
+ * system values, "XML", "Message" and "StringInserts" as #each_batch
+ * yields them, except that the system values are typed: EventID and
+ * the other numbers are unsigned integers, TimeCreated is a timestamp
+ * in nanoseconds in UTC and Keywords and EventRecordID are 64-bit
+ * integers. "StringInserts" is a list of strings, with insert values
+ * which are not strings converted with to_s. Columns follow fields,
+ * render_as_xml, preserve_qualifiers and preserve_sid.
+ *
+ * The events are rendered into the columns without making Ruby
+ * objects for them, and each record batch is written with io.write.
+ *
+ * @param io [IO] The IO to write to, which only needs #write.
+ * @param rows [Integer] The number of events in a record batch. The
+ *   last record batch may have fewer events. By default, a record
+ *   batch is written for each batch of EvtNext.
+ * @return [Integer] The number of written events.
+ * @since 0.12.0
+ */
+static VALUE
+rb_winevt_query_write_arrow(int argc, VALUE* argv, VALUE self)
+{
+  struct WinevtQueryArrow arrow;
+  struct WinevtQuery* winevtQuery;
+  VALUE rb_io, rb_opts = Qnil;
+
+  rb_scan_args(argc, argv, "1:", &rb_io, &rb_opts);
+
+  TypedData_Get_Struct(self, struct WinevtQuery, &rb_winevt_query_type, winevtQuery);
+
+  arrow.self = self;
+  arrow.io = rb_io;
+  arrow.rows = get_count_option(rb_opts, "rows");
+  arrow.events = 0;
+  arrow.encoder = arrow_encoder_create(winevtQuery->fields,
+                                       winevtQuery->renderAsXML,
+                                       winevtQuery->preserveQualifiers,
+                                       winevtQuery->preserveSID);
+  rb_ensure(rb_winevt_query_write_arrow_body,
+            (VALUE)&arrow,
+            rb_winevt_query_write_arrow_ensure,
+            (VALUE)&arrow);
+
+  return LONG2NUM(arrow.events);
+}
+
+/* Arguments of rb_winevt_query_write_json_body(). */
+struct WinevtQueryJson
+{
+  VALUE self;
+  VALUE io;
+  long events;
+  struct WinevtJsonEncoder* encoder;
+};
+
+static VALUE
+rb_winevt_query_write_json_batch(VALUE rb_json)
+{
+  struct WinevtQueryJson* json = (struct WinevtQueryJson*)rb_json;
+  VALUE self = json->self;
+  struct WinevtQuery* winevtQuery;
+
+  TypedData_Get_Struct(self, struct WinevtQuery, &rb_winevt_query_type, winevtQuery);
+
+  for (ULONG i = 0; i < winevtQuery->count; i++) {
+    json_encoder_append(json->encoder,
+                        &winevtQuery->renderer,
+                        winevtQuery->hEvents[i],
+                        winevtQuery->localeInfo->langID,
+                        winevtQuery->remoteHandle);
+  }
+  json->events += winevtQuery->count;
+  WINEVT_STATS_COUNT(&winevtQuery->renderer.stats, events, winevtQuery->count);
+  json_encoder_flush(json->encoder, json->io);
+
+  return Qnil;
+}
+
+static VALUE
+rb_winevt_query_write_json_body(VALUE rb_json)
+{
+  struct WinevtQueryJson* json = (struct WinevtQueryJson*)rb_json;
+
+  while (rb_winevt_query_next(json->self)) {
+    rb_ensure(rb_winevt_query_write_json_batch,
+              rb_json,
+              rb_winevt_query_close_handle,
+              json->self);
+  }
+
+  return Qnil;
+}
+
+static VALUE
+rb_winevt_query_write_json_ensure(VALUE rb_json)
+{
+  struct WinevtQueryJson* json = (struct WinevtQueryJson*)rb_json;
+
+  json_encoder_destroy(json->encoder);
+
+  return Qnil;
+}
+
+/*
+ * Write events to io as JSON lines.
+ *
+ * Each event is a JSON object on a line, whose members are the keys
+ * and values of the Hash #each yields, with "Message" and
+ * "StringInserts" besides, or "XML" when XML is rendered. Members
+ * follow fields, render_as_xml, preserve_qualifiers and preserve_sid;
+ * typed_values is not applied.
+ *
+ * The events of a batch of EvtNext are rendered into a native buffer,
+ * which is reused for every batch, with strings escaped from UTF-16
+ * directly. The lines of a batch are written with a single io.write,
+ * so that no Hash is made for the events and no JSON generator is
+ * needed.
+ *
+ * @param io [IO] The IO to write to, which only needs #write.
+ * @return [Integer] The number of written events.
+ * @since 0.12.0
+ */
+static VALUE
+rb_winevt_query_write_json(VALUE self, VALUE rb_io)
+{
+  struct WinevtQueryJson json;
+  struct WinevtQuery* winevtQuery;
+
+  TypedData_Get_Struct(self, struct WinevtQuery, &rb_winevt_query_type, winevtQuery);
+
+  json.self = self;
+  json.io = rb_io;
+  json.events = 0;
+  json.encoder = json_encoder_create(winevtQuery->fields,
+                                     winevtQuery->renderAsXML,
+                                     winevtQuery->preserveQualifiers,
+                                     winevtQuery->preserveSID);
+  rb_ensure(rb_winevt_query_write_json_body,
+            (VALUE)&json,
+            rb_winevt_query_write_json_ensure,
+            (VALUE)&json);
+
+  return LONG2NUM(json.events);
+}
+
 /*
  * This method returns whether render as xml or not.
  *
@@ -572,67 +1038,539 @@ rb_winevt_query_preserve_sid_p(VALUE self)
 }
 
 /*
- * This method cancels channel query.
+ * This method specifies whether keys of rendered system event hashes
+ * are Symbols or not. By default, they are frozen Strings.
+ *
+ * @param rb_symbolize_keys_p [Boolean]
+ * @since 0.12.0
+ */
+static VALUE
+rb_winevt_query_set_symbolize_keys(VALUE self, VALUE rb_symbolize_keys_p)
+{
+  struct WinevtQuery* winevtQuery;
+
+  TypedData_Get_Struct(
+    self, struct WinevtQuery, &rb_winevt_query_type, winevtQuery);
+
+  winevtQuery->symbolizeKeys = RTEST(rb_symbolize_keys_p);
+
+  return Qnil;
+}
+
+/*
+ * This method returns whether keys of rendered system event hashes
+ * are Symbols or not.
  *
  * @return [Boolean]
- * @since 0.9.1
+ * @since 0.12.0
  */
 static VALUE
-rb_winevt_query_cancel(VALUE self)
+rb_winevt_query_symbolize_keys_p(VALUE self)
 {
   struct WinevtQuery* winevtQuery;
-  BOOL result = FALSE;
 
   TypedData_Get_Struct(
     self, struct WinevtQuery, &rb_winevt_query_type, winevtQuery);
 
-  if (winevtQuery->query) {
-    result = EvtCancel(winevtQuery->query);
-  }
+  return winevtQuery->symbolizeKeys ? Qtrue : Qfalse;
+}
 
-  if (result) {
-    return Qtrue;
-  } else {
-    return Qfalse;
-  }
+/*
+ * This method specifies whether values are yielded as Ruby objects of
+ * their types instead of formatted Strings. With it, FileTime and
+ * SysTime values become Time in UTC, Single and Double become Float,
+ * HexInt32 and HexInt64 become Integer and Binary becomes an
+ * ASCII-8BIT String of the raw bytes. This applies to string inserts,
+ * and to TimeCreated, Keywords and EventRecordID of rendered system
+ * event hashes.
+ *
+ * @param rb_typed_values_p [Boolean]
+ * @since 0.12.0
+ */
+static VALUE
+rb_winevt_query_set_typed_values(VALUE self, VALUE rb_typed_values_p)
+{
+  struct WinevtQuery* winevtQuery;
+
+  TypedData_Get_Struct(
+    self, struct WinevtQuery, &rb_winevt_query_type, winevtQuery);
+
+  winevtQuery->typedValues = RTEST(rb_typed_values_p);
+
+  return Qnil;
 }
 
 /*
- * This method closes channel handles forcibly.
+ * This method returns whether values are yielded as Ruby objects of
+ * their types or not.
  *
- * @since 0.9.1
+ * @return [Boolean]
+ * @since 0.12.0
  */
 static VALUE
-rb_winevt_query_close(VALUE self)
+rb_winevt_query_typed_values_p(VALUE self)
 {
   struct WinevtQuery* winevtQuery;
 
   TypedData_Get_Struct(
     self, struct WinevtQuery, &rb_winevt_query_type, winevtQuery);
 
-  close_handles(winevtQuery);
+  return winevtQuery->typedValues ? Qtrue : Qfalse;
+}
+
+/*
+ * This method specifies which parts of events are computed by #each.
+ * Parts which are not specified are yielded as nil. nil restores the
+ * default, which computes all parts.
+ *
+ * @example Skip formatting messages and rendering string inserts
+ *   query.fields = [:xml]
+ * @param rb_fields [Array<Symbol>, nil] :xml or :system, :message and :inserts
+ * @raise ArgumentError
+ * @since 0.12.0
+ */
+static VALUE
+rb_winevt_query_set_fields(VALUE self, VALUE rb_fields)
+{
+  struct WinevtQuery* winevtQuery;
+
+  TypedData_Get_Struct(
+    self, struct WinevtQuery, &rb_winevt_query_type, winevtQuery);
+
+  winevtQuery->fields = get_fields_from_rb_ary(rb_fields);
 
   return Qnil;
 }
 
-void
-Init_winevt_query(VALUE rb_cEventLog)
+/*
+ * This method returns which parts of events are computed by #each.
+ *
+ * @return [Array<Symbol>, nil]
+ * @since 0.12.0
+ */
+static VALUE
+rb_winevt_query_get_fields(VALUE self)
 {
-  rb_cQuery = rb_define_class_under(rb_cEventLog, "Query", rb_cObject);
-  rb_define_alloc_func(rb_cQuery, rb_winevt_query_alloc);
+  struct WinevtQuery* winevtQuery;
 
-  rb_cFlag = rb_define_module_under(rb_cQuery, "Flag");
+  TypedData_Get_Struct(
+    self, struct WinevtQuery, &rb_winevt_query_type, winevtQuery);
 
-  /* clang-format off */
-  /*
-   * EVT_SEEK_FLAGS enumeration: EvtSeekRelativeToFirst
-   * @since 0.6.0
-   * @see https://msdn.microsoft.com/en-us/windows/desktop/aa385575#EvtSeekRelativeToFirst
-   */
-  rb_define_const(rb_cFlag, "RelativeToFirst", LONG2NUM(EvtSeekRelativeToFirst));
-  /*
-   * EVT_SEEK_FLAGS enumeration: EvtSeekRelativeToLast
-   * @since 0.6.0
+  return fields_to_rb_ary(winevtQuery->fields);
+}
+
+/*
+ * This method specifies the number of publisher metadata handles
+ * which are kept open for formatting messages. 0 disables caching.
+ *
+ * @since 0.12.0
+ * @param rb_capacity [Integer]
+ */
+static VALUE
+rb_winevt_query_set_publisher_cache_capacity(VALUE self, VALUE rb_capacity)
+{
+  struct WinevtQuery* winevtQuery;
+  long capacity;
+
+  TypedData_Get_Struct(
+    self, struct WinevtQuery, &rb_winevt_query_type, winevtQuery);
+
+  capacity = NUM2LONG(rb_capacity);
+  if (capacity < 0) {
+    rb_raise(rb_eArgError, "Specify 0 or a positive capacity");
+  }
+
+  publisher_cache_set_capacity(renderer_publisher_cache(&winevtQuery->renderer),
+                               (size_t)capacity);
+
+  return Qnil;
+}
+
+/*
+ * This method returns the capacity of the publisher metadata cache.
+ *
+ * @since 0.12.0
+ * @return [Integer]
+ */
+static VALUE
+rb_winevt_query_get_publisher_cache_capacity(VALUE self)
+{
+  struct WinevtQuery* winevtQuery;
+
+  TypedData_Get_Struct(
+    self, struct WinevtQuery, &rb_winevt_query_type, winevtQuery);
+
+  return SIZET2NUM(
+    publisher_cache_get_capacity(renderer_publisher_cache(&winevtQuery->renderer)));
+}
+
+/*
+ * This method returns hits, misses, evictions, size and capacity of
+ * the publisher metadata cache.
+ *
+ * @since 0.12.0
+ * @return [Hash]
+ */
+static VALUE
+rb_winevt_query_publisher_cache_stats(VALUE self)
+{
+  struct WinevtQuery* winevtQuery;
+
+  TypedData_Get_Struct(
+    self, struct WinevtQuery, &rb_winevt_query_type, winevtQuery);
+
+  return publisher_cache_stats(renderer_publisher_cache(&winevtQuery->renderer));
+}
+
+/*
+ * This method specifies the maximum number of SIDs which are kept
+ * in the SID to account name cache. 0 disables caching.
+ *
+ * @since 0.12.0
+ * @param rb_capacity [Integer]
+ */
+static VALUE
+rb_winevt_query_set_sid_cache_capacity(VALUE self, VALUE rb_capacity)
+{
+  struct WinevtQuery* winevtQuery;
+  long capacity;
+
+  TypedData_Get_Struct(
+    self, struct WinevtQuery, &rb_winevt_query_type, winevtQuery);
+
+  capacity = NUM2LONG(rb_capacity);
+  if (capacity < 0) {
+    rb_raise(rb_eArgError, "Specify 0 or a positive capacity");
+  }
+
+  sid_cache_set_capacity(renderer_sid_cache(&winevtQuery->renderer), (size_t)capacity);
+
+  return Qnil;
+}
+
+/*
+ * This method returns the capacity of the SID to account name cache.
+ *
+ * @since 0.12.0
+ * @return [Integer]
+ */
+static VALUE
+rb_winevt_query_get_sid_cache_capacity(VALUE self)
+{
+  struct WinevtQuery* winevtQuery;
+
+  TypedData_Get_Struct(
+    self, struct WinevtQuery, &rb_winevt_query_type, winevtQuery);
+
+  return SIZET2NUM(sid_cache_get_capacity(renderer_sid_cache(&winevtQuery->renderer)));
+}
+
+/*
+ * This method specifies how long resolved account names are cached
+ * in seconds.
+ *
+ * @since 0.12.0
+ * @param rb_ttl [Integer]
+ */
+static VALUE
+rb_winevt_query_set_sid_cache_ttl(VALUE self, VALUE rb_ttl)
+{
+  struct WinevtQuery* winevtQuery;
+  long ttl;
+
+  TypedData_Get_Struct(
+    self, struct WinevtQuery, &rb_winevt_query_type, winevtQuery);
+
+  ttl = NUM2LONG(rb_ttl);
+  if (ttl < 0) {
+    rb_raise(rb_eArgError, "Specify 0 or a positive TTL");
+  }
+
+  sid_cache_set_ttl(renderer_sid_cache(&winevtQuery->renderer), (ULONGLONG)ttl);
+
+  return Qnil;
+}
+
+/*
+ * This method returns how long resolved account names are cached in
+ * seconds.
+ *
+ * @since 0.12.0
+ * @return [Integer]
+ */
+static VALUE
+rb_winevt_query_get_sid_cache_ttl(VALUE self)
+{
+  struct WinevtQuery* winevtQuery;
+
+  TypedData_Get_Struct(
+    self, struct WinevtQuery, &rb_winevt_query_type, winevtQuery);
+
+  return ULL2NUM(sid_cache_get_ttl(renderer_sid_cache(&winevtQuery->renderer)));
+}
+
+/*
+ * This method specifies how long unresolvable SIDs are remembered in
+ * seconds.
+ *
+ * @since 0.12.0
+ * @param rb_ttl [Integer]
+ */
+static VALUE
+rb_winevt_query_set_sid_cache_negative_ttl(VALUE self, VALUE rb_ttl)
+{
+  struct WinevtQuery* winevtQuery;
+  long ttl;
+
+  TypedData_Get_Struct(
+    self, struct WinevtQuery, &rb_winevt_query_type, winevtQuery);
+
+  ttl = NUM2LONG(rb_ttl);
+  if (ttl < 0) {
+    rb_raise(rb_eArgError, "Specify 0 or a positive TTL");
+  }
+
+  sid_cache_set_negative_ttl(renderer_sid_cache(&winevtQuery->renderer), (ULONGLONG)ttl);
+
+  return Qnil;
+}
+
+/*
+ * This method returns how long unresolvable SIDs are remembered in
+ * seconds.
+ *
+ * @since 0.12.0
+ * @return [Integer]
+ */
+static VALUE
+rb_winevt_query_get_sid_cache_negative_ttl(VALUE self)
+{
+  struct WinevtQuery* winevtQuery;
+
+  TypedData_Get_Struct(
+    self, struct WinevtQuery, &rb_winevt_query_type, winevtQuery);
+
+  return ULL2NUM(sid_cache_get_negative_ttl(renderer_sid_cache(&winevtQuery->renderer)));
+}
+
+/*
+ * This method returns hits, negative hits, misses, evictions,
+ * expirations, size, capacity and hit rate of the SID to account name
+ * cache.
+ *
+ * @since 0.12.0
+ * @return [Hash]
+ */
+static VALUE
+rb_winevt_query_sid_cache_stats(VALUE self)
+{
+  struct WinevtQuery* winevtQuery;
+
+  TypedData_Get_Struct(
+    self, struct WinevtQuery, &rb_winevt_query_type, winevtQuery);
+
+  return sid_cache_stats(renderer_sid_cache(&winevtQuery->renderer));
+}
+
+/*
+ * This method specifies how many event handles are requested by a
+ * single EvtNext call.
+ *
+ * @since 0.12.0
+ * @param rb_batch_size [Integer] 1 up to 1024
+ */
+static VALUE
+rb_winevt_query_set_batch_size(VALUE self, VALUE rb_batch_size)
+{
+  struct WinevtQuery* winevtQuery;
+  long batchSize;
+
+  TypedData_Get_Struct(
+    self, struct WinevtQuery, &rb_winevt_query_type, winevtQuery);
+
+  batchSize = NUM2LONG(rb_batch_size);
+  if (batchSize < 1 || batchSize > QUERY_ARRAY_MAX_SIZE) {
+    rb_raise(rb_eArgError, "Specify a batch size between 1 and %d", QUERY_ARRAY_MAX_SIZE);
+  }
+
+  /* Handles which do not fit into the new array cannot be rendered
+   * anymore. */
+  for (ULONG i = batchSize; i < winevtQuery->count; i++) {
+    if (winevtQuery->hEvents[i]) {
+      winevt_backend->close(winevtQuery->hEvents[i]);
+      winevtQuery->hEvents[i] = NULL;
+    }
+  }
+  if (winevtQuery->count > (ULONG)batchSize) {
+    winevtQuery->count = batchSize;
+  }
+
+  REALLOC_N(winevtQuery->hEvents, EVT_HANDLE, batchSize);
+  for (ULONG i = winevtQuery->count; i < (ULONG)batchSize; i++) {
+    winevtQuery->hEvents[i] = NULL;
+  }
+  winevtQuery->batchSize = batchSize;
+
+  return Qnil;
+}
+
+/*
+ * This method returns how many event handles are requested by a
+ * single EvtNext call.
+ *
+ * @since 0.12.0
+ * @return [Integer]
+ */
+static VALUE
+rb_winevt_query_get_batch_size(VALUE self)
+{
+  struct WinevtQuery* winevtQuery;
+
+  TypedData_Get_Struct(
+    self, struct WinevtQuery, &rb_winevt_query_type, winevtQuery);
+
+  return ULONG2NUM(winevtQuery->batchSize);
+}
+
+/*
+ * This method specifies whether the time spent in EvtNext, EvtRender,
+ * EvtFormatMessage, SID lookups and the block of #each is collected
+ * into #stats. It is disabled by default.
+ *
+ * @since 0.12.0
+ * @param rb_collect_stats [Boolean]
+ */
+static VALUE
+rb_winevt_query_set_collect_stats(VALUE self, VALUE rb_collect_stats)
+{
+  struct WinevtQuery* winevtQuery;
+
+  TypedData_Get_Struct(
+    self, struct WinevtQuery, &rb_winevt_query_type, winevtQuery);
+
+  winevtQuery->renderer.stats.enabled = RTEST(rb_collect_stats);
+
+  return Qnil;
+}
+
+/*
+ * This method returns whether #stats are collected or not.
+ *
+ * @since 0.12.0
+ * @return [Boolean]
+ */
+static VALUE
+rb_winevt_query_collect_stats_p(VALUE self)
+{
+  struct WinevtQuery* winevtQuery;
+
+  TypedData_Get_Struct(
+    self, struct WinevtQuery, &rb_winevt_query_type, winevtQuery);
+
+  return winevtQuery->renderer.stats.enabled ? Qtrue : Qfalse;
+}
+
+/*
+ * This method returns the counters which are collected while
+ * #collect_stats is enabled: "events", "batches", "rendered_bytes"
+ * and the nanoseconds spent in each stage ("next_nsec", "render_nsec",
+ * "format_message_nsec", "sid_lookup_nsec" and "yield_nsec"). The
+ * statistics of the publisher and SID caches are included as well.
+ *
+ * @since 0.12.0
+ * @return [Hash]
+ */
+static VALUE
+rb_winevt_query_stats(VALUE self)
+{
+  struct WinevtQuery* winevtQuery;
+
+  TypedData_Get_Struct(
+    self, struct WinevtQuery, &rb_winevt_query_type, winevtQuery);
+
+  return winevt_stats_to_hash(&winevtQuery->renderer);
+}
+
+/*
+ * This method resets the counters of #stats.
+ *
+ * @since 0.12.0
+ */
+static VALUE
+rb_winevt_query_reset_stats(VALUE self)
+{
+  struct WinevtQuery* winevtQuery;
+
+  TypedData_Get_Struct(
+    self, struct WinevtQuery, &rb_winevt_query_type, winevtQuery);
+
+  winevt_stats_reset(&winevtQuery->renderer.stats);
+
+  return Qnil;
+}
+
+/*
+ * This method cancels channel query.
+ *
+ * @return [Boolean]
+ * @since 0.9.1
+ */
+static VALUE
+rb_winevt_query_cancel(VALUE self)
+{
+  struct WinevtQuery* winevtQuery;
+  BOOL result = FALSE;
+
+  TypedData_Get_Struct(
+    self, struct WinevtQuery, &rb_winevt_query_type, winevtQuery);
+
+  if (winevtQuery->query) {
+    result = winevt_backend->cancel(winevtQuery->query);
+  }
+
+  if (result) {
+    return Qtrue;
+  } else {
+    return Qfalse;
+  }
+}
+
+/*
+ * This method closes channel handles forcibly.
+ *
+ * @since 0.9.1
+ */
+static VALUE
+rb_winevt_query_close(VALUE self)
+{
+  struct WinevtQuery* winevtQuery;
+
+  TypedData_Get_Struct(
+    self, struct WinevtQuery, &rb_winevt_query_type, winevtQuery);
+
+  close_handles(winevtQuery);
+
+  return Qnil;
+}
+
+void
+Init_winevt_query(VALUE rb_cEventLog)
+{
+  rb_cQuery = rb_define_class_under(rb_cEventLog, "Query", rb_cObject);
+  rb_define_alloc_func(rb_cQuery, rb_winevt_query_alloc);
+
+  rb_cFlag = rb_define_module_under(rb_cQuery, "Flag");
+
+  /* clang-format off */
+  /*
+   * EVT_SEEK_FLAGS enumeration: EvtSeekRelativeToFirst
+   * @since 0.6.0
+   * @see https://msdn.microsoft.com/en-us/windows/desktop/aa385575#EvtSeekRelativeToFirst
+   */
+  rb_define_const(rb_cFlag, "RelativeToFirst", LONG2NUM(EvtSeekRelativeToFirst));
+  /*
+   * EVT_SEEK_FLAGS enumeration: EvtSeekRelativeToLast
+   * @since 0.6.0
    * @see https://msdn.microsoft.com/en-us/windows/desktop/aa385575#EvtSeekRelativeToLast
    */
   rb_define_const(rb_cFlag, "RelativeToLast", LONG2NUM(EvtSeekRelativeToLast));
@@ -701,6 +1639,12 @@ Init_winevt_query(VALUE rb_cEventLog)
   rb_define_method(rb_cQuery, "timeout", rb_winevt_query_get_timeout, 0);
   rb_define_method(rb_cQuery, "timeout=", rb_winevt_query_set_timeout, 1);
   rb_define_method(rb_cQuery, "each", rb_winevt_query_each, 0);
+  /* @since 0.12.0 */
+  rb_define_method(rb_cQuery, "each_batch", rb_winevt_query_each_batch, -1);
+  /* @since 0.12.0 */
+  rb_define_method(rb_cQuery, "write_arrow", rb_winevt_query_write_arrow, -1);
+  /* @since 0.12.0 */
+  rb_define_method(rb_cQuery, "write_json", rb_winevt_query_write_json, 1);
   rb_define_method(rb_cQuery, "render_as_xml?", rb_winevt_query_render_as_xml_p, 0);
   rb_define_method(rb_cQuery, "render_as_xml=", rb_winevt_query_set_render_as_xml, 1);
   /*
@@ -727,6 +1671,94 @@ Init_winevt_query(VALUE rb_cEventLog)
    * @since 0.11.0
    */
   rb_define_method(rb_cQuery, "preserve_sid=", rb_winevt_query_set_preserve_sid, 1);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cQuery, "symbolize_keys?", rb_winevt_query_symbolize_keys_p, 0);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cQuery, "symbolize_keys=", rb_winevt_query_set_symbolize_keys, 1);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cQuery, "typed_values?", rb_winevt_query_typed_values_p, 0);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cQuery, "typed_values=", rb_winevt_query_set_typed_values, 1);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cQuery, "fields", rb_winevt_query_get_fields, 0);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cQuery, "fields=", rb_winevt_query_set_fields, 1);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cQuery, "publisher_cache_capacity", rb_winevt_query_get_publisher_cache_capacity, 0);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cQuery, "publisher_cache_capacity=", rb_winevt_query_set_publisher_cache_capacity, 1);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cQuery, "publisher_cache_stats", rb_winevt_query_publisher_cache_stats, 0);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cQuery, "sid_cache_capacity", rb_winevt_query_get_sid_cache_capacity, 0);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cQuery, "sid_cache_capacity=", rb_winevt_query_set_sid_cache_capacity, 1);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cQuery, "sid_cache_ttl", rb_winevt_query_get_sid_cache_ttl, 0);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cQuery, "sid_cache_ttl=", rb_winevt_query_set_sid_cache_ttl, 1);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cQuery, "sid_cache_negative_ttl", rb_winevt_query_get_sid_cache_negative_ttl, 0);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cQuery, "sid_cache_negative_ttl=", rb_winevt_query_set_sid_cache_negative_ttl, 1);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cQuery, "sid_cache_stats", rb_winevt_query_sid_cache_stats, 0);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cQuery, "batch_size", rb_winevt_query_get_batch_size, 0);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cQuery, "batch_size=", rb_winevt_query_set_batch_size, 1);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cQuery, "collect_stats?", rb_winevt_query_collect_stats_p, 0);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cQuery, "collect_stats=", rb_winevt_query_set_collect_stats, 1);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cQuery, "stats", rb_winevt_query_stats, 0);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cQuery, "reset_stats", rb_winevt_query_reset_stats, 0);
   /*
    * @since 0.9.1
    */
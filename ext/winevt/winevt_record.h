@@ -0,0 +1,246 @@
+#ifndef _WINEVT_RECORD_H_
+#define _WINEVT_RECORD_H_
+
+/*
+ * Writes an event as a record, which is a map of the keys and values of
+ * the Hash #each yields without typed values, followed by "Message" and
+ * "StringInserts", or of "XML" when XML is rendered. Records are written
+ * straight from the rendered values with a writer of a format such as
+ * MessagePack or JSON, which has these members:
+ *
+ *   void startMap(uint32_t count);
+ *   void endMap();
+ *   void startArray(uint32_t count);
+ *   void endArray();
+ *   void key(enum SystemEventKey key);
+ *   void writeNull();
+ *   void writeBoolean(bool value);
+ *   void writeUnsigned(uint64_t value);
+ *   void writeSigned(int64_t value);
+ *   void writeString(const char* value, size_t length);
+ *   void writeWstr(const WCHAR* value);  // NULL is an empty string
+ *
+ * This header is for C++ only.
+ */
+
+#include <winevt_format.h>
+#include <winevt_native.h>
+
+#include <stdint.h>
+#include <string>
+
+/* Which parts of events are written. */
+struct WinevtRecordFields
+{
+  bool xml;
+  bool system;
+  bool message;
+  bool inserts;
+  BOOL preserveQualifiers;
+  BOOL preserveSID;
+};
+
+static inline void
+record_fields_init(struct WinevtRecordFields* recordFields, DWORD fields, BOOL renderAsXML,
+                   BOOL preserveQualifiers, BOOL preserveSID)
+{
+  // fields= takes precedence over render_as_xml= as in #each.
+  if (fields) {
+    renderAsXML = (fields & WINEVT_FIELD_XML) != 0;
+  }
+  recordFields->xml = renderAsXML && (!fields || (fields & WINEVT_FIELD_XML));
+  recordFields->system = !renderAsXML && (!fields || (fields & WINEVT_FIELD_SYSTEM));
+  recordFields->message = !fields || (fields & WINEVT_FIELD_MESSAGE);
+  recordFields->inserts = !fields || (fields & WINEVT_FIELD_INSERTS);
+  recordFields->preserveQualifiers = preserveQualifiers;
+  recordFields->preserveSID = preserveSID;
+}
+
+template<typename Writer>
+static void
+write_record_guid(Writer& writer, const GUID* guid)
+{
+  WCHAR wsGuid[50];
+
+  StringFromGUID2(*guid, wsGuid, _countof(wsGuid));
+  writer.writeWstr(wsGuid);
+}
+
+template<typename Writer>
+static void
+write_record_byte(Writer& writer, const EVT_VARIANT& variant)
+{
+  writer.writeUnsigned(EvtVarTypeNull == variant.Type ? 0 : variant.ByteVal);
+}
+
+/* The same values as render_system_values() makes without typed
+ * values. The map has extraKeys more members, which follow. */
+template<typename Writer>
+static void
+write_record_system_values(Writer& writer, const struct WinevtRecordFields& fields,
+                           struct WinevtRenderer* renderer, EVT_HANDLE event,
+                           uint32_t extraKeys)
+{
+  PEVT_VARIANT values = render_system_variants(renderer, event);
+  char buffer[WINEVT_FORMAT_BUFFER_SIZE];
+  WinevtCivilTime time;
+  DWORD eventID = values[EvtSystemEventID].UInt16Val;
+  bool hasActivityID = EvtVarTypeNull != values[EvtSystemActivityID].Type;
+  bool hasRelatedActivityID = EvtVarTypeNull != values[EvtSystemRelatedActivityID].Type;
+  struct WinevtUserSid user;
+
+  user.hasSid = false;
+  user.hasAccount = false;
+  if (EvtVarTypeNull != values[EvtSystemUserID].Type) {
+    render_user_sid(renderer, values[EvtSystemUserID].SidVal, &user);
+  }
+  // ProviderName to EventRecordID, ProcessID to Computer and the optional keys.
+  writer.startMap(14 + (fields.preserveQualifiers ? 1 : 0) + (hasActivityID ? 1 : 0) +
+                  (hasRelatedActivityID ? 1 : 0) + (user.hasSid && fields.preserveSID ? 1 : 0) +
+                  (user.hasAccount ? 1 : 0) + extraKeys);
+
+  writer.key(SYSTEM_EVENT_KEY_PROVIDER_NAME);
+  writer.writeWstr(values[EvtSystemProviderName].StringVal);
+  writer.key(SYSTEM_EVENT_KEY_PROVIDER_GUID);
+  if (NULL != values[EvtSystemProviderGuid].GuidVal) {
+    write_record_guid(writer, values[EvtSystemProviderGuid].GuidVal);
+  } else {
+    writer.writeNull();
+  }
+
+  if (fields.preserveQualifiers) {
+    writer.key(SYSTEM_EVENT_KEY_QUALIFIERS);
+    if (EvtVarTypeNull != values[EvtSystemQualifiers].Type) {
+      writer.writeUnsigned(values[EvtSystemQualifiers].UInt16Val);
+    } else {
+      writer.writeString("", 0);
+    }
+  } else if (EvtVarTypeNull != values[EvtSystemQualifiers].Type) {
+    eventID = MAKELONG(values[EvtSystemEventID].UInt16Val, values[EvtSystemQualifiers].UInt16Val);
+  }
+  writer.key(SYSTEM_EVENT_KEY_EVENT_ID);
+  writer.writeUnsigned(eventID);
+
+  writer.key(SYSTEM_EVENT_KEY_VERSION);
+  write_record_byte(writer, values[EvtSystemVersion]);
+  writer.key(SYSTEM_EVENT_KEY_LEVEL);
+  write_record_byte(writer, values[EvtSystemLevel]);
+  writer.key(SYSTEM_EVENT_KEY_TASK);
+  writer.writeUnsigned(EvtVarTypeNull == values[EvtSystemTask].Type
+                         ? 0
+                         : values[EvtSystemTask].UInt16Val);
+  writer.key(SYSTEM_EVENT_KEY_OPCODE);
+  write_record_byte(writer, values[EvtSystemOpcode]);
+
+  writer.key(SYSTEM_EVENT_KEY_KEYWORDS);
+  if (EvtVarTypeNull == values[EvtSystemKeywords].Type) {
+    writer.writeNull();
+  } else {
+    writer.writeString(buffer,
+                       winevt_format_hex_prefixed(values[EvtSystemKeywords].UInt64Val, 1, buffer));
+  }
+  writer.key(SYSTEM_EVENT_KEY_TIME_CREATED);
+  if (EvtVarTypeNull == values[EvtSystemTimeCreated].Type) {
+    writer.writeNull();
+  } else {
+    winevt_filetime_to_civil(values[EvtSystemTimeCreated].FileTimeVal, &time);
+    writer.writeString(buffer, winevt_format_time_created(&time, buffer));
+  }
+  writer.key(SYSTEM_EVENT_KEY_EVENT_RECORD_ID);
+  if (EvtVarTypeNull == values[EvtSystemEventRecordId].UInt64Val) {
+    writer.writeNull();
+  } else {
+    writer.writeString(buffer,
+                       winevt_format_uint(values[EvtSystemEventRecordId].UInt64Val, 1, buffer));
+  }
+
+  if (hasActivityID) {
+    writer.key(SYSTEM_EVENT_KEY_ACTIVITY_ID);
+    write_record_guid(writer, values[EvtSystemActivityID].GuidVal);
+  }
+  if (hasRelatedActivityID) {
+    writer.key(SYSTEM_EVENT_KEY_RELATED_ACTIVITY_ID);
+    write_record_guid(writer, values[EvtSystemRelatedActivityID].GuidVal);
+  }
+  writer.key(SYSTEM_EVENT_KEY_PROCESS_ID);
+  writer.writeUnsigned(values[EvtSystemProcessID].UInt32Val);
+  writer.key(SYSTEM_EVENT_KEY_THREAD_ID);
+  writer.writeUnsigned(values[EvtSystemThreadID].UInt32Val);
+  writer.key(SYSTEM_EVENT_KEY_CHANNEL);
+  writer.writeWstr(values[EvtSystemChannel].StringVal);
+  writer.key(SYSTEM_EVENT_KEY_COMPUTER);
+  writer.writeWstr(values[EvtSystemComputer].StringVal);
+
+  if (user.hasSid && fields.preserveSID) {
+    writer.key(SYSTEM_EVENT_KEY_USER_ID);
+    writer.writeString(user.sid.data(), user.sid.size());
+  }
+  if (user.hasAccount) {
+    writer.key(SYSTEM_EVENT_KEY_USER);
+    writer.writeString(user.account.data(), user.account.size());
+  }
+}
+
+template<typename Writer>
+static void
+write_record_string_inserts(Writer& writer, struct WinevtRenderer* renderer, EVT_HANDLE event,
+                            std::string& text)
+{
+  DWORD count = 0;
+  PEVT_VARIANT values = render_user_variants(renderer, event, &count);
+  uint64_t integer = 0;
+
+  writer.startArray(count);
+  for (DWORD i = 0; i < count; i++) {
+    text.clear();
+    switch (evt_variant_to_native(&values[i], text, &integer)) {
+      case WINEVT_VARIANT_NULL:
+        writer.writeNull();
+        break;
+      case WINEVT_VARIANT_STRING:
+        writer.writeString(text.data(), text.size());
+        break;
+      case WINEVT_VARIANT_SIGNED:
+        writer.writeSigned(static_cast<int64_t>(integer));
+        break;
+      case WINEVT_VARIANT_UNSIGNED:
+        writer.writeUnsigned(integer);
+        break;
+      case WINEVT_VARIANT_BOOLEAN:
+        writer.writeBoolean(integer != 0);
+        break;
+    }
+  }
+  writer.endArray();
+}
+
+/* text is a scratch buffer for insert values. */
+template<typename Writer>
+static void
+write_record(Writer& writer, const struct WinevtRecordFields& fields,
+             struct WinevtRenderer* renderer, EVT_HANDLE event, LANGID langID,
+             EVT_HANDLE hRemote, std::string& text)
+{
+  uint32_t extraKeys = (fields.message ? 1 : 0) + (fields.inserts ? 1 : 0);
+
+  if (fields.system) {
+    write_record_system_values(writer, fields, renderer, event, extraKeys);
+  } else if (fields.xml) {
+    writer.startMap(1 + extraKeys);
+    writer.key(SYSTEM_EVENT_KEY_XML);
+    writer.writeWstr(render_xml_to_wstr(renderer, event));
+  } else {
+    writer.startMap(extraKeys);
+  }
+  if (fields.message) {
+    writer.key(SYSTEM_EVENT_KEY_MESSAGE);
+    writer.writeWstr(get_description_wstr(renderer, event, langID, hRemote));
+  }
+  if (fields.inserts) {
+    writer.key(SYSTEM_EVENT_KEY_STRING_INSERTS);
+    write_record_string_inserts(writer, renderer, event, text);
+  }
+  writer.endMap();
+}
+
+#endif // _WINEVT_RECORD_H_
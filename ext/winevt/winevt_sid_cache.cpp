@@ -0,0 +1,83 @@
+#include <winevt_c.h>
+#include <winevt_sid_cache.h>
+
+/* The fake backend has a clock which tests move forward. */
+static uint64_t
+sid_cache_clock(void)
+{
+  return winevt_backend->tickCount64();
+}
+
+struct WinevtSidCache*
+sid_cache_create(void)
+{
+  return new WinevtSidCache(SID_CACHE_DEFAULT_CAPACITY,
+                            SID_CACHE_DEFAULT_TTL_MSEC,
+                            SID_CACHE_DEFAULT_NEGATIVE_TTL_MSEC,
+                            sid_cache_clock);
+}
+
+void
+sid_cache_destroy(struct WinevtSidCache* cache)
+{
+  delete cache;
+}
+
+size_t
+sid_cache_get_capacity(struct WinevtSidCache* cache)
+{
+  return cache->capacity();
+}
+
+void
+sid_cache_set_capacity(struct WinevtSidCache* cache, size_t capacity)
+{
+  cache->setCapacity(capacity);
+}
+
+ULONGLONG
+sid_cache_get_ttl(struct WinevtSidCache* cache)
+{
+  return cache->ttl() / 1000;
+}
+
+void
+sid_cache_set_ttl(struct WinevtSidCache* cache, ULONGLONG seconds)
+{
+  cache->setTtl(seconds * 1000);
+}
+
+ULONGLONG
+sid_cache_get_negative_ttl(struct WinevtSidCache* cache)
+{
+  return cache->negativeTtl() / 1000;
+}
+
+void
+sid_cache_set_negative_ttl(struct WinevtSidCache* cache, ULONGLONG seconds)
+{
+  cache->setNegativeTtl(seconds * 1000);
+}
+
+VALUE
+sid_cache_stats(struct WinevtSidCache* cache)
+{
+  VALUE hash = rb_hash_new();
+  SidCacheStats stats = cache->stats();
+  uint64_t lookups = stats.hits + stats.negativeHits + stats.misses;
+
+  rb_hash_aset(hash, rb_str_new2("hits"), ULL2NUM(stats.hits));
+  rb_hash_aset(hash, rb_str_new2("negative_hits"), ULL2NUM(stats.negativeHits));
+  rb_hash_aset(hash, rb_str_new2("misses"), ULL2NUM(stats.misses));
+  rb_hash_aset(hash, rb_str_new2("evictions"), ULL2NUM(stats.evictions));
+  rb_hash_aset(hash, rb_str_new2("expirations"), ULL2NUM(stats.expirations));
+  rb_hash_aset(hash, rb_str_new2("size"), SIZET2NUM(stats.size));
+  rb_hash_aset(hash, rb_str_new2("capacity"), SIZET2NUM(cache->capacity()));
+  rb_hash_aset(hash,
+               rb_str_new2("hit_rate"),
+               DBL2NUM(lookups == 0 ? 0.0
+                                    : (double)(stats.hits + stats.negativeHits) /
+                                        (double)lookups));
+
+  return hash;
+}
@@ -0,0 +1,221 @@
+#ifndef _WINEVT_SID_CACHE_H_
+#define _WINEVT_SID_CACHE_H_
+
+/*
+ * SID to "DOMAIN\account" cache.
+ *
+ * This header does not depend on Windows or Ruby headers so that the
+ * eviction and expiration behaviour can be exercised on any platform.
+ * Keys are the binary representation of a SID. Unresolvable SIDs are
+ * remembered as negative entries with their own (shorter) TTL. Entries
+ * expire by a clock which is given to the cache, so that tests can
+ * move it forward.
+ */
+
+#include <chrono>
+#include <list>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#define SID_CACHE_DEFAULT_CAPACITY 4096
+#define SID_CACHE_DEFAULT_TTL_MSEC (10 * 60 * 1000)
+#define SID_CACHE_DEFAULT_NEGATIVE_TTL_MSEC (60 * 1000)
+
+struct SidCacheStats
+{
+  uint64_t hits;
+  uint64_t negativeHits;
+  uint64_t misses;
+  uint64_t evictions;
+  uint64_t expirations;
+  size_t size;
+};
+
+enum SidCacheResult
+{
+  SID_CACHE_MISS = 0,
+  SID_CACHE_HIT,
+  SID_CACHE_NEGATIVE_HIT,
+};
+
+struct WinevtSidCache
+{
+  /* Returns milliseconds of a monotonic clock. */
+  typedef uint64_t (*Clock)(void);
+
+  struct Entry
+  {
+    std::string sid;
+    std::string account;
+    bool resolved;
+    uint64_t expiresAt;
+  };
+  typedef std::list<Entry> EntryList;
+
+  static uint64_t steadyClock()
+  {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                   std::chrono::steady_clock::now().time_since_epoch())
+                                   .count());
+  }
+
+  WinevtSidCache(size_t capacity = SID_CACHE_DEFAULT_CAPACITY,
+                 uint64_t ttlMsec = SID_CACHE_DEFAULT_TTL_MSEC,
+                 uint64_t negativeTtlMsec = SID_CACHE_DEFAULT_NEGATIVE_TTL_MSEC,
+                 Clock clock = steadyClock)
+    : clock_(clock)
+    , capacity_(capacity)
+    , ttl_(ttlMsec)
+    , negativeTtl_(negativeTtlMsec)
+  {
+    stats_ = SidCacheStats();
+  }
+
+  /* Returns SID_CACHE_HIT and stores the account name when the SID has
+   * been resolved before, SID_CACHE_NEGATIVE_HIT when it is known to be
+   * unresolvable and SID_CACHE_MISS otherwise. */
+  SidCacheResult lookup(const std::string& sid, std::string* account)
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    auto found = index_.find(sid);
+
+    if (found == index_.end()) {
+      stats_.misses++;
+      return SID_CACHE_MISS;
+    }
+
+    EntryList::iterator entry = found->second;
+    if (clock_() >= entry->expiresAt) {
+      index_.erase(found);
+      entries_.erase(entry);
+      stats_.expirations++;
+      stats_.misses++;
+      return SID_CACHE_MISS;
+    }
+
+    entries_.splice(entries_.begin(), entries_, entry);
+    if (!entry->resolved) {
+      stats_.negativeHits++;
+      return SID_CACHE_NEGATIVE_HIT;
+    }
+
+    stats_.hits++;
+    if (account)
+      *account = entry->account;
+    return SID_CACHE_HIT;
+  }
+
+  void insert(const std::string& sid, const std::string& account)
+  {
+    store(sid, account, true, ttl_);
+  }
+
+  void insertNegative(const std::string& sid)
+  {
+    store(sid, std::string(), false, negativeTtl_);
+  }
+
+  void clear()
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    index_.clear();
+    entries_.clear();
+  }
+
+  size_t capacity()
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    return capacity_;
+  }
+
+  void setCapacity(size_t capacity)
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    capacity_ = capacity;
+    evict(capacity_);
+  }
+
+  uint64_t ttl()
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    return ttl_;
+  }
+
+  void setTtl(uint64_t msec)
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    ttl_ = msec;
+  }
+
+  uint64_t negativeTtl()
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    return negativeTtl_;
+  }
+
+  void setNegativeTtl(uint64_t msec)
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    negativeTtl_ = msec;
+  }
+
+  SidCacheStats stats()
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    SidCacheStats stats = stats_;
+    stats.size = entries_.size();
+    return stats;
+  }
+
+private:
+  void store(const std::string& sid,
+             const std::string& account,
+             bool resolved,
+             uint64_t ttl)
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+
+    if (capacity_ == 0)
+      return;
+
+    auto found = index_.find(sid);
+    if (found != index_.end()) {
+      entries_.erase(found->second);
+      index_.erase(found);
+    }
+
+    Entry entry;
+    entry.sid = sid;
+    entry.account = account;
+    entry.resolved = resolved;
+    entry.expiresAt = clock_() + ttl;
+    entries_.push_front(entry);
+    index_[sid] = entries_.begin();
+
+    evict(capacity_);
+  }
+
+  void evict(size_t capacity)
+  {
+    while (entries_.size() > capacity) {
+      index_.erase(entries_.back().sid);
+      entries_.pop_back();
+      stats_.evictions++;
+    }
+  }
+
+  std::mutex lock_;
+  Clock clock_;
+  size_t capacity_;
+  uint64_t ttl_;
+  uint64_t negativeTtl_;
+  SidCacheStats stats_;
+  // Most recently used entry is placed at the front.
+  EntryList entries_;
+  std::unordered_map<std::string, EntryList::iterator> index_;
+};
+
+#endif // _WINEVT_SID_CACHE_H_
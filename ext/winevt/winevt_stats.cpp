@@ -0,0 +1,49 @@
+#include <winevt_c.h>
+
+#include <chrono>
+
+/* steady_clock is monotonic, and it is QueryPerformanceCounter on
+ * Windows. */
+ULONGLONG
+winevt_stats_clock(void)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+           std::chrono::steady_clock::now().time_since_epoch())
+    .count();
+}
+
+void
+winevt_stats_reset(struct WinevtStats* stats)
+{
+  BOOL enabled = stats->enabled;
+
+  ZeroMemory(stats, sizeof(struct WinevtStats));
+  stats->enabled = enabled;
+}
+
+VALUE
+winevt_stats_to_hash(struct WinevtRenderer* renderer)
+{
+  const struct WinevtStats* stats = &renderer->stats;
+  VALUE hash = rb_hash_new();
+
+  rb_hash_aset(hash, rb_str_new2("enabled"), stats->enabled ? Qtrue : Qfalse);
+  rb_hash_aset(hash, rb_str_new2("events"), ULL2NUM(stats->events));
+  rb_hash_aset(hash, rb_str_new2("batches"), ULL2NUM(stats->batches));
+  rb_hash_aset(hash, rb_str_new2("rendered_bytes"), ULL2NUM(stats->renderedBytes));
+  rb_hash_aset(hash, rb_str_new2("next_nsec"), ULL2NUM(stats->nextNsec));
+  rb_hash_aset(hash, rb_str_new2("render_nsec"), ULL2NUM(stats->renderNsec));
+  rb_hash_aset(
+    hash, rb_str_new2("format_message_nsec"), ULL2NUM(stats->formatMessageNsec));
+  rb_hash_aset(hash, rb_str_new2("sid_lookup_nsec"), ULL2NUM(stats->sidLookupNsec));
+  rb_hash_aset(hash, rb_str_new2("yield_nsec"), ULL2NUM(stats->yieldNsec));
+  if (renderer->publisherCache) {
+    rb_hash_aset(
+      hash, rb_str_new2("publisher_cache"), publisher_cache_stats(renderer->publisherCache));
+  }
+  if (renderer->sidCache) {
+    rb_hash_aset(hash, rb_str_new2("sid_cache"), sid_cache_stats(renderer->sidCache));
+  }
+
+  return hash;
+}
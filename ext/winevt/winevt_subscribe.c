@@ -38,6 +38,20 @@ static const rb_data_type_t rb_winevt_subscribe_type = { "winevt/subscribe",
                                                          NULL,
                                                          RUBY_TYPED_FREE_IMMEDIATELY };
 
+static void
+close_event_handles(struct WinevtSubscribe* winevtSubscribe)
+{
+  if (winevtSubscribe->hEvents == NULL)
+    return;
+
+  for (DWORD i = 0; i < winevtSubscribe->count; i++) {
+    if (winevtSubscribe->hEvents[i]) {
+      winevt_backend->close(winevtSubscribe->hEvents[i]);
+      winevtSubscribe->hEvents[i] = NULL;
+    }
+  }
+}
+
 static void
 close_handles(struct WinevtSubscribe* winevtSubscribe)
 {
@@ -47,25 +61,24 @@ close_handles(struct WinevtSubscribe* winevtSubscribe)
   }
 
   if (winevtSubscribe->subscription) {
-    EvtClose(winevtSubscribe->subscription);
+    winevt_backend->close(winevtSubscribe->subscription);
     winevtSubscribe->subscription = NULL;
   }
 
   if (winevtSubscribe->bookmark) {
-    EvtClose(winevtSubscribe->bookmark);
+    winevt_backend->close(winevtSubscribe->bookmark);
     winevtSubscribe->bookmark = NULL;
   }
 
-  for (int i = 0; i < winevtSubscribe->count; i++) {
-    if (winevtSubscribe->hEvents[i]) {
-      EvtClose(winevtSubscribe->hEvents[i]);
-      winevtSubscribe->hEvents[i] = NULL;
-    }
-  }
+  close_event_handles(winevtSubscribe);
   winevtSubscribe->count = 0;
 
+  if (winevtSubscribe->renderer.publisherCache) {
+    publisher_cache_clear(winevtSubscribe->renderer.publisherCache);
+  }
+
   if (winevtSubscribe->remoteHandle) {
-    EvtClose(winevtSubscribe->remoteHandle);
+    winevt_backend->close(winevtSubscribe->remoteHandle);
     winevtSubscribe->remoteHandle = NULL;
   }
 }
@@ -75,6 +88,10 @@ subscribe_free(void* ptr)
 {
   struct WinevtSubscribe* winevtSubscribe = (struct WinevtSubscribe*)ptr;
   close_handles(winevtSubscribe);
+  finalize_renderer(&winevtSubscribe->renderer);
+
+  if (winevtSubscribe->hEvents)
+    xfree(winevtSubscribe->hEvents);
 
   xfree(ptr);
 }
@@ -111,6 +128,16 @@ rb_winevt_subscribe_initialize(VALUE self)
   winevtSubscribe->preserveQualifiers = FALSE;
   winevtSubscribe->localeInfo = &default_locale;
   winevtSubscribe->preserveSID = TRUE;
+  winevtSubscribe->symbolizeKeys = FALSE;
+  winevtSubscribe->typedValues = FALSE;
+  winevtSubscribe->fields = 0;
+
+  initialize_renderer(&winevtSubscribe->renderer);
+
+  if (winevtSubscribe->hEvents == NULL) {
+    winevtSubscribe->batchSize = SUBSCRIBE_ARRAY_SIZE;
+    winevtSubscribe->hEvents = ZALLOC_N(EVT_HANDLE, winevtSubscribe->batchSize);
+  }
 
   return Qnil;
 }
@@ -196,7 +223,7 @@ rb_winevt_subscribe_subscribe(int argc, VALUE* argv, VALUE self)
                         bookmarkXml,
                         len);
     bookmarkXml[len] = L'\0';
-    hBookmark = EvtCreateBookmark(bookmarkXml);
+    hBookmark = winevt_backend->createBookmark(bookmarkXml);
     ALLOCV_END(wBookmarkBuf);
     if (hBookmark == NULL) {
       status = GetLastError();
@@ -240,11 +267,12 @@ rb_winevt_subscribe_subscribe(int argc, VALUE* argv, VALUE self)
   }
 
   hSubscription =
-    EvtSubscribe(hRemoteHandle, hSignalEvent, path, query, hBookmark, NULL, NULL, flags);
+    winevt_backend->subscribe(
+      hRemoteHandle, hSignalEvent, path, query, hBookmark, NULL, NULL, flags);
   if (!hSubscription) {
     status = GetLastError();
     if (hBookmark != NULL) {
-      EvtClose(hBookmark);
+      winevt_backend->close(hBookmark);
     }
     if (hSignalEvent != NULL) {
       CloseHandle(hSignalEvent);
@@ -265,7 +293,12 @@ rb_winevt_subscribe_subscribe(int argc, VALUE* argv, VALUE self)
 
   if (winevtSubscribe->subscription != NULL) {
     // should be disgarded the old event subscription handle.
-    EvtClose(winevtSubscribe->subscription);
+    winevt_backend->close(winevtSubscribe->subscription);
+  }
+
+  // Cached publisher metadata can belong to the previous remote session.
+  if (winevtSubscribe->renderer.publisherCache) {
+    publisher_cache_clear(winevtSubscribe->renderer.publisherCache);
   }
 
   ALLOCV_END(wpathBuf);
@@ -277,11 +310,11 @@ rb_winevt_subscribe_subscribe(int argc, VALUE* argv, VALUE self)
   if (hBookmark) {
     winevtSubscribe->bookmark = hBookmark;
   } else {
-    winevtSubscribe->bookmark = EvtCreateBookmark(NULL);
+    winevtSubscribe->bookmark = winevt_backend->createBookmark(NULL);
     if (winevtSubscribe->bookmark == NULL) {
       status = GetLastError();
       if (hSubscription != NULL) {
-        EvtClose(hSubscription);
+        winevt_backend->close(hSubscription);
       }
       if (hSignalEvent != NULL) {
         CloseHandle(hSignalEvent);
@@ -298,7 +331,7 @@ is_rate_limit_exceeded(struct WinevtSubscribe* winevtSubscribe)
 {
   time_t now;
 
-  if (winevtSubscribe->rateLimit == SUBSCRIBE_RATE_INFINITE)
+  if (winevtSubscribe->rateLimit == (DWORD)SUBSCRIBE_RATE_INFINITE)
     return FALSE;
 
   time(&now);
@@ -319,7 +352,7 @@ update_to_reflect_rate_limit_state(struct WinevtSubscribe* winevtSubscribe, ULON
 {
   time_t lastTime = 0;
 
-  if (winevtSubscribe->rateLimit == SUBSCRIBE_RATE_INFINITE)
+  if (winevtSubscribe->rateLimit == (DWORD)SUBSCRIBE_RATE_INFINITE)
     return;
 
   time(&lastTime);
@@ -339,10 +372,11 @@ update_to_reflect_rate_limit_state(struct WinevtSubscribe* winevtSubscribe, ULON
 static VALUE
 rb_winevt_subscribe_next(VALUE self)
 {
-  EVT_HANDLE hEvents[SUBSCRIBE_ARRAY_SIZE];
   ULONG count = 0;
+  DWORD requested = 0;
   DWORD status = ERROR_SUCCESS;
   DWORD dwWait = 0;
+  ULONGLONG start;
 
   struct WinevtSubscribe* winevtSubscribe;
 
@@ -375,13 +409,28 @@ rb_winevt_subscribe_next(VALUE self)
     return Qfalse;
   }
 
-  if (!EvtNext(winevtSubscribe->subscription,
-               SUBSCRIBE_ARRAY_SIZE,
-               hEvents,
-               INFINITE,
-               0,
-               &count)) {
+  /* Handles of the previous batch which are not consumed by #each
+   * should not be leaked. The count is of the new batch from here, even
+   * if EvtNext raises. */
+  close_event_handles(winevtSubscribe);
+  winevtSubscribe->count = 0;
+
+  /* Larger batches should not overshoot the remaining rate limit. */
+  requested = winevtSubscribe->batchSize;
+  if (winevtSubscribe->rateLimit != (DWORD)SUBSCRIBE_RATE_INFINITE &&
+      winevtSubscribe->rateLimit - winevtSubscribe->currentRate < requested) {
+    requested = winevtSubscribe->rateLimit - winevtSubscribe->currentRate;
+  }
+
+  start = WINEVT_STATS_START(&winevtSubscribe->renderer.stats);
+  if (!EvtNextWithoutGVL(winevtSubscribe->subscription,
+                         requested,
+                         winevtSubscribe->hEvents,
+                         INFINITE,
+                         0,
+                         &count)) {
     status = GetLastError();
+    WINEVT_STATS_ADD(&winevtSubscribe->renderer.stats, nextNsec, start);
     if (ERROR_CANCELLED == status) {
       return Qfalse;
     }
@@ -390,13 +439,15 @@ rb_winevt_subscribe_next(VALUE self)
     }
 
     ResetEvent(winevtSubscribe->signalEvent);
+  } else {
+    WINEVT_STATS_ADD(&winevtSubscribe->renderer.stats, nextNsec, start);
   }
 
   if (status == ERROR_SUCCESS) {
     winevtSubscribe->count = count;
-    for (int i = 0; i < count; i++) {
-      winevtSubscribe->hEvents[i] = hEvents[i];
-      EvtUpdateBookmark(winevtSubscribe->bookmark, winevtSubscribe->hEvents[i]);
+    WINEVT_STATS_COUNT(&winevtSubscribe->renderer.stats, batches, 1);
+    for (ULONG i = 0; i < count; i++) {
+      winevt_backend->updateBookmark(winevtSubscribe->bookmark, winevtSubscribe->hEvents[i]);
     }
 
     update_to_reflect_rate_limit_state(winevtSubscribe, count);
@@ -411,35 +462,41 @@ static VALUE
 rb_winevt_subscribe_render(VALUE self, EVT_HANDLE event)
 {
   struct WinevtSubscribe* winevtSubscribe;
+  BOOL renderAsXML;
 
   TypedData_Get_Struct(
     self, struct WinevtSubscribe, &rb_winevt_subscribe_type, winevtSubscribe);
 
-  if (winevtSubscribe->renderAsXML) {
-    return render_to_rb_str(event, EvtRenderEventXml);
+  // fields= takes precedence over render_as_xml=.
+  if (winevtSubscribe->fields) {
+    renderAsXML = (winevtSubscribe->fields & WINEVT_FIELD_XML) != 0;
+  } else {
+    renderAsXML = winevtSubscribe->renderAsXML;
+  }
+
+  if (renderAsXML) {
+    return render_xml_to_rb_str(&winevtSubscribe->renderer, event);
   } else {
-    return render_system_event(event, winevtSubscribe->preserveQualifiers,
-                               winevtSubscribe->preserveSID);
+    return render_system_event(&winevtSubscribe->renderer, event,
+                               winevtSubscribe->preserveQualifiers,
+                               winevtSubscribe->preserveSID,
+                               winevtSubscribe->symbolizeKeys,
+                               winevtSubscribe->typedValues);
   }
 }
 
 static VALUE
-rb_winevt_subscribe_message(EVT_HANDLE event, LocaleInfo* localeInfo, EVT_HANDLE hRemote)
+rb_winevt_subscribe_message(struct WinevtRenderer* renderer, EVT_HANDLE event,
+                            LocaleInfo* localeInfo, EVT_HANDLE hRemote)
 {
-  WCHAR* wResult;
-  VALUE utf8str;
-
-  wResult = get_description(event, localeInfo->langID, hRemote);
-  utf8str = wstr_to_rb_str(CP_UTF8, wResult, -1);
-  free(wResult);
-
-  return utf8str;
+  return get_description(renderer, event, localeInfo->langID, hRemote);
 }
 
 static VALUE
-rb_winevt_subscribe_string_inserts(EVT_HANDLE event)
+rb_winevt_subscribe_string_inserts(struct WinevtRenderer* renderer, EVT_HANDLE event,
+                                   BOOL typedValues)
 {
-  return get_values(event);
+  return get_values(renderer, event, typedValues);
 }
 
 static VALUE
@@ -450,12 +507,7 @@ rb_winevt_subscribe_close_handle(VALUE self)
   TypedData_Get_Struct(
     self, struct WinevtSubscribe, &rb_winevt_subscribe_type, winevtSubscribe);
 
-  for (int i = 0; i < winevtSubscribe->count; i++) {
-    if (winevtSubscribe->hEvents[i] != NULL) {
-      EvtClose(winevtSubscribe->hEvents[i]);
-      winevtSubscribe->hEvents[i] = NULL;
-    }
-  }
+  close_event_handles(winevtSubscribe);
 
   return Qnil;
 }
@@ -469,12 +521,31 @@ rb_winevt_subscribe_each_yield(VALUE self)
   TypedData_Get_Struct(
     self, struct WinevtSubscribe, &rb_winevt_subscribe_type, winevtSubscribe);
 
-  for (int i = 0; i < winevtSubscribe->count; i++) {
-    rb_yield_values(3,
-                    rb_winevt_subscribe_render(self, winevtSubscribe->hEvents[i]),
-                    rb_winevt_subscribe_message(winevtSubscribe->hEvents[i], winevtSubscribe->localeInfo,
-                                                winevtSubscribe->remoteHandle),
-                    rb_winevt_subscribe_string_inserts(winevtSubscribe->hEvents[i]));
+  for (DWORD i = 0; i < winevtSubscribe->count; i++) {
+    DWORD fields = winevtSubscribe->fields;
+    VALUE event = Qnil;
+    VALUE message = Qnil;
+    VALUE stringInserts = Qnil;
+    ULONGLONG start;
+
+    if (!fields || (fields & (WINEVT_FIELD_XML | WINEVT_FIELD_SYSTEM))) {
+      event = rb_winevt_subscribe_render(self, winevtSubscribe->hEvents[i]);
+    }
+    if (!fields || (fields & WINEVT_FIELD_MESSAGE)) {
+      message = rb_winevt_subscribe_message(&winevtSubscribe->renderer,
+                                            winevtSubscribe->hEvents[i],
+                                            winevtSubscribe->localeInfo,
+                                            winevtSubscribe->remoteHandle);
+    }
+    if (!fields || (fields & WINEVT_FIELD_INSERTS)) {
+      stringInserts = rb_winevt_subscribe_string_inserts(&winevtSubscribe->renderer,
+                                                         winevtSubscribe->hEvents[i],
+                                                         winevtSubscribe->typedValues);
+    }
+    WINEVT_STATS_COUNT(&winevtSubscribe->renderer.stats, events, 1);
+    start = WINEVT_STATS_START(&winevtSubscribe->renderer.stats);
+    rb_yield_values(3, event, message, stringInserts);
+    WINEVT_STATS_ADD(&winevtSubscribe->renderer.stats, yieldNsec, start);
   }
 
   return Qnil;
@@ -503,6 +574,424 @@ rb_winevt_subscribe_each(VALUE self)
   return Qnil;
 }
 
+/* Arguments of rb_winevt_subscribe_each_batch_yield(). */
+struct WinevtSubscribeBatch
+{
+  VALUE self;
+  long max;
+  /* NULL unless format: :msgpack is given. */
+  struct WinevtMsgpackEncoder* msgpack;
+};
+
+static VALUE
+rb_winevt_subscribe_each_batch_yield(VALUE rb_batch)
+{
+  struct WinevtSubscribeBatch* batch = (struct WinevtSubscribeBatch*)rb_batch;
+  VALUE self = batch->self;
+  struct WinevtSubscribe* winevtSubscribe;
+  DWORD fields;
+  BOOL renderAsXML;
+
+  TypedData_Get_Struct(
+    self, struct WinevtSubscribe, &rb_winevt_subscribe_type, winevtSubscribe);
+
+  fields = winevtSubscribe->fields;
+  if (fields) {
+    renderAsXML = (fields & WINEVT_FIELD_XML) != 0;
+  } else {
+    renderAsXML = winevtSubscribe->renderAsXML;
+  }
+
+  for (long offset = 0; offset < (long)winevtSubscribe->count;) {
+    long count = (long)winevtSubscribe->count - offset;
+    VALUE columns[SYSTEM_EVENT_KEY_MAX];
+    ULONGLONG start;
+
+    if (batch->max > 0 && count > batch->max) {
+      count = batch->max;
+    }
+    if (batch->msgpack) {
+      for (long i = 0; i < count; i++) {
+        msgpack_encoder_append(batch->msgpack,
+                               &winevtSubscribe->renderer,
+                               winevtSubscribe->hEvents[offset + i],
+                               winevtSubscribe->localeInfo->langID,
+                               winevtSubscribe->remoteHandle);
+      }
+      offset += count;
+
+      WINEVT_STATS_COUNT(&winevtSubscribe->renderer.stats, events, count);
+      start = WINEVT_STATS_START(&winevtSubscribe->renderer.stats);
+      rb_yield(msgpack_encoder_flush(batch->msgpack));
+      WINEVT_STATS_ADD(&winevtSubscribe->renderer.stats, yieldNsec, start);
+      continue;
+    }
+    for (int i = 0; i < SYSTEM_EVENT_KEY_MAX; i++) {
+      columns[i] = Qnil;
+    }
+    if (renderAsXML && (!fields || (fields & WINEVT_FIELD_XML))) {
+      columns[SYSTEM_EVENT_KEY_XML] = rb_ary_new_capa(count);
+    }
+    if (!fields || (fields & WINEVT_FIELD_MESSAGE)) {
+      columns[SYSTEM_EVENT_KEY_MESSAGE] = rb_ary_new_capa(count);
+    }
+    if (!fields || (fields & WINEVT_FIELD_INSERTS)) {
+      columns[SYSTEM_EVENT_KEY_STRING_INSERTS] = rb_ary_new_capa(count);
+    }
+
+    for (long i = 0; i < count; i++) {
+      EVT_HANDLE event = winevtSubscribe->hEvents[offset + i];
+
+      if (renderAsXML) {
+        if (!fields || (fields & WINEVT_FIELD_XML)) {
+          rb_ary_push(columns[SYSTEM_EVENT_KEY_XML],
+                      render_xml_to_rb_str(&winevtSubscribe->renderer, event));
+        }
+      } else if (!fields || (fields & WINEVT_FIELD_SYSTEM)) {
+        append_system_event_columns(&winevtSubscribe->renderer,
+                                    event,
+                                    winevtSubscribe->preserveQualifiers,
+                                    winevtSubscribe->preserveSID,
+                                    winevtSubscribe->typedValues,
+                                    columns,
+                                    i,
+                                    count);
+      }
+      if (!fields || (fields & WINEVT_FIELD_MESSAGE)) {
+        rb_ary_push(columns[SYSTEM_EVENT_KEY_MESSAGE],
+                    rb_winevt_subscribe_message(&winevtSubscribe->renderer,
+                                            event,
+                                            winevtSubscribe->localeInfo,
+                                            winevtSubscribe->remoteHandle));
+      }
+      if (!fields || (fields & WINEVT_FIELD_INSERTS)) {
+        rb_ary_push(columns[SYSTEM_EVENT_KEY_STRING_INSERTS],
+                    rb_winevt_subscribe_string_inserts(&winevtSubscribe->renderer,
+                                                   event,
+                                                   winevtSubscribe->typedValues));
+      }
+    }
+    offset += count;
+
+    WINEVT_STATS_COUNT(&winevtSubscribe->renderer.stats, events, count);
+    start = WINEVT_STATS_START(&winevtSubscribe->renderer.stats);
+    rb_yield(batch_columns_to_rb_hash(columns, winevtSubscribe->symbolizeKeys));
+    WINEVT_STATS_ADD(&winevtSubscribe->renderer.stats, yieldNsec, start);
+  }
+
+  return Qnil;
+}
+
+static VALUE
+rb_winevt_subscribe_each_batch_body(VALUE rb_batch)
+{
+  struct WinevtSubscribeBatch* batch = (struct WinevtSubscribeBatch*)rb_batch;
+
+  while (rb_winevt_subscribe_next(batch->self)) {
+    rb_ensure(rb_winevt_subscribe_each_batch_yield,
+              rb_batch,
+              rb_winevt_subscribe_close_handle,
+              batch->self);
+  }
+
+  return Qnil;
+}
+
+static VALUE
+rb_winevt_subscribe_each_batch_ensure(VALUE rb_batch)
+{
+  struct WinevtSubscribeBatch* batch = (struct WinevtSubscribeBatch*)rb_batch;
+
+  if (batch->msgpack) {
+    msgpack_encoder_destroy(batch->msgpack);
+  }
+
+  return Qnil;
+}
+
+/*
+ * Enumerate to obtain Windows EventLog contents a batch at a time.
+ *
+ * This method yields a Hash of columns for each batch of events which
+ * EvtNext returns, so that the block is called once per batch instead
+ * of once per event. Each column is an Array with one element per
+ * event in the batch:
+ *
+ * - the system values such as "EventID" and "TimeCreated", which are
+ *   nil for events which do not have them and are omitted when no
+ *   event in the batch has them, unless XML is rendered
+ * - "XML" when XML is rendered
+ * - "Message" and "StringInserts"
+ *
+ * Columns follow fields, render_as_xml, symbolize_keys and
+ * typed_values as #each does.
+ *
+ * With format: :msgpack, a binary String of MessagePack is yielded
+ * instead. It has a map for each event in the batch, whose keys and
+ * values are those of the Hash #each yields, with "Message" and
+ * "StringInserts" besides, or "XML" when XML is rendered. The events
+ * are written into the String straight from the rendered values
+ * without making Ruby objects for them. Keys are always Strings and
+ * typed_values is not applied.
+ *
+ * @param max [Integer] The maximum number of events in a yielded
+ *   batch. Batches of EvtNext which have more events are yielded in
+ *   parts. By default, whole batches of EvtNext are yielded.
+ * @param format [Symbol] :columns, the default, or :msgpack.
+ * @yield (Hash) or (String) with format: :msgpack
+ * @since 0.12.0
+ */
+static VALUE
+rb_winevt_subscribe_each_batch(int argc, VALUE* argv, VALUE self)
+{
+  struct WinevtSubscribeBatch batch;
+  struct WinevtSubscribe* winevtSubscribe;
+  enum WinevtBatchFormat format;
+  VALUE rb_opts = Qnil;
+
+#ifdef RETURN_ENUMERATOR_KW
+  RETURN_ENUMERATOR_KW(self, argc, argv, RB_PASS_CALLED_KEYWORDS);
+#else
+  RETURN_ENUMERATOR(self, argc, argv);
+#endif /* RETURN_ENUMERATOR_KW */
+
+  rb_scan_args(argc, argv, "0:", &rb_opts);
+  get_batch_options(rb_opts, &batch.max, &format);
+
+  TypedData_Get_Struct(self, struct WinevtSubscribe, &rb_winevt_subscribe_type, winevtSubscribe);
+
+  batch.self = self;
+  batch.msgpack = NULL;
+  if (format == WINEVT_BATCH_FORMAT_MSGPACK) {
+    batch.msgpack = msgpack_encoder_create(winevtSubscribe->fields,
+                                           winevtSubscribe->renderAsXML,
+                                           winevtSubscribe->preserveQualifiers,
+                                           winevtSubscribe->preserveSID);
+  }
+  rb_ensure(rb_winevt_subscribe_each_batch_body,
+            (VALUE)&batch,
+            rb_winevt_subscribe_each_batch_ensure,
+            (VALUE)&batch);
+
+  return Qnil;
+}
+
+/* Arguments of rb_winevt_subscribe_write_arrow_body(). */
+struct WinevtSubscribeArrow
+{
+  VALUE self;
+  VALUE io;
+  long rows;
+  long events;
+  struct WinevtArrowEncoder* encoder;
+};
+
+static VALUE
+rb_winevt_subscribe_write_arrow_batch(VALUE rb_arrow)
+{
+  struct WinevtSubscribeArrow* arrow = (struct WinevtSubscribeArrow*)rb_arrow;
+  VALUE self = arrow->self;
+  struct WinevtSubscribe* winevtSubscribe;
+
+  TypedData_Get_Struct(
+    self, struct WinevtSubscribe, &rb_winevt_subscribe_type, winevtSubscribe);
+
+  for (ULONG i = 0; i < winevtSubscribe->count; i++) {
+    arrow_encoder_append(arrow->encoder,
+                         &winevtSubscribe->renderer,
+                         winevtSubscribe->hEvents[i],
+                         winevtSubscribe->localeInfo->langID,
+                         winevtSubscribe->remoteHandle);
+    arrow->events++;
+    if (arrow->rows > 0 && arrow_encoder_get_length(arrow->encoder) >= arrow->rows) {
+      rb_io_write(arrow->io, arrow_encoder_flush(arrow->encoder));
+    }
+  }
+  WINEVT_STATS_COUNT(&winevtSubscribe->renderer.stats, events, winevtSubscribe->count);
+  if (arrow->rows == 0) {
+    rb_io_write(arrow->io, arrow_encoder_flush(arrow->encoder));
+  }
+
+  return Qnil;
+}
+
+static VALUE
+rb_winevt_subscribe_write_arrow_body(VALUE rb_arrow)
+{
+  struct WinevtSubscribeArrow* arrow = (struct WinevtSubscribeArrow*)rb_arrow;
+
+  while (rb_winevt_subscribe_next(arrow->self)) {
+    rb_ensure(rb_winevt_subscribe_write_arrow_batch,
+              rb_arrow,
+              rb_winevt_subscribe_close_handle,
+              arrow->self);
+  }
+  rb_io_write(arrow->io, arrow_encoder_finish(arrow->encoder));
+
+  return Qnil;
+}
+
+static VALUE
+rb_winevt_subscribe_write_arrow_ensure(VALUE rb_arrow)
+{
+  struct WinevtSubscribeArrow* arrow = (struct WinevtSubscribeArrow*)rb_arrow;
+
+  arrow_encoder_destroy(arrow->encoder);
+
+  return Qnil;
+}
+
+/*
+ * Write events to io in the Apache Arrow IPC streaming format.
+ *
+ * The stream has a schema and record batches whose columns are the
+ * system values, "XML", "Message" and "StringInserts" as #each_batch
+ * yields them, except that the system values are typed: EventID and
+ * the other numbers are unsigned integers, TimeCreated is a timestamp
+ * in nanoseconds in UTC and Keywords and EventRecordID are 64-bit
+ * integers. "StringInserts" is a list of strings, with insert values
+ * which are not strings converted with to_s. Columns follow fields,
+ * render_as_xml, preserve_qualifiers and preserve_sid.
+ *
+ * The events are rendered into the columns without making Ruby
+ * objects for them, and each record batch is written with io.write.
+ *
+ * @param io [IO] The IO to write to, which only needs #write.
+ * @param rows [Integer] The number of events in a record batch. The
+ *   last record batch may have fewer events. By default, a record
+ *   batch is written for each batch of EvtNext.
+ * @return [Integer] The number of written events.
+ * @since 0.12.0
+ */
+static VALUE
+rb_winevt_subscribe_write_arrow(int argc, VALUE* argv, VALUE self)
+{
+  struct WinevtSubscribeArrow arrow;
+  struct WinevtSubscribe* winevtSubscribe;
+  VALUE rb_io, rb_opts = Qnil;
+
+  rb_scan_args(argc, argv, "1:", &rb_io, &rb_opts);
+
+  TypedData_Get_Struct(
+    self, struct WinevtSubscribe, &rb_winevt_subscribe_type, winevtSubscribe);
+
+  arrow.self = self;
+  arrow.io = rb_io;
+  arrow.rows = get_count_option(rb_opts, "rows");
+  arrow.events = 0;
+  arrow.encoder = arrow_encoder_create(winevtSubscribe->fields,
+                                       winevtSubscribe->renderAsXML,
+                                       winevtSubscribe->preserveQualifiers,
+                                       winevtSubscribe->preserveSID);
+  rb_ensure(rb_winevt_subscribe_write_arrow_body,
+            (VALUE)&arrow,
+            rb_winevt_subscribe_write_arrow_ensure,
+            (VALUE)&arrow);
+
+  return LONG2NUM(arrow.events);
+}
+
+/* Arguments of rb_winevt_subscribe_write_json_body(). */
+struct WinevtSubscribeJson
+{
+  VALUE self;
+  VALUE io;
+  long events;
+  struct WinevtJsonEncoder* encoder;
+};
+
+static VALUE
+rb_winevt_subscribe_write_json_batch(VALUE rb_json)
+{
+  struct WinevtSubscribeJson* json = (struct WinevtSubscribeJson*)rb_json;
+  VALUE self = json->self;
+  struct WinevtSubscribe* winevtSubscribe;
+
+  TypedData_Get_Struct(
+    self, struct WinevtSubscribe, &rb_winevt_subscribe_type, winevtSubscribe);
+
+  for (ULONG i = 0; i < winevtSubscribe->count; i++) {
+    json_encoder_append(json->encoder,
+                        &winevtSubscribe->renderer,
+                        winevtSubscribe->hEvents[i],
+                        winevtSubscribe->localeInfo->langID,
+                        winevtSubscribe->remoteHandle);
+  }
+  json->events += winevtSubscribe->count;
+  WINEVT_STATS_COUNT(&winevtSubscribe->renderer.stats, events, winevtSubscribe->count);
+  json_encoder_flush(json->encoder, json->io);
+
+  return Qnil;
+}
+
+static VALUE
+rb_winevt_subscribe_write_json_body(VALUE rb_json)
+{
+  struct WinevtSubscribeJson* json = (struct WinevtSubscribeJson*)rb_json;
+
+  while (rb_winevt_subscribe_next(json->self)) {
+    rb_ensure(rb_winevt_subscribe_write_json_batch,
+              rb_json,
+              rb_winevt_subscribe_close_handle,
+              json->self);
+  }
+
+  return Qnil;
+}
+
+static VALUE
+rb_winevt_subscribe_write_json_ensure(VALUE rb_json)
+{
+  struct WinevtSubscribeJson* json = (struct WinevtSubscribeJson*)rb_json;
+
+  json_encoder_destroy(json->encoder);
+
+  return Qnil;
+}
+
+/*
+ * Write events to io as JSON lines.
+ *
+ * Each event is a JSON object on a line, whose members are the keys
+ * and values of the Hash #each yields, with "Message" and
+ * "StringInserts" besides, or "XML" when XML is rendered. Members
+ * follow fields, render_as_xml, preserve_qualifiers and preserve_sid;
+ * typed_values is not applied.
+ *
+ * The events of a batch of EvtNext are rendered into a native buffer,
+ * which is reused for every batch, with strings escaped from UTF-16
+ * directly. The lines of a batch are written with a single io.write,
+ * so that no Hash is made for the events and no JSON generator is
+ * needed.
+ *
+ * @param io [IO] The IO to write to, which only needs #write.
+ * @return [Integer] The number of written events.
+ * @since 0.12.0
+ */
+static VALUE
+rb_winevt_subscribe_write_json(VALUE self, VALUE rb_io)
+{
+  struct WinevtSubscribeJson json;
+  struct WinevtSubscribe* winevtSubscribe;
+
+  TypedData_Get_Struct(
+    self, struct WinevtSubscribe, &rb_winevt_subscribe_type, winevtSubscribe);
+
+  json.self = self;
+  json.io = rb_io;
+  json.events = 0;
+  json.encoder = json_encoder_create(winevtSubscribe->fields,
+                                     winevtSubscribe->renderAsXML,
+                                     winevtSubscribe->preserveQualifiers,
+                                     winevtSubscribe->preserveSID);
+  rb_ensure(rb_winevt_subscribe_write_json_body,
+            (VALUE)&json,
+            rb_winevt_subscribe_write_json_ensure,
+            (VALUE)&json);
+
+  return LONG2NUM(json.events);
+}
+
 /*
  * This method renders bookmark content which is related to Subscribe class instance.
  *
@@ -553,7 +1042,7 @@ rb_winevt_subscribe_set_rate_limit(VALUE self, VALUE rb_rate_limit)
 
   rateLimit = NUM2LONG(rb_rate_limit);
 
-  if ((rateLimit != SUBSCRIBE_RATE_INFINITE) && (rateLimit < 10 || rateLimit % 10)) {
+  if ((rateLimit != (DWORD)SUBSCRIBE_RATE_INFINITE) && (rateLimit < 10 || rateLimit % 10)) {
     rb_raise(rb_eArgError, "Specify a multiples of 10 or RATE_INFINITE constant");
   } else {
     winevtSubscribe->rateLimit = rateLimit;
@@ -711,70 +1200,552 @@ rb_winevt_subscribe_preserve_sid_p(VALUE self)
 }
 
 /*
- * This method cancels channel subscription.
+ * This method specifies whether keys of rendered system event hashes
+ * are Symbols or not. By default, they are frozen Strings.
  *
- * @return [Boolean]
- * @since 0.9.1
+ * @param rb_symbolize_keys_p [Boolean]
+ * @since 0.12.0
  */
 static VALUE
-rb_winevt_subscribe_cancel(VALUE self)
+rb_winevt_subscribe_set_symbolize_keys(VALUE self, VALUE rb_symbolize_keys_p)
 {
   struct WinevtSubscribe* winevtSubscribe;
-  BOOL result = FALSE;
 
   TypedData_Get_Struct(
     self, struct WinevtSubscribe, &rb_winevt_subscribe_type, winevtSubscribe);
 
-  if (winevtSubscribe->subscription) {
-    result = EvtCancel(winevtSubscribe->subscription);
-  }
+  winevtSubscribe->symbolizeKeys = RTEST(rb_symbolize_keys_p);
 
-  if (result) {
-    return Qtrue;
-  } else {
-    return Qfalse;
-  }
+  return Qnil;
 }
 
 /*
- * This method closes channel handles forcibly.
+ * This method returns whether keys of rendered system event hashes
+ * are Symbols or not.
  *
- * @since 0.9.1
+ * @return [Boolean]
+ * @since 0.12.0
  */
 static VALUE
-rb_winevt_subscribe_close(VALUE self)
+rb_winevt_subscribe_symbolize_keys_p(VALUE self)
 {
   struct WinevtSubscribe* winevtSubscribe;
 
   TypedData_Get_Struct(
     self, struct WinevtSubscribe, &rb_winevt_subscribe_type, winevtSubscribe);
 
-  close_handles(winevtSubscribe);
+  return winevtSubscribe->symbolizeKeys ? Qtrue : Qfalse;
+}
+
+/*
+ * This method specifies whether values are yielded as Ruby objects of
+ * their types instead of formatted Strings. With it, FileTime and
+ * SysTime values become Time in UTC, Single and Double become Float,
+ * HexInt32 and HexInt64 become Integer and Binary becomes an
+ * ASCII-8BIT String of the raw bytes. This applies to string inserts,
+ * and to TimeCreated, Keywords and EventRecordID of rendered system
+ * event hashes.
+ *
+ * @param rb_typed_values_p [Boolean]
+ * @since 0.12.0
+ */
+static VALUE
+rb_winevt_subscribe_set_typed_values(VALUE self, VALUE rb_typed_values_p)
+{
+  struct WinevtSubscribe* winevtSubscribe;
+
+  TypedData_Get_Struct(
+    self, struct WinevtSubscribe, &rb_winevt_subscribe_type, winevtSubscribe);
+
+  winevtSubscribe->typedValues = RTEST(rb_typed_values_p);
 
   return Qnil;
 }
 
+/*
+ * This method returns whether values are yielded as Ruby objects of
+ * their types or not.
+ *
+ * @return [Boolean]
+ * @since 0.12.0
+ */
+static VALUE
+rb_winevt_subscribe_typed_values_p(VALUE self)
+{
+  struct WinevtSubscribe* winevtSubscribe;
+
+  TypedData_Get_Struct(
+    self, struct WinevtSubscribe, &rb_winevt_subscribe_type, winevtSubscribe);
 
-void
-Init_winevt_subscribe(VALUE rb_cEventLog)
+  return winevtSubscribe->typedValues ? Qtrue : Qfalse;
+}
+
+/*
+ * This method specifies which parts of events are computed by #each.
+ * Parts which are not specified are yielded as nil. nil restores the
+ * default, which computes all parts.
+ *
+ * @example Skip formatting messages and rendering string inserts
+ *   subscribe.fields = [:xml]
+ * @param rb_fields [Array<Symbol>, nil] :xml or :system, :message and :inserts
+ * @raise ArgumentError
+ * @since 0.12.0
+ */
+static VALUE
+rb_winevt_subscribe_set_fields(VALUE self, VALUE rb_fields)
 {
-  rb_cSubscribe = rb_define_class_under(rb_cEventLog, "Subscribe", rb_cObject);
+  struct WinevtSubscribe* winevtSubscribe;
 
-  rb_define_alloc_func(rb_cSubscribe, rb_winevt_subscribe_alloc);
+  TypedData_Get_Struct(
+    self, struct WinevtSubscribe, &rb_winevt_subscribe_type, winevtSubscribe);
 
-  /*
-   * For Subscribe#rate_limit=. It represents unspecified rate limit.
-   * @since 0.6.0
-   */
-  rb_define_const(rb_cSubscribe, "RATE_INFINITE", SUBSCRIBE_RATE_INFINITE);
+  winevtSubscribe->fields = get_fields_from_rb_ary(rb_fields);
 
-  rb_define_method(rb_cSubscribe, "initialize", rb_winevt_subscribe_initialize, 0);
-  rb_define_method(rb_cSubscribe, "subscribe", rb_winevt_subscribe_subscribe, -1);
-  rb_define_method(rb_cSubscribe, "next", rb_winevt_subscribe_next, 0);
-  rb_define_method(rb_cSubscribe, "each", rb_winevt_subscribe_each, 0);
-  rb_define_method(rb_cSubscribe, "bookmark", rb_winevt_subscribe_get_bookmark, 0);
-  /*
-   * @since 0.7.0
+  return Qnil;
+}
+
+/*
+ * This method returns which parts of events are computed by #each.
+ *
+ * @return [Array<Symbol>, nil]
+ * @since 0.12.0
+ */
+static VALUE
+rb_winevt_subscribe_get_fields(VALUE self)
+{
+  struct WinevtSubscribe* winevtSubscribe;
+
+  TypedData_Get_Struct(
+    self, struct WinevtSubscribe, &rb_winevt_subscribe_type, winevtSubscribe);
+
+  return fields_to_rb_ary(winevtSubscribe->fields);
+}
+
+/*
+ * This method specifies the number of publisher metadata handles
+ * which are kept open for formatting messages. 0 disables caching.
+ *
+ * @since 0.12.0
+ * @param rb_capacity [Integer]
+ */
+static VALUE
+rb_winevt_subscribe_set_publisher_cache_capacity(VALUE self, VALUE rb_capacity)
+{
+  struct WinevtSubscribe* winevtSubscribe;
+  long capacity;
+
+  TypedData_Get_Struct(
+    self, struct WinevtSubscribe, &rb_winevt_subscribe_type, winevtSubscribe);
+
+  capacity = NUM2LONG(rb_capacity);
+  if (capacity < 0) {
+    rb_raise(rb_eArgError, "Specify 0 or a positive capacity");
+  }
+
+  publisher_cache_set_capacity(renderer_publisher_cache(&winevtSubscribe->renderer),
+                               (size_t)capacity);
+
+  return Qnil;
+}
+
+/*
+ * This method returns the capacity of the publisher metadata cache.
+ *
+ * @since 0.12.0
+ * @return [Integer]
+ */
+static VALUE
+rb_winevt_subscribe_get_publisher_cache_capacity(VALUE self)
+{
+  struct WinevtSubscribe* winevtSubscribe;
+
+  TypedData_Get_Struct(
+    self, struct WinevtSubscribe, &rb_winevt_subscribe_type, winevtSubscribe);
+
+  return SIZET2NUM(
+    publisher_cache_get_capacity(renderer_publisher_cache(&winevtSubscribe->renderer)));
+}
+
+/*
+ * This method returns hits, misses, evictions, size and capacity of
+ * the publisher metadata cache.
+ *
+ * @since 0.12.0
+ * @return [Hash]
+ */
+static VALUE
+rb_winevt_subscribe_publisher_cache_stats(VALUE self)
+{
+  struct WinevtSubscribe* winevtSubscribe;
+
+  TypedData_Get_Struct(
+    self, struct WinevtSubscribe, &rb_winevt_subscribe_type, winevtSubscribe);
+
+  return publisher_cache_stats(renderer_publisher_cache(&winevtSubscribe->renderer));
+}
+
+/*
+ * This method specifies the maximum number of SIDs which are kept
+ * in the SID to account name cache. 0 disables caching.
+ *
+ * @since 0.12.0
+ * @param rb_capacity [Integer]
+ */
+static VALUE
+rb_winevt_subscribe_set_sid_cache_capacity(VALUE self, VALUE rb_capacity)
+{
+  struct WinevtSubscribe* winevtSubscribe;
+  long capacity;
+
+  TypedData_Get_Struct(
+    self, struct WinevtSubscribe, &rb_winevt_subscribe_type, winevtSubscribe);
+
+  capacity = NUM2LONG(rb_capacity);
+  if (capacity < 0) {
+    rb_raise(rb_eArgError, "Specify 0 or a positive capacity");
+  }
+
+  sid_cache_set_capacity(renderer_sid_cache(&winevtSubscribe->renderer),
+                         (size_t)capacity);
+
+  return Qnil;
+}
+
+/*
+ * This method returns the capacity of the SID to account name cache.
+ *
+ * @since 0.12.0
+ * @return [Integer]
+ */
+static VALUE
+rb_winevt_subscribe_get_sid_cache_capacity(VALUE self)
+{
+  struct WinevtSubscribe* winevtSubscribe;
+
+  TypedData_Get_Struct(
+    self, struct WinevtSubscribe, &rb_winevt_subscribe_type, winevtSubscribe);
+
+  return SIZET2NUM(
+    sid_cache_get_capacity(renderer_sid_cache(&winevtSubscribe->renderer)));
+}
+
+/*
+ * This method specifies how long resolved account names are cached
+ * in seconds.
+ *
+ * @since 0.12.0
+ * @param rb_ttl [Integer]
+ */
+static VALUE
+rb_winevt_subscribe_set_sid_cache_ttl(VALUE self, VALUE rb_ttl)
+{
+  struct WinevtSubscribe* winevtSubscribe;
+  long ttl;
+
+  TypedData_Get_Struct(
+    self, struct WinevtSubscribe, &rb_winevt_subscribe_type, winevtSubscribe);
+
+  ttl = NUM2LONG(rb_ttl);
+  if (ttl < 0) {
+    rb_raise(rb_eArgError, "Specify 0 or a positive TTL");
+  }
+
+  sid_cache_set_ttl(renderer_sid_cache(&winevtSubscribe->renderer), (ULONGLONG)ttl);
+
+  return Qnil;
+}
+
+/*
+ * This method returns how long resolved account names are cached in
+ * seconds.
+ *
+ * @since 0.12.0
+ * @return [Integer]
+ */
+static VALUE
+rb_winevt_subscribe_get_sid_cache_ttl(VALUE self)
+{
+  struct WinevtSubscribe* winevtSubscribe;
+
+  TypedData_Get_Struct(
+    self, struct WinevtSubscribe, &rb_winevt_subscribe_type, winevtSubscribe);
+
+  return ULL2NUM(sid_cache_get_ttl(renderer_sid_cache(&winevtSubscribe->renderer)));
+}
+
+/*
+ * This method specifies how long unresolvable SIDs are remembered in
+ * seconds.
+ *
+ * @since 0.12.0
+ * @param rb_ttl [Integer]
+ */
+static VALUE
+rb_winevt_subscribe_set_sid_cache_negative_ttl(VALUE self, VALUE rb_ttl)
+{
+  struct WinevtSubscribe* winevtSubscribe;
+  long ttl;
+
+  TypedData_Get_Struct(
+    self, struct WinevtSubscribe, &rb_winevt_subscribe_type, winevtSubscribe);
+
+  ttl = NUM2LONG(rb_ttl);
+  if (ttl < 0) {
+    rb_raise(rb_eArgError, "Specify 0 or a positive TTL");
+  }
+
+  sid_cache_set_negative_ttl(renderer_sid_cache(&winevtSubscribe->renderer),
+                             (ULONGLONG)ttl);
+
+  return Qnil;
+}
+
+/*
+ * This method returns how long unresolvable SIDs are remembered in
+ * seconds.
+ *
+ * @since 0.12.0
+ * @return [Integer]
+ */
+static VALUE
+rb_winevt_subscribe_get_sid_cache_negative_ttl(VALUE self)
+{
+  struct WinevtSubscribe* winevtSubscribe;
+
+  TypedData_Get_Struct(
+    self, struct WinevtSubscribe, &rb_winevt_subscribe_type, winevtSubscribe);
+
+  return ULL2NUM(
+    sid_cache_get_negative_ttl(renderer_sid_cache(&winevtSubscribe->renderer)));
+}
+
+/*
+ * This method returns hits, negative hits, misses, evictions,
+ * expirations, size, capacity and hit rate of the SID to account name
+ * cache.
+ *
+ * @since 0.12.0
+ * @return [Hash]
+ */
+static VALUE
+rb_winevt_subscribe_sid_cache_stats(VALUE self)
+{
+  struct WinevtSubscribe* winevtSubscribe;
+
+  TypedData_Get_Struct(
+    self, struct WinevtSubscribe, &rb_winevt_subscribe_type, winevtSubscribe);
+
+  return sid_cache_stats(renderer_sid_cache(&winevtSubscribe->renderer));
+}
+
+/*
+ * This method specifies how many event handles are requested by a
+ * single EvtNext call.
+ *
+ * @since 0.12.0
+ * @param rb_batch_size [Integer] 1 up to 1024
+ */
+static VALUE
+rb_winevt_subscribe_set_batch_size(VALUE self, VALUE rb_batch_size)
+{
+  struct WinevtSubscribe* winevtSubscribe;
+  long batchSize;
+
+  TypedData_Get_Struct(
+    self, struct WinevtSubscribe, &rb_winevt_subscribe_type, winevtSubscribe);
+
+  batchSize = NUM2LONG(rb_batch_size);
+  if (batchSize < 1 || batchSize > SUBSCRIBE_ARRAY_MAX_SIZE) {
+    rb_raise(rb_eArgError, "Specify a batch size between 1 and %d", SUBSCRIBE_ARRAY_MAX_SIZE);
+  }
+
+  /* Handles which do not fit into the new array cannot be rendered
+   * anymore. */
+  for (DWORD i = batchSize; i < winevtSubscribe->count; i++) {
+    if (winevtSubscribe->hEvents[i]) {
+      winevt_backend->close(winevtSubscribe->hEvents[i]);
+      winevtSubscribe->hEvents[i] = NULL;
+    }
+  }
+  if (winevtSubscribe->count > (DWORD)batchSize) {
+    winevtSubscribe->count = batchSize;
+  }
+
+  REALLOC_N(winevtSubscribe->hEvents, EVT_HANDLE, batchSize);
+  for (DWORD i = winevtSubscribe->count; i < (DWORD)batchSize; i++) {
+    winevtSubscribe->hEvents[i] = NULL;
+  }
+  winevtSubscribe->batchSize = batchSize;
+
+  return Qnil;
+}
+
+/*
+ * This method returns how many event handles are requested by a
+ * single EvtNext call.
+ *
+ * @since 0.12.0
+ * @return [Integer]
+ */
+static VALUE
+rb_winevt_subscribe_get_batch_size(VALUE self)
+{
+  struct WinevtSubscribe* winevtSubscribe;
+
+  TypedData_Get_Struct(
+    self, struct WinevtSubscribe, &rb_winevt_subscribe_type, winevtSubscribe);
+
+  return ULONG2NUM(winevtSubscribe->batchSize);
+}
+
+/*
+ * This method specifies whether the time spent in EvtNext, EvtRender,
+ * EvtFormatMessage, SID lookups and the block of #each is collected
+ * into #stats. It is disabled by default.
+ *
+ * @since 0.12.0
+ * @param rb_collect_stats [Boolean]
+ */
+static VALUE
+rb_winevt_subscribe_set_collect_stats(VALUE self, VALUE rb_collect_stats)
+{
+  struct WinevtSubscribe* winevtSubscribe;
+
+  TypedData_Get_Struct(
+    self, struct WinevtSubscribe, &rb_winevt_subscribe_type, winevtSubscribe);
+
+  winevtSubscribe->renderer.stats.enabled = RTEST(rb_collect_stats);
+
+  return Qnil;
+}
+
+/*
+ * This method returns whether #stats are collected or not.
+ *
+ * @since 0.12.0
+ * @return [Boolean]
+ */
+static VALUE
+rb_winevt_subscribe_collect_stats_p(VALUE self)
+{
+  struct WinevtSubscribe* winevtSubscribe;
+
+  TypedData_Get_Struct(
+    self, struct WinevtSubscribe, &rb_winevt_subscribe_type, winevtSubscribe);
+
+  return winevtSubscribe->renderer.stats.enabled ? Qtrue : Qfalse;
+}
+
+/*
+ * This method returns the counters which are collected while
+ * #collect_stats is enabled: "events", "batches", "rendered_bytes"
+ * and the nanoseconds spent in each stage ("next_nsec", "render_nsec",
+ * "format_message_nsec", "sid_lookup_nsec" and "yield_nsec"). The
+ * statistics of the publisher and SID caches are included as well.
+ *
+ * @since 0.12.0
+ * @return [Hash]
+ */
+static VALUE
+rb_winevt_subscribe_stats(VALUE self)
+{
+  struct WinevtSubscribe* winevtSubscribe;
+
+  TypedData_Get_Struct(
+    self, struct WinevtSubscribe, &rb_winevt_subscribe_type, winevtSubscribe);
+
+  return winevt_stats_to_hash(&winevtSubscribe->renderer);
+}
+
+/*
+ * This method resets the counters of #stats.
+ *
+ * @since 0.12.0
+ */
+static VALUE
+rb_winevt_subscribe_reset_stats(VALUE self)
+{
+  struct WinevtSubscribe* winevtSubscribe;
+
+  TypedData_Get_Struct(
+    self, struct WinevtSubscribe, &rb_winevt_subscribe_type, winevtSubscribe);
+
+  winevt_stats_reset(&winevtSubscribe->renderer.stats);
+
+  return Qnil;
+}
+
+/*
+ * This method cancels channel subscription.
+ *
+ * @return [Boolean]
+ * @since 0.9.1
+ */
+static VALUE
+rb_winevt_subscribe_cancel(VALUE self)
+{
+  struct WinevtSubscribe* winevtSubscribe;
+  BOOL result = FALSE;
+
+  TypedData_Get_Struct(
+    self, struct WinevtSubscribe, &rb_winevt_subscribe_type, winevtSubscribe);
+
+  if (winevtSubscribe->subscription) {
+    result = winevt_backend->cancel(winevtSubscribe->subscription);
+  }
+
+  if (result) {
+    return Qtrue;
+  } else {
+    return Qfalse;
+  }
+}
+
+/*
+ * This method closes channel handles forcibly.
+ *
+ * @since 0.9.1
+ */
+static VALUE
+rb_winevt_subscribe_close(VALUE self)
+{
+  struct WinevtSubscribe* winevtSubscribe;
+
+  TypedData_Get_Struct(
+    self, struct WinevtSubscribe, &rb_winevt_subscribe_type, winevtSubscribe);
+
+  close_handles(winevtSubscribe);
+
+  return Qnil;
+}
+
+
+void
+Init_winevt_subscribe(VALUE rb_cEventLog)
+{
+  rb_cSubscribe = rb_define_class_under(rb_cEventLog, "Subscribe", rb_cObject);
+
+  rb_define_alloc_func(rb_cSubscribe, rb_winevt_subscribe_alloc);
+
+  /*
+   * For Subscribe#rate_limit=. It represents unspecified rate limit.
+   * @since 0.6.0
+   */
+  rb_define_const(rb_cSubscribe, "RATE_INFINITE", SUBSCRIBE_RATE_INFINITE);
+
+  rb_define_method(rb_cSubscribe, "initialize", rb_winevt_subscribe_initialize, 0);
+  rb_define_method(rb_cSubscribe, "subscribe", rb_winevt_subscribe_subscribe, -1);
+  rb_define_method(rb_cSubscribe, "next", rb_winevt_subscribe_next, 0);
+  rb_define_method(rb_cSubscribe, "each", rb_winevt_subscribe_each, 0);
+  /* @since 0.12.0 */
+  rb_define_method(rb_cSubscribe, "each_batch", rb_winevt_subscribe_each_batch, -1);
+  /* @since 0.12.0 */
+  rb_define_method(rb_cSubscribe, "write_arrow", rb_winevt_subscribe_write_arrow, -1);
+  /* @since 0.12.0 */
+  rb_define_method(rb_cSubscribe, "write_json", rb_winevt_subscribe_write_json, 1);
+  rb_define_method(rb_cSubscribe, "bookmark", rb_winevt_subscribe_get_bookmark, 0);
+  /*
+   * @since 0.7.0
    */
   rb_define_method(rb_cSubscribe, "read_existing_events?", rb_winevt_subscribe_read_existing_events_p, 0);
   /*
@@ -815,6 +1786,94 @@ Init_winevt_subscribe(VALUE rb_cEventLog)
    * @since 0.11.0
    */
   rb_define_method(rb_cSubscribe, "preserve_sid=", rb_winevt_subscribe_set_preserve_sid, 1);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cSubscribe, "symbolize_keys?", rb_winevt_subscribe_symbolize_keys_p, 0);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cSubscribe, "symbolize_keys=", rb_winevt_subscribe_set_symbolize_keys, 1);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cSubscribe, "typed_values?", rb_winevt_subscribe_typed_values_p, 0);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cSubscribe, "typed_values=", rb_winevt_subscribe_set_typed_values, 1);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cSubscribe, "fields", rb_winevt_subscribe_get_fields, 0);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cSubscribe, "fields=", rb_winevt_subscribe_set_fields, 1);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cSubscribe, "publisher_cache_capacity", rb_winevt_subscribe_get_publisher_cache_capacity, 0);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cSubscribe, "publisher_cache_capacity=", rb_winevt_subscribe_set_publisher_cache_capacity, 1);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cSubscribe, "publisher_cache_stats", rb_winevt_subscribe_publisher_cache_stats, 0);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cSubscribe, "sid_cache_capacity", rb_winevt_subscribe_get_sid_cache_capacity, 0);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cSubscribe, "sid_cache_capacity=", rb_winevt_subscribe_set_sid_cache_capacity, 1);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cSubscribe, "sid_cache_ttl", rb_winevt_subscribe_get_sid_cache_ttl, 0);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cSubscribe, "sid_cache_ttl=", rb_winevt_subscribe_set_sid_cache_ttl, 1);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cSubscribe, "sid_cache_negative_ttl", rb_winevt_subscribe_get_sid_cache_negative_ttl, 0);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cSubscribe, "sid_cache_negative_ttl=", rb_winevt_subscribe_set_sid_cache_negative_ttl, 1);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cSubscribe, "sid_cache_stats", rb_winevt_subscribe_sid_cache_stats, 0);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cSubscribe, "batch_size", rb_winevt_subscribe_get_batch_size, 0);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cSubscribe, "batch_size=", rb_winevt_subscribe_set_batch_size, 1);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cSubscribe, "collect_stats?", rb_winevt_subscribe_collect_stats_p, 0);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cSubscribe, "collect_stats=", rb_winevt_subscribe_set_collect_stats, 1);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cSubscribe, "stats", rb_winevt_subscribe_stats, 0);
+  /*
+   * @since 0.12.0
+   */
+  rb_define_method(rb_cSubscribe, "reset_stats", rb_winevt_subscribe_reset_stats, 0);
   /*
    * @since 0.9.1
    */
@@ -0,0 +1,64 @@
+#include <winevt_system_keys.h>
+
+static const char* const systemEventKeyNames[SYSTEM_EVENT_KEY_MAX] = {
+  "ProviderName",
+  "ProviderGuid",
+  "Qualifiers",
+  "EventID",
+  "Version",
+  "Level",
+  "Task",
+  "Opcode",
+  "Keywords",
+  "TimeCreated",
+  "EventRecordID",
+  "ActivityID",
+  "RelatedActivityID",
+  "ProcessID",
+  "ThreadID",
+  "Channel",
+  "Computer",
+  "UserID",
+  "User",
+  "EventData",
+  "UserData",
+  "XML",
+  "Message",
+  "StringInserts",
+};
+
+static VALUE systemEventStringKeys[SYSTEM_EVENT_KEY_MAX];
+static VALUE systemEventSymbolKeys[SYSTEM_EVENT_KEY_MAX];
+
+/*
+ * Hash keys of rendered system events are the same for every event.
+ * They are created once as frozen (and interned when possible)
+ * strings, so rb_hash_aset neither allocates nor dups them.
+ */
+void
+init_system_event_keys(void)
+{
+  int i;
+
+  for (i = 0; i < SYSTEM_EVENT_KEY_MAX; i++) {
+#ifdef HAVE_RB_INTERNED_STR_CSTR
+    systemEventStringKeys[i] = rb_interned_str_cstr(systemEventKeyNames[i]);
+#else
+    systemEventStringKeys[i] = rb_obj_freeze(rb_str_new_cstr(systemEventKeyNames[i]));
+#endif /* HAVE_RB_INTERNED_STR_CSTR */
+    rb_gc_register_mark_object(systemEventStringKeys[i]);
+    systemEventSymbolKeys[i] = ID2SYM(rb_intern(systemEventKeyNames[i]));
+  }
+}
+
+const VALUE*
+get_system_event_keys(int symbolize)
+{
+  return symbolize ? systemEventSymbolKeys : systemEventStringKeys;
+}
+
+const char*
+get_system_event_key_name(enum SystemEventKey key)
+{
+  return systemEventKeyNames[key];
+}
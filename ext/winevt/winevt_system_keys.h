@@ -0,0 +1,54 @@
+#ifndef _WINEVT_SYSTEM_KEYS_H_
+#define _WINEVT_SYSTEM_KEYS_H_
+
+/*
+ * Keys of system event hashes and of the column hashes which
+ * #each_batch yields. This header does not depend on Windows
+ * headers because EVTX files are rendered on other platforms, too.
+ */
+
+#include <ruby.h>
+
+enum SystemEventKey
+{
+  SYSTEM_EVENT_KEY_PROVIDER_NAME,
+  SYSTEM_EVENT_KEY_PROVIDER_GUID,
+  SYSTEM_EVENT_KEY_QUALIFIERS,
+  SYSTEM_EVENT_KEY_EVENT_ID,
+  SYSTEM_EVENT_KEY_VERSION,
+  SYSTEM_EVENT_KEY_LEVEL,
+  SYSTEM_EVENT_KEY_TASK,
+  SYSTEM_EVENT_KEY_OPCODE,
+  SYSTEM_EVENT_KEY_KEYWORDS,
+  SYSTEM_EVENT_KEY_TIME_CREATED,
+  SYSTEM_EVENT_KEY_EVENT_RECORD_ID,
+  SYSTEM_EVENT_KEY_ACTIVITY_ID,
+  SYSTEM_EVENT_KEY_RELATED_ACTIVITY_ID,
+  SYSTEM_EVENT_KEY_PROCESS_ID,
+  SYSTEM_EVENT_KEY_THREAD_ID,
+  SYSTEM_EVENT_KEY_CHANNEL,
+  SYSTEM_EVENT_KEY_COMPUTER,
+  SYSTEM_EVENT_KEY_USER_ID,
+  SYSTEM_EVENT_KEY_USER,
+  SYSTEM_EVENT_KEY_EVENT_DATA,
+  SYSTEM_EVENT_KEY_USER_DATA,
+  /* Columns of batches besides the system values. */
+  SYSTEM_EVENT_KEY_XML,
+  SYSTEM_EVENT_KEY_MESSAGE,
+  SYSTEM_EVENT_KEY_STRING_INSERTS,
+  SYSTEM_EVENT_KEY_MAX
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+void init_system_event_keys(void);
+const VALUE* get_system_event_keys(int symbolize);
+const char* get_system_event_key_name(enum SystemEventKey key);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif // _WINEVT_SYSTEM_KEYS_H_
@@ -0,0 +1,153 @@
+#ifndef _WINEVT_UTF16_H_
+#define _WINEVT_UTF16_H_
+
+/*
+ * UTF-16LE to UTF-8 transcoder.
+ *
+ * This header does not depend on Windows or Ruby headers so that the
+ * conversion can be tested and benchmarked on any platform. Runs of
+ * ASCII are converted 16 code units at a time with SSE2, or 32 when the
+ * CPU has AVX2.
+ * Unpaired surrogates are replaced with U+FFFD as WideCharToMultiByte
+ * does without WC_ERR_INVALID_CHARS.
+ */
+
+#include <winevt_cpu.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define WINEVT_UTF16_SSE2 1
+#endif
+#ifdef WINEVT_CPU_X86
+#define WINEVT_UTF16_AVX2 1
+#endif
+
+/* A UTF-16 code unit is converted to 3 bytes at most. Surrogate pairs
+ * need 4 bytes for 2 code units. */
+#define WINEVT_UTF8_MAX_BYTES_PER_UTF16 3
+
+#ifdef WINEVT_UTF16_AVX2
+/* Converts blocks of 32 code units while they are ASCII. Returns the
+ * number of code units converted. */
+WINEVT_TARGET("avx2")
+static inline size_t
+winevt_utf16_ascii_blocks_avx2(const uint16_t* src, size_t len, char* dst)
+{
+  const __m256i nonAsciiMask = _mm256_set1_epi16((short)0xff80);
+  size_t i = 0;
+
+  for (; i + 32 <= len; i += 32) {
+    __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 16));
+    if (!_mm256_testz_si256(_mm256_or_si256(v0, v1), nonAsciiMask))
+      break;
+    // packus works per 128-bit lane. Restore the order of 64-bit blocks.
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(v0, v1), 0xd8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), packed);
+  }
+
+  return i;
+}
+#endif /* WINEVT_UTF16_AVX2 */
+
+#ifdef WINEVT_UTF16_SSE2
+/* Converts blocks of 16 code units while they are ASCII. Returns the
+ * number of code units converted. */
+static inline size_t
+winevt_utf16_ascii_blocks_sse2(const uint16_t* src, size_t len, char* dst)
+{
+  const __m128i nonAsciiMask = _mm_set1_epi16((short)0xff80);
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+
+  for (; i + 16 <= len; i += 16) {
+    __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8));
+    __m128i high = _mm_and_si128(_mm_or_si128(v0, v1), nonAsciiMask);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(high, zero)) != 0xffff)
+      break;
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(v0, v1));
+  }
+
+  return i;
+}
+#endif /* WINEVT_UTF16_SSE2 */
+
+static inline size_t
+winevt_utf16_ascii_prefix_to_utf8(const uint16_t* src, size_t len, char* dst)
+{
+  size_t i = 0;
+
+#ifdef WINEVT_UTF16_AVX2
+  if (winevt_cpu_has(WINEVT_CPU_AVX2)) {
+    i = winevt_utf16_ascii_blocks_avx2(src, len, dst);
+  }
+#endif
+#ifdef WINEVT_UTF16_SSE2
+  i += winevt_utf16_ascii_blocks_sse2(src + i, len - i, dst + i);
+#endif
+
+  for (; i < len && src[i] < 0x80; i++) {
+    dst[i] = static_cast<char>(src[i]);
+  }
+
+  return i;
+}
+
+/*
+ * Converts len code units from src into dst and returns the number of
+ * bytes written. dst must have room for
+ * len * WINEVT_UTF8_MAX_BYTES_PER_UTF16 bytes. No NUL is appended.
+ */
+static inline size_t
+winevt_utf16_to_utf8(const uint16_t* src, size_t len, char* dst)
+{
+  unsigned char* out = reinterpret_cast<unsigned char*>(dst);
+  size_t i = 0;
+
+  while (i < len) {
+    uint32_t c = src[i];
+
+    if (c < 0x80) {
+      size_t n = winevt_utf16_ascii_prefix_to_utf8(
+        src + i, len - i, reinterpret_cast<char*>(out));
+      i += n;
+      out += n;
+      continue;
+    }
+
+    if (c < 0x800) {
+      *out++ = static_cast<unsigned char>(0xc0 | (c >> 6));
+      *out++ = static_cast<unsigned char>(0x80 | (c & 0x3f));
+      i++;
+      continue;
+    }
+
+    if (c >= 0xd800 && c <= 0xdfff) {
+      if (c <= 0xdbff && i + 1 < len && src[i + 1] >= 0xdc00 && src[i + 1] <= 0xdfff) {
+        c = 0x10000 + ((c - 0xd800) << 10) + (src[i + 1] - 0xdc00);
+        *out++ = static_cast<unsigned char>(0xf0 | (c >> 18));
+        *out++ = static_cast<unsigned char>(0x80 | ((c >> 12) & 0x3f));
+        *out++ = static_cast<unsigned char>(0x80 | ((c >> 6) & 0x3f));
+        *out++ = static_cast<unsigned char>(0x80 | (c & 0x3f));
+        i += 2;
+        continue;
+      }
+      // Unpaired surrogate
+      c = 0xfffd;
+    }
+
+    *out++ = static_cast<unsigned char>(0xe0 | (c >> 12));
+    *out++ = static_cast<unsigned char>(0x80 | ((c >> 6) & 0x3f));
+    *out++ = static_cast<unsigned char>(0x80 | (c & 0x3f));
+    i++;
+  }
+
+  return static_cast<size_t>(reinterpret_cast<char*>(out) - dst);
+}
+
+#endif // _WINEVT_UTF16_H_
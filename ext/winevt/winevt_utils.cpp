@@ -1,7 +1,14 @@
 #include <winevt_c.h>
+#include <winevt_format.h>
+#include <winevt_hex.h>
+#include <winevt_native.h>
+#include <winevt_sid_cache.h>
+#include <winevt_utf16.h>
 
+#include <limits.h>
 #include <sddl.h>
 #include <stdlib.h>
+#include <time.h>
 #include <string>
 #include <vector>
 
@@ -16,6 +23,18 @@ wstr_to_rb_str(UINT cp, const WCHAR* wstr, int clen)
     return rb_utf8_str_new_cstr("");
   }
 
+  if (cp == CP_UTF8) {
+    size_t wlen = clen < 0 ? wcslen(wstr) : wcsnlen(wstr, clen);
+    // Allocate for the worst case and transcode into the string in
+    // a single pass. rb_str_resize shrinks the buffer if it is too large.
+    VALUE str = rb_utf8_str_new(nullptr, wlen * WINEVT_UTF8_MAX_BYTES_PER_UTF16);
+    size_t len = winevt_utf16_to_utf8(
+      reinterpret_cast<const uint16_t*>(wstr), wlen, RSTRING_PTR(str));
+    rb_str_resize(str, len);
+
+    return str;
+  }
+
   int len = WideCharToMultiByte(cp, 0, wstr, clen, nullptr, 0, nullptr, nullptr);
   ptr = RB_ALLOCV_N(CHAR, vstr, len);
   // For memory safety.
@@ -34,6 +53,18 @@ wstr_to_rb_str(UINT cp, const WCHAR* wstr, int clen)
   return str;
 }
 
+void
+append_wstr_to_utf8(const WCHAR* wstr, std::string& out)
+{
+  size_t wlen = wcslen(wstr);
+  size_t offset = out.size();
+
+  out.resize(offset + wlen * WINEVT_UTF8_MAX_BYTES_PER_UTF16);
+  size_t len = winevt_utf16_to_utf8(
+    reinterpret_cast<const uint16_t*>(wstr), wlen, &out[offset]);
+  out.resize(offset + len);
+}
+
 void
 raise_system_error(VALUE error, DWORD errorCode)
 {
@@ -66,39 +97,283 @@ raise_channel_not_found_error(VALUE channelPath)
 #pragma GCC diagnostic pop
 }
 
+static void
+grow_render_buffer(struct WinevtRenderBuffer* buffer, DWORD size)
+{
+  DWORD newSize = buffer->size ? buffer->size : 256;
+
+  if (buffer->size >= size) {
+    return;
+  }
+
+  while (newSize < size) {
+    if (newSize > MAXDWORD / 2) {
+      newSize = size;
+      break;
+    }
+    newSize *= 2;
+  }
+
+  buffer->data = xrealloc(buffer->data, newSize);
+  buffer->size = newSize;
+}
+
+/*
+ * Render into a buffer which is kept over events. EvtRender is called
+ * once in the steady state and is retried only when the buffer is too
+ * small for the current event.
+ */
+static DWORD
+render_to_buffer_uncounted(EVT_HANDLE context, EVT_HANDLE fragment, DWORD flags,
+                           struct WinevtRenderBuffer* buffer, PDWORD bufferUsed,
+                           PDWORD propertyCount)
+{
+  DWORD status = ERROR_SUCCESS;
+
+  if (winevt_backend->render(context,
+                             fragment,
+                             flags,
+                             buffer->size,
+                             buffer->data,
+                             bufferUsed,
+                             propertyCount)) {
+    return ERROR_SUCCESS;
+  }
+
+  status = GetLastError();
+  if (status != ERROR_INSUFFICIENT_BUFFER) {
+    return status;
+  }
+
+  grow_render_buffer(buffer, *bufferUsed);
+
+  if (winevt_backend->render(context,
+                             fragment,
+                             flags,
+                             buffer->size,
+                             buffer->data,
+                             bufferUsed,
+                             propertyCount)) {
+    return ERROR_SUCCESS;
+  }
+
+  return GetLastError();
+}
+
+/* Same as render_to_buffer_uncounted, and adds the time and the
+ * rendered bytes to stats when they are collected. */
+static DWORD
+render_to_buffer(EVT_HANDLE context, EVT_HANDLE fragment, DWORD flags,
+                 struct WinevtRenderBuffer* buffer, PDWORD propertyCount,
+                 struct WinevtStats* stats)
+{
+  ULONGLONG start = WINEVT_STATS_START(stats);
+  DWORD bufferUsed = 0;
+  DWORD status = render_to_buffer_uncounted(
+    context, fragment, flags, buffer, &bufferUsed, propertyCount);
+
+  WINEVT_STATS_ADD(stats, renderNsec, start);
+  if (status == ERROR_SUCCESS) {
+    WINEVT_STATS_COUNT(stats, renderedBytes, bufferUsed);
+  }
+
+  return status;
+}
+
+static void
+free_render_buffer(struct WinevtRenderBuffer* buffer)
+{
+  if (buffer->data) {
+    xfree(buffer->data);
+    buffer->data = nullptr;
+  }
+  buffer->size = 0;
+}
+
+static const struct {
+  const char* name;
+  DWORD field;
+} fieldNames[] = {
+  { "xml", WINEVT_FIELD_XML },
+  { "system", WINEVT_FIELD_SYSTEM },
+  { "message", WINEVT_FIELD_MESSAGE },
+  { "inserts", WINEVT_FIELD_INSERTS },
+};
+
+DWORD
+get_fields_from_rb_ary(VALUE rb_fields)
+{
+  DWORD fields = 0;
+
+  if (NIL_P(rb_fields)) {
+    return 0;
+  }
+
+  Check_Type(rb_fields, T_ARRAY);
+
+  for (long i = 0; i < RARRAY_LEN(rb_fields); i++) {
+    VALUE rb_field = rb_ary_entry(rb_fields, i);
+    DWORD field = 0;
+
+    if (SYMBOL_P(rb_field)) {
+      rb_field = rb_sym2str(rb_field);
+    }
+    Check_Type(rb_field, T_STRING);
+
+    for (size_t j = 0; j < _countof(fieldNames); j++) {
+      if (strcmp(StringValueCStr(rb_field), fieldNames[j].name) == 0) {
+        field = fieldNames[j].field;
+        break;
+      }
+    }
+    if (field == 0) {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat="
+#pragma GCC diagnostic ignored "-Wformat-extra-args"
+      rb_raise(rb_eArgError, "Unknown field: %" PRIsVALUE, rb_field);
+#pragma GCC diagnostic pop
+    }
+
+    fields |= field;
+  }
+
+  if (fields == 0) {
+    rb_raise(rb_eArgError, "fields must not be empty");
+  }
+  if ((fields & WINEVT_FIELD_XML) && (fields & WINEVT_FIELD_SYSTEM)) {
+    rb_raise(rb_eArgError, "xml and system cannot be specified together");
+  }
+
+  return fields;
+}
+
+VALUE
+fields_to_rb_ary(DWORD fields)
+{
+  VALUE rb_fields;
+
+  if (fields == 0) {
+    return Qnil;
+  }
+
+  rb_fields = rb_ary_new();
+  for (size_t i = 0; i < _countof(fieldNames); i++) {
+    if (fields & fieldNames[i].field) {
+      rb_ary_push(rb_fields, ID2SYM(rb_intern(fieldNames[i].name)));
+    }
+  }
+
+  return rb_fields;
+}
+
+static long
+count_option_value(VALUE rb_count, const char* name)
+{
+  long count;
+
+  if (rb_count == Qundef || NIL_P(rb_count)) {
+    return 0;
+  }
+
+  count = NUM2LONG(rb_count);
+  if (count < 1) {
+    rb_raise(rb_eArgError, "%s must be positive", name);
+  }
+
+  return count;
+}
+
+/* Returns the keyword option name of rb_opts, which must be a positive
+ * Integer. 0 means that it is not given. */
+long
+get_count_option(VALUE rb_opts, const char* name)
+{
+  ID keyword = rb_intern(name);
+  VALUE rb_count = Qundef;
+
+  if (NIL_P(rb_opts)) {
+    return 0;
+  }
+  rb_get_kwargs(rb_opts, &keyword, 0, 1, &rb_count);
+
+  return count_option_value(rb_count, name);
+}
+
+/* Reads the max: and format: options of #each_batch. */
+void
+get_batch_options(VALUE rb_opts, long* max, enum WinevtBatchFormat* format)
+{
+  ID keywords[2];
+  VALUE values[2] = { Qundef, Qundef };
+
+  *max = 0;
+  *format = WINEVT_BATCH_FORMAT_COLUMNS;
+  if (NIL_P(rb_opts)) {
+    return;
+  }
+  keywords[0] = rb_intern("max");
+  keywords[1] = rb_intern("format");
+  rb_get_kwargs(rb_opts, keywords, 0, 2, values);
+
+  *max = count_option_value(values[0], "max");
+  if (values[1] == Qundef || NIL_P(values[1]) || values[1] == ID2SYM(rb_intern("columns"))) {
+    *format = WINEVT_BATCH_FORMAT_COLUMNS;
+  } else if (values[1] == ID2SYM(rb_intern("msgpack"))) {
+    *format = WINEVT_BATCH_FORMAT_MSGPACK;
+  } else {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat="
+#pragma GCC diagnostic ignored "-Wformat-extra-args"
+    rb_raise(rb_eArgError, "Unknown format: %" PRIsVALUE, values[1]);
+#pragma GCC diagnostic pop
+  }
+}
+
 VALUE
 render_to_rb_str(EVT_HANDLE handle, DWORD flags)
 {
-  VALUE vbuffer;
-  WCHAR* buffer;
-  ULONG bufferSize = 0;
-  ULONG bufferSizeUsed = 0;
-  ULONG count;
-  BOOL succeeded;
+  struct WinevtRenderBuffer buffer = { nullptr, 0 };
+  DWORD bufferUsed = 0;
+  DWORD count = 0;
+  DWORD status;
   VALUE result;
 
   if (flags != EvtRenderEventXml && flags != EvtRenderBookmark) {
     return Qnil;
   }
 
-  // Get the size of the buffer
-  EvtRender(nullptr, handle, flags, 0, NULL, &bufferSize, &count);
+  status = render_to_buffer_uncounted(nullptr, handle, flags, &buffer, &bufferUsed, &count);
+  if (status != ERROR_SUCCESS) {
+    free_render_buffer(&buffer);
+    raise_system_error(rb_eWinevtQueryError, status);
+  }
+
+  result = wstr_to_rb_str(CP_UTF8, (WCHAR*)buffer.data, -1);
+  free_render_buffer(&buffer);
 
-  // bufferSize is in bytes, not characters
-  buffer = (WCHAR*)RB_ALLOCV(vbuffer, bufferSize);
+  return result;
+}
+
+const WCHAR*
+render_xml_to_wstr(struct WinevtRenderer* renderer, EVT_HANDLE handle)
+{
+  DWORD count = 0;
+  DWORD status;
 
-  succeeded =
-    EvtRender(nullptr, handle, flags, bufferSize, buffer, &bufferSizeUsed, &count);
-  if (!succeeded) {
-    DWORD status = GetLastError();
-    RB_ALLOCV_END(vbuffer);
+  status =
+    render_to_buffer(
+      nullptr, handle, EvtRenderEventXml, &renderer->xmlBuffer, &count, &renderer->stats);
+  if (status != ERROR_SUCCESS) {
     raise_system_error(rb_eWinevtQueryError, status);
   }
 
-  result = wstr_to_rb_str(CP_UTF8, buffer, -1);
-  RB_ALLOCV_END(vbuffer);
+  return (WCHAR*)renderer->xmlBuffer.data;
+}
 
-  return result;
+VALUE
+render_xml_to_rb_str(struct WinevtRenderer* renderer, EVT_HANDLE handle)
+{
+  return wstr_to_rb_str(CP_UTF8, render_xml_to_wstr(renderer, handle), -1);
 }
 
 EVT_HANDLE
@@ -116,7 +391,7 @@ connect_to_remote(LPWSTR computerName, LPWSTR domain, LPWSTR username, LPWSTR pa
   Credentials.Password = password;
   Credentials.Flags = flags;
 
-  hRemote = EvtOpenSession(EvtRpcLogin, &Credentials, 0, 0);
+  hRemote = winevt_backend->openSession(EvtRpcLogin, &Credentials, 0, 0);
   if (!hRemote) {
     *error_code = GetLastError();
     return hRemote;
@@ -127,50 +402,159 @@ connect_to_remote(LPWSTR computerName, LPWSTR domain, LPWSTR username, LPWSTR pa
   return hRemote;
 }
 
-static std::wstring
-guid_to_wstr(const GUID& guid)
+void
+initialize_renderer(struct WinevtRenderer* renderer)
 {
-  LPOLESTR p = nullptr;
-  if (FAILED(StringFromCLSID(guid, &p))) {
-    return nullptr;
+  static PCWSTR eventProperties[] = { L"Event/System/Provider/@Name" };
+  DWORD status = ERROR_SUCCESS;
+
+  if (renderer->hSystemContext == nullptr) {
+    renderer->hSystemContext =
+      winevt_backend->createRenderContext(0, nullptr, EvtRenderContextSystem);
+    if (renderer->hSystemContext == nullptr) {
+      goto error;
+    }
+  }
+
+  if (renderer->hUserContext == nullptr) {
+    renderer->hUserContext =
+      winevt_backend->createRenderContext(0, nullptr, EvtRenderContextUser);
+    if (renderer->hUserContext == nullptr) {
+      goto error;
+    }
+  }
+
+  if (renderer->hProviderNameContext == nullptr) {
+    renderer->hProviderNameContext =
+      winevt_backend->createRenderContext(1, eventProperties, EvtRenderContextValues);
+    if (renderer->hProviderNameContext == nullptr) {
+      goto error;
+    }
+  }
+
+  if (renderer->publisherCache == nullptr) {
+    renderer->publisherCache = publisher_cache_create(PUBLISHER_CACHE_DEFAULT_CAPACITY);
+  }
+
+  if (renderer->sidCache == nullptr) {
+    renderer->sidCache = sid_cache_create();
+  }
+
+  return;
+
+error:
+  status = GetLastError();
+  finalize_renderer(renderer);
+  rb_raise(
+    rb_eWinevtQueryError, "Failed to create renderContext with %lu\n", status);
+}
+
+void
+finalize_renderer(struct WinevtRenderer* renderer)
+{
+  if (renderer->hSystemContext) {
+    winevt_backend->close(renderer->hSystemContext);
+    renderer->hSystemContext = nullptr;
   }
-  std::wstring s(p);
-  CoTaskMemFree(p);
-  return s;
+
+  if (renderer->hUserContext) {
+    winevt_backend->close(renderer->hUserContext);
+    renderer->hUserContext = nullptr;
+  }
+
+  if (renderer->hProviderNameContext) {
+    winevt_backend->close(renderer->hProviderNameContext);
+    renderer->hProviderNameContext = nullptr;
+  }
+
+  if (renderer->publisherCache) {
+    publisher_cache_destroy(renderer->publisherCache);
+    renderer->publisherCache = nullptr;
+  }
+
+  if (renderer->sidCache) {
+    sid_cache_destroy(renderer->sidCache);
+    renderer->sidCache = nullptr;
+  }
+
+  free_render_buffer(&renderer->xmlBuffer);
+  free_render_buffer(&renderer->systemBuffer);
+  free_render_buffer(&renderer->userBuffer);
+  free_render_buffer(&renderer->providerNameBuffer);
+  free_render_buffer(&renderer->messageBuffer);
+}
+
+/* The caches are created by initialize, so objects which are only
+ * allocated do not have them. */
+struct WinevtPublisherCache*
+renderer_publisher_cache(struct WinevtRenderer* renderer)
+{
+  if (renderer->publisherCache == nullptr) {
+    rb_raise(rb_eRuntimeError, "The publisher metadata cache is not initialized");
+  }
+
+  return renderer->publisherCache;
+}
+
+struct WinevtSidCache*
+renderer_sid_cache(struct WinevtRenderer* renderer)
+{
+  if (renderer->sidCache == nullptr) {
+    rb_raise(rb_eRuntimeError, "The SID cache is not initialized");
+  }
+
+  return renderer->sidCache;
 }
 
 static VALUE
 make_displayable_binary_string(PBYTE bin, size_t length)
 {
-  const char *HEX_TABLE = "0123456789ABCDEF";
-  CHAR *buffer;
-  int size = length * 2 + 1;
-  size_t i, j;
-  unsigned int idx = 0;
-  VALUE vbuffer;
+  VALUE str;
 
   if (length == 0) {
     return rb_str_new2("(NULL)");
   }
 
-  buffer = RB_ALLOCV_N(CHAR, vbuffer, size);
+  str = rb_str_new(NULL, length * 2);
+  winevt_hex_encode(bin, length, RSTRING_PTR(str));
 
-  for (i = 0; i < length; i++) {
-    for (j = 0; j < 2; j++) {
-      idx = (unsigned int)(bin[i] >> (j * 4) & 0x0F);
-      buffer[2*i+(1-j)] = HEX_TABLE[idx];
-    }
-  }
-  buffer[size - 1] = '\0';
+  return str;
+}
+
+/* Converts 100 nanoseconds since 1601-01-01 into a Time in UTC. */
+static VALUE
+filetime_to_rb_time(ULONGLONG filetime)
+{
+  struct timespec ts;
 
-  VALUE str = rb_str_new2(buffer);
-  RB_ALLOCV_END(vbuffer);
+  ts.tv_sec = static_cast<time_t>(static_cast<LONGLONG>(filetime / 10000000) - 11644473600LL);
+  ts.tv_nsec = static_cast<long>(filetime % 10000000) * 100;
 
-  return str;
+  return rb_time_timespec_new(&ts, INT_MAX - 1);
+}
+
+static VALUE
+systemtime_to_rb_time(const SYSTEMTIME* st)
+{
+  WinevtCivilTime time;
+  uint64_t filetime;
+
+  time.year = st->wYear;
+  time.month = st->wMonth;
+  time.day = st->wDay;
+  time.hour = st->wHour;
+  time.minute = st->wMinute;
+  time.second = st->wSecond;
+  time.fraction = st->wMilliseconds * 10000U;
+  if (!winevt_civil_to_filetime(&time, &filetime)) {
+    return Qnil;
+  }
+
+  return filetime_to_rb_time(filetime);
 }
 
 static VALUE
-extract_user_evt_variants(PEVT_VARIANT pRenderedValues, DWORD propCount)
+extract_user_evt_variants(PEVT_VARIANT pRenderedValues, DWORD propCount, BOOL typedValues)
 {
   VALUE userValues = rb_ary_new();
   VALUE rbObj;
@@ -184,8 +568,7 @@ extract_user_evt_variants(PEVT_VARIANT pRenderedValues, DWORD propCount)
         if (pRenderedValues[i].StringVal == nullptr) {
           rb_ary_push(userValues, rb_utf8_str_new_cstr("(NULL)"));
         } else {
-          std::wstring wStr(pRenderedValues[i].StringVal);
-          rbObj = wstr_to_rb_str(CP_UTF8, &wStr[0], -1);
+          rbObj = wstr_to_rb_str(CP_UTF8, pRenderedValues[i].StringVal, -1);
           rb_ary_push(userValues, rbObj);
         }
         break;
@@ -232,79 +615,83 @@ extract_user_evt_variants(PEVT_VARIANT pRenderedValues, DWORD propCount)
         break;
       case EvtVarTypeSingle: {
         CHAR sResult[256];
-        _snprintf_s(
-          sResult, _countof(sResult), _TRUNCATE, "%f", pRenderedValues[i].SingleVal);
-        rb_ary_push(userValues, rb_utf8_str_new_cstr(sResult));
+        if (typedValues) {
+          rb_ary_push(userValues, DBL2NUM(pRenderedValues[i].SingleVal));
+          break;
+        }
+        size_t length =
+          winevt_format_fixed(pRenderedValues[i].SingleVal, sResult, _countof(sResult));
+        rb_ary_push(userValues, rb_utf8_str_new(sResult, length));
         break;
       }
       case EvtVarTypeDouble: {
         CHAR sResult[256];
-        _snprintf_s(
-          sResult, _countof(sResult), _TRUNCATE, "%lf", pRenderedValues[i].DoubleVal);
-        rb_ary_push(userValues, rb_utf8_str_new_cstr(sResult));
+        if (typedValues) {
+          rb_ary_push(userValues, DBL2NUM(pRenderedValues[i].DoubleVal));
+          break;
+        }
+        size_t length =
+          winevt_format_fixed(pRenderedValues[i].DoubleVal, sResult, _countof(sResult));
+        rb_ary_push(userValues, rb_utf8_str_new(sResult, length));
         break;
       }
       case EvtVarTypeBoolean:
         rbObj = pRenderedValues[i].BooleanVal ? Qtrue : Qfalse;
         rb_ary_push(userValues, rbObj);
         break;
-      case EvtVarTypeGuid:
-        if (pRenderedValues[i].GuidVal != nullptr) {
-          const GUID guid = *pRenderedValues[i].GuidVal;
-          std::wstring wstr = guid_to_wstr(guid);
-          rbObj = wstr_to_rb_str(CP_UTF8, wstr.c_str(), -1);
+      case EvtVarTypeGuid: {
+        WCHAR wsGuid[50];
+        if (pRenderedValues[i].GuidVal != nullptr &&
+            StringFromGUID2(*pRenderedValues[i].GuidVal, wsGuid, _countof(wsGuid))) {
+          rbObj = wstr_to_rb_str(CP_UTF8, wsGuid, -1);
           rb_ary_push(userValues, rbObj);
         } else {
           rb_ary_push(userValues, rb_utf8_str_new_cstr("?"));
         }
         break;
+      }
       case EvtVarTypeSizeT:
         rbObj = SIZET2NUM(pRenderedValues[i].SizeTVal);
         rb_ary_push(userValues, rbObj);
         break;
       case EvtVarTypeFileTime: {
-        LARGE_INTEGER timestamp;
-        CHAR strTime[128];
-        FILETIME ft;
-        SYSTEMTIME st;
-        timestamp.QuadPart = pRenderedValues[i].FileTimeVal;
-        ft.dwHighDateTime = timestamp.HighPart;
-        ft.dwLowDateTime = timestamp.LowPart;
-        if (FileTimeToSystemTime(&ft, &st)) {
-          _snprintf_s(strTime,
-                      _countof(strTime),
-                      _TRUNCATE,
-                      "%04d-%02d-%02d %02d:%02d:%02d.%dZ",
-                      st.wYear,
-                      st.wMonth,
-                      st.wDay,
-                      st.wHour,
-                      st.wMinute,
-                      st.wSecond,
-                      st.wMilliseconds);
-          rb_ary_push(userValues, rb_utf8_str_new_cstr(strTime));
+        CHAR strTime[WINEVT_FORMAT_BUFFER_SIZE];
+        WinevtCivilTime time;
+        if (typedValues) {
+          rb_ary_push(userValues, filetime_to_rb_time(pRenderedValues[i].FileTimeVal));
+          break;
+        }
+        // FileTimeToSystemTime rejects FILETIMEs above 0x7FFFFFFFFFFFFFFF.
+        if (pRenderedValues[i].FileTimeVal <= 0x7FFFFFFFFFFFFFFFULL) {
+          winevt_filetime_to_civil(pRenderedValues[i].FileTimeVal, &time);
+          rb_ary_push(userValues,
+                      rb_utf8_str_new(strTime, winevt_format_insert_time(&time, strTime)));
         } else {
           rb_ary_push(userValues, rb_utf8_str_new_cstr("?"));
         }
         break;
       }
       case EvtVarTypeSysTime: {
-        CHAR strTime[128];
-        SYSTEMTIME st;
+        CHAR strTime[WINEVT_FORMAT_BUFFER_SIZE];
+        WinevtCivilTime time;
+        if (typedValues) {
+          rb_ary_push(userValues,
+                      pRenderedValues[i].SysTimeVal
+                        ? systemtime_to_rb_time(pRenderedValues[i].SysTimeVal)
+                        : Qnil);
+          break;
+        }
         if (pRenderedValues[i].SysTimeVal != nullptr) {
-          st = *pRenderedValues[i].SysTimeVal;
-          _snprintf_s(strTime,
-                      _countof(strTime),
-                      _TRUNCATE,
-                      "%04d-%02d-%02d %02d:%02d:%02d.%dZ",
-                      st.wYear,
-                      st.wMonth,
-                      st.wDay,
-                      st.wHour,
-                      st.wMinute,
-                      st.wSecond,
-                      st.wMilliseconds);
-          rb_ary_push(userValues, rb_utf8_str_new_cstr(strTime));
+          const SYSTEMTIME* st = pRenderedValues[i].SysTimeVal;
+          time.year = st->wYear;
+          time.month = st->wMonth;
+          time.day = st->wDay;
+          time.hour = st->wHour;
+          time.minute = st->wMinute;
+          time.second = st->wSecond;
+          time.fraction = st->wMilliseconds * 10000U;
+          rb_ary_push(userValues,
+                      rb_utf8_str_new(strTime, winevt_format_insert_time(&time, strTime)));
         } else {
           rb_ary_push(userValues, rb_utf8_str_new_cstr("?"));
         }
@@ -321,19 +708,31 @@ extract_user_evt_variants(PEVT_VARIANT pRenderedValues, DWORD propCount)
         }
         break;
       }
-      case EvtVarTypeHexInt32:
-        rbObj = rb_sprintf("%#x", pRenderedValues[i].UInt32Val);
+      case EvtVarTypeHexInt32: {
+        CHAR strHex[WINEVT_FORMAT_BUFFER_SIZE];
+        // "%#x" has no prefix for 0.
+        if (typedValues) {
+          rbObj = UINT2NUM(pRenderedValues[i].UInt32Val);
+        } else if (pRenderedValues[i].UInt32Val == 0) {
+          rbObj = rb_str_new("0", 1);
+        } else {
+          rbObj = rb_str_new(
+            strHex, winevt_format_hex_prefixed(pRenderedValues[i].UInt32Val, 1, strHex));
+        }
         rb_ary_push(userValues, rbObj);
         break;
-      case EvtVarTypeHexInt64:
-        uint32_t  high;
-        uint32_t  low;
-
-        high = pRenderedValues[i].UInt64Val >> 32;
-        low = pRenderedValues[i].UInt64Val & 0x00000000FFFFFFFF;
-        rbObj = rb_sprintf("0x%08x%08x", high, low);
+      }
+      case EvtVarTypeHexInt64: {
+        CHAR strHex[WINEVT_FORMAT_BUFFER_SIZE];
+        if (typedValues) {
+          rbObj = ULL2NUM(pRenderedValues[i].UInt64Val);
+        } else {
+          rbObj = rb_str_new(
+            strHex, winevt_format_hex_prefixed(pRenderedValues[i].UInt64Val, 16, strHex));
+        }
         rb_ary_push(userValues, rbObj);
         break;
+      }
       case EvtVarTypeEvtXml:
         if (pRenderedValues[i].XmlVal == nullptr) {
           rb_ary_push(userValues, rb_utf8_str_new_cstr("(NULL)"));
@@ -343,7 +742,13 @@ extract_user_evt_variants(PEVT_VARIANT pRenderedValues, DWORD propCount)
         }
         break;
       case EvtVarTypeBinary:
-        if (pRenderedValues[i].BinaryVal == nullptr) {
+        if (typedValues) {
+          rbObj = pRenderedValues[i].BinaryVal
+                    ? rb_str_new(reinterpret_cast<const char*>(pRenderedValues[i].BinaryVal),
+                                 pRenderedValues[i].Count)
+                    : Qnil;
+          rb_ary_push(userValues, rbObj);
+        } else if (pRenderedValues[i].BinaryVal == nullptr) {
           rb_ary_push(userValues, rb_utf8_str_new_cstr("(NULL)"));
         } else {
           rbObj = make_displayable_binary_string(pRenderedValues[i].BinaryVal, pRenderedValues[i].Count);
@@ -359,241 +764,330 @@ extract_user_evt_variants(PEVT_VARIANT pRenderedValues, DWORD propCount)
   return userValues;
 }
 
-VALUE
-get_values(EVT_HANDLE handle)
+/*
+ * The text of an insert value which extract_user_evt_variants() makes
+ * without typed values. It is appended to text for strings, and is
+ * stored into integer for integers and booleans.
+ */
+WinevtVariantKind
+evt_variant_to_native(const EVT_VARIANT* variant, std::string& text, uint64_t* integer)
 {
-  VALUE vbuffer;
-  PEVT_VARIANT pRenderedValues;
-  ULONG bufferSize = 0;
-  ULONG bufferSizeUsed = 0;
-  DWORD propCount = 0;
-  BOOL succeeded;
-  VALUE userValues = Qnil;
-
-  EVT_HANDLE renderContext = EvtCreateRenderContext(0, nullptr, EvtRenderContextUser);
-  if (renderContext == nullptr) {
-    rb_raise(rb_eWinevtQueryError, "Failed to create renderContext");
-  }
-
-  // Get the size of the buffer
-  EvtRender(
-    renderContext, handle, EvtRenderEventValues, 0, NULL, &bufferSize, &propCount);
-
-  // bufferSize is in bytes, not array size
-  pRenderedValues = (PEVT_VARIANT)RB_ALLOCV(vbuffer, bufferSize);
-
-  succeeded = EvtRender(renderContext,
-                        handle,
-                        EvtRenderEventValues,
-                        bufferSize,
-                        pRenderedValues,
-                        &bufferSizeUsed,
-                        &propCount);
-  if (!succeeded) {
-    DWORD status = GetLastError();
-    RB_ALLOCV_END(vbuffer);
-    EvtClose(renderContext);
+  CHAR buffer[256];
+  WinevtCivilTime time;
+  size_t length;
+
+  switch (variant->Type) {
+    case EvtVarTypeNull:
+      return WINEVT_VARIANT_NULL;
+    case EvtVarTypeString:
+      append_wstr_to_utf8(variant->StringVal ? variant->StringVal : L"(NULL)", text);
+      return WINEVT_VARIANT_STRING;
+    case EvtVarTypeAnsiString:
+      text.append(variant->AnsiStringVal ? variant->AnsiStringVal : "(NULL)");
+      return WINEVT_VARIANT_STRING;
+    case EvtVarTypeSByte:
+      // extract_user_evt_variants() casts it to UINT32, but INT2NUM
+      // takes it back as a negative int.
+      *integer = static_cast<uint64_t>(static_cast<int64_t>(variant->SByteVal));
+      return WINEVT_VARIANT_SIGNED;
+    case EvtVarTypeByte:
+      *integer = variant->ByteVal;
+      return WINEVT_VARIANT_UNSIGNED;
+    case EvtVarTypeInt16:
+      *integer = static_cast<uint64_t>(static_cast<int64_t>(variant->Int16Val));
+      return WINEVT_VARIANT_SIGNED;
+    case EvtVarTypeUInt16:
+      *integer = variant->UInt16Val;
+      return WINEVT_VARIANT_UNSIGNED;
+    case EvtVarTypeInt32:
+      *integer = static_cast<uint64_t>(static_cast<int64_t>(variant->Int32Val));
+      return WINEVT_VARIANT_SIGNED;
+    case EvtVarTypeUInt32:
+      *integer = variant->UInt32Val;
+      return WINEVT_VARIANT_UNSIGNED;
+    case EvtVarTypeInt64:
+      *integer = static_cast<uint64_t>(variant->Int64Val);
+      return WINEVT_VARIANT_SIGNED;
+    case EvtVarTypeUInt64:
+      *integer = variant->UInt64Val;
+      return WINEVT_VARIANT_UNSIGNED;
+    case EvtVarTypeSizeT:
+      *integer = variant->SizeTVal;
+      return WINEVT_VARIANT_UNSIGNED;
+    case EvtVarTypeBoolean:
+      *integer = variant->BooleanVal ? 1 : 0;
+      return WINEVT_VARIANT_BOOLEAN;
+    case EvtVarTypeSingle:
+      text.append(buffer, winevt_format_fixed(variant->SingleVal, buffer, sizeof(buffer)));
+      return WINEVT_VARIANT_STRING;
+    case EvtVarTypeDouble:
+      text.append(buffer, winevt_format_fixed(variant->DoubleVal, buffer, sizeof(buffer)));
+      return WINEVT_VARIANT_STRING;
+    case EvtVarTypeGuid: {
+      WCHAR wsGuid[50];
+      if (variant->GuidVal != nullptr &&
+          StringFromGUID2(*variant->GuidVal, wsGuid, _countof(wsGuid))) {
+        append_wstr_to_utf8(wsGuid, text);
+      } else {
+        text.append("?");
+      }
+      return WINEVT_VARIANT_STRING;
+    }
+    case EvtVarTypeFileTime:
+      if (variant->FileTimeVal <= 0x7FFFFFFFFFFFFFFFULL) {
+        winevt_filetime_to_civil(variant->FileTimeVal, &time);
+        text.append(buffer, winevt_format_insert_time(&time, buffer));
+      } else {
+        text.append("?");
+      }
+      return WINEVT_VARIANT_STRING;
+    case EvtVarTypeSysTime:
+      if (variant->SysTimeVal != nullptr) {
+        const SYSTEMTIME* st = variant->SysTimeVal;
+        time.year = st->wYear;
+        time.month = st->wMonth;
+        time.day = st->wDay;
+        time.hour = st->wHour;
+        time.minute = st->wMinute;
+        time.second = st->wSecond;
+        time.fraction = st->wMilliseconds * 10000U;
+        text.append(buffer, winevt_format_insert_time(&time, buffer));
+      } else {
+        text.append("?");
+      }
+      return WINEVT_VARIANT_STRING;
+    case EvtVarTypeSid: {
+      WCHAR* sid = nullptr;
+      if (ConvertSidToStringSidW(variant->SidVal, &sid)) {
+        append_wstr_to_utf8(sid, text);
+        LocalFree(sid);
+      } else {
+        text.append("?");
+      }
+      return WINEVT_VARIANT_STRING;
+    }
+    case EvtVarTypeHexInt32:
+      if (variant->UInt32Val == 0) {
+        text.append("0");
+      } else {
+        text.append(buffer, winevt_format_hex_prefixed(variant->UInt32Val, 1, buffer));
+      }
+      return WINEVT_VARIANT_STRING;
+    case EvtVarTypeHexInt64:
+      text.append(buffer, winevt_format_hex_prefixed(variant->UInt64Val, 16, buffer));
+      return WINEVT_VARIANT_STRING;
+    case EvtVarTypeEvtXml:
+      append_wstr_to_utf8(variant->XmlVal ? variant->XmlVal : L"(NULL)", text);
+      return WINEVT_VARIANT_STRING;
+    case EvtVarTypeBinary:
+      if (variant->BinaryVal == nullptr || variant->Count == 0) {
+        text.append("(NULL)");
+      } else {
+        length = text.size();
+        text.resize(length + variant->Count * 2);
+        winevt_hex_encode(variant->BinaryVal, variant->Count, &text[length]);
+      }
+      return WINEVT_VARIANT_STRING;
+    default:
+      text.append("?");
+      return WINEVT_VARIANT_STRING;
+  }
+}
+
+PEVT_VARIANT
+render_user_variants(struct WinevtRenderer* renderer, EVT_HANDLE handle, DWORD* count)
+{
+  DWORD status;
+
+  *count = 0;
+  status = render_to_buffer(renderer->hUserContext,
+                            handle,
+                            EvtRenderEventValues,
+                            &renderer->userBuffer,
+                            count,
+                            &renderer->stats);
+  if (status != ERROR_SUCCESS) {
     raise_system_error(rb_eWinevtQueryError, status);
   }
 
-  userValues = extract_user_evt_variants(pRenderedValues, propCount);
+  return (PEVT_VARIANT)renderer->userBuffer.data;
+}
 
-  RB_ALLOCV_END(vbuffer);
-  EvtClose(renderContext);
+VALUE
+get_values(struct WinevtRenderer* renderer, EVT_HANDLE handle, BOOL typedValues)
+{
+  DWORD propCount = 0;
+  PEVT_VARIANT values = render_user_variants(renderer, handle, &propCount);
 
-  return userValues;
+  return extract_user_evt_variants(values, propCount, typedValues);
+}
+
+static void
+copy_system_message(struct WinevtRenderBuffer* buffer, DWORD status)
+{
+  LPVOID lpMsgBuf = nullptr;
+  size_t len;
+
+  if (FormatMessageW(FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM |
+                       FORMAT_MESSAGE_IGNORE_INSERTS,
+                     nullptr,
+                     status,
+                     MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
+                     reinterpret_cast<WCHAR*>(&lpMsgBuf),
+                     0,
+                     nullptr) == 0)
+    FormatMessageW(FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM |
+                     FORMAT_MESSAGE_IGNORE_INSERTS,
+                   nullptr,
+                   status,
+                   MAKELANGID(LANG_ENGLISH, SUBLANG_ENGLISH_US),
+                   reinterpret_cast<WCHAR*>(&lpMsgBuf),
+                   0,
+                   nullptr);
+
+  if (lpMsgBuf == nullptr) {
+    reinterpret_cast<WCHAR*>(buffer->data)[0] = L'\0';
+    return;
+  }
+
+  len = wcslen(reinterpret_cast<WCHAR*>(lpMsgBuf)) + 1;
+  grow_render_buffer(buffer, len * sizeof(WCHAR));
+  memcpy(buffer->data, lpMsgBuf, len * sizeof(WCHAR));
+  LocalFree(lpMsgBuf);
 }
 
-static std::vector<WCHAR>
-get_message(EVT_HANDLE hMetadata, EVT_HANDLE handle)
+/* Messages of a remote session are formatted on the remote machine. */
+static const WCHAR*
+get_message(struct WinevtRenderer* renderer, EVT_HANDLE hMetadata, EVT_HANDLE handle,
+            BOOL remote)
 {
 #define BUFSIZE 4096
-  std::vector<WCHAR> result;
+  struct WinevtRenderBuffer* message = &renderer->messageBuffer;
   ULONG status;
   ULONG bufferSizeNeeded = 0;
-  LPVOID lpMsgBuf;
-  std::vector<WCHAR> message(BUFSIZE);
-
-  if (!EvtFormatMessage(hMetadata,
-                        handle,
-                        0xffffffff,
-                        0,
-                        nullptr,
-                        EvtFormatMessageEvent,
-                        message.size(),
-                        &message[0],
-                        &bufferSizeNeeded)) {
-    status = GetLastError();
-
-    if (status != ERROR_EVT_UNRESOLVED_VALUE_INSERT) {
-      switch (status) {
-        case ERROR_EVT_MESSAGE_NOT_FOUND:
-        case ERROR_EVT_MESSAGE_ID_NOT_FOUND:
-        case ERROR_EVT_MESSAGE_LOCALE_NOT_FOUND:
-        case ERROR_RESOURCE_DATA_NOT_FOUND:
-        case ERROR_RESOURCE_TYPE_NOT_FOUND:
-        case ERROR_RESOURCE_NAME_NOT_FOUND:
-        case ERROR_RESOURCE_LANG_NOT_FOUND:
-        case ERROR_MUI_FILE_NOT_FOUND:
-        case ERROR_EVT_UNRESOLVED_PARAMETER_INSERT: {
-          if (FormatMessageW(FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM |
-                               FORMAT_MESSAGE_IGNORE_INSERTS,
-                             nullptr,
-                             status,
-                             MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
-                             reinterpret_cast<WCHAR*>(&lpMsgBuf),
-                             0,
-                             nullptr) == 0)
-            FormatMessageW(FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM |
-                             FORMAT_MESSAGE_IGNORE_INSERTS,
-                           nullptr,
-                           status,
-                           MAKELANGID(LANG_ENGLISH, SUBLANG_ENGLISH_US),
-                           reinterpret_cast<WCHAR*>(&lpMsgBuf),
-                           0,
-                           nullptr);
-
-          std::wstring ret(reinterpret_cast<WCHAR*>(lpMsgBuf));
-          std::copy(ret.begin(), ret.end(), std::back_inserter(result));
-          LocalFree(lpMsgBuf);
-
-          goto cleanup;
-        }
-      }
 
-      if (status != ERROR_INSUFFICIENT_BUFFER)
-        rb_raise(rb_eWinevtQueryError, "ErrorCode: %lu", status);
+  grow_render_buffer(message, BUFSIZE * sizeof(WCHAR));
+
+  for (int retry = 0; retry < 2; retry++) {
+    ULONGLONG start = WINEVT_STATS_START(&renderer->stats);
+    DWORD bufferSize = message->size / sizeof(WCHAR);
+    WCHAR* buffer = reinterpret_cast<WCHAR*>(message->data);
+    BOOL formatted;
+    if (remote) {
+      formatted = EvtFormatMessageWithoutGVL(hMetadata,
+                                             handle,
+                                             0xffffffff,
+                                             0,
+                                             nullptr,
+                                             EvtFormatMessageEvent,
+                                             bufferSize,
+                                             buffer,
+                                             &bufferSizeNeeded);
+    } else {
+      formatted = winevt_backend->formatMessage(hMetadata,
+                                                handle,
+                                                0xffffffff,
+                                                0,
+                                                nullptr,
+                                                EvtFormatMessageEvent,
+                                                bufferSize,
+                                                buffer,
+                                                &bufferSizeNeeded);
+    }
+    status = formatted ? ERROR_SUCCESS : GetLastError();
+    WINEVT_STATS_ADD(&renderer->stats, formatMessageNsec, start);
+    if (formatted) {
+      break;
     }
 
-    if (status == ERROR_INSUFFICIENT_BUFFER) {
-      message.resize(bufferSizeNeeded);
-      message.shrink_to_fit();
-
-      if (!EvtFormatMessage(hMetadata,
-                            handle,
-                            0xffffffff,
-                            0,
-                            nullptr,
-                            EvtFormatMessageEvent,
-                            message.size(),
-                            &message.front(),
-                            &bufferSizeNeeded)) {
-        status = GetLastError();
-
-        if (status != ERROR_EVT_UNRESOLVED_VALUE_INSERT) {
-          switch (status) {
-            case ERROR_EVT_MESSAGE_NOT_FOUND:
-            case ERROR_EVT_MESSAGE_ID_NOT_FOUND:
-            case ERROR_EVT_MESSAGE_LOCALE_NOT_FOUND:
-            case ERROR_RESOURCE_DATA_NOT_FOUND:
-            case ERROR_RESOURCE_TYPE_NOT_FOUND:
-            case ERROR_RESOURCE_NAME_NOT_FOUND:
-            case ERROR_RESOURCE_LANG_NOT_FOUND:
-            case ERROR_MUI_FILE_NOT_FOUND:
-            case ERROR_EVT_UNRESOLVED_PARAMETER_INSERT:
-              if (FormatMessageW(FORMAT_MESSAGE_ALLOCATE_BUFFER |
-                                   FORMAT_MESSAGE_FROM_SYSTEM |
-                                   FORMAT_MESSAGE_IGNORE_INSERTS,
-                                 nullptr,
-                                 status,
-                                 MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
-                                 reinterpret_cast<WCHAR*>(&lpMsgBuf),
-                                 0,
-                                 nullptr) == 0)
-                FormatMessageW(FORMAT_MESSAGE_ALLOCATE_BUFFER |
-                                 FORMAT_MESSAGE_FROM_SYSTEM |
-                                 FORMAT_MESSAGE_IGNORE_INSERTS,
-                               nullptr,
-                               status,
-                               MAKELANGID(LANG_ENGLISH, SUBLANG_ENGLISH_US),
-                               reinterpret_cast<WCHAR*>(&lpMsgBuf),
-                               0,
-                               nullptr);
-
-              std::wstring ret(reinterpret_cast<WCHAR*>(lpMsgBuf));
-              std::copy(ret.begin(), ret.end(), std::back_inserter(result));
-              LocalFree(lpMsgBuf);
-
-              goto cleanup;
-          }
-
-          rb_raise(rb_eWinevtQueryError, "ErrorCode: %lu", status);
+    switch (status) {
+      case ERROR_EVT_UNRESOLVED_VALUE_INSERT:
+        // Use the message which is formatted as much as possible.
+        goto done;
+      case ERROR_INSUFFICIENT_BUFFER:
+        if (retry == 0) {
+          // bufferSizeNeeded is in characters, not bytes
+          grow_render_buffer(message, bufferSizeNeeded * sizeof(WCHAR));
+          continue;
         }
-      }
+        break;
+      case ERROR_EVT_MESSAGE_NOT_FOUND:
+      case ERROR_EVT_MESSAGE_ID_NOT_FOUND:
+      case ERROR_EVT_MESSAGE_LOCALE_NOT_FOUND:
+      case ERROR_RESOURCE_DATA_NOT_FOUND:
+      case ERROR_RESOURCE_TYPE_NOT_FOUND:
+      case ERROR_RESOURCE_NAME_NOT_FOUND:
+      case ERROR_RESOURCE_LANG_NOT_FOUND:
+      case ERROR_MUI_FILE_NOT_FOUND:
+      case ERROR_EVT_UNRESOLVED_PARAMETER_INSERT:
+        copy_system_message(message, status);
+        goto done;
     }
+
+    rb_raise(rb_eWinevtQueryError, "ErrorCode: %lu", status);
   }
 
-  result = message;
+done:
 
-cleanup:
-
-  return result;
+  return reinterpret_cast<WCHAR*>(message->data);
 
 #undef BUFSIZE
 }
 
-WCHAR*
-get_description(EVT_HANDLE handle, LANGID langID, EVT_HANDLE hRemote)
+const WCHAR*
+get_description_wstr(struct WinevtRenderer* renderer, EVT_HANDLE handle,
+                     LANGID langID, EVT_HANDLE hRemote)
 {
-#define BUFSIZE 4096
-  std::vector<WCHAR> buffer(BUFSIZE);
-  ULONG bufferSizeNeeded = 0;
-  ULONG status, count;
-  std::vector<WCHAR> result;
+  DWORD status, count = 0;
+  const WCHAR* result = nullptr;
   EVT_HANDLE hMetadata = nullptr;
+  BOOL cached = FALSE;
 
-  static PCWSTR eventProperties[] = { L"Event/System/Provider/@Name" };
-  EVT_HANDLE renderContext =
-    EvtCreateRenderContext(1, eventProperties, EvtRenderContextValues);
-  if (renderContext == nullptr) {
-    rb_raise(rb_eWinevtQueryError, "Failed to create renderContext");
-  }
-
-  if (EvtRender(renderContext,
-                handle,
-                EvtRenderEventValues,
-                buffer.size(),
-                &buffer.front(),
-                &bufferSizeNeeded,
-                &count) != FALSE) {
-    status = ERROR_SUCCESS;
-  } else {
-    status = GetLastError();
-  }
-
+  status = render_to_buffer(renderer->hProviderNameContext,
+                            handle,
+                            EvtRenderEventValues,
+                            &renderer->providerNameBuffer,
+                            &count,
+                            &renderer->stats);
   if (status != ERROR_SUCCESS) {
     raise_system_error(rb_eWinevtQueryError, status);
   }
 
   // Obtain buffer as EVT_VARIANT pointer. To avoid ErrorCide 87 in EvtRender.
-  const PEVT_VARIANT values = reinterpret_cast<PEVT_VARIANT>(&buffer.front());
-
-  // Open publisher metadata
-  hMetadata = EvtOpenPublisherMetadata(
-    hRemote,
-    values[0].StringVal,
-    nullptr,
-    MAKELCID(langID, SORT_DEFAULT),
-    0);
+  const PEVT_VARIANT values =
+    reinterpret_cast<PEVT_VARIANT>(renderer->providerNameBuffer.data);
+
+  // Open publisher metadata. Cached handles are owned by the cache and
+  // must not be closed here.
+  if (publisher_cache_get_capacity(renderer->publisherCache) > 0) {
+    hMetadata = publisher_cache_open(
+      renderer->publisherCache, hRemote, values[0].StringVal, langID);
+    cached = TRUE;
+  } else {
+    hMetadata = EvtOpenPublisherMetadataWithoutGVL(
+      hRemote, values[0].StringVal, nullptr, MAKELCID(langID, SORT_DEFAULT), 0);
+  }
   if (hMetadata == nullptr) {
     // When winevt_c cannot open metadata, then give up to obtain
     // message file and clean up immediately.
     goto cleanup;
   }
 
-  result = get_message(hMetadata, handle);
-
-#undef BUFSIZE
+  result = get_message(renderer, hMetadata, handle, hRemote != nullptr);
 
 cleanup:
 
-  if (renderContext)
-    EvtClose(renderContext);
+  if (hMetadata && !cached)
+    winevt_backend->close(hMetadata);
 
-  if (hMetadata)
-    EvtClose(hMetadata);
+  return result;
+}
 
-  return _wcsdup(result.data());
+VALUE
+get_description(struct WinevtRenderer* renderer, EVT_HANDLE handle,
+                LANGID langID, EVT_HANDLE hRemote)
+{
+  return wstr_to_rb_str(CP_UTF8, get_description_wstr(renderer, handle, langID, hRemote), -1);
 }
 
 static char* convert_wstr(wchar_t *wstr)
@@ -637,9 +1131,9 @@ static int ExpandSIDWString(PSID sid, CHAR **out_expanded)
   VALUE vformatted;
 #undef MAX_NAME
 
-  if (!LookupAccountSidW(NULL, sid,
-                         wAccount, &len, wDomain,
-                         &len, &sid_type)) {
+  if (!LookupAccountSidWithoutGVL(NULL, sid,
+                                  wAccount, &len, wDomain,
+                                  &len, &sid_type)) {
     err = GetLastError();
     if (err == ERROR_NONE_MAPPED) {
       goto none_mapped_error;
@@ -690,221 +1184,286 @@ error:
   raise_system_error(rb_eRuntimeError, err);
 }
 
-VALUE
-render_system_event(EVT_HANDLE hEvent, BOOL preserve_qualifiers, BOOL preserveSID_p)
+static bool
+lookup_account_name(struct WinevtSidCache* cache, PSID sid, std::string* account)
+{
+  std::string key(reinterpret_cast<const char*>(sid), GetLengthSid(sid));
+  CHAR* expandSID = NULL;
+
+  switch (cache->lookup(key, account)) {
+    case SID_CACHE_HIT:
+      return true;
+    case SID_CACHE_NEGATIVE_HIT:
+      return false;
+    default:
+      break;
+  }
+
+  switch (ExpandSIDWString(sid, &expandSID)) {
+    case 0:
+      *account = expandSID;
+      free(expandSID);
+      cache->insert(key, *account);
+      return true;
+    case WINEVT_UTILS_ERROR_NONE_MAPPED:
+      cache->insertNegative(key);
+      return false;
+    default:
+      // Transient failures should be retried with the next event.
+      return false;
+  }
+}
+
+void
+render_user_sid(struct WinevtRenderer* renderer, PSID sid, struct WinevtUserSid* user)
+{
+  LPSTR pwsSid = NULL;
+
+  user->hasSid = false;
+  user->hasAccount = false;
+  if (!ConvertSidToStringSid(sid, &pwsSid)) {
+    return;
+  }
+  user->hasSid = true;
+  user->sid = pwsSid;
+
+  /* S-1-15-3- is used for capability SIDs. So, we need to skip
+   * SID translation.
+   * ref: https://learn.microsoft.com/en-us/windows-server/identity/ad-ds/manage/understand-security-identifiers
+   * See also: https://learn.microsoft.com/en-us/troubleshoot/windows-server/windows-security/sids-not-resolve-into-friendly-names
+   */
+  if (strnicmp(pwsSid, "S-1-15-3-", 9) != 0) {
+    ULONGLONG start = WINEVT_STATS_START(&renderer->stats);
+    user->hasAccount = lookup_account_name(renderer->sidCache, sid, &user->account);
+    WINEVT_STATS_ADD(&renderer->stats, sidLookupNsec, start);
+  }
+  LocalFree(pwsSid);
+}
+
+PEVT_VARIANT
+render_system_variants(struct WinevtRenderer* renderer, EVT_HANDLE hEvent)
 {
   DWORD status = ERROR_SUCCESS;
-  EVT_HANDLE hContext = NULL;
-  DWORD dwBufferSize = 0;
-  DWORD dwBufferUsed = 0;
   DWORD dwPropertyCount = 0;
-  VALUE vRenderedValues;
+
+  status = render_to_buffer(renderer->hSystemContext,
+                            hEvent,
+                            EvtRenderEventValues,
+                            &renderer->systemBuffer,
+                            &dwPropertyCount,
+                            &renderer->stats);
+  if (ERROR_SUCCESS != status) {
+    rb_raise(rb_eWinevtQueryError, "EvtRender failed with %lu\n", status);
+  }
+
+  return (PEVT_VARIANT)renderer->systemBuffer.data;
+}
+
+/* System values are the keys before EventData. */
+#define SYSTEM_VALUE_KEY_MAX SYSTEM_EVENT_KEY_EVENT_DATA
+
+/*
+ * Renders the system values of hEvent into values, which is indexed by
+ * SystemEventKey and has SYSTEM_VALUE_KEY_MAX elements. Values which
+ * the event does not have are Qundef.
+ */
+static void
+render_system_values(struct WinevtRenderer* renderer, EVT_HANDLE hEvent,
+                     BOOL preserve_qualifiers, BOOL preserveSID_p,
+                     BOOL typedValues, VALUE* values)
+{
   PEVT_VARIANT pRenderedValues = NULL;
   WCHAR wsGuid[50];
-  LPSTR pwsSid = NULL;
-  ULONGLONG ullTimeStamp = 0;
-  ULONGLONG ullNanoseconds = 0;
-  SYSTEMTIME st;
-  FILETIME ft;
-  CHAR buffer[32];
+  WinevtCivilTime time;
+  CHAR buffer[WINEVT_FORMAT_BUFFER_SIZE];
   VALUE rbstr;
   DWORD EventID;
-  VALUE hash = rb_hash_new();
-
-  hContext = EvtCreateRenderContext(0, NULL, EvtRenderContextSystem);
-  if (NULL == hContext) {
-    rb_raise(
-      rb_eWinevtQueryError, "Failed to create renderContext with %lu\n", GetLastError());
-  }
-
-  if (!EvtRender(hContext,
-                 hEvent,
-                 EvtRenderEventValues,
-                 dwBufferSize,
-                 pRenderedValues,
-                 &dwBufferUsed,
-                 &dwPropertyCount)) {
-    status = GetLastError();
-    if (ERROR_INSUFFICIENT_BUFFER == status) {
-      dwBufferSize = dwBufferUsed;
-      pRenderedValues = (PEVT_VARIANT)RB_ALLOCV(vRenderedValues, dwBufferSize);
-      if (pRenderedValues) {
-        EvtRender(hContext,
-                  hEvent,
-                  EvtRenderEventValues,
-                  dwBufferSize,
-                  pRenderedValues,
-                  &dwBufferUsed,
-                  &dwPropertyCount);
-        status = GetLastError();
-      } else {
-        EvtClose(hContext);
-        rb_raise(rb_eRuntimeError, "Failed to malloc memory with %lu\n", status);
-      }
-    }
-
-    if (ERROR_SUCCESS != status) {
-      EvtClose(hContext);
-      RB_ALLOCV_END(vRenderedValues);
 
-      rb_raise(rb_eWinevtQueryError, "EvtRender failed with %lu\n", status);
-    }
+  for (int i = 0; i < SYSTEM_VALUE_KEY_MAX; i++) {
+    values[i] = Qundef;
   }
 
+  pRenderedValues = render_system_variants(renderer, hEvent);
+
   // EVT_VARIANT value with EvtRenderContextSystem will be decomposed
   // as the following enum definition:
   // https://docs.microsoft.com/en-us/windows/win32/api/winevt/ne-winevt-evt_system_property_id
   rbstr = wstr_to_rb_str(CP_UTF8, pRenderedValues[EvtSystemProviderName].StringVal, -1);
-  rb_hash_aset(hash, rb_str_new2("ProviderName"), rbstr);
+  values[SYSTEM_EVENT_KEY_PROVIDER_NAME] = rbstr;
   if (NULL != pRenderedValues[EvtSystemProviderGuid].GuidVal) {
     const GUID* Guid = pRenderedValues[EvtSystemProviderGuid].GuidVal;
     StringFromGUID2(*Guid, wsGuid, _countof(wsGuid));
     rbstr = wstr_to_rb_str(CP_UTF8, wsGuid, -1);
-    rb_hash_aset(hash, rb_str_new2("ProviderGuid"), rbstr);
+    values[SYSTEM_EVENT_KEY_PROVIDER_GUID] = rbstr;
   } else {
-    rb_hash_aset(hash, rb_str_new2("ProviderGuid"), Qnil);
+    values[SYSTEM_EVENT_KEY_PROVIDER_GUID] = Qnil;
   }
 
   EventID = pRenderedValues[EvtSystemEventID].UInt16Val;
   if (preserve_qualifiers) {
     if (EvtVarTypeNull != pRenderedValues[EvtSystemQualifiers].Type) {
-      rb_hash_aset(hash, rb_str_new2("Qualifiers"),
-                   INT2NUM(pRenderedValues[EvtSystemQualifiers].UInt16Val));
+      values[SYSTEM_EVENT_KEY_QUALIFIERS] =
+        INT2NUM(pRenderedValues[EvtSystemQualifiers].UInt16Val);
     } else {
-      rb_hash_aset(hash, rb_str_new2("Qualifiers"), rb_str_new2(""));
+      values[SYSTEM_EVENT_KEY_QUALIFIERS] = rb_str_new2("");
     }
 
-    rb_hash_aset(hash, rb_str_new2("EventID"), INT2NUM(EventID));
+    values[SYSTEM_EVENT_KEY_EVENT_ID] = INT2NUM(EventID);
   } else {
     if (EvtVarTypeNull != pRenderedValues[EvtSystemQualifiers].Type) {
       EventID = MAKELONG(pRenderedValues[EvtSystemEventID].UInt16Val,
                          pRenderedValues[EvtSystemQualifiers].UInt16Val);
     }
 
-    rb_hash_aset(hash, rb_str_new2("EventID"), ULONG2NUM(EventID));
-  }
-
-  rb_hash_aset(hash,
-               rb_str_new2("Version"),
-               (EvtVarTypeNull == pRenderedValues[EvtSystemVersion].Type)
-                 ? INT2NUM(0)
-                 : INT2NUM(pRenderedValues[EvtSystemVersion].ByteVal));
-  rb_hash_aset(hash,
-               rb_str_new2("Level"),
-               (EvtVarTypeNull == pRenderedValues[EvtSystemLevel].Type)
-                 ? INT2NUM(0)
-                 : INT2NUM(pRenderedValues[EvtSystemLevel].ByteVal));
-  rb_hash_aset(hash,
-               rb_str_new2("Task"),
-               (EvtVarTypeNull == pRenderedValues[EvtSystemTask].Type)
-                 ? INT2NUM(0)
-                 : INT2NUM(pRenderedValues[EvtSystemTask].UInt16Val));
-  rb_hash_aset(hash,
-               rb_str_new2("Opcode"),
-               (EvtVarTypeNull == pRenderedValues[EvtSystemOpcode].Type)
-                 ? INT2NUM(0)
-                 : INT2NUM(pRenderedValues[EvtSystemOpcode].ByteVal));
-  _snprintf_s(buffer,
-              _countof(buffer),
-              _TRUNCATE,
-              "0x%llx",
-              pRenderedValues[EvtSystemKeywords].UInt64Val);
-  rb_hash_aset(hash,
-               rb_str_new2("Keywords"),
-               (EvtVarTypeNull == pRenderedValues[EvtSystemKeywords].Type)
-                 ? Qnil
-                 : rb_str_new2(buffer));
-
-  if (EvtVarTypeNull != pRenderedValues[EvtSystemTimeCreated].Type) {
-    ullTimeStamp = pRenderedValues[EvtSystemTimeCreated].FileTimeVal;
-    ft.dwHighDateTime = (DWORD)((ullTimeStamp >> 32) & 0xFFFFFFFF);
-    ft.dwLowDateTime = (DWORD)(ullTimeStamp & 0xFFFFFFFF);
-
-    FileTimeToSystemTime(&ft, &st);
-    ullNanoseconds =
-        (ullTimeStamp % 10000000) *
-        100; // Display nanoseconds instead of milliseconds for higher resolution
-    _snprintf_s(buffer,
-                _countof(buffer),
-                _TRUNCATE,
-                "%02d/%02d/%02d %02d:%02d:%02d.%llu",
-                st.wYear,
-                st.wMonth,
-                st.wDay,
-                st.wHour,
-                st.wMinute,
-                st.wSecond,
-                ullNanoseconds);
-    rb_hash_aset(hash,
-                 rb_str_new2("TimeCreated"),
-                 rb_str_new2(buffer));
+    values[SYSTEM_EVENT_KEY_EVENT_ID] = ULONG2NUM(EventID);
+  }
+
+  values[SYSTEM_EVENT_KEY_VERSION] = (EvtVarTypeNull == pRenderedValues[EvtSystemVersion].Type)
+                                       ? INT2NUM(0)
+                                       : INT2NUM(pRenderedValues[EvtSystemVersion].ByteVal);
+  values[SYSTEM_EVENT_KEY_LEVEL] = (EvtVarTypeNull == pRenderedValues[EvtSystemLevel].Type)
+                                     ? INT2NUM(0)
+                                     : INT2NUM(pRenderedValues[EvtSystemLevel].ByteVal);
+  values[SYSTEM_EVENT_KEY_TASK] = (EvtVarTypeNull == pRenderedValues[EvtSystemTask].Type)
+                                    ? INT2NUM(0)
+                                    : INT2NUM(pRenderedValues[EvtSystemTask].UInt16Val);
+  values[SYSTEM_EVENT_KEY_OPCODE] = (EvtVarTypeNull == pRenderedValues[EvtSystemOpcode].Type)
+                                      ? INT2NUM(0)
+                                      : INT2NUM(pRenderedValues[EvtSystemOpcode].ByteVal);
+  if (EvtVarTypeNull == pRenderedValues[EvtSystemKeywords].Type) {
+    values[SYSTEM_EVENT_KEY_KEYWORDS] = Qnil;
+  } else if (typedValues) {
+    values[SYSTEM_EVENT_KEY_KEYWORDS] = ULL2NUM(pRenderedValues[EvtSystemKeywords].UInt64Val);
+  } else {
+    values[SYSTEM_EVENT_KEY_KEYWORDS] = rb_str_new(
+      buffer,
+      winevt_format_hex_prefixed(pRenderedValues[EvtSystemKeywords].UInt64Val, 1, buffer));
+  }
+
+  if (EvtVarTypeNull == pRenderedValues[EvtSystemTimeCreated].Type) {
+    values[SYSTEM_EVENT_KEY_TIME_CREATED] = Qnil;
+  } else if (typedValues) {
+    values[SYSTEM_EVENT_KEY_TIME_CREATED] =
+      filetime_to_rb_time(pRenderedValues[EvtSystemTimeCreated].FileTimeVal);
   } else {
-    rb_hash_aset(hash,
-                 rb_str_new2("TimeCreated"),
-                 Qnil);
-  }
-  _snprintf_s(buffer,
-              _countof(buffer),
-              _TRUNCATE,
-              "%llu",
-              pRenderedValues[EvtSystemEventRecordId].UInt64Val);
-  rb_hash_aset(hash,
-               rb_str_new2("EventRecordID"),
-               (EvtVarTypeNull == pRenderedValues[EvtSystemEventRecordId].UInt64Val)
-                 ? Qnil
-                 : rb_str_new2(buffer));
+    // Display nanoseconds instead of milliseconds for higher resolution
+    winevt_filetime_to_civil(pRenderedValues[EvtSystemTimeCreated].FileTimeVal, &time);
+    values[SYSTEM_EVENT_KEY_TIME_CREATED] =
+      rb_str_new(buffer, winevt_format_time_created(&time, buffer));
+  }
+
+  if (EvtVarTypeNull == pRenderedValues[EvtSystemEventRecordId].UInt64Val) {
+    values[SYSTEM_EVENT_KEY_EVENT_RECORD_ID] = Qnil;
+  } else if (typedValues) {
+    values[SYSTEM_EVENT_KEY_EVENT_RECORD_ID] =
+      ULL2NUM(pRenderedValues[EvtSystemEventRecordId].UInt64Val);
+  } else {
+    values[SYSTEM_EVENT_KEY_EVENT_RECORD_ID] = rb_str_new(
+      buffer,
+      winevt_format_uint(pRenderedValues[EvtSystemEventRecordId].UInt64Val, 1, buffer));
+  }
 
   if (EvtVarTypeNull != pRenderedValues[EvtSystemActivityID].Type) {
     const GUID* Guid = pRenderedValues[EvtSystemActivityID].GuidVal;
     StringFromGUID2(*Guid, wsGuid, _countof(wsGuid));
     rbstr = wstr_to_rb_str(CP_UTF8, wsGuid, -1);
-    rb_hash_aset(hash, rb_str_new2("ActivityID"), rbstr);
+    values[SYSTEM_EVENT_KEY_ACTIVITY_ID] = rbstr;
   }
 
   if (EvtVarTypeNull != pRenderedValues[EvtSystemRelatedActivityID].Type) {
     const GUID* Guid = pRenderedValues[EvtSystemRelatedActivityID].GuidVal;
     StringFromGUID2(*Guid, wsGuid, _countof(wsGuid));
     rbstr = wstr_to_rb_str(CP_UTF8, wsGuid, -1);
-    rb_hash_aset(hash, rb_str_new2("RelatedActivityID"), rbstr);
+    values[SYSTEM_EVENT_KEY_RELATED_ACTIVITY_ID] = rbstr;
   }
 
-  rb_hash_aset(hash,
-               rb_str_new2("ProcessID"),
-               UINT2NUM(pRenderedValues[EvtSystemProcessID].UInt32Val));
-  rb_hash_aset(hash,
-               rb_str_new2("ThreadID"),
-               UINT2NUM(pRenderedValues[EvtSystemThreadID].UInt32Val));
+  values[SYSTEM_EVENT_KEY_PROCESS_ID] =
+    UINT2NUM(pRenderedValues[EvtSystemProcessID].UInt32Val);
+  values[SYSTEM_EVENT_KEY_THREAD_ID] =
+    UINT2NUM(pRenderedValues[EvtSystemThreadID].UInt32Val);
   rbstr = wstr_to_rb_str(CP_UTF8, pRenderedValues[EvtSystemChannel].StringVal, -1);
-  rb_hash_aset(hash, rb_str_new2("Channel"), rbstr);
+  values[SYSTEM_EVENT_KEY_CHANNEL] = rbstr;
   rbstr = wstr_to_rb_str(CP_UTF8, pRenderedValues[EvtSystemComputer].StringVal, -1);
-  rb_hash_aset(hash, rb_str_new2("Computer"), rbstr);
+  values[SYSTEM_EVENT_KEY_COMPUTER] = rbstr;
 
   if (EvtVarTypeNull != pRenderedValues[EvtSystemUserID].Type) {
-    if (ConvertSidToStringSid(pRenderedValues[EvtSystemUserID].SidVal, &pwsSid)) {
-      CHAR *expandSID = NULL;
-      if (preserveSID_p) {
-        rbstr = rb_utf8_str_new_cstr(pwsSid);
-        rb_hash_aset(hash, rb_str_new2("UserID"), rbstr);
+    struct WinevtUserSid user;
+
+    render_user_sid(renderer, pRenderedValues[EvtSystemUserID].SidVal, &user);
+    if (user.hasSid && preserveSID_p) {
+      values[SYSTEM_EVENT_KEY_USER_ID] = rb_utf8_str_new(user.sid.data(), user.sid.size());
+    }
+    if (user.hasAccount) {
+      values[SYSTEM_EVENT_KEY_USER] = rb_utf8_str_new(user.account.data(), user.account.size());
+    }
+  }
+}
+
+VALUE
+render_system_event(struct WinevtRenderer* renderer, EVT_HANDLE hEvent,
+                    BOOL preserve_qualifiers, BOOL preserveSID_p,
+                    BOOL symbolize_keys, BOOL typedValues)
+{
+  const VALUE* keys = get_system_event_keys(symbolize_keys);
+  VALUE values[SYSTEM_VALUE_KEY_MAX];
+  VALUE hash = rb_hash_new();
+
+  render_system_values(
+    renderer, hEvent, preserve_qualifiers, preserveSID_p, typedValues, values);
+  for (int i = 0; i < SYSTEM_VALUE_KEY_MAX; i++) {
+    if (values[i] != Qundef) {
+      rb_hash_aset(hash, keys[i], values[i]);
+    }
+  }
+
+  return hash;
+}
+
+/*
+ * Appends the system values of hEvent, the index-th of count events
+ * in a batch, to columns which are indexed by SystemEventKey. Columns
+ * are created on the first event which has their value, with nil for
+ * the events before it, and nil is appended for the events which do
+ * not have it. So every column has one element per event.
+ */
+void
+append_system_event_columns(struct WinevtRenderer* renderer, EVT_HANDLE hEvent,
+                            BOOL preserve_qualifiers, BOOL preserveSID_p,
+                            BOOL typedValues, VALUE* columns, long index, long count)
+{
+  VALUE values[SYSTEM_VALUE_KEY_MAX];
+
+  render_system_values(
+    renderer, hEvent, preserve_qualifiers, preserveSID_p, typedValues, values);
+  for (int i = 0; i < SYSTEM_VALUE_KEY_MAX; i++) {
+    if (values[i] == Qundef) {
+      if (!NIL_P(columns[i])) {
+        rb_ary_push(columns[i], Qnil);
       }
-      /* S-1-15-3- is used for capability SIDs. So, we need to skip
-       * SID translation.
-       * ref: https://learn.microsoft.com/en-us/windows-server/identity/ad-ds/manage/understand-security-identifiers
-       * See also: https://learn.microsoft.com/en-us/troubleshoot/windows-server/windows-security/sids-not-resolve-into-friendly-names
-       */
-      if (strnicmp(pwsSid, "S-1-15-3-", 9) != 0) {
-        if (ExpandSIDWString(pRenderedValues[EvtSystemUserID].SidVal,
-                             &expandSID) == 0) {
-          rbstr = rb_utf8_str_new_cstr(expandSID);
-          free(expandSID);
-          rb_hash_aset(hash, rb_str_new2("User"), rbstr);
-        }
+      continue;
+    }
+    if (NIL_P(columns[i])) {
+      columns[i] = rb_ary_new_capa(count);
+      for (long j = 0; j < index; j++) {
+        rb_ary_push(columns[i], Qnil);
       }
-      LocalFree(pwsSid);
     }
+    rb_ary_push(columns[i], values[i]);
   }
+}
 
-  EvtClose(hContext);
-  RB_ALLOCV_END(vRenderedValues);
+/* Makes a Hash of the columns which are not nil. */
+VALUE
+batch_columns_to_rb_hash(const VALUE* columns, BOOL symbolize_keys)
+{
+  const VALUE* keys = get_system_event_keys(symbolize_keys);
+  VALUE hash = rb_hash_new();
+
+  for (int i = 0; i < SYSTEM_EVENT_KEY_MAX; i++) {
+    if (!NIL_P(columns[i])) {
+      rb_hash_aset(hash, keys[i], columns[i]);
+    }
+  }
 
   return hash;
 }
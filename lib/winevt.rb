@@ -3,11 +3,15 @@ begin
 rescue LoadError
   require "winevt/winevt"
 end
-require "winevt/bookmark"
-require "winevt/query"
-require "winevt/subscribe"
 require "winevt/version"
-require "winevt/session"
+# Only EventLog::File is available on platforms other than Windows,
+# unless the extension is built with --enable-fake-backend.
+if Gem.win_platform? || Winevt::EventLog.const_defined?(:Query)
+  require "winevt/bookmark"
+  require "winevt/query"
+  require "winevt/subscribe"
+  require "winevt/session"
+end
 
 module Winevt
   # Your code goes here...
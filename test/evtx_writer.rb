@@ -0,0 +1,426 @@
+require "digest/md5"
+require "zlib"
+
+# Writes EVTX files for tests and benchmarks, so that
+# Winevt::EventLog::File can be exercised without Windows.
+#
+# Records are written as template instances as Windows does. The first
+# record of a chunk with a given shape defines the template and its
+# names inline. The following records refer to them by offset.
+class EvtxWriter
+  FILE_HEADER_SIZE = 4096
+  CHUNK_SIZE = 65536
+  CHUNK_HEADER_SIZE = 512
+  EVENT_NAMESPACE = "http://schemas.microsoft.com/win/2004/08/events/event"
+  FILETIME_EPOCH_OFFSET = 116444736000000000
+
+  module Type
+    NULL = 0x00
+    WSTRING = 0x01
+    INT8 = 0x03
+    UINT8 = 0x04
+    INT16 = 0x05
+    UINT16 = 0x06
+    INT32 = 0x07
+    UINT32 = 0x08
+    INT64 = 0x09
+    UINT64 = 0x0a
+    REAL32 = 0x0b
+    REAL64 = 0x0c
+    BOOL = 0x0d
+    BINARY = 0x0e
+    GUID = 0x0f
+    SIZET = 0x10
+    FILETIME = 0x11
+    SYSTIME = 0x12
+    SID = 0x13
+    HEXINT32 = 0x14
+    HEXINT64 = 0x15
+    BINXML = 0x21
+    ARRAY = 0x80
+  end
+
+  # A value whose type is given explicitly.
+  Value = Struct.new(:type, :bytes)
+
+  def initialize
+    @chunks = []
+    @next_record_id = 1
+    new_chunk
+  end
+
+  # Adds an event. data is a Hash of EventData/Data names and values.
+  # Data elements of keys which are not Strings have no Name attribute.
+  # user_data is a Hash which is rendered as
+  # <UserData><name xmlns=...><key>value</key>...</name></UserData>.
+  def add(provider_name: "TestProvider", provider_guid: nil, event_id: 1,
+          qualifiers: nil, version: 0, level: 4, task: 0, opcode: 0,
+          keywords: 0x80000000000000, time_created: Time.at(0),
+          process_id: 0, thread_id: 0, channel: "Application",
+          computer: "localhost", user_id: nil, activity_id: nil,
+          data: {}, user_data: nil)
+    record_id = @next_record_id
+    values = [
+      wstring(provider_name),
+      provider_guid ? Value.new(Type::GUID, pack_guid(provider_guid)) : null,
+      qualifiers ? Value.new(Type::UINT16, [qualifiers].pack("v")) : null,
+      Value.new(Type::UINT16, [event_id].pack("v")),
+      Value.new(Type::UINT8, [version].pack("C")),
+      Value.new(Type::UINT8, [level].pack("C")),
+      Value.new(Type::UINT16, [task].pack("v")),
+      Value.new(Type::UINT8, [opcode].pack("C")),
+      Value.new(Type::HEXINT64, [keywords].pack("Q<")),
+      Value.new(Type::FILETIME, [filetime(time_created)].pack("Q<")),
+      Value.new(Type::UINT64, [record_id].pack("Q<")),
+      activity_id ? Value.new(Type::GUID, pack_guid(activity_id)) : null,
+      Value.new(Type::UINT32, [process_id].pack("V")),
+      Value.new(Type::UINT32, [thread_id].pack("V")),
+      wstring(channel),
+      wstring(computer),
+      user_id ? Value.new(Type::SID, pack_sid(user_id)) : null,
+    ]
+    if user_data
+      values << user_data
+    else
+      values.concat(data.values.map { |value| to_value(value) })
+    end
+    shape = user_data ? [:user_data] : data.keys
+
+    unless @chunk.add_record(record_id, filetime(time_created), shape, values)
+      new_chunk
+      unless @chunk.add_record(record_id, filetime(time_created), shape, values)
+        raise ArgumentError, "event is too large for a chunk"
+      end
+    end
+    @next_record_id += 1
+  end
+
+  def write(path)
+    File.open(path, "wb") do |file|
+      file.write(file_header)
+      @chunks.each do |chunk|
+        file.write(chunk.to_s)
+      end
+    end
+  end
+
+  # Packs object as a value of type, one of Type. object is what Query
+  # yields with typed values: an Integer, a Float, a Time for FILETIME
+  # and SYSTIME, a "{...}" String for GUID and a "S-1-..." String for SID.
+  def value(type, object)
+    bytes =
+      case type
+      when Type::NULL then "".b
+      when Type::WSTRING then object.encode("UTF-16LE").b
+      when Type::INT8 then [object].pack("c")
+      when Type::UINT8 then [object].pack("C")
+      when Type::INT16 then [object].pack("s<")
+      when Type::UINT16 then [object].pack("v")
+      when Type::INT32 then [object].pack("l<")
+      when Type::UINT32, Type::HEXINT32 then [object].pack("V")
+      when Type::INT64 then [object].pack("q<")
+      when Type::UINT64, Type::SIZET, Type::HEXINT64 then [object].pack("Q<")
+      when Type::REAL32 then [object].pack("e")
+      when Type::REAL64 then [object].pack("E")
+      when Type::BOOL then [object ? 1 : 0].pack("V")
+      when Type::BINARY then object.b
+      when Type::GUID then pack_guid(object)
+      when Type::FILETIME then [filetime(object)].pack("Q<")
+      when Type::SYSTIME then pack_systime(object)
+      when Type::SID then pack_sid(object)
+      else raise ArgumentError, "unsupported type: #{type}"
+      end
+    Value.new(type, bytes)
+  end
+
+  # Writes a file which contains count events with string inserts.
+  def self.generate(path, count)
+    writer = new
+    count.times do |i|
+      writer.add(provider_name: "Benchmark", event_id: 1000 + i % 10,
+                 time_created: Time.at(1_600_000_000 + i), process_id: 4,
+                 thread_id: 100 + i % 7, computer: "bench.example.com",
+                 user_id: "S-1-5-18",
+                 data: {"Message" => "event #{i}", "Count" => i, "Path" => "C:\\Windows\\System32\\svchost.exe"})
+    end
+    writer.write(path)
+  end
+
+  private
+
+  def null
+    Value.new(Type::NULL, "".b)
+  end
+
+  def wstring(string)
+    Value.new(Type::WSTRING, string.encode("UTF-16LE").b)
+  end
+
+  def to_value(value)
+    case value
+    when Value then value
+    when nil then null
+    when String then wstring(value)
+    when true, false then Value.new(Type::BOOL, [value ? 1 : 0].pack("V"))
+    when Float then Value.new(Type::REAL64, [value].pack("E"))
+    when Time then Value.new(Type::FILETIME, [filetime(value)].pack("Q<"))
+    when Integer
+      if value >= 0 && value < 2**32
+        Value.new(Type::UINT32, [value].pack("V"))
+      else
+        Value.new(Type::INT64, [value].pack("q<"))
+      end
+    else
+      raise ArgumentError, "unsupported value: #{value.inspect}"
+    end
+  end
+
+  def filetime(time)
+    (time.to_r * 10_000_000).to_i + FILETIME_EPOCH_OFFSET
+  end
+
+  def pack_systime(time)
+    time = time.getutc
+    [time.year, time.month, time.wday, time.day, time.hour, time.min, time.sec,
+     time.usec / 1000].pack("v8")
+  end
+
+  def pack_guid(guid)
+    hex = guid.delete("{}-")
+    [hex[0, 8].hex, hex[8, 4].hex, hex[12, 4].hex].pack("Vvv") + [hex[16, 16]].pack("H*")
+  end
+
+  def pack_sid(sid)
+    _, revision, authority, *sub_authorities = sid.split("-")
+    [revision.to_i, sub_authorities.size].pack("CC") +
+      [authority.to_i].pack("Q>")[2, 6] + sub_authorities.map(&:to_i).pack("V*")
+  end
+
+  def new_chunk
+    @chunk = Chunk.new(@next_record_id)
+    @chunks << @chunk
+  end
+
+  def file_header
+    header = "ElfFile\0".b
+    header << [0, @chunks.size - 1, @next_record_id].pack("Q<Q<Q<")
+    header << [128, 1, 3, FILE_HEADER_SIZE, @chunks.size].pack("VvvvV")
+    header << "\0".b * (120 - header.bytesize)
+    header << [0].pack("V") # flags
+    header << [Zlib.crc32(header[0, 120])].pack("V")
+    header << "\0".b * (FILE_HEADER_SIZE - header.bytesize)
+  end
+
+  class Chunk
+    def initialize(first_record_id)
+      @data = "\0".b * CHUNK_HEADER_SIZE
+      @names = {}
+      @templates = {}
+      @first_record_id = first_record_id
+      @last_record_id = first_record_id - 1
+      @last_record_offset = 0
+    end
+
+    def add_record(record_id, written_time, shape, values)
+      start = @data.bytesize
+      names = @names.dup
+      templates = @templates.dup
+
+      @data << [0x2a2a, 0, record_id, written_time].pack("VVQ<Q<")
+      @data << [0x0f, 1, 1, 0].pack("C4")
+      template_instance(shape, values)
+      @data << [0x00].pack("C")
+      size = @data.bytesize - start + 4
+      @data << [size].pack("V")
+      @data[start + 4, 4] = [size].pack("V")
+
+      if @data.bytesize > CHUNK_SIZE
+        @data = @data[0, start]
+        @names = names
+        @templates = templates
+        return false
+      end
+
+      @last_record_id = record_id
+      @last_record_offset = start
+      true
+    end
+
+    def to_s
+      free_space = @data.bytesize
+      header = "ElfChnk\0".b
+      header << [1, @last_record_id - @first_record_id + 1,
+                 @first_record_id, @last_record_id].pack("Q<4")
+      header << [128, @last_record_offset, free_space,
+                 Zlib.crc32(@data[CHUNK_HEADER_SIZE..-1])].pack("V4")
+      header << "\0".b * (124 - header.bytesize)
+      chunk = header + [0].pack("V") + @data[128...CHUNK_HEADER_SIZE] + @data[CHUNK_HEADER_SIZE..-1]
+      chunk[124, 4] = [Zlib.crc32(chunk[0, 120] + chunk[128, 384])].pack("V")
+      chunk + "\0".b * (CHUNK_SIZE - chunk.bytesize)
+    end
+
+    private
+
+    def pos
+      @data.bytesize
+    end
+
+    def name(string)
+      if @names.key?(string)
+        @data << [@names[string]].pack("V")
+        return
+      end
+
+      offset = pos + 4
+      @names[string] = offset
+      hash = string.each_codepoint.reduce(0) { |h, c| (h * 65599 + c) & 0xffffffff }
+      @data << [offset, 0, hash & 0xffff, string.size].pack("VVvv")
+      @data << string.encode("UTF-16LE").b << "\0\0".b
+    end
+
+    def open_element(element, has_attributes: false)
+      @data << [has_attributes ? 0x41 : 0x01, 0xffff, 0].pack("CvV")
+      name(element)
+      @data << [0].pack("V") if has_attributes
+    end
+
+    def attribute(attribute)
+      @data << [0x06].pack("C")
+      name(attribute)
+    end
+
+    def text(string)
+      @data << [0x05, Type::WSTRING, string.size].pack("CCv") << string.encode("UTF-16LE").b
+    end
+
+    def substitution(index, type, optional: true)
+      @data << [optional ? 0x0e : 0x0d, index, type].pack("CvC")
+    end
+
+    def close_start_element
+      @data << [0x02].pack("C")
+    end
+
+    def close_empty_element
+      @data << [0x03].pack("C")
+    end
+
+    def end_element
+      @data << [0x04].pack("C")
+    end
+
+    def element(element, attributes = {})
+      open_element(element, has_attributes: !attributes.empty?)
+      attributes.each do |attribute_name, (index, type)|
+        attribute(attribute_name)
+        substitution(index, type)
+      end
+      if block_given?
+        close_start_element
+        yield
+        end_element
+      else
+        close_empty_element
+      end
+    end
+
+    def template_instance(shape, values)
+      @data << [0x0c, 0x01, Zlib.crc32(shape.inspect)].pack("CCV")
+      if @templates.key?(shape)
+        @data << [@templates[shape]].pack("V")
+      else
+        definition = pos + 4
+        @templates[shape] = definition
+        @data << [definition].pack("V")
+        # Templates are identified by GUID across chunks.
+        @data << [0].pack("V") << Digest::MD5.digest(shape.inspect) << [0].pack("V")
+        body = pos
+        @data << [0x0f, 1, 1, 0].pack("C4")
+        template_body(shape)
+        @data << [0x00].pack("C")
+        @data[definition + 20, 4] = [pos - body].pack("V")
+      end
+
+      @data << [values.size].pack("V")
+      descriptors = pos
+      @data << "\0".b * (values.size * 4)
+      values.each_with_index do |value, i|
+        start = pos
+        if value.is_a?(Hash)
+          user_data_fragment(value)
+          type = Type::BINXML
+        else
+          @data << value.bytes
+          type = value.type
+        end
+        @data[descriptors + i * 4, 4] = [pos - start, type, 0].pack("vCC")
+      end
+    end
+
+    def template_body(shape)
+      open_element("Event", has_attributes: true)
+      attribute("xmlns")
+      text(EVENT_NAMESPACE)
+      close_start_element
+      element("System") do
+        element("Provider", "Name" => [0, Type::WSTRING], "Guid" => [1, Type::GUID])
+        element("EventID", "Qualifiers" => [2, Type::UINT16]) { substitution(3, Type::UINT16) }
+        element("Version") { substitution(4, Type::UINT8) }
+        element("Level") { substitution(5, Type::UINT8) }
+        element("Task") { substitution(6, Type::UINT16) }
+        element("Opcode") { substitution(7, Type::UINT8) }
+        element("Keywords") { substitution(8, Type::HEXINT64) }
+        element("TimeCreated", "SystemTime" => [9, Type::FILETIME])
+        element("EventRecordID") { substitution(10, Type::UINT64) }
+        element("Correlation", "ActivityID" => [11, Type::GUID])
+        element("Execution", "ProcessID" => [12, Type::UINT32], "ThreadID" => [13, Type::UINT32])
+        element("Channel") { substitution(14, Type::WSTRING) }
+        element("Computer") { substitution(15, Type::WSTRING) }
+        element("Security", "UserID" => [16, Type::SID])
+      end
+      if shape == [:user_data]
+        substitution(17, Type::BINXML)
+      elsif shape.empty?
+        element("EventData")
+      else
+        element("EventData") do
+          shape.each_with_index do |data_name, i|
+            unless data_name.is_a?(String)
+              element("Data") { substitution(17 + i, Type::WSTRING) }
+              next
+            end
+            open_element("Data", has_attributes: true)
+            attribute("Name")
+            text(data_name)
+            close_start_element
+            substitution(17 + i, Type::WSTRING)
+            end_element
+          end
+        end
+      end
+      end_element
+    end
+
+    # Nested binary XML without templates, as in UserData.
+    def user_data_fragment(user_data)
+      @data << [0x0f, 1, 1, 0].pack("C4")
+      open_element("UserData")
+      close_start_element
+      user_data.each do |element_name, children|
+        open_element(element_name, has_attributes: true)
+        attribute("xmlns")
+        text("http://example.com/#{element_name}")
+        close_start_element
+        children.each do |child, value|
+          open_element(child)
+          close_start_element
+          text(value.to_s)
+          end_element
+        end
+        end_element
+      end
+      end_element
+      @data << [0x00].pack("C")
+    end
+  end
+end
@@ -0,0 +1,42 @@
+#ifndef _NATIVE_TEST_H_
+#define _NATIVE_TEST_H_
+
+// Checks of the native tests, which test/test_native.rb builds and runs.
+// A failed check is printed to stderr and makes the program exit with
+// native_test_status() as EXIT_FAILURE.
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+static int native_test_failures = 0;
+
+static inline void
+check(const char* name, bool condition)
+{
+  if (!condition) {
+    fprintf(stderr, "FAIL: %s\n", name);
+    native_test_failures++;
+  }
+}
+
+static inline void
+check_equal(const char* name, const std::string& expected, const std::string& actual)
+{
+  if (expected != actual) {
+    fprintf(stderr,
+            "FAIL: %s: expected \"%s\" but was \"%s\"\n",
+            name,
+            expected.c_str(),
+            actual.c_str());
+    native_test_failures++;
+  }
+}
+
+static inline int
+native_test_status()
+{
+  return native_test_failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+#endif // _NATIVE_TEST_H_
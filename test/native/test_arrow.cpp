@@ -0,0 +1,210 @@
+// Checks the messages which winevt_arrow.h writes by reading them back
+// with a minimal reader of the Arrow IPC stream format.
+#include "native_test.h"
+
+#include <winevt_arrow.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+template<typename T>
+static T
+read(const std::string& buffer, size_t position)
+{
+  T value;
+  memcpy(&value, buffer.data() + position, sizeof(T));
+  return value;
+}
+
+// Minimal reader of the tables of a FlatBuffer.
+struct FlatTable
+{
+  const std::string& buffer;
+  size_t table;
+
+  size_t field(uint16_t slot) const
+  {
+    size_t vtable = table - read<int32_t>(buffer, table);
+    if (4 + slot * 2 >= read<uint16_t>(buffer, vtable)) {
+      return 0;
+    }
+    uint16_t offset = read<uint16_t>(buffer, vtable + 4 + slot * 2);
+    return offset == 0 ? 0 : table + offset;
+  }
+
+  template<typename T>
+  T scalar(uint16_t slot) const
+  {
+    size_t position = field(slot);
+    return position == 0 ? T() : read<T>(buffer, position);
+  }
+
+  size_t offset(uint16_t slot) const
+  {
+    size_t position = field(slot);
+    return position + read<uint32_t>(buffer, position);
+  }
+};
+
+struct Message
+{
+  uint8_t headerType;
+  int64_t length;
+  std::vector<int64_t> nodes;
+  std::vector<int64_t> buffers;
+  std::string body;
+};
+
+static bool
+read_messages(const std::string& stream, std::vector<Message>& messages)
+{
+  size_t position = 0;
+
+  while (position + 8 <= stream.size()) {
+    if (read<uint32_t>(stream, position) != 0xffffffff) {
+      return false;
+    }
+    uint32_t size = read<uint32_t>(stream, position + 4);
+    position += 8;
+    if (size == 0) {
+      return position == stream.size();
+    }
+    if (size % 8 != 0 || position + size > stream.size()) {
+      return false;
+    }
+    std::string metadata = stream.substr(position, size);
+    FlatTable message{ metadata, read<uint32_t>(metadata, 0) };
+    FlatTable header{ metadata, message.offset(2) };
+    Message result = Message();
+    result.headerType = message.scalar<uint8_t>(1);
+    if (message.scalar<int16_t>(0) != WinevtArrowWriter::METADATA_VERSION_V5) {
+      return false;
+    }
+    if (result.headerType == WinevtArrowWriter::MESSAGE_HEADER_RECORD_BATCH) {
+      result.length = header.scalar<int64_t>(0);
+      for (uint16_t slot = 1; slot <= 2; slot++) {
+        size_t vector = header.offset(slot);
+        std::vector<int64_t>& values = slot == 1 ? result.nodes : result.buffers;
+        for (uint32_t i = 0; i < read<uint32_t>(metadata, vector) * 2; i++) {
+          values.push_back(read<int64_t>(metadata, vector + 4 + i * 8));
+        }
+      }
+    }
+    int64_t bodyLength = message.scalar<int64_t>(3);
+    position += size;
+    result.body = stream.substr(position, static_cast<size_t>(bodyLength));
+    position += static_cast<size_t>(bodyLength);
+    messages.push_back(result);
+  }
+
+  return false;
+}
+
+static std::vector<WinevtArrowColumn>
+event_columns()
+{
+  std::vector<WinevtArrowColumn> columns;
+
+  columns.push_back(WinevtArrowColumn("ProviderName", WINEVT_ARROW_UTF8));
+  columns.push_back(WinevtArrowColumn("EventID", WINEVT_ARROW_UINT32));
+  columns.push_back(WinevtArrowColumn("Level", WINEVT_ARROW_UINT8));
+  columns.push_back(WinevtArrowColumn("Task", WINEVT_ARROW_UINT16));
+  columns.push_back(WinevtArrowColumn("Keywords", WINEVT_ARROW_UINT64));
+  columns.push_back(WinevtArrowColumn("TimeCreated", WINEVT_ARROW_TIMESTAMP));
+  columns.push_back(WinevtArrowColumn("Computer", WINEVT_ARROW_UTF8));
+  columns.push_back(WinevtArrowColumn("Message", WINEVT_ARROW_UTF8));
+  columns.push_back(WinevtArrowColumn("StringInserts", WINEVT_ARROW_UTF8_LIST));
+
+  return columns;
+}
+
+static void
+append_event(std::vector<WinevtArrowColumn>& columns, uint64_t i)
+{
+  char message[128];
+
+  columns[0].appendString("Microsoft-Windows-Security-Auditing", 35);
+  columns[1].appendInteger(4624 + i % 8);
+  columns[2].appendInteger(i % 5);
+  if (i % 3 == 0) {
+    columns[3].appendNull();
+  } else {
+    columns[3].appendInteger(12544);
+  }
+  columns[4].appendInteger(0x8020000000000000ULL);
+  columns[5].appendInteger(1704067200000000000ULL + i * 1000);
+  columns[6].appendString("WIN-HOST.example.com", 20);
+  int length = snprintf(message, sizeof(message), "An account was successfully logged on. %llu",
+                        static_cast<unsigned long long>(i));
+  columns[7].appendString(message, static_cast<size_t>(length));
+  for (uint64_t j = 0; j < i % 4; j++) {
+    columns[8].item().appendString("S-1-5-18", 8);
+  }
+  columns[8].endList();
+}
+
+static void
+check_stream()
+{
+  std::vector<WinevtArrowColumn> columns = event_columns();
+  std::vector<Message> messages;
+  std::string stream;
+
+  WinevtArrowWriter::writeSchema(columns, stream);
+  for (uint64_t i = 0; i < 10; i++) {
+    append_event(columns, i);
+  }
+  WinevtArrowWriter::writeRecordBatch(columns, stream);
+  for (WinevtArrowColumn& column : columns) {
+    column.clear();
+  }
+  WinevtArrowWriter::writeRecordBatch(columns, stream);
+  WinevtArrowWriter::writeEndOfStream(stream);
+
+  check("stream", read_messages(stream, messages));
+  check("messages", messages.size() == 3);
+  if (messages.size() != 3) {
+    return;
+  }
+  check("schema", messages[0].headerType == WinevtArrowWriter::MESSAGE_HEADER_SCHEMA);
+  check("schema body", messages[0].body.empty());
+
+  const Message& batch = messages[1];
+  check("record batch", batch.headerType == WinevtArrowWriter::MESSAGE_HEADER_RECORD_BATCH);
+  check("length", batch.length == 10);
+  // Nine columns and the items of StringInserts.
+  check("nodes", batch.nodes.size() == 10 * 2);
+  // Three buffers of each string column, two of the others.
+  check("buffers", batch.buffers.size() == 24 * 2);
+  for (size_t i = 0; i < batch.buffers.size(); i += 2) {
+    check("buffer alignment", batch.buffers[i] % 8 == 0);
+    check("buffer bounds",
+          static_cast<size_t>(batch.buffers[i] + batch.buffers[i + 1]) <= batch.body.size());
+  }
+  check("body alignment", batch.body.size() % 8 == 0);
+
+  // Task is the only column with nulls and needs its validity bitmap.
+  check("null count", batch.nodes[3 * 2 + 1] == 4);
+  check("validity", batch.buffers[0 * 2 + 1] == 0 && batch.buffers[7 * 2 + 1] == 2);
+  check("validity bits",
+        read<uint16_t>(batch.body, static_cast<size_t>(batch.buffers[7 * 2])) == 0x1b6);
+  check("values", read<uint32_t>(batch.body, static_cast<size_t>(batch.buffers[4 * 2])) == 4624);
+  // 0 + 1 + 2 + 3 + 0 + 1 + 2 + 3 + 0 + 1 inserts.
+  check("items", batch.nodes[9 * 2] == 13);
+  size_t offsets = static_cast<size_t>(batch.buffers[20 * 2]);
+  check("list offsets",
+        read<int32_t>(batch.body, offsets + 4 * 4) == 6 &&
+          read<int32_t>(batch.body, offsets + 10 * 4) == 13);
+  check("strings", batch.body.find("An account was successfully logged on. 9") != std::string::npos);
+
+  check("empty record batch", messages[2].length == 0 && messages[2].body.size() % 8 == 0);
+}
+
+int
+main()
+{
+  check_stream();
+
+  return native_test_status();
+}
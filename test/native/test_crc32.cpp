@@ -0,0 +1,60 @@
+// Checks winevt_crc32, slicing-by-8 and the PCLMULQDQ folding when the
+// CPU supports it against a bitwise reference.
+#include "native_test.h"
+
+#include <winevt_crc32.h>
+
+#include <random>
+#include <vector>
+
+static uint32_t
+reference_crc32(const uint8_t* p, size_t len)
+{
+  uint32_t crc = 0xffffffff;
+
+  for (size_t i = 0; i < len; i++) {
+    crc ^= p[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ ((crc & 1) ? WINEVT_CRC32_POLYNOMIAL : 0);
+    }
+  }
+
+  return ~crc;
+}
+
+int
+main()
+{
+  std::mt19937 rng(20241016);
+  std::vector<uint8_t> data(70000);
+
+  for (uint8_t& byte : data) {
+    byte = static_cast<uint8_t>(rng());
+  }
+
+  // "123456789" is the standard check value.
+  check("check value", winevt_crc32(0, "123456789", 9) == 0xcbf43926);
+
+  for (size_t len = 0; len <= 300; len++) {
+    for (size_t offset = 0; offset < 8; offset++) {
+      const uint8_t* p = data.data() + offset;
+      uint32_t expected = reference_crc32(p, len);
+
+      check("winevt_crc32", winevt_crc32(0, p, len) == expected);
+      check("slicing-by-8", ~winevt_crc32_slicing_by_8(0xffffffff, p, len) == expected);
+#ifdef WINEVT_CRC32_PCLMUL
+      if (len >= 64 && len % 16 == 0 && winevt_cpu_has(WINEVT_CPU_PCLMUL | WINEVT_CPU_SSE4_1)) {
+        check("pclmul", ~winevt_crc32_pclmul(0xffffffff, p, len) == expected);
+      }
+#endif
+    }
+  }
+
+  // EVTX chunk sized input, and an update in two parts.
+  uint32_t whole = winevt_crc32(0, data.data(), 65536);
+  check("chunk", whole == reference_crc32(data.data(), 65536));
+  check("update",
+        winevt_crc32(winevt_crc32(0, data.data(), 1000), data.data() + 1000, 64536) == whole);
+
+  return native_test_status();
+}
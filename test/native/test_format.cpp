@@ -0,0 +1,185 @@
+// Checks the formatters of winevt_format.h against the printf formats
+// they replace, and the civil times against gmtime.
+#include "native_test.h"
+
+#include <winevt_format.h>
+
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <ctime>
+#include <random>
+#include <string>
+#include <vector>
+
+static std::string
+printf_string(const char* format, ...)
+{
+  char buf[512];
+  va_list args;
+
+  va_start(args, format);
+  vsnprintf(buf, sizeof(buf), format, args);
+  va_end(args);
+
+  return buf;
+}
+
+// gmtime is the reference for the civil time. FILETIME starts 11644473600
+// seconds before the Unix epoch.
+static bool
+reference_civil(uint64_t filetime, struct tm* tm)
+{
+  time_t t = static_cast<time_t>(static_cast<int64_t>(filetime / 10000000) - 11644473600LL);
+#ifdef _WIN32
+  return gmtime_s(tm, &t) == 0;
+#else
+  return gmtime_r(&t, tm) != nullptr;
+#endif /* _WIN32 */
+}
+
+static void
+check_format(const char* name, const std::string& expected, const char* buf, size_t length)
+{
+  check_equal(name, expected, std::string(buf, length));
+}
+
+static void
+check_doubles(std::mt19937_64& rng)
+{
+  char buf[256];
+  std::vector<double> values = {
+    0.0, -0.0, 1.0, -1.0, 0.5, 1.5, 2.5, 0.1, 0.0000005, 0.0000015, 0.0000025,
+    0.0078125, 0.0234375, 1e-7, 4.9e-324, 2.2250738585072014e-308, 123456.7890125,
+    8796093022207.999, 8796093022208.0, 1e15, 1e300, 3.4028234663852886e38,
+    INFINITY, -INFINITY, NAN, 0.1f, 3.14159265f, 16777216.0f,
+  };
+
+  // Multiples of 1/128 include exact ties at the sixth decimal place.
+  for (int k = 0; k < 4096; k++) {
+    values.push_back(k / 128.0);
+    values.push_back(k / 2097152.0);
+    values.push_back(k / 4194304.0 + 1000.0);
+  }
+  for (int i = 0; i < 200000; i++) {
+    uint64_t bits = rng();
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    values.push_back(value);
+    values.push_back(std::ldexp(static_cast<double>(rng() >> 11), -static_cast<int>(rng() % 100)));
+    values.push_back(static_cast<double>(static_cast<float>(
+      std::ldexp(static_cast<double>(rng() >> 40), -static_cast<int>(rng() % 40)))));
+  }
+
+  // Large values are truncated to the buffer as snprintf does.
+  for (double value : values) {
+    size_t length = winevt_format_fixed(value, buf, sizeof(buf));
+    check_format("fixed", printf_string("%f", value).substr(0, sizeof(buf) - 1), buf, length);
+  }
+}
+
+static void
+check_integers(std::mt19937_64& rng)
+{
+  char buf[WINEVT_FORMAT_BUFFER_SIZE];
+  std::vector<uint64_t> values = { 0, 1, 9, 10, 99, 100, 0xf, 0x10, 0xffffffff, UINT64_MAX };
+
+  for (int shift = 0; shift < 64; shift++) {
+    values.push_back(1ULL << shift);
+    values.push_back((1ULL << shift) - 1);
+  }
+  for (int i = 0; i < 200000; i++) {
+    values.push_back(rng() >> (rng() % 64));
+  }
+
+  for (uint64_t value : values) {
+    unsigned long long v = value;
+    check_format("uint", printf_string("%llu", v), buf, winevt_format_uint(value, 1, buf));
+    check_format("uint/2", printf_string("%02llu", v), buf, winevt_format_uint(value, 2, buf));
+    check_format("hex", printf_string("%llx", v), buf, winevt_format_hex(value, 1, buf));
+    check_format("hex/8", printf_string("%08llx", v), buf, winevt_format_hex(value, 8, buf));
+    check_format("hex/16", printf_string("%016llx", v), buf, winevt_format_hex(value, 16, buf));
+    check_format("0x/1", printf_string("0x%llx", v), buf, winevt_format_hex_prefixed(value, 1, buf));
+  }
+}
+
+static void
+check_invalid_civil_times()
+{
+  const WinevtCivilTime times[] = {
+    { 1600, 12, 31, 23, 59, 59, 0 }, { 30828, 1, 1, 0, 0, 0, 0 }, { 2023, 2, 29, 0, 0, 0, 0 },
+    { 1900, 2, 29, 0, 0, 0, 0 },     { 2024, 4, 31, 0, 0, 0, 0 },  { 2024, 13, 1, 0, 0, 0, 0 },
+    { 2024, 0, 1, 0, 0, 0, 0 },      { 2024, 1, 0, 0, 0, 0, 0 },   { 2024, 1, 1, 24, 0, 0, 0 },
+    { 2024, 1, 1, 0, 60, 0, 0 },     { 2024, 1, 1, 0, 0, 60, 0 },  { 2024, 1, 1, 0, 0, 0, 10000000 },
+  };
+  uint64_t filetime;
+
+  for (const WinevtCivilTime& time : times) {
+    check("civil_to_filetime rejects", !winevt_civil_to_filetime(&time, &filetime));
+  }
+}
+
+static void
+check_times(std::mt19937_64& rng)
+{
+  char buf[WINEVT_FORMAT_BUFFER_SIZE];
+  std::vector<uint64_t> values = {
+    0, 1, 9999999, 10000000, 864000000000ULL, 116444736000000000ULL, 133485408012345678ULL,
+    // 1700-02-28/29/03-01, 2000-02-29, 2100-03-01 and 9999-12-31 23:59:59.9999999
+    31241376000000000ULL, 31242240000000000ULL, 125911584000000000ULL, 157469184000000000ULL,
+    2650467743999999999ULL,
+  };
+
+  for (int i = 0; i < 200000; i++) {
+    // Up to the year 9999, which gmtime handles everywhere.
+    values.push_back(rng() % 2650467744000000000ULL);
+  }
+
+  for (uint64_t filetime : values) {
+    WinevtCivilTime time;
+    struct tm tm;
+
+    if (!reference_civil(filetime, &tm)) {
+      continue;
+    }
+    winevt_filetime_to_civil(filetime, &time);
+    uint64_t roundTrip = 0;
+    check("civil_to_filetime",
+          winevt_civil_to_filetime(&time, &roundTrip) && roundTrip == filetime);
+    check_format("insert_time",
+                 printf_string("%04d-%02d-%02d %02d:%02d:%02d.%dZ",
+                               tm.tm_year + 1900,
+                               tm.tm_mon + 1,
+                               tm.tm_mday,
+                               tm.tm_hour,
+                               tm.tm_min,
+                               tm.tm_sec,
+                               static_cast<int>(filetime % 10000000 / 10000)),
+                 buf,
+                 winevt_format_insert_time(&time, buf));
+    check_format("time_created",
+                 printf_string("%02d/%02d/%02d %02d:%02d:%02d.%llu",
+                               tm.tm_year + 1900,
+                               tm.tm_mon + 1,
+                               tm.tm_mday,
+                               tm.tm_hour,
+                               tm.tm_min,
+                               tm.tm_sec,
+                               static_cast<unsigned long long>(filetime % 10000000 * 100)),
+                 buf,
+                 winevt_format_time_created(&time, buf));
+  }
+}
+
+int
+main()
+{
+  std::mt19937_64 rng(20241016);
+
+  check_doubles(rng);
+  check_integers(rng);
+  check_times(rng);
+  check_invalid_civil_times();
+
+  return native_test_status();
+}
@@ -0,0 +1,81 @@
+// Checks winevt_hex_encode and its SSSE3 and AVX2 paths which the CPU
+// supports against a nibble by nibble reference.
+#include "native_test.h"
+
+#include <winevt_hex.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+// The nested loop which make_displayable_binary_string used before.
+static std::string
+reference_hex(const uint8_t* p, size_t len)
+{
+  const char* HEX_TABLE = "0123456789ABCDEF";
+  std::string out(len * 2, '\0');
+
+  for (size_t i = 0; i < len; i++) {
+    for (size_t j = 0; j < 2; j++) {
+      out[2 * i + (1 - j)] = HEX_TABLE[(p[i] >> (j * 4)) & 0x0F];
+    }
+  }
+
+  return out;
+}
+
+typedef void (*HexEncode)(const uint8_t* src, size_t len, char* dst);
+
+// Guard bytes catch writes past len * 2.
+static void
+check_encode(const char* name, HexEncode encode, const uint8_t* p, size_t len)
+{
+  std::string out(len * 2 + 2, '#');
+
+  encode(p, len, &out[0]);
+  check_equal(name, reference_hex(p, len) + "##", out);
+}
+
+static void
+encode(const uint8_t* src, size_t len, char* dst)
+{
+  winevt_hex_encode(src, len, dst);
+}
+
+int
+main()
+{
+  std::mt19937 rng(20241016);
+  std::vector<uint8_t> data(5000);
+
+  for (uint8_t& byte : data) {
+    byte = static_cast<uint8_t>(rng());
+  }
+
+  for (size_t len = 0; len <= 300; len++) {
+    for (size_t offset = 0; offset < 8; offset++) {
+      const uint8_t* p = data.data() + offset;
+
+      check_encode("winevt_hex_encode", encode, p, len);
+      check_encode("scalar", winevt_hex_encode_scalar, p, len);
+#ifdef WINEVT_HEX_SSSE3
+      if (len % 16 == 0 && winevt_cpu_has(WINEVT_CPU_SSSE3)) {
+        check_encode("ssse3", winevt_hex_encode_ssse3, p, len);
+      }
+#endif
+#ifdef WINEVT_HEX_AVX2
+      if (len % 32 == 0 && winevt_cpu_has(WINEVT_CPU_AVX2)) {
+        check_encode("avx2", winevt_hex_encode_avx2, p, len);
+      }
+#endif
+    }
+  }
+
+  std::vector<uint8_t> all(256);
+  for (size_t i = 0; i < all.size(); i++) {
+    all[i] = static_cast<uint8_t>(i);
+  }
+  check_encode("all byte values", encode, all.data(), all.size());
+
+  return native_test_status();
+}
@@ -0,0 +1,209 @@
+// Checks the JSON escaping of winevt_json.h and each of its vector paths
+// which the CPU supports against a simple reference, and the writer.
+#include "native_test.h"
+
+#include <winevt_json.h>
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+// Escapes one code point at a time.
+static std::string
+reference_utf16_to_json(const std::vector<uint16_t>& src)
+{
+  std::string out;
+
+  for (size_t i = 0; i < src.size(); i++) {
+    uint32_t c = src[i];
+    char buf[8];
+
+    if (c >= 0xd800 && c <= 0xdfff) {
+      if (c <= 0xdbff && i + 1 < src.size() && src[i + 1] >= 0xdc00 && src[i + 1] <= 0xdfff) {
+        c = 0x10000 + ((c - 0xd800) << 10) + (src[++i] - 0xdc00);
+      } else {
+        c = 0xfffd;
+      }
+    }
+    if (c == '"' || c == '\\') {
+      out.push_back('\\');
+      out.push_back(static_cast<char>(c));
+    } else if (c == '\n') {
+      out += "\\n";
+    } else if (c == '\r') {
+      out += "\\r";
+    } else if (c == '\t') {
+      out += "\\t";
+    } else if (c == '\b') {
+      out += "\\b";
+    } else if (c == '\f') {
+      out += "\\f";
+    } else if (c < 0x20) {
+      snprintf(buf, sizeof(buf), "\\u%04x", c);
+      out += buf;
+    } else if (c < 0x80) {
+      out.push_back(static_cast<char>(c));
+    } else if (c < 0x800) {
+      out.push_back(static_cast<char>(0xc0 | (c >> 6)));
+      out.push_back(static_cast<char>(0x80 | (c & 0x3f)));
+    } else if (c < 0x10000) {
+      out.push_back(static_cast<char>(0xe0 | (c >> 12)));
+      out.push_back(static_cast<char>(0x80 | ((c >> 6) & 0x3f)));
+      out.push_back(static_cast<char>(0x80 | (c & 0x3f)));
+    } else {
+      out.push_back(static_cast<char>(0xf0 | (c >> 18)));
+      out.push_back(static_cast<char>(0x80 | ((c >> 12) & 0x3f)));
+      out.push_back(static_cast<char>(0x80 | ((c >> 6) & 0x3f)));
+      out.push_back(static_cast<char>(0x80 | (c & 0x3f)));
+    }
+  }
+
+  return out;
+}
+
+static std::string
+to_json(const std::vector<uint16_t>& src)
+{
+  std::string out(src.size() * WINEVT_JSON_MAX_BYTES_PER_CHAR, '\0');
+
+  out.resize(winevt_utf16_to_json(src.data(), src.size(), &out[0]));
+  return out;
+}
+
+// Mostly ASCII text with a character which needs care at a random
+// place, so that the SIMD loops stop at every position of a block.
+static std::vector<uint16_t>
+random_text(std::mt19937& rng, size_t length)
+{
+  static const uint16_t specials[] = { '"',    '\\',   '\n',   0x01,   0x1f,   0x7f,
+                                       0x80,   0xe9,   0x3042, 0xd83d, 0xde00, 0xfffd,
+                                       0x8000, 0xff22, 0x20,   0x7e };
+  std::vector<uint16_t> text(length);
+
+  for (uint16_t& c : text) {
+    c = static_cast<uint16_t>(0x20 + rng() % 0x5f);
+  }
+  for (size_t n = rng() % 4; n > 0 && length > 0; n--) {
+    text[rng() % length] = specials[rng() % (sizeof(specials) / sizeof(specials[0]))];
+  }
+  if (length > 1 && rng() % 8 == 0) {
+    // A surrogate pair
+    size_t i = rng() % (length - 1);
+    text[i] = 0xd83d;
+    text[i + 1] = 0xde00;
+  }
+
+  return text;
+}
+
+// A function which copies whole blocks of ASCII which needs no
+// escaping, such as winevt_json_ascii_blocks_sse2.
+typedef size_t (*AsciiBlocks)(const uint16_t* src, size_t len, char* dst);
+
+// Checks that blocks copies the whole blocks of the prefix of src which
+// needs no escaping and writes nothing after them.
+static void
+check_ascii_blocks(const char* name, AsciiBlocks blocks, size_t blockSize,
+                   const std::vector<uint16_t>& src)
+{
+  size_t prefix = 0;
+  while (prefix < src.size() && src[prefix] < 0x80 && !winevt_json_needs_escape(src[prefix])) {
+    prefix++;
+  }
+  std::string out(src.size(), '#');
+  size_t copied = blocks(src.data(), src.size(), &out[0]);
+  std::string expected(src.size(), '#');
+
+  for (size_t i = 0; i < prefix / blockSize * blockSize; i++) {
+    expected[i] = static_cast<char>(src[i]);
+  }
+  check(name, copied == prefix / blockSize * blockSize);
+  check_equal(name, expected, out);
+}
+
+static void
+check_escape(const char* name, const std::vector<uint16_t>& text)
+{
+  check_equal(name, reference_utf16_to_json(text), to_json(text));
+#ifdef WINEVT_UTF16_SSE2
+  check_ascii_blocks(name, winevt_json_ascii_blocks_sse2, 16, text);
+#endif
+#ifdef WINEVT_UTF16_AVX2
+  if (winevt_cpu_has(WINEVT_CPU_AVX2)) {
+    check_ascii_blocks(name, winevt_json_ascii_blocks_avx2, 32, text);
+  }
+#endif
+}
+
+static void
+check_escapes(std::mt19937& rng)
+{
+  for (int i = 0; i < 200000; i++) {
+    std::vector<uint16_t> text = random_text(rng, rng() % 100);
+    check_escape("utf16_to_json", text);
+  }
+  for (uint32_t c = 0; c < 0x10000; c++) {
+    std::vector<uint16_t> text(40, 'a');
+    text[c % 40] = static_cast<uint16_t>(c);
+    check_escape("code unit", text);
+  }
+
+  std::string utf8 = "quote \" backslash \\ tab \t nul";
+  utf8.push_back('\0');
+  utf8 += " \xe3\x81\x82 \x7f";
+  std::string out(utf8.size() * WINEVT_JSON_MAX_BYTES_PER_CHAR, '\0');
+  out.resize(winevt_utf8_to_json(utf8.data(), utf8.size(), &out[0]));
+  check_equal("utf8_to_json", "quote \\\" backslash \\\\ tab \\t nul\\u0000 \xe3\x81\x82 \x7f", out);
+}
+
+static void
+check_writer()
+{
+  WinevtJsonWriter writer;
+  const uint16_t message[] = { 'a', '"', 0x3042, '\r', '\n' };
+
+  for (int i = 0; i < 2; i++) {
+    writer.startObject();
+    writer.key("EventID", 7);
+    writer.writeUnsigned(4624);
+    writer.key("Keywords", 8);
+    writer.writeNull();
+    writer.key("Message", 7);
+    writer.writeUtf16(message, 5);
+    writer.key("StringInserts", 13);
+    writer.startArray();
+    writer.writeString("S-1-5-18", 8);
+    writer.writeSigned(-42);
+    writer.writeBoolean(i == 0);
+    writer.startArray();
+    writer.endArray();
+    writer.endArray();
+    writer.key("Empty", 5);
+    writer.startObject();
+    writer.endObject();
+    writer.endObject();
+    writer.newline();
+  }
+  std::string line = "{\"EventID\":4624,\"Keywords\":null,\"Message\":\"a\\\"\xe3\x81\x82\\r\\n\","
+                     "\"StringInserts\":[\"S-1-5-18\",-42,true,[]],\"Empty\":{}}\n";
+  std::string second = line;
+  second.replace(second.find("true"), 4, "false");
+  check_equal("writer", line + second, writer.buffer());
+
+  writer.clear();
+  writer.writeSigned(INT64_MIN);
+  writer.writeUnsigned(UINT64_MAX);
+  check_equal("integers", "-9223372036854775808,18446744073709551615", writer.buffer());
+}
+
+int
+main()
+{
+  std::mt19937 rng(20241016);
+
+  check_escapes(rng);
+  check_writer();
+
+  return native_test_status();
+}
@@ -0,0 +1,409 @@
+// Checks winevt_msgpack.h by decoding what it writes.
+#include "native_test.h"
+
+#include <winevt_msgpack.h>
+
+#include <cinttypes>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+// A decoded value. The items of a map are its keys and values in turn.
+struct Value
+{
+  enum Type
+  {
+    NIL,
+    BOOLEAN,
+    UNSIGNED,
+    SIGNED,
+    STRING,
+    ARRAY,
+    MAP,
+  };
+
+  Type type;
+  uint64_t integer;
+  std::string string;
+  std::vector<Value> items;
+
+  bool operator==(const Value& other) const
+  {
+    return type == other.type && integer == other.integer && string == other.string &&
+           items == other.items;
+  }
+};
+
+class Reader
+{
+public:
+  explicit Reader(const std::string& buffer)
+    : buffer_(buffer)
+    , position_(0)
+  {
+  }
+
+  bool atEnd() const { return position_ == buffer_.size(); }
+
+  bool read(Value& value)
+  {
+    uint8_t type;
+
+    value = Value();
+    if (!readByte(type)) {
+      return false;
+    }
+    if (type < 0x80) {
+      return scalar(value, Value::UNSIGNED, type);
+    } else if (type >= 0xe0) {
+      return scalar(value, Value::SIGNED, static_cast<uint64_t>(static_cast<int8_t>(type)));
+    } else if ((type & 0xf0) == 0x80) {
+      return items(value, Value::MAP, (type & 0x0f) * 2);
+    } else if ((type & 0xf0) == 0x90) {
+      return items(value, Value::ARRAY, type & 0x0f);
+    } else if ((type & 0xe0) == 0xa0) {
+      return string(value, type & 0x1f);
+    }
+
+    uint64_t n;
+    switch (type) {
+      case 0xc0:
+        value.type = Value::NIL;
+        return true;
+      case 0xc2:
+      case 0xc3:
+        return scalar(value, Value::BOOLEAN, type & 1);
+      case 0xcc:
+      case 0xcd:
+      case 0xce:
+      case 0xcf:
+        return readBigEndian(1 << (type - 0xcc), n) && scalar(value, Value::UNSIGNED, n);
+      case 0xd0:
+        return readBigEndian(1, n) &&
+               scalar(value, Value::SIGNED, static_cast<uint64_t>(static_cast<int8_t>(n)));
+      case 0xd1:
+        return readBigEndian(2, n) &&
+               scalar(value, Value::SIGNED, static_cast<uint64_t>(static_cast<int16_t>(n)));
+      case 0xd2:
+        return readBigEndian(4, n) &&
+               scalar(value, Value::SIGNED, static_cast<uint64_t>(static_cast<int32_t>(n)));
+      case 0xd3:
+        return readBigEndian(8, n) && scalar(value, Value::SIGNED, n);
+      case 0xd9:
+      case 0xda:
+      case 0xdb:
+        return readBigEndian(1 << (type - 0xd9), n) && string(value, n);
+      case 0xdc:
+      case 0xdd:
+        return readBigEndian(type == 0xdc ? 2 : 4, n) && items(value, Value::ARRAY, n);
+      case 0xde:
+      case 0xdf:
+        return readBigEndian(type == 0xde ? 2 : 4, n) && items(value, Value::MAP, n * 2);
+      default:
+        return false;
+    }
+  }
+
+private:
+  bool readByte(uint8_t& byte)
+  {
+    if (position_ >= buffer_.size()) {
+      return false;
+    }
+    byte = static_cast<uint8_t>(buffer_[position_++]);
+    return true;
+  }
+
+  bool readBigEndian(size_t size, uint64_t& value)
+  {
+    uint8_t byte;
+
+    value = 0;
+    for (size_t i = 0; i < size; i++) {
+      if (!readByte(byte)) {
+        return false;
+      }
+      value = value << 8 | byte;
+    }
+    return true;
+  }
+
+  static bool scalar(Value& value, Value::Type type, uint64_t integer)
+  {
+    value.type = type;
+    value.integer = integer;
+    return true;
+  }
+
+  bool string(Value& value, uint64_t length)
+  {
+    if (buffer_.size() - position_ < length) {
+      return false;
+    }
+    value.type = Value::STRING;
+    value.string = buffer_.substr(position_, length);
+    position_ += length;
+    return true;
+  }
+
+  bool items(Value& value, Value::Type type, uint64_t count)
+  {
+    value.type = type;
+    value.items.resize(count);
+    for (Value& item : value.items) {
+      if (!read(item)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  const std::string& buffer_;
+  size_t position_;
+};
+
+// Checks that value is decoded back and written in size bytes.
+static void
+check_round_trip(const char* name, const Value& value, void (*pack)(WinevtMsgpackWriter&, const Value&),
+                 size_t size)
+{
+  WinevtMsgpackWriter writer;
+  Value decoded;
+
+  pack(writer, value);
+  Reader reader(writer.buffer());
+  if (!reader.read(decoded) || !reader.atEnd() || !(decoded == value)) {
+    fprintf(stderr, "FAIL: %s: round trip of %" PRIu64 "\n", name, value.integer);
+    native_test_failures++;
+  }
+  if (writer.size() != size) {
+    fprintf(stderr,
+            "FAIL: %s: %" PRIu64 " was written in %lu bytes, not %lu\n",
+            name,
+            value.integer,
+            (unsigned long)writer.size(),
+            (unsigned long)size);
+    native_test_failures++;
+  }
+}
+
+static void
+pack_value(WinevtMsgpackWriter& writer, const Value& value)
+{
+  switch (value.type) {
+    case Value::NIL:
+      writer.packNil();
+      break;
+    case Value::BOOLEAN:
+      writer.packBoolean(value.integer != 0);
+      break;
+    case Value::UNSIGNED:
+      writer.packUnsigned(value.integer);
+      break;
+    case Value::SIGNED:
+      writer.packSigned(static_cast<int64_t>(value.integer));
+      break;
+    case Value::STRING:
+      writer.packString(value.string.data(), value.string.size());
+      break;
+    case Value::ARRAY:
+      writer.packArrayHeader(static_cast<uint32_t>(value.items.size()));
+      for (const Value& item : value.items) {
+        pack_value(writer, item);
+      }
+      break;
+    case Value::MAP:
+      writer.packMapHeader(static_cast<uint32_t>(value.items.size() / 2));
+      for (const Value& item : value.items) {
+        pack_value(writer, item);
+      }
+      break;
+  }
+}
+
+// Writes strings with startString() for a larger maximum length.
+static void
+pack_value_in_place(WinevtMsgpackWriter& writer, const Value& value)
+{
+  if (value.type != Value::STRING) {
+    pack_value(writer, value);
+    return;
+  }
+  char* p = writer.startString(value.string.size() * 3 + 40);
+  memcpy(p, value.string.data(), value.string.size());
+  writer.endString(value.string.size());
+}
+
+static Value
+make_value(Value::Type type, uint64_t integer)
+{
+  Value value = Value();
+  value.type = type;
+  value.integer = integer;
+  return value;
+}
+
+static Value
+make_string(size_t length)
+{
+  Value value = make_value(Value::STRING, 0);
+  for (size_t i = 0; i < length; i++) {
+    value.string.push_back(static_cast<char>('a' + i % 26));
+  }
+  return value;
+}
+
+static void
+check_scalars(std::mt19937_64& rng)
+{
+  const struct
+  {
+    uint64_t value;
+    size_t size;
+  } unsigneds[] = {
+    { 0, 1 },      { 0x7f, 1 },      { 0x80, 2 },        { 0xff, 2 },         { 0x100, 3 },
+    { 0xffff, 3 }, { 0x10000, 5 },   { 0xffffffff, 5 },  { 0x100000000, 9 }, { UINT64_MAX, 9 },
+  };
+  const struct
+  {
+    int64_t value;
+    size_t size;
+  } signeds[] = {
+    { -1, 1 },      { -32, 1 },     { -33, 2 },        { -128, 2 },         { -129, 3 },
+    { -32768, 3 },  { -32769, 5 },  { INT32_MIN, 5 },  { INT32_MIN - 1LL, 9 }, { INT64_MIN, 9 },
+  };
+
+  check_round_trip("nil", make_value(Value::NIL, 0), pack_value, 1);
+  check_round_trip("true", make_value(Value::BOOLEAN, 1), pack_value, 1);
+  check_round_trip("false", make_value(Value::BOOLEAN, 0), pack_value, 1);
+  for (auto& unsigned_ : unsigneds) {
+    check_round_trip("unsigned", make_value(Value::UNSIGNED, unsigned_.value), pack_value, unsigned_.size);
+  }
+  for (auto& signed_ : signeds) {
+    check_round_trip("signed",
+                     make_value(Value::SIGNED, static_cast<uint64_t>(signed_.value)),
+                     pack_value,
+                     signed_.size);
+  }
+  for (int i = 0; i < 100000; i++) {
+    WinevtMsgpackWriter writer;
+    Value decoded;
+    uint64_t value = rng() >> (rng() % 64);
+    int64_t signedValue = -static_cast<int64_t>(value >> 1) - 1;
+
+    writer.packUnsigned(value);
+    writer.packSigned(signedValue);
+    Reader reader(writer.buffer());
+    check("random unsigned", reader.read(decoded) && decoded.integer == value);
+    check("random signed",
+          reader.read(decoded) && decoded.type == Value::SIGNED &&
+            static_cast<int64_t>(decoded.integer) == signedValue);
+  }
+}
+
+static void
+check_strings()
+{
+  const struct
+  {
+    size_t length;
+    size_t headerSize;
+  } strings[] = {
+    { 0, 1 }, { 31, 1 }, { 32, 2 }, { 255, 2 }, { 256, 3 }, { 65535, 3 }, { 65536, 5 },
+  };
+
+  for (auto& string : strings) {
+    Value value = make_string(string.length);
+    check_round_trip("string", value, pack_value, string.headerSize + string.length);
+    check_round_trip("string in place", value, pack_value_in_place, string.headerSize + string.length);
+  }
+}
+
+static void
+check_containers()
+{
+  for (size_t count : { 0, 15, 16, 65535, 65536 }) {
+    size_t headerSize = count < 16 ? 1 : count <= 65535 ? 3 : 5;
+    Value array = make_value(Value::ARRAY, 0);
+    Value map = make_value(Value::MAP, 0);
+
+    for (size_t i = 0; i < count; i++) {
+      array.items.push_back(make_value(Value::UNSIGNED, i % 100));
+      map.items.push_back(make_string(i % 40));
+      map.items.push_back(i % 3 == 0 ? make_value(Value::NIL, 0) : make_string(i % 300));
+    }
+    size_t mapSize = headerSize;
+    for (const Value& item : map.items) {
+      WinevtMsgpackWriter writer;
+      pack_value(writer, item);
+      mapSize += writer.size();
+    }
+    check_round_trip("array", array, pack_value, headerSize + count);
+    check_round_trip("map", map, pack_value, mapSize);
+    check_round_trip("map in place", map, pack_value_in_place, mapSize);
+  }
+}
+
+// An event as Query#each_batch(format: :msgpack) writes it.
+static void
+pack_event(WinevtMsgpackWriter& writer, uint64_t i)
+{
+  static const char* keys[] = { "ProviderName", "EventID", "Level", "Task", "Keywords",
+                                "TimeCreated", "EventRecordID", "Computer", "Message",
+                                "StringInserts" };
+  char buffer[128];
+  int length;
+
+  writer.packMapHeader(10);
+  writer.packString(keys[0], strlen(keys[0]));
+  writer.packString("Microsoft-Windows-Security-Auditing", 35);
+  writer.packString(keys[1], strlen(keys[1]));
+  writer.packUnsigned(4624 + i % 8);
+  writer.packString(keys[2], strlen(keys[2]));
+  writer.packUnsigned(i % 5);
+  writer.packString(keys[3], strlen(keys[3]));
+  writer.packUnsigned(12544);
+  writer.packString(keys[4], strlen(keys[4]));
+  writer.packString("0x8020000000000000", 18);
+  writer.packString(keys[5], strlen(keys[5]));
+  writer.packString("2024/01/01 00:00:01.123400", 26);
+  writer.packString(keys[6], strlen(keys[6]));
+  length = snprintf(buffer, sizeof(buffer), "%" PRIu64, i);
+  writer.packString(buffer, static_cast<size_t>(length));
+  writer.packString(keys[7], strlen(keys[7]));
+  writer.packString("WIN-HOST.example.com", 20);
+  writer.packString(keys[8], strlen(keys[8]));
+  char* p = writer.startString(sizeof(buffer));
+  length = snprintf(p, sizeof(buffer), "An account was successfully logged on. %" PRIu64, i);
+  writer.endString(static_cast<size_t>(length));
+  writer.packString(keys[9], strlen(keys[9]));
+  writer.packArrayHeader(static_cast<uint32_t>(i % 4));
+  for (uint64_t j = 0; j < i % 4; j++) {
+    writer.packString("S-1-5-18", 8);
+  }
+}
+
+int
+main()
+{
+  std::mt19937_64 rng(20241016);
+  WinevtMsgpackWriter writer;
+
+  check_scalars(rng);
+  check_strings();
+  check_containers();
+  for (uint64_t i = 0; i < 10; i++) {
+    pack_event(writer, i);
+  }
+  Reader reader(writer.buffer());
+  for (uint64_t i = 0; i < 10; i++) {
+    Value event;
+    check("event", reader.read(event) && event.type == Value::MAP && event.items.size() == 20);
+    check("message",
+          event.items[17].string == "An account was successfully logged on. " + std::to_string(i));
+  }
+  check("events", reader.atEnd());
+
+  return native_test_status();
+}
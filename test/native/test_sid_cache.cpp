@@ -0,0 +1,121 @@
+// Checks the LRU eviction and the expiry of positive and negative
+// entries of WinevtSidCache with a clock which the checks move forward.
+#include "native_test.h"
+
+#include <winevt_sid_cache.h>
+
+static uint64_t fake_now = 0;
+
+static uint64_t
+fake_clock(void)
+{
+  return fake_now;
+}
+
+static std::string
+lookup(WinevtSidCache& cache, const std::string& sid)
+{
+  std::string account;
+
+  switch (cache.lookup(sid, &account)) {
+    case SID_CACHE_HIT:
+      return account;
+    case SID_CACHE_NEGATIVE_HIT:
+      return "(negative)";
+    default:
+      return "(miss)";
+  }
+}
+
+static void
+test_lru_eviction()
+{
+  WinevtSidCache cache(2, 1000, 100, fake_clock);
+
+  cache.insert("S-1", "A");
+  cache.insert("S-2", "B");
+  // S-1 becomes the most recently used, so S-2 is evicted by S-3.
+  check_equal("lru hit", "A", lookup(cache, "S-1"));
+  cache.insert("S-3", "C");
+  check_equal("lru evicted", "(miss)", lookup(cache, "S-2"));
+  check_equal("lru kept", "A", lookup(cache, "S-1"));
+  check_equal("lru inserted", "C", lookup(cache, "S-3"));
+  check("lru evictions", cache.stats().evictions == 1);
+  check("lru size", cache.stats().size == 2);
+
+  // Inserting a cached SID again replaces it without evicting.
+  cache.insert("S-3", "D");
+  check_equal("lru replaced", "D", lookup(cache, "S-3"));
+  check("lru no eviction on replace", cache.stats().evictions == 1);
+
+  cache.setCapacity(1);
+  check("lru shrunk", cache.stats().size == 1);
+  check_equal("lru shrunk keeps most recent", "D", lookup(cache, "S-3"));
+
+  cache.setCapacity(0);
+  cache.insert("S-4", "E");
+  check_equal("lru disabled", "(miss)", lookup(cache, "S-4"));
+  check("lru disabled size", cache.stats().size == 0);
+}
+
+static void
+test_ttl()
+{
+  fake_now = 5000;
+  WinevtSidCache cache(16, 1000, 100, fake_clock);
+
+  cache.insert("S-1", "A");
+  fake_now += 999;
+  check_equal("ttl not expired", "A", lookup(cache, "S-1"));
+  // Hits do not extend the lifetime of an entry.
+  fake_now += 1;
+  check_equal("ttl expired", "(miss)", lookup(cache, "S-1"));
+  check("ttl expirations", cache.stats().expirations == 1);
+  check("ttl expired entry removed", cache.stats().size == 0);
+
+  // A new TTL applies to entries inserted after it is set.
+  cache.setTtl(10);
+  cache.insert("S-2", "B");
+  fake_now += 9;
+  check_equal("ttl changed not expired", "B", lookup(cache, "S-2"));
+  fake_now += 1;
+  check_equal("ttl changed expired", "(miss)", lookup(cache, "S-2"));
+}
+
+static void
+test_negative_ttl()
+{
+  fake_now = 0;
+  WinevtSidCache cache(16, 1000, 100, fake_clock);
+
+  cache.insertNegative("S-1");
+  cache.insert("S-2", "B");
+  fake_now += 99;
+  check_equal("negative hit", "(negative)", lookup(cache, "S-1"));
+  check("negative hits", cache.stats().negativeHits == 1);
+  fake_now += 1;
+  check_equal("negative expired", "(miss)", lookup(cache, "S-1"));
+  // The positive entry lives longer than the negative one.
+  check_equal("positive not expired", "B", lookup(cache, "S-2"));
+
+  // A SID which is resolved later replaces its negative entry.
+  cache.insertNegative("S-3");
+  cache.insert("S-3", "C");
+  fake_now += 500;
+  check_equal("negative replaced", "C", lookup(cache, "S-3"));
+
+  SidCacheStats stats = cache.stats();
+  check("negative stats hits", stats.hits == 2);
+  check("negative stats misses", stats.misses == 1);
+  check("negative stats expirations", stats.expirations == 1);
+}
+
+int
+main()
+{
+  test_lru_eviction();
+  test_ttl();
+  test_negative_ttl();
+
+  return native_test_status();
+}
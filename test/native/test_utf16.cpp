@@ -0,0 +1,145 @@
+// Checks winevt_utf16_to_utf8 and each of its vector paths which the
+// CPU supports against a reference encoder.
+#include "native_test.h"
+
+#include <winevt_utf16.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+static std::string
+reference_utf16_to_utf8(const std::vector<uint16_t>& src)
+{
+  std::string out;
+
+  for (size_t i = 0; i < src.size(); i++) {
+    uint32_t c = src[i];
+    if (c >= 0xd800 && c <= 0xdbff && i + 1 < src.size() && src[i + 1] >= 0xdc00 &&
+        src[i + 1] <= 0xdfff) {
+      c = 0x10000 + ((c - 0xd800) << 10) + (src[++i] - 0xdc00);
+    } else if (c >= 0xd800 && c <= 0xdfff) {
+      c = 0xfffd;
+    }
+
+    if (c < 0x80) {
+      out += static_cast<char>(c);
+    } else if (c < 0x800) {
+      out += static_cast<char>(0xc0 | (c >> 6));
+      out += static_cast<char>(0x80 | (c & 0x3f));
+    } else if (c < 0x10000) {
+      out += static_cast<char>(0xe0 | (c >> 12));
+      out += static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+      out += static_cast<char>(0x80 | (c & 0x3f));
+    } else {
+      out += static_cast<char>(0xf0 | (c >> 18));
+      out += static_cast<char>(0x80 | ((c >> 12) & 0x3f));
+      out += static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+      out += static_cast<char>(0x80 | (c & 0x3f));
+    }
+  }
+
+  return out;
+}
+
+static std::string
+transcode(const std::vector<uint16_t>& src)
+{
+  std::string out(src.size() * WINEVT_UTF8_MAX_BYTES_PER_UTF16, '\0');
+  out.resize(winevt_utf16_to_utf8(src.data(), src.size(), &out[0]));
+  return out;
+}
+
+// A function which converts whole blocks of ASCII, such as
+// winevt_utf16_ascii_blocks_sse2.
+typedef size_t (*AsciiBlocks)(const uint16_t* src, size_t len, char* dst);
+
+// Checks that blocks converts the whole blocks of the ASCII prefix of
+// src and writes nothing after them.
+static void
+check_ascii_blocks(const char* name, AsciiBlocks blocks, size_t blockSize,
+                   const std::vector<uint16_t>& src)
+{
+  size_t prefix = 0;
+  while (prefix < src.size() && src[prefix] < 0x80) {
+    prefix++;
+  }
+  std::string out(src.size(), '#');
+  size_t converted = blocks(src.data(), src.size(), &out[0]);
+  std::string expected(src.size(), '#');
+
+  for (size_t i = 0; i < prefix / blockSize * blockSize; i++) {
+    expected[i] = static_cast<char>(src[i]);
+  }
+  check(name, converted == prefix / blockSize * blockSize);
+  check_equal(name, expected, out);
+}
+
+static void
+check_transcode(const char* name, const std::vector<uint16_t>& src)
+{
+  check_equal(name, reference_utf16_to_utf8(src), transcode(src));
+#ifdef WINEVT_UTF16_SSE2
+  check_ascii_blocks(name, winevt_utf16_ascii_blocks_sse2, 16, src);
+#endif
+#ifdef WINEVT_UTF16_AVX2
+  if (winevt_cpu_has(WINEVT_CPU_AVX2)) {
+    check_ascii_blocks(name, winevt_utf16_ascii_blocks_avx2, 32, src);
+  }
+#endif
+}
+
+static std::vector<uint16_t>
+random_text(std::mt19937& rng, size_t len, int asciiPercent)
+{
+  std::vector<uint16_t> text(len);
+  std::uniform_int_distribution<int> percent(0, 99);
+  std::uniform_int_distribution<int> ascii(0x20, 0x7e);
+  std::uniform_int_distribution<int> unit(0x80, 0xffff);
+
+  for (size_t i = 0; i < len; i++) {
+    text[i] = percent(rng) < asciiPercent ? ascii(rng) : unit(rng);
+  }
+
+  return text;
+}
+
+int
+main()
+{
+  std::mt19937 rng(20241016);
+
+  check_transcode("empty", {});
+  check_transcode("ascii", { 'a', 'b', 'c' });
+  check_transcode("two bytes", { 0x00e9, 0x07ff });
+  check_transcode("three bytes", { 0x0800, 0x3042, 0xfffd, 0xffff });
+  check_transcode("surrogate pair", { 0xd83d, 0xde00 });
+  check_transcode("lone high surrogate", { 'a', 0xd83d, 'b' });
+  check_transcode("lone low surrogate", { 'a', 0xde00, 'b' });
+  check_transcode("high surrogate at end", { 'a', 0xd83d });
+  check_transcode("reversed pair", { 0xde00, 0xd83d });
+
+  // Put non-ASCII code units around every SIMD block boundary.
+  for (size_t len = 1; len <= 80; len++) {
+    for (size_t pos = 0; pos < len; pos++) {
+      std::vector<uint16_t> text(len, 'x');
+      text[pos] = 0x3042;
+      check_transcode("boundary", text);
+      text[pos] = 0x80;
+      check_transcode("boundary 0x80", text);
+      if (pos + 1 < len) {
+        text[pos] = 0xd83d;
+        text[pos + 1] = 0xde00;
+        check_transcode("boundary pair", text);
+      }
+    }
+  }
+
+  for (int asciiPercent : { 0, 50, 90, 99, 100 }) {
+    for (int n = 0; n < 200; n++) {
+      check_transcode("random", random_text(rng, rng() % 300, asciiPercent));
+    }
+  }
+
+  return native_test_status();
+}
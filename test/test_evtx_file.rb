@@ -0,0 +1,466 @@
+# coding: utf-8
+require "helper"
+require "evtx_writer"
+require "tmpdir"
+
+class EvtxFileTest < Test::Unit::TestCase
+  def setup
+    @dir = Dir.mktmpdir("winevt")
+    @path = File.join(@dir, "test.evtx")
+  end
+
+  def teardown
+    FileUtils.rm_rf(@dir)
+  end
+
+  def write_events(count = 1, **options)
+    writer = EvtxWriter.new
+    count.times do |i|
+      writer.add(**options)
+    end
+    writer.write(@path)
+    Winevt::EventLog::File.new(@path)
+  end
+
+  def test_each_xml
+    file = write_events(provider_name: "Test<Provider>",
+                        provider_guid: "{12345678-1234-5678-9ABC-DEF012345678}",
+                        event_id: 7,
+                        time_created: Time.at(1_600_000_000, 1234567, :nsec),
+                        user_id: "S-1-5-18",
+                        data: {"Path" => "C:\\Windows", "Count" => 42})
+    events = file.each.to_a
+    assert_equal(1, events.size)
+    xml, message, string_inserts = events.first
+    assert_equal("<Event xmlns='http://schemas.microsoft.com/win/2004/08/events/event'>" +
+                 "<System><Provider Name='Test&lt;Provider&gt;' Guid='{12345678-1234-5678-9ABC-DEF012345678}'/>" +
+                 "<EventID>7</EventID><Version>0</Version><Level>4</Level><Task>0</Task>" +
+                 "<Opcode>0</Opcode><Keywords>0x80000000000000</Keywords>" +
+                 "<TimeCreated SystemTime='2020-09-13T12:26:40.0012345Z'/>" +
+                 "<EventRecordID>1</EventRecordID><Correlation/>" +
+                 "<Execution ProcessID='0' ThreadID='0'/><Channel>Application</Channel>" +
+                 "<Computer>localhost</Computer><Security UserID='S-1-5-18'/></System>" +
+                 "<EventData><Data Name='Path'>C:\\Windows</Data><Data Name='Count'>42</Data>" +
+                 "</EventData></Event>",
+                 xml)
+    assert_equal(Encoding::UTF_8, xml.encoding)
+    assert_nil(message)
+    assert_equal(["C:\\Windows", 42], string_inserts)
+  end
+
+  def test_each_system_hash
+    file = write_events(provider_name: "TestProvider", event_id: 7, qualifiers: 16384,
+                        level: 2, process_id: 4, thread_id: 8, computer: "example",
+                        time_created: Time.at(1_600_000_000, 123456, :usec),
+                        user_id: "S-1-5-18")
+    file.render_as_xml = false
+    system, _, _ = file.each.first
+    assert_equal({"ProviderName" => "TestProvider",
+                  "ProviderGuid" => nil,
+                  "EventID" => 16384 << 16 | 7,
+                  "Version" => 0,
+                  "Level" => 2,
+                  "Task" => 0,
+                  "Opcode" => 0,
+                  "Keywords" => "0x80000000000000",
+                  "TimeCreated" => "2020/09/13 12:26:40.123456000",
+                  "EventRecordID" => "1",
+                  "ProcessID" => 4,
+                  "ThreadID" => 8,
+                  "Channel" => "Application",
+                  "Computer" => "example",
+                  "UserID" => "S-1-5-18"},
+                 system)
+    assert_true(system.keys.all?(&:frozen?))
+  end
+
+  def test_preserve_qualifiers
+    file = write_events(event_id: 7, qualifiers: 16384)
+    file.render_as_xml = false
+    file.preserve_qualifiers = true
+    assert_true(file.preserve_qualifiers?)
+    system, _, _ = file.each.first
+    assert_equal([7, 16384], system.values_at("EventID", "Qualifiers"))
+  end
+
+  def test_preserve_sid
+    file = write_events(user_id: "S-1-5-18")
+    file.render_as_xml = false
+    file.preserve_sid = false
+    assert_false(file.preserve_sid?)
+    system, _, _ = file.each.first
+    assert_false(system.key?("UserID"))
+  end
+
+  def test_include_event_data
+    file = write_events(data: {"Path" => "C:\\Windows", "Count" => 42, "Null" => nil})
+    file.render_as_xml = false
+    assert_false(file.include_event_data?)
+    system, _, _ = file.each.first
+    assert_false(system.key?("EventData"))
+
+    file.include_event_data = true
+    system, _, string_inserts = file.each.first
+    assert_equal({"Path" => "C:\\Windows", "Count" => 42, "Null" => nil}, system["EventData"])
+    assert_equal(["C:\\Windows", 42, nil], string_inserts)
+    assert_equal("TestProvider", system["ProviderName"])
+  end
+
+  def test_include_event_data_unnamed
+    file = write_events(data: {0 => "first", 1 => "second"})
+    file.render_as_xml = false
+    file.include_event_data = true
+    system, _, _ = file.each.first
+    assert_equal({"param1" => "first", "param2" => "second"}, system["EventData"])
+  end
+
+  def test_include_user_data
+    file = write_events(user_data: {"Log" => {"Name" => "System", "Size" => 42}})
+    file.render_as_xml = false
+    file.include_event_data = true
+    system, _, _ = file.each.first
+    assert_equal({"Name" => "System", "Size" => "42"}, system["UserData"])
+    assert_false(system.key?("EventData"))
+  end
+
+  def test_include_event_data_workers
+    file = write_events(1000, data: {"Message" => "x" * 100, "Index" => 7})
+    file.render_as_xml = false
+    file.include_event_data = true
+    expected = file.each.to_a
+    file.workers = 2
+    assert_equal(expected, file.each.to_a)
+    assert_equal({"Message" => "x" * 100, "Index" => 7}, expected.last[0]["EventData"])
+  end
+
+  def test_string_inserts
+    time = Time.utc(2021, 1, 2, 3, 4, 5)
+    file = write_events(data: {"String" => "日本語", "Number" => 2**40, "Null" => nil,
+                               "True" => true, "Time" => time})
+    _, _, string_inserts = file.each.first
+    assert_equal(["日本語", 2**40, nil, true, "2021-01-02 03:04:05.0Z"], string_inserts)
+  end
+
+  def test_binary_string_inserts
+    bytes = (0...300).map { |i| (i * 37 + 11) % 256 }.pack("C*")
+    sizes = [1, 15, 16, 17, 31, 32, 33, 63, 64, 100, 300]
+    data = sizes.to_h do |size|
+      ["Binary#{size}", EvtxWriter::Value.new(EvtxWriter::Type::BINARY, bytes[0, size])]
+    end
+    file = write_events(data: data)
+    _, _, string_inserts = file.each.first
+    assert_equal(sizes.map { |size| bytes[0, size].unpack1("H*").upcase }, string_inserts)
+  end
+
+  def test_typed_inserts
+    type = EvtxWriter::Type
+    writer = EvtxWriter.new
+    time = Time.utc(2021, 1, 2, 3, 4, 5, 123456)
+    data = {
+      "Int8" => writer.value(type::INT8, -2),
+      "Int16" => writer.value(type::INT16, -300),
+      "UInt16" => writer.value(type::UINT16, 65535),
+      "Int32" => writer.value(type::INT32, -5),
+      "UInt64" => writer.value(type::UINT64, 2**64 - 1),
+      "SizeT" => writer.value(type::SIZET, 7),
+      "Real32" => writer.value(type::REAL32, 1 / 3.0),
+      "Real64" => writer.value(type::REAL64, -2.5e20),
+      "HexInt32Zero" => writer.value(type::HEXINT32, 0),
+      "HexInt32" => writer.value(type::HEXINT32, 0x1f),
+      "HexInt64" => writer.value(type::HEXINT64, 0x1f),
+      "FileTime" => writer.value(type::FILETIME, time),
+      "FileTimeOverflow" => EvtxWriter::Value.new(type::FILETIME, [2**63].pack("Q<")),
+      "SysTime" => writer.value(type::SYSTIME, time),
+      "Binary" => writer.value(type::BINARY, "\x01\xab".b),
+      "Guid" => writer.value(type::GUID, "{01234567-89AB-CDEF-0123-456789ABCDEF}"),
+      "Sid" => writer.value(type::SID, "S-1-5-18"),
+      "Array" => EvtxWriter::Value.new(type::WSTRING | type::ARRAY,
+                                       "a\0b\0".encode("UTF-16LE").b),
+    }
+    writer.add(data: data)
+    writer.write(@path)
+    _, _, string_inserts = Winevt::EventLog::File.new(@path).each.first
+    # The same values in the same encodings as Query without typed values
+    expected = [
+      -2, -300, 65535, -5, 2**64 - 1, 7,
+      "0.333333", "-250000000000000000000.000000",
+      "0".b, "0x1f".b, "0x000000000000001f".b,
+      "2021-01-02 03:04:05.123Z", "?", "2021-01-02 03:04:05.123Z",
+      "01AB".b, "{01234567-89AB-CDEF-0123-456789ABCDEF}", "S-1-5-18", "?",
+    ]
+    assert_equal(expected, string_inserts)
+    assert_equal(expected.map { |value| value.is_a?(String) ? value.encoding : nil },
+                 string_inserts.map { |value| value.is_a?(String) ? value.encoding : nil })
+  end
+
+  # Types of the inserts of the fake backend
+  FAKE_INSERT_TYPES = [
+    EvtxWriter::Type::WSTRING, EvtxWriter::Type::UINT32, EvtxWriter::Type::HEXINT64,
+    EvtxWriter::Type::BOOL, EvtxWriter::Type::GUID, EvtxWriter::Type::SID,
+    EvtxWriter::Type::BINARY, EvtxWriter::Type::FILETIME, EvtxWriter::Type::INT8,
+    EvtxWriter::Type::REAL32, EvtxWriter::Type::REAL64, EvtxWriter::Type::HEXINT32,
+    EvtxWriter::Type::SYSTIME,
+  ]
+
+  def test_inserts_same_as_query
+    unless Winevt::EventLog.respond_to?(:backend) && Winevt::EventLog.backend == "fake"
+      omit("The fake backend is not used")
+    end
+    Winevt::EventLog::FakeBackend.reset(4)
+    begin
+      expected = Winevt::EventLog::Query.new("System", "*").each.map { |_, _, inserts| inserts }
+      query = Winevt::EventLog::Query.new("System", "*")
+      query.typed_values = true
+      writer = EvtxWriter.new
+      query.each do |_, _, inserts|
+        assert_equal(FAKE_INSERT_TYPES.size, inserts.size)
+        data = inserts.each_with_index.to_h do |value, i|
+          ["Value#{i}", writer.value(FAKE_INSERT_TYPES[i], value)]
+        end
+        writer.add(data: data)
+      end
+    ensure
+      Winevt::EventLog::FakeBackend.reset
+    end
+    writer.write(@path)
+    actual = Winevt::EventLog::File.new(@path).each.map { |_, _, inserts| inserts }
+    assert_equal(expected, actual)
+    assert_equal(expected.flatten.map { |value| value.is_a?(String) ? value.encoding : nil },
+                 actual.flatten.map { |value| value.is_a?(String) ? value.encoding : nil })
+  end
+
+  def test_user_data
+    file = write_events(user_data: {"Log" => {"Name" => "System", "Size" => 42}})
+    xml, _, string_inserts = file.each.first
+    assert_match(%r{<UserData><Log xmlns='http://example.com/Log'><Name>System</Name><Size>42</Size></Log></UserData>}, xml)
+    assert_equal(["System", "42"], string_inserts)
+  end
+
+  def test_each_over_chunks
+    file = write_events(1000, data: {"Message" => "x" * 100})
+    record_ids = file.each.map { |xml, _, _| xml[%r{<EventRecordID>(\d+)</EventRecordID>}, 1].to_i }
+    assert_equal((1..1000).to_a, record_ids)
+    assert_operator(File.size(@path), :>, 4096 + 65536 * 2)
+    # each starts from the beginning every time.
+    assert_equal(1000, file.each.count)
+  end
+
+  def test_template_cache
+    writer = EvtxWriter.new
+    1000.times do |i|
+      if i.even?
+        writer.add(data: {"Message" => "x" * 100, "Index" => i})
+      else
+        writer.add(data: {"Name" => "y" * 100})
+      end
+    end
+    writer.write(@path)
+    file = Winevt::EventLog::File.new(@path)
+    file.each.with_index do |(xml, _, string_inserts), i|
+      if i.even?
+        assert_match(%r{<Data Name='Message'>x+</Data><Data Name='Index'>#{i}</Data>}, xml)
+        assert_equal(["x" * 100, i], string_inserts)
+      else
+        assert_match(%r{<EventData><Data Name='Name'>y+</Data></EventData>}, xml)
+      end
+    end
+    assert_equal({hits: 998, misses: 2, templates: 2}, file.template_cache_stats)
+  end
+
+  def test_mmap
+    file = write_events(300, data: {"Message" => "x" * 100})
+    assert_true(file.mmap?)
+    buffered = Winevt::EventLog::File.new(@path, false)
+    assert_false(buffered.mmap?)
+    assert_equal(buffered.each.to_a, file.each.to_a)
+  end
+
+  def test_workers
+    file = write_events(2000, data: {"Message" => "x" * 100})
+    expected = file.each.to_a
+    file.workers = 4
+    assert_equal(4, file.workers)
+    assert_true(file.ordered?)
+    assert_equal(expected, file.each.to_a)
+
+    file.ordered = false
+    assert_equal(expected.sort, file.each.to_a.sort)
+
+    file.render_as_xml = false
+    assert_equal(2000, file.each.count)
+
+    buffered = Winevt::EventLog::File.new(@path, false)
+    buffered.workers = 4
+    assert_equal(expected, buffered.each.to_a)
+  end
+
+  def test_workers_unordered
+    writer = EvtxWriter.new
+    # The first chunk has many small records and is slow to decode. Each
+    # of the following chunks has a single large record.
+    300.times { |i| writer.add(data: {"Message" => "x" * 100, "Index" => i}) }
+    40.times { |i| writer.add(data: {"Message" => "y" * 20000, "Index" => i}) }
+    writer.write(@path)
+    file = Winevt::EventLog::File.new(@path)
+    file.render_as_xml = false
+    file.workers = 4
+    assert_equal(1, file.each.first[0]["EventRecordID"].to_i)
+
+    file.ordered = false
+    # Thread scheduling decides the order, so a few tries are allowed.
+    first_ids = 20.times.collect do
+      file.each.first[0]["EventRecordID"].to_i
+    end
+    assert_not_equal([1], first_ids.uniq)
+  end
+
+  def test_workers_break
+    file = write_events(2000, data: {"Message" => "x" * 100})
+    file.workers = 4
+    assert_equal(10, file.each.first(10).size)
+    file.each do |xml, _, _|
+      file.close
+    end
+    assert_equal(0, file.each.count)
+  end
+
+  def test_invalid_workers
+    file = write_events
+    assert_raise(ArgumentError) do
+      file.workers = 0
+    end
+  end
+
+  def test_close
+    file = write_events
+    file.close
+    assert_equal(0, file.each.count)
+  end
+
+  def test_not_evtx
+    File.binwrite(@path, "not an evtx file")
+    assert_raise(Winevt::EventLog::File::Error) do
+      Winevt::EventLog::File.new(@path)
+    end
+  end
+
+  def test_missing_file
+    assert_raise(Winevt::EventLog::File::Error) do
+      Winevt::EventLog::File.new(File.join(@dir, "missing.evtx"))
+    end
+  end
+
+  def test_corrupted_record
+    write_events(data: {"Message" => "corrupted"})
+    data = File.binread(@path)
+    # Point the template definition of the first record at the end of the chunk.
+    data[4096 + 512 + 24 + 4 + 6, 4] = [65535].pack("V")
+    File.binwrite(@path, data)
+    file = Winevt::EventLog::File.new(@path)
+    file.checksum_mode = :skip
+    assert_raise(Winevt::EventLog::File::Error) do
+      file.each {}
+    end
+    file.workers = 2
+    assert_raise(Winevt::EventLog::File::Error) do
+      file.each {}
+    end
+  end
+
+  def corrupt_second_chunk
+    write_events(1000, data: {"Message" => "x" * 100})
+    data = File.binread(@path)
+    # Flip a byte in the records of the second chunk.
+    offset = 4096 + 65536 + 512 + 100
+    data.setbyte(offset, data.getbyte(offset) ^ 0xff)
+    File.binwrite(@path, data)
+    Winevt::EventLog::File.new(@path)
+  end
+
+  def capture_warnings
+    warnings = []
+    original = Warning.method(:warn)
+    Warning.singleton_class.send(:define_method, :warn) do |message, **|
+      warnings << message[/warning: (.*)$/, 1]
+    end
+    yield
+    warnings
+  ensure
+    Warning.singleton_class.send(:define_method, :warn, original)
+  end
+
+  def test_checksum_mode
+    file = write_events
+    assert_equal(:warn, file.checksum_mode)
+    file.checksum_mode = "strict"
+    assert_equal(:strict, file.checksum_mode)
+    assert_raise(ArgumentError) do
+      file.checksum_mode = :unknown
+    end
+  end
+
+  def test_checksum_strict
+    file = corrupt_second_chunk
+    file.checksum_mode = :strict
+    yielded = 0
+    error = assert_raise(Winevt::EventLog::File::Error) do
+      file.each { yielded += 1 }
+    end
+    assert_equal("Chunk 1 has an invalid records checksum", error.message)
+    assert_operator(yielded, :>, 0)
+    # Workers check checksums in parallel, but do not yield the records
+    # after the corrupted chunk either.
+    file.workers = 4
+    [true, false].each do |ordered|
+      file.ordered = ordered
+      yielded_by_workers = 0
+      error = assert_raise(Winevt::EventLog::File::Error) do
+        file.each { yielded_by_workers += 1 }
+      end
+      assert_equal(["Chunk 1 has an invalid records checksum", yielded],
+                   [error.message, yielded_by_workers])
+    end
+  end
+
+  def test_checksum_warn
+    file = corrupt_second_chunk
+    count = nil
+    warnings = capture_warnings do
+      count = file.each.count
+    end
+    assert_operator(count, :<, 1000)
+    assert_equal(["Chunk 1 has an invalid records checksum"], warnings)
+    file.workers = 2
+    warnings = capture_warnings do
+      assert_equal(count, file.each.count)
+    end
+    assert_equal(["Chunk 1 has an invalid records checksum"], warnings)
+    buffered = Winevt::EventLog::File.new(@path, false)
+    buffered.workers = 2
+    warnings = capture_warnings do
+      assert_equal(count, buffered.each.count)
+    end
+    assert_equal(["Chunk 1 has an invalid records checksum"], warnings)
+  end
+
+  def test_checksum_skip
+    file = corrupt_second_chunk
+    file.checksum_mode = :skip
+    warnings = capture_warnings do
+      assert_equal(1000, file.each.count)
+    end
+    assert_equal([], warnings)
+  end
+
+  def test_checksum_file_header
+    write_events
+    data = File.binread(@path)
+    data[124, 4] = [0].pack("V")
+    File.binwrite(@path, data)
+    file = Winevt::EventLog::File.new(@path)
+    warnings = capture_warnings do
+      assert_equal(1, file.each.count)
+    end
+    assert_equal(["The file header has an invalid checksum"], warnings)
+  end
+end
@@ -0,0 +1,751 @@
+# coding: utf-8
+require "helper"
+require "json"
+require "stringio"
+
+class FakeBackendTest < Test::Unit::TestCase
+  def self.fake_backend?
+    Winevt::EventLog.respond_to?(:backend) && Winevt::EventLog.backend == "fake"
+  end
+
+  def setup
+    omit("The fake backend is not used") unless self.class.fake_backend?
+    Winevt::EventLog::FakeBackend.reset(20)
+  end
+
+  def teardown
+    Winevt::EventLog::FakeBackend.reset if self.class.fake_backend?
+  end
+
+  def record_ids(source)
+    ids = []
+    source.each do |eventlog, _message, _string_inserts|
+      ids << eventlog["EventRecordID"].to_i
+    end
+    ids
+  end
+
+  # Reads the messages of an Arrow IPC stream into the field names of the
+  # schema and the lengths of the record batches.
+  def read_arrow_stream(data)
+    messages = []
+    position = 0
+    loop do
+      marker, size = data.unpack("@#{position}L<L<")
+      assert_equal(0xffffffff, marker)
+      position += 8
+      break if size == 0
+      metadata = data.byteslice(position, size)
+      message = flat_root(metadata)
+      header = flat_table(metadata, message, 2)
+      case flat_field(metadata, message, 1, "C")
+      when 1
+        fields = flat_table(metadata, header, 1)
+        messages << flat_vector(metadata, fields).collect do |field|
+          flat_string(metadata, flat_table(metadata, field, 0))
+        end
+      when 3
+        messages << flat_field(metadata, header, 0, "q<")
+      end
+      position += size + flat_field(metadata, message, 3, "q<")
+    end
+    assert_equal(data.bytesize, position)
+    messages
+  end
+
+  # Records the strings written to it.
+  class WriteRecorder
+    attr_reader :writes
+
+    def initialize
+      @writes = []
+    end
+
+    def write(string)
+      @writes << string
+      string.bytesize
+    end
+  end
+
+  # Reads the MessagePack objects of data, which are the types that
+  # #each_batch(format: :msgpack) writes.
+  def unpack_msgpack(data)
+    objects = []
+    position = 0
+    read = lambda do
+      type = data.getbyte(position)
+      position += 1
+      read_big_endian = lambda do |size|
+        value = data.byteslice(position, size).bytes.inject(0) {|n, byte| n << 8 | byte }
+        position += size
+        value
+      end
+      read_string = lambda do |length|
+        string = data.byteslice(position, length).force_encoding("UTF-8")
+        position += length
+        string
+      end
+      case type
+      when 0x00..0x7f then type
+      when 0x80..0x8f then Array.new(type & 0x0f) { [read.call, read.call] }.to_h
+      when 0x90..0x9f then Array.new(type & 0x0f) { read.call }
+      when 0xa0..0xbf then read_string.call(type & 0x1f)
+      when 0xc0 then nil
+      when 0xc2 then false
+      when 0xc3 then true
+      when 0xcc..0xcf then read_big_endian.call(1 << (type - 0xcc))
+      when 0xd0..0xd3
+        size = 1 << (type - 0xd0)
+        value = read_big_endian.call(size)
+        value >= 1 << (size * 8 - 1) ? value - (1 << (size * 8)) : value
+      when 0xd9..0xdb then read_string.call(read_big_endian.call(1 << (type - 0xd9)))
+      when 0xdc, 0xdd then Array.new(read_big_endian.call(type == 0xdc ? 2 : 4)) { read.call }
+      when 0xde, 0xdf
+        Array.new(read_big_endian.call(type == 0xde ? 2 : 4)) { [read.call, read.call] }.to_h
+      when 0xe0..0xff then type - 0x100
+      else flunk("Unexpected MessagePack type: 0x%02x" % type)
+      end
+    end
+    objects << read.call while position < data.bytesize
+    objects
+  end
+
+  def flat_root(buffer)
+    buffer.unpack1("L<")
+  end
+
+  def flat_field(buffer, table, slot, format)
+    vtable = table - buffer.unpack1("@#{table}l<")
+    offset = buffer.unpack1("@#{vtable + 4 + slot * 2}S<")
+    offset == 0 ? 0 : buffer.unpack1("@#{table + offset}#{format}")
+  end
+
+  def flat_table(buffer, table, slot)
+    vtable = table - buffer.unpack1("@#{table}l<")
+    position = table + buffer.unpack1("@#{vtable + 4 + slot * 2}S<")
+    position + buffer.unpack1("@#{position}L<")
+  end
+
+  def flat_vector(buffer, vector)
+    (0...buffer.unpack1("@#{vector}L<")).collect do |i|
+      position = vector + 4 + i * 4
+      position + buffer.unpack1("@#{position}L<")
+    end
+  end
+
+  def flat_string(buffer, string)
+    buffer.byteslice(string + 4, buffer.unpack1("@#{string}L<")).force_encoding("UTF-8")
+  end
+
+  class QueryTest < self
+    def test_each
+      query = Winevt::EventLog::Query.new("Application", "*")
+      query.render_as_xml = false
+      assert_equal((1..20).to_a, record_ids(query))
+    end
+
+    def test_reverse
+      query = Winevt::EventLog::Query.new("Application", "*", nil,
+                                          Winevt::EventLog::Query::Flag::ChannelPath |
+                                          Winevt::EventLog::Query::Flag::ReverseDirection)
+      query.render_as_xml = false
+      assert_equal(20.downto(1).to_a, record_ids(query))
+    end
+
+    def test_event
+      query = Winevt::EventLog::Query.new("System", "*")
+      query.render_as_xml = false
+      query.each do |eventlog, message, string_inserts|
+        assert_equal({
+                       "ProviderName" => "Winevt-Fake",
+                       "EventID" => 1001,
+                       "Level" => 3,
+                       "Channel" => "System",
+                       "UserID" => "S-1-5-18",
+                       "User" => "NT AUTHORITY\\SYSTEM",
+                     },
+                     eventlog.slice("ProviderName", "EventID", "Level", "Channel",
+                                    "UserID", "User"))
+        assert_equal("Fake event 1 was written to System.\r\n\r\nValue: value 1", message)
+        assert_equal(["value 1", 1, "0x0000000000010001", true,
+                      "{00000001-1B2C-4D3E-8F4A-5B6C7D8E9FA0}", "S-1-5-18",
+                      "0100000000000000"],
+                     string_inserts[0, 7])
+        break
+      end
+    end
+
+    def test_typed_values
+      query = Winevt::EventLog::Query.new("System", "*")
+      query.render_as_xml = false
+      query.typed_values = true
+      assert_true(query.typed_values?)
+      query.each do |eventlog, _message, string_inserts|
+        time = Time.utc(2024, 1, 1, 0, 0, 1) + Rational(1234, 10_000_000)
+        assert_equal({
+                       "Keywords" => 0x80000000000000,
+                       "TimeCreated" => time,
+                       "EventRecordID" => 1,
+                     },
+                     eventlog.slice("Keywords", "TimeCreated", "EventRecordID"))
+        assert_true(eventlog["TimeCreated"].utc?)
+        assert_equal(123400, eventlog["TimeCreated"].nsec)
+        assert_equal([1, 0x10001, true], string_inserts.values_at(1, 2, 3))
+        assert_equal("\x01\x00\x00\x00\x00\x00\x00\x00".b, string_inserts[6])
+        assert_equal(Encoding::ASCII_8BIT, string_inserts[6].encoding)
+        assert_equal(time, string_inserts[7])
+        break
+      end
+    end
+
+    def test_message_not_found
+      query = Winevt::EventLog::Query.new("Application", "*")
+      messages = []
+      query.each do |_xml, message, _string_inserts|
+        messages << message
+      end
+      assert_equal("Fake event 9 was written to Application.\r\n\r\nValue: value 9", messages[8])
+      assert_match(/message was not found/, messages[9])
+    end
+
+    def test_each_batch
+      query = Winevt::EventLog::Query.new("System", "*")
+      query.render_as_xml = false
+      query.batch_size = 8
+      batches = query.each_batch.to_a
+      assert_equal([8, 8, 4], batches.collect {|batch| batch["EventRecordID"].size })
+      batch = batches.first
+      assert_equal(["1", "2", "3"], batch["EventRecordID"].first(3))
+      assert_equal((1001..1008).to_a, batch["EventID"])
+      # Events whose SID is not mapped have no User.
+      assert_equal(["NT AUTHORITY\\SYSTEM", "NT AUTHORITY\\SYSTEM", nil],
+                   batch["User"].first(3))
+      assert_equal("Fake event 1 was written to System.\r\n\r\nValue: value 1",
+                   batch["Message"][0])
+      assert_equal("value 2", batch["StringInserts"][1][0])
+      assert_false(batch.key?("XML"))
+      assert_equal(batch.values.collect(&:size).uniq, [8])
+
+      # Columns are the values which #each yields.
+      query = Winevt::EventLog::Query.new("System", "*")
+      query.render_as_xml = false
+      events = query.each.collect {|eventlog, _message, _string_inserts| eventlog }
+      keys = events.flat_map(&:keys).uniq
+      assert_equal(keys.sort, (batch.keys - ["Message", "StringInserts"]).sort)
+      keys.each do |key|
+        assert_equal(events.collect {|eventlog| eventlog[key] },
+                     batches.flat_map {|columns| columns[key] },
+                     key)
+      end
+    end
+
+    def test_each_batch_with_max
+      query = Winevt::EventLog::Query.new("Application", "*")
+      query.render_as_xml = false
+      query.batch_size = 8
+      query.fields = [:system]
+      query.symbolize_keys = true
+      record_ids = []
+      query.each_batch(max: 3) do |batch|
+        assert_equal([:EventRecordID], batch.keys & [:EventRecordID, :Message, :StringInserts])
+        record_ids << batch[:EventRecordID].collect(&:to_i)
+      end
+      assert_equal([[1, 2, 3], [4, 5, 6], [7, 8], [9, 10, 11], [12, 13, 14], [15, 16],
+                    [17, 18, 19], [20]],
+                   record_ids)
+      assert_raise(ArgumentError) do
+        query.each_batch(max: 0) {}
+      end
+    end
+
+    def test_each_batch_xml
+      query = Winevt::EventLog::Query.new("Application", "*")
+      query.fields = [:xml, :inserts]
+      batch = query.each_batch.first
+      assert_equal(["XML", "StringInserts"], batch.keys)
+      assert_match(/<EventRecordID>1<\/EventRecordID>/, batch["XML"][0])
+    end
+
+    def test_each_batch_msgpack
+      query = Winevt::EventLog::Query.new("System", "*")
+      query.render_as_xml = false
+      query.preserve_qualifiers = true
+      query.batch_size = 8
+      batches = query.each_batch(format: :msgpack, max: 3).to_a
+      assert_equal([Encoding::ASCII_8BIT], batches.collect(&:encoding).uniq)
+      events = batches.collect {|batch| unpack_msgpack(batch) }
+      assert_equal([3, 3, 2, 3, 3, 2, 3, 1], events.collect(&:size))
+
+      # Events are the values which #each yields.
+      query = Winevt::EventLog::Query.new("System", "*")
+      query.render_as_xml = false
+      query.preserve_qualifiers = true
+      expected = query.each.collect do |eventlog, message, string_inserts|
+        eventlog.merge("Message" => message, "StringInserts" => string_inserts)
+      end
+      assert_equal(expected, events.flatten(1))
+      assert_equal(expected[0].keys, events[0][0].keys)
+    end
+
+    def test_each_batch_msgpack_fields
+      query = Winevt::EventLog::Query.new("Application", "*")
+      query.fields = [:xml, :inserts]
+      event = unpack_msgpack(query.each_batch(format: :msgpack).first).first
+      assert_equal(["XML", "StringInserts"], event.keys)
+      assert_match(/<EventRecordID>1<\/EventRecordID>/, event["XML"])
+
+      query.fields = [:message]
+      event = unpack_msgpack(query.each_batch(format: :msgpack).first).first
+      assert_equal(["Message"], event.keys)
+      assert_raise(ArgumentError) do
+        query.each_batch(format: :json) {}
+      end
+    end
+
+    def test_write_json
+      query = Winevt::EventLog::Query.new("System", "*")
+      query.render_as_xml = false
+      query.batch_size = 8
+      io = WriteRecorder.new
+      assert_equal(20, query.write_json(io))
+      # The lines of a batch are written at once.
+      assert_equal([8, 8, 4], io.writes.collect {|lines| lines.lines.size })
+      assert_equal([Encoding::UTF_8], io.writes.collect(&:encoding).uniq)
+
+      query = Winevt::EventLog::Query.new("System", "*")
+      query.render_as_xml = false
+      expected = query.each.collect do |eventlog, message, string_inserts|
+        eventlog.merge("Message" => message, "StringInserts" => string_inserts)
+      end
+      events = io.writes.join.lines.collect {|line| JSON.parse(line) }
+      assert_equal(expected, events)
+      assert_equal(expected[0].keys, events[0].keys)
+    end
+
+    def test_write_json_fields
+      query = Winevt::EventLog::Query.new("Application", "*")
+      query.fields = [:xml, :message]
+      io = StringIO.new
+      assert_equal(20, query.write_json(io))
+      event = JSON.parse(io.string.lines.first)
+      assert_equal(["XML", "Message"], event.keys)
+      assert_match(/<EventRecordID>1<\/EventRecordID>/, event["XML"])
+    end
+
+    def test_write_arrow
+      query = Winevt::EventLog::Query.new("System", "*")
+      query.render_as_xml = false
+      query.batch_size = 8
+      io = StringIO.new("".b)
+      assert_equal(20, query.write_arrow(io))
+      schema, *lengths = read_arrow_stream(io.string)
+      assert_equal(["ProviderName", "ProviderGuid", "EventID", "Version", "Level", "Task",
+                    "Opcode", "Keywords", "TimeCreated", "EventRecordID", "ActivityID",
+                    "RelatedActivityID", "ProcessID", "ThreadID", "Channel", "Computer",
+                    "UserID", "User", "Message", "StringInserts"],
+                   schema)
+      # A record batch is written for each batch of events by default.
+      assert_equal([8, 8, 4], lengths)
+      assert_include(io.string, "Fake event 1 was written to System.")
+    end
+
+    def test_write_arrow_with_rows
+      query = Winevt::EventLog::Query.new("Application", "*")
+      query.batch_size = 8
+      query.fields = [:xml, :inserts]
+      io = StringIO.new("".b)
+      assert_equal(20, query.write_arrow(io, rows: 6))
+      assert_equal([["XML", "StringInserts"], 6, 6, 6, 2], read_arrow_stream(io.string))
+      assert_raise(ArgumentError) do
+        query.write_arrow(StringIO.new, rows: 0)
+      end
+    end
+
+    def test_seek_with_bookmark
+      bookmark = Winevt::EventLog::Bookmark.new
+      query = Winevt::EventLog::Query.new("Application", "*")
+      query.batch_size = 5
+      query.next
+      bookmark.update(query)
+
+      query = Winevt::EventLog::Query.new("Application", "*")
+      query.render_as_xml = false
+      query.offset = 1
+      assert_true(query.seek(bookmark))
+      assert_equal((6..20).to_a, record_ids(query))
+    end
+
+    def test_stats_disabled
+      query = Winevt::EventLog::Query.new("Application", "*")
+      record_ids(query)
+      assert_false(query.collect_stats?)
+      assert_equal([0, 0, 0],
+                   query.stats.values_at("events", "batches", "render_nsec"))
+    end
+
+    def test_stats
+      query = Winevt::EventLog::Query.new("Application", "*")
+      query.collect_stats = true
+      query.batch_size = 8
+      query.render_as_xml = false
+      record_ids(query)
+      stats = query.stats
+      assert_equal([20, 3], stats.values_at("events", "batches"))
+      assert_true(stats["rendered_bytes"] > 0)
+      assert_true(stats["next_nsec"] > 0)
+      assert_true(stats["render_nsec"] > 0)
+      assert_true(stats["sid_lookup_nsec"] > 0)
+      assert_equal(0.95, stats["publisher_cache"]["hit_rate"])
+
+      query.reset_stats
+      assert_true(query.collect_stats?)
+      assert_equal([0, 0], query.stats.values_at("events", "batches"))
+    end
+
+    def test_render_contexts
+      Winevt::EventLog::FakeBackend.reset(500)
+      query = Winevt::EventLog::Query.new("System", "*")
+      query.render_as_xml = false
+      # System, user and provider name contexts.
+      assert_equal(3, Winevt::EventLog::FakeBackend.calls["create_render_context"])
+      assert_equal(500, record_ids(query).size)
+      query.seek(:first)
+      assert_equal(500, query.write_json(StringIO.new))
+      assert_equal(3, Winevt::EventLog::FakeBackend.calls["create_render_context"])
+    end
+
+    def read_with_latency
+      query = Winevt::EventLog::Query.new("Application", "*")
+      query.render_as_xml = false
+      query.batch_size = 10
+      record_ids(query)
+    end
+
+    def test_threads
+      # Two batches and the end of them take 300 milliseconds.
+      Winevt::EventLog::FakeBackend.next_latency = 100
+      start = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+      assert_equal((1..20).to_a, read_with_latency)
+      single = Process.clock_gettime(Process::CLOCK_MONOTONIC) - start
+
+      start = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+      threads = 4.times.collect { Thread.new { read_with_latency } }
+      assert_equal([(1..20).to_a] * 4, threads.collect(&:value))
+      elapsed = Process.clock_gettime(Process::CLOCK_MONOTONIC) - start
+      # The threads wait for EvtNext at the same time.
+      assert_operator(elapsed, :<, single * 2)
+    end
+
+    def wait_for_next(thread)
+      Thread.pass until thread.status == "sleep" || !thread.alive?
+    end
+
+    def test_wakeup_while_waiting_for_next
+      Winevt::EventLog::FakeBackend.next_latency = 300
+      thread = Thread.new { read_with_latency }
+      wait_for_next(thread)
+      3.times do
+        sleep(0.05)
+        thread.wakeup
+      end
+      assert_equal((1..20).to_a, thread.value)
+    end
+
+    def test_rescued_raise_while_waiting_for_next
+      Winevt::EventLog::FakeBackend.next_latency = 300
+      query = Winevt::EventLog::Query.new("Application", "*")
+      query.render_as_xml = false
+      query.batch_size = 10
+      thread = Thread.new do
+        begin
+          record_ids(query)
+        rescue Interrupt
+          # The query goes on from where it was interrupted.
+          record_ids(query)
+        end
+      end
+      wait_for_next(thread)
+      thread.raise(Interrupt)
+      assert_equal((1..20).to_a, thread.value)
+    end
+
+    # Raises in EvtNext of source after it has returned events, while
+    # the handles of held_batches batches before are still held.
+    def raise_after_next(source, held_batches)
+      Winevt::EventLog::FakeBackend.next_latency = 50
+      ready = Queue.new
+      thread = Thread.new do
+        held_batches.times { source.next }
+        ready << true
+        begin
+          source.next
+        rescue Interrupt
+        end
+        record_ids(source)
+      end
+      ready.pop
+      wait_for_next(thread)
+      # EvtNext returns the events in its first wait of 100 milliseconds.
+      sleep(0.02)
+      thread.raise(Interrupt)
+      thread.join
+      source.close
+      Winevt::EventLog::FakeBackend.calls
+    end
+
+    def test_rescued_raise_after_next
+      [0, 1].each do |held_batches|
+        Winevt::EventLog::FakeBackend.reset(20)
+        query = Winevt::EventLog::Query.new("Application", "*")
+        query.render_as_xml = false
+        query.batch_size = 5
+        calls = raise_after_next(query, held_batches)
+        assert_equal([20, 20, 0],
+                     calls.values_at("next_event", "close_event", "invalid_close"))
+      end
+    end
+
+    def test_rescued_raise_after_next_of_subscribe
+      [0, 1].each do |held_batches|
+        Winevt::EventLog::FakeBackend.reset(20)
+        subscribe = Winevt::EventLog::Subscribe.new
+        subscribe.render_as_xml = false
+        subscribe.subscribe("Setup", "*")
+        calls = raise_after_next(subscribe, held_batches)
+        assert_equal([20, 20, 0],
+                     calls.values_at("next_event", "close_event", "invalid_close"))
+      end
+    end
+
+    def sid_lookups
+      Winevt::EventLog::FakeBackend.calls["lookup_account_sid"]
+    end
+
+    def test_sid_cache
+      Winevt::EventLog::FakeBackend.reset(6)
+      query = Winevt::EventLog::Query.new("System", "*")
+      query.render_as_xml = false
+      users = query.each.collect {|eventlog, _message, _string_inserts| eventlog["User"] }
+      assert_equal(["NT AUTHORITY\\SYSTEM", "NT AUTHORITY\\SYSTEM", nil,
+                    "NT AUTHORITY\\SYSTEM", "NT AUTHORITY\\LOCAL SERVICE", nil],
+                   users)
+      # The unmapped SID is looked up once, too.
+      assert_equal(3, sid_lookups)
+      assert_equal([3, 2, 1, 3],
+                   query.sid_cache_stats.values_at("misses", "hits", "negative_hits", "size"))
+    end
+
+    def test_sid_cache_eviction_order
+      Winevt::EventLog::FakeBackend.reset(6)
+      query = Winevt::EventLog::Query.new("System", "*")
+      query.render_as_xml = false
+      query.sid_cache_capacity = 2
+      record_ids(query)
+      # SYSTEM, SYSTEM, unmapped, SYSTEM, LOCAL SERVICE and unmapped. The
+      # fourth event makes SYSTEM the most recently used one, so
+      # LOCAL SERVICE evicts the unmapped SID, which is looked up again.
+      assert_equal(4, sid_lookups)
+      assert_equal([2, 2], query.sid_cache_stats.values_at("evictions", "size"))
+    end
+
+    def test_sid_cache_capacity
+      Winevt::EventLog::FakeBackend.reset(6)
+      query = Winevt::EventLog::Query.new("System", "*")
+      query.render_as_xml = false
+      record_ids(query)
+      assert_equal(3, sid_lookups)
+
+      # Shrinking keeps the most recently used SID, which is the last one.
+      query.sid_cache_capacity = 1
+      assert_equal([2, 1], query.sid_cache_stats.values_at("evictions", "size"))
+      query.seek(:last)
+      assert_equal([6], record_ids(query))
+      assert_equal(3, sid_lookups)
+      query.seek(:first)
+      record_ids(query)
+      assert_equal(8, sid_lookups)
+
+      query.sid_cache_capacity = 0
+      query.seek(:first)
+      record_ids(query)
+      assert_equal(14, sid_lookups)
+      assert_equal(0, query.sid_cache_stats["size"])
+    end
+
+    def test_sid_cache_ttl
+      Winevt::EventLog::FakeBackend.reset(3)
+      query = Winevt::EventLog::Query.new("System", "*")
+      query.render_as_xml = false
+      query.sid_cache_ttl = 60
+      query.sid_cache_negative_ttl = 5
+      record_ids(query)
+      assert_equal(2, sid_lookups)
+
+      # Only the negative entry of the unmapped SID has expired.
+      Winevt::EventLog::FakeBackend.advance_clock(10)
+      query.seek(:first)
+      record_ids(query)
+      assert_equal(3, sid_lookups)
+      assert_equal(1, query.sid_cache_stats["expirations"])
+
+      Winevt::EventLog::FakeBackend.advance_clock(60)
+      query.seek(:first)
+      record_ids(query)
+      assert_equal(5, sid_lookups)
+      assert_equal(3, query.sid_cache_stats["expirations"])
+    end
+
+    def test_channel_not_found
+      assert_raise(Winevt::EventLog::ChannelNotFoundError) do
+        Winevt::EventLog::Query.new("Nonexistent", "*")
+      end
+    end
+  end
+
+  class SubscribeTest < self
+    def test_write
+      subscribe = Winevt::EventLog::Subscribe.new
+      subscribe.read_existing_events = false
+      subscribe.render_as_xml = false
+      subscribe.subscribe("Application", "*")
+      assert_equal([], record_ids(subscribe))
+
+      Winevt::EventLog::FakeBackend.write("Application", 3)
+      assert_equal([21, 22, 23], record_ids(subscribe))
+    end
+
+    def test_read_existing_events
+      subscribe = Winevt::EventLog::Subscribe.new
+      subscribe.render_as_xml = false
+      subscribe.subscribe("Setup", "*")
+      assert_equal((1..20).to_a, record_ids(subscribe))
+    end
+
+    def test_subscribe_with_bookmark
+      bookmark = Winevt::EventLog::Bookmark.new
+      query = Winevt::EventLog::Query.new("Application", "*")
+      query.batch_size = 15
+      query.next
+      bookmark.update(query)
+
+      subscribe = Winevt::EventLog::Subscribe.new
+      subscribe.render_as_xml = false
+      subscribe.subscribe("Application", "*", bookmark)
+      assert_equal((16..20).to_a, record_ids(subscribe))
+    end
+
+    def test_render_contexts
+      subscribe = Winevt::EventLog::Subscribe.new
+      subscribe.render_as_xml = false
+      subscribe.subscribe("Setup", "*")
+      assert_equal(3, Winevt::EventLog::FakeBackend.calls["create_render_context"])
+      assert_equal(20, record_ids(subscribe).size)
+      Winevt::EventLog::FakeBackend.write("Setup", 480)
+      assert_equal(480, record_ids(subscribe).size)
+      assert_equal(3, Winevt::EventLog::FakeBackend.calls["create_render_context"])
+    end
+
+    def test_stats
+      subscribe = Winevt::EventLog::Subscribe.new
+      subscribe.collect_stats = true
+      subscribe.render_as_xml = false
+      subscribe.subscribe("Setup", "*")
+      record_ids(subscribe)
+      stats = subscribe.stats
+      assert_equal(20, stats["events"])
+      assert_true(stats["format_message_nsec"] > 0)
+      assert_true(stats["yield_nsec"] > 0)
+    end
+
+    def test_each_batch
+      subscribe = Winevt::EventLog::Subscribe.new
+      subscribe.collect_stats = true
+      subscribe.render_as_xml = false
+      subscribe.typed_values = true
+      subscribe.subscribe("Setup", "*")
+      record_ids = []
+      subscribe.each_batch(max: 4) do |batch|
+        record_ids << batch["EventRecordID"]
+        assert_kind_of(Time, batch["TimeCreated"][0])
+      end
+      # Subscribe fetches 10 events at a time.
+      assert_equal([[1, 2, 3, 4], [5, 6, 7, 8], [9, 10], [11, 12, 13, 14], [15, 16, 17, 18],
+                    [19, 20]],
+                   record_ids)
+      assert_equal(20, subscribe.stats["events"])
+    end
+
+    def test_each_batch_msgpack
+      subscribe = Winevt::EventLog::Subscribe.new
+      subscribe.render_as_xml = false
+      subscribe.preserve_sid = false
+      subscribe.subscribe("Setup", "*")
+      events = subscribe.each_batch(format: :msgpack).flat_map {|batch| unpack_msgpack(batch) }
+      assert_equal((1..20).collect(&:to_s), events.collect {|event| event["EventRecordID"] })
+      assert_false(events[0].key?("UserID"))
+      assert_equal(["value 1", 1, "0x0000000000010001", true],
+                   events[0]["StringInserts"].first(4))
+    end
+
+    def test_write_json
+      subscribe = Winevt::EventLog::Subscribe.new
+      subscribe.render_as_xml = false
+      subscribe.fields = [:system, :inserts]
+      subscribe.subscribe("Setup", "*")
+      io = WriteRecorder.new
+      assert_equal(20, subscribe.write_json(io))
+      # Subscribe fetches 10 events at a time.
+      assert_equal(2, io.writes.size)
+      events = io.writes.join.lines.collect {|line| JSON.parse(line) }
+      assert_equal((1..20).collect(&:to_s), events.collect {|event| event["EventRecordID"] })
+      assert_false(events[0].key?("Message"))
+      assert_equal(["value 1", 1, "0x0000000000010001", true],
+                   events[0]["StringInserts"].first(4))
+    end
+
+    def test_write_arrow
+      subscribe = Winevt::EventLog::Subscribe.new
+      subscribe.render_as_xml = false
+      subscribe.fields = [:system]
+      subscribe.subscribe("Setup", "*")
+      io = StringIO.new("".b)
+      assert_equal(20, subscribe.write_arrow(io, rows: 7))
+      schema, *lengths = read_arrow_stream(io.string)
+      assert_equal("EventRecordID", schema[9])
+      assert_equal([7, 7, 6], lengths)
+    end
+
+    def test_typed_values
+      subscribe = Winevt::EventLog::Subscribe.new
+      subscribe.render_as_xml = false
+      subscribe.typed_values = true
+      subscribe.subscribe("Application", "*")
+      subscribe.each do |eventlog, _message, string_inserts|
+        assert_equal(1, eventlog["EventRecordID"])
+        assert_kind_of(Time, eventlog["TimeCreated"])
+        assert_equal(0x10001, string_inserts[2])
+        break
+      end
+    end
+
+    def test_write_to_unknown_channel
+      assert_raise(Winevt::EventLog::ChannelNotFoundError) do
+        Winevt::EventLog::FakeBackend.write("Nonexistent")
+      end
+    end
+  end
+
+  class ChannelTest < self
+    def test_each
+      channel = Winevt::EventLog::Channel.new
+      assert_equal(["Application", "Security", "Setup", "System"],
+                   channel.each.to_a.sort)
+    end
+
+    def test_force_enumerate
+      channel = Winevt::EventLog::Channel.new
+      channel.force_enumerate = true
+      assert_include(channel.each.to_a, "Winevt-Fake/Debug")
+    end
+  end
+end
@@ -0,0 +1,66 @@
+require "helper"
+require "open3"
+require "rbconfig"
+require "shellwords"
+require "tmpdir"
+
+# Builds and runs the programs under test/native, which check the
+# encoders of ext/winevt which do not depend on Windows or Ruby, such as
+# winevt_utf16.h. Each program prints the checks which failed and exits
+# with failure.
+class NativeTest < Test::Unit::TestCase
+  NATIVE_DIR = File.expand_path("native", __dir__)
+  EXT_DIR = File.expand_path("../ext/winevt", __dir__)
+
+  def setup
+    @dir = Dir.mktmpdir("winevt")
+  end
+
+  def teardown
+    FileUtils.rm_rf(@dir)
+  end
+
+  def run_native(name)
+    cxx = Shellwords.split(RbConfig::CONFIG["CXX"].to_s)
+    omit("needs a C++ compiler which takes GCC options") if cxx.empty? || cxx.first =~ /\Acl(\.exe)?\z/i
+    program = File.join(@dir, name + RbConfig::CONFIG["EXEEXT"].to_s)
+    output, status = Open3.capture2e(*cxx, "-O2", "-std=c++11", "-Wall", "-I#{EXT_DIR}",
+                                     "-o", program, File.join(NATIVE_DIR, "#{name}.cpp"))
+    assert_true(status.success?, output)
+    output, status = Open3.capture2e(program)
+    # The first failures are enough, and they may have invalid UTF-8.
+    assert_true(status.success?, output.force_encoding(Encoding::UTF_8).scrub.lines.first(20).join)
+  end
+
+  def test_utf16
+    run_native("test_utf16")
+  end
+
+  def test_crc32
+    run_native("test_crc32")
+  end
+
+  def test_hex
+    run_native("test_hex")
+  end
+
+  def test_format
+    run_native("test_format")
+  end
+
+  def test_arrow
+    run_native("test_arrow")
+  end
+
+  def test_msgpack
+    run_native("test_msgpack")
+  end
+
+  def test_json
+    run_native("test_json")
+  end
+
+  def test_sid_cache
+    run_native("test_sid_cache")
+  end
+end
@@ -58,6 +58,18 @@ class WinevtTest < Test::Unit::TestCase
       end
     end
 
+    def test_each_across_batches_without_xml
+      @query.render_as_xml = false
+      count = 0
+      @query.each do |eventlog, message, string_inserts|
+        assert_kind_of(Hash, eventlog)
+        assert_kind_of(String, message)
+        assert_kind_of(Array, string_inserts)
+        count += 1
+        break if count >= 25
+      end
+    end
+
     data("first symbol" => [true, :first],
          "first string" => [true, "first"],
          "last symbol" => [true, :last],
@@ -86,6 +98,74 @@ class WinevtTest < Test::Unit::TestCase
       assert_true(@query.preserve_qualifiers?)
     end
 
+    def test_system_event_keys
+      @query.render_as_xml = false
+      keys = []
+      @query.each do |eventlog, message, string_inserts|
+        keys << eventlog.keys.find {|key| key == "ProviderName"}
+        break if keys.size >= 2
+      end
+      assert_true(keys.all?(&:frozen?))
+      assert_same(keys[0], keys[1])
+    end
+
+    def test_fields
+      assert_nil(@query.fields)
+      @query.fields = [:xml]
+      assert_equal([:xml], @query.fields)
+      @query.each do |xml, message, string_inserts|
+        assert_kind_of(String, xml)
+        assert_nil(message)
+        assert_nil(string_inserts)
+        break
+      end
+
+      @query.fields = ["system", "inserts"]
+      assert_equal([:system, :inserts], @query.fields)
+      @query.each do |eventlog, message, string_inserts|
+        assert_kind_of(Hash, eventlog)
+        assert_nil(message)
+        assert_kind_of(Array, string_inserts)
+        break
+      end
+
+      @query.fields = nil
+      assert_nil(@query.fields)
+    end
+
+    data("unknown" => [:unknown],
+         "empty" => [],
+         "xml and system" => [:xml, :system])
+    def test_invalid_fields(data)
+      assert_raise(ArgumentError) do
+        @query.fields = data
+      end
+    end
+
+    def test_symbolize_keys
+      assert_false(@query.symbolize_keys?)
+      @query.symbolize_keys = true
+      assert_true(@query.symbolize_keys?)
+      @query.render_as_xml = false
+      @query.each do |eventlog, message, string_inserts|
+        assert_true(eventlog.keys.all? {|key| key.is_a?(Symbol)})
+        assert_kind_of(Integer, eventlog[:EventID])
+        break
+      end
+    end
+
+    def test_typed_values
+      assert_false(@query.typed_values?)
+      @query.typed_values = true
+      assert_true(@query.typed_values?)
+      @query.render_as_xml = false
+      @query.each do |eventlog, message, string_inserts|
+        assert_kind_of(Time, eventlog["TimeCreated"])
+        assert_kind_of(Integer, eventlog["EventRecordID"])
+        break
+      end
+    end
+
     data("Japanese"                       => "ja_JP",
          "Italian (Italy)"                => "it_IT",
          "English (United States)"        => "en_US",
@@ -113,6 +193,139 @@ class WinevtTest < Test::Unit::TestCase
         @query.locale = "ex_EX" # Invalid Locale
       end
     end
+
+    data("minimum" => 1,
+         "default" => 10,
+         "maximum" => 1024)
+    def test_batch_size(data)
+      assert_equal(10, @query.batch_size)
+      @query.batch_size = data
+      assert_equal(data, @query.batch_size)
+      assert_true(@query.next)
+    end
+
+    def test_invalid_batch_size
+      assert_raise(ArgumentError) do
+        @query.batch_size = 0
+      end
+      assert_raise(ArgumentError) do
+        @query.batch_size = 1025
+      end
+    end
+
+    def test_each_with_large_batch_size
+      @query.batch_size = 512
+      @query.render_as_xml = false
+      count = 0
+      @query.each do |eventlog, message, string_inserts|
+        assert_kind_of(Hash, eventlog)
+        count += 1
+        break if count >= 600
+      end
+    end
+
+    def test_each_in_threads
+      threads = 4.times.map do
+        Thread.new do
+          query = Winevt::EventLog::Query.new("Application", "*")
+          count = 0
+          query.each do |xml, message, string_inserts|
+            count += 1
+            break if count >= 50
+          end
+          count
+        end
+      end
+      threads.each do |thread|
+        assert_true(thread.value > 0)
+      end
+    end
+
+    def test_kill_thread_while_each
+      thread = Thread.new do
+        @query.each do |xml, message, string_inserts|
+          sleep 0.01
+        end
+      end
+      sleep 0.1
+      thread.kill
+      assert_not_nil(thread.join(5))
+    end
+
+    def test_publisher_cache
+      assert_equal(256, @query.publisher_cache_capacity)
+      count = 0
+      @query.each do |xml, message, string_inserts|
+        count += 1
+        break if count >= 20
+      end
+      stats = @query.publisher_cache_stats
+      assert_equal(count, stats["hits"] + stats["misses"])
+      assert_true(stats["size"] <= stats["capacity"])
+
+      @query.publisher_cache_capacity = 0
+      assert_equal(0, @query.publisher_cache_stats["size"])
+      assert_raise(ArgumentError) do
+        @query.publisher_cache_capacity = -1
+      end
+    end
+
+    def test_sid_cache
+      assert_equal(4096, @query.sid_cache_capacity)
+      assert_equal(600, @query.sid_cache_ttl)
+      assert_equal(60, @query.sid_cache_negative_ttl)
+      @query.sid_cache_ttl = 30
+      @query.sid_cache_negative_ttl = 5
+      assert_equal(30, @query.sid_cache_ttl)
+      assert_equal(5, @query.sid_cache_negative_ttl)
+
+      @query.render_as_xml = false
+      count = 0
+      @query.each do |eventlog, message, string_inserts|
+        count += 1
+        break if count >= 20
+      end
+      stats = @query.sid_cache_stats
+      assert_true(stats["size"] <= stats["capacity"])
+      assert_true(stats["hit_rate"].between?(0.0, 1.0))
+      assert_raise(ArgumentError) do
+        @query.sid_cache_ttl = -1
+      end
+    end
+
+    def test_caches_of_allocated_query
+      query = Winevt::EventLog::Query.allocate
+      assert_raise(RuntimeError) { query.publisher_cache_stats }
+      assert_raise(RuntimeError) { query.publisher_cache_capacity = 1 }
+      assert_raise(RuntimeError) { query.sid_cache_stats }
+      assert_raise(RuntimeError) { query.sid_cache_ttl }
+      assert_raise(RuntimeError) { query.sid_cache_negative_ttl = 1 }
+    end
+
+    def test_each_renders_valid_utf8
+      count = 0
+      @query.each do |xml, message, string_inserts|
+        assert_equal(Encoding::UTF_8, xml.encoding)
+        assert_true(xml.valid_encoding?)
+        assert_true(message.valid_encoding?)
+        count += 1
+        break if count >= 50
+      end
+    end
+
+    def test_render_with_reused_buffers
+      results = 2.times.map do
+        query = Winevt::EventLog::Query.new("Application", "*")
+        query.render_as_xml = false
+        events = []
+        query.each do |eventlog, message, string_inserts|
+          events << [eventlog["EventRecordID"], message, string_inserts]
+          break if events.size >= 50
+        end
+        events
+      end
+      assert_equal(results[0], results[1])
+    end
   end
 
   class BookmarkTest < self
@@ -273,6 +486,27 @@ class WinevtTest < Test::Unit::TestCase
       assert_true(@subscribe.preserve_qualifiers?)
     end
 
+    def test_fields
+      assert_nil(@subscribe.fields)
+      @subscribe.fields = [:message]
+      assert_equal([:message], @subscribe.fields)
+      assert_raise(ArgumentError) do
+        @subscribe.fields = [:xml, :system]
+      end
+    end
+
+    def test_symbolize_keys
+      assert_false(@subscribe.symbolize_keys?)
+      @subscribe.symbolize_keys = true
+      assert_true(@subscribe.symbolize_keys?)
+    end
+
+    def test_typed_values
+      assert_false(@subscribe.typed_values?)
+      @subscribe.typed_values = true
+      assert_true(@subscribe.typed_values?)
+    end
+
     data("Japanese"                       => "ja_JP",
          "Italian (Italy)"                => "it_IT",
          "English (United States)"        => "en_US",
@@ -294,6 +528,36 @@ class WinevtTest < Test::Unit::TestCase
       assert_equal(data, @subscribe.locale)
     end
 
+    def test_publisher_cache_capacity
+      assert_equal(256, @subscribe.publisher_cache_capacity)
+      @subscribe.publisher_cache_capacity = 16
+      assert_equal(16, @subscribe.publisher_cache_capacity)
+      assert_equal(16, @subscribe.publisher_cache_stats["capacity"])
+    end
+
+    def test_batch_size
+      assert_equal(10, @subscribe.batch_size)
+      @subscribe.batch_size = 256
+      assert_equal(256, @subscribe.batch_size)
+      assert_true(@subscribe.next)
+      assert_raise(ArgumentError) do
+        @subscribe.batch_size = 0
+      end
+    end
+
+    def test_sid_cache_capacity
+      assert_equal(4096, @subscribe.sid_cache_capacity)
+      @subscribe.sid_cache_capacity = 0
+      assert_equal(0, @subscribe.sid_cache_stats["capacity"])
+    end
+
+    def test_caches_of_allocated_subscribe
+      subscribe = Winevt::EventLog::Subscribe.allocate
+      assert_raise(RuntimeError) { subscribe.publisher_cache_capacity }
+      assert_raise(RuntimeError) { subscribe.sid_cache_capacity = 1 }
+      assert_raise(RuntimeError) { subscribe.sid_cache_stats }
+    end
+
     def test_invalid_locale
       assert_equal("neutral", @subscribe.locale)
       assert_raise(ArgumentError) do